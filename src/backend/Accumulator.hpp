@@ -6,12 +6,53 @@ namespace nn {
 
 using AccumulatorType = int16_t;
 
+struct AccumulatorUpdateStep;
+
+#if defined(NN_USE_AVX512) || defined(NN_USE_AVX2) || defined(NN_USE_SSE2) || defined(NN_USE_ARM_NEON)
+
+// load one register of feature transformer weights
+INLINE static Int16VecType LoadAccumulatorWeights(const FirstLayerWeightType* ptr)
+{
+    return Int16VecLoad(ptr);
+}
+
+// load one register of 8-bit feature transformer weights, sign-extended and scaled to accumulator precision
+INLINE static Int16VecType LoadAccumulatorWeights(const FirstLayerInt8WeightType* ptr)
+{
+#if defined(NN_USE_AVX512)
+    const __m512i w = _mm512_cvtepi8_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(ptr)));
+    return _mm512_slli_epi16(w, InputLayerInt8WeightShift);
+#elif defined(NN_USE_AVX2)
+    const __m256i w = _mm256_cvtepi8_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(ptr)));
+    return _mm256_slli_epi16(w, InputLayerInt8WeightShift);
+#elif defined(NN_USE_SSE2)
+    // no sign extension instruction in SSE2: move bytes to upper halves and shift back arithmetically
+    const __m128i w = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ptr));
+    return _mm_srai_epi16(_mm_unpacklo_epi8(_mm_setzero_si128(), w), 8 - InputLayerInt8WeightShift);
+#elif defined(NN_USE_ARM_NEON)
+    return vshlq_n_s16(vmovl_s8(vld1_s8(ptr)), InputLayerInt8WeightShift);
+#endif
+}
+
+#endif // NN_USE_AVX512 || NN_USE_AVX2 || NN_USE_SSE2 || NN_USE_ARM_NEON
+
+INLINE static int32_t AccumulatorWeightValue(FirstLayerWeightType weight)
+{
+    return weight;
+}
+
+INLINE static int32_t AccumulatorWeightValue(FirstLayerInt8WeightType weight)
+{
+    return (int32_t)weight * (1 << InputLayerInt8WeightShift);
+}
+
 struct alignas(CACHELINE_SIZE) Accumulator
 {
     AccumulatorType values[AccumulatorSize];
 
+    template<typename WeightType>
     INLINE void Refresh(
-        const FirstLayerWeightType* weights, const FirstLayerBiasType* biases,
+        const WeightType* weights, const FirstLayerBiasType* biases,
         uint32_t numActiveFeatures, const uint16_t* activeFeatures)
     {
 #ifndef CONFIGURATION_FINAL
@@ -29,7 +70,7 @@ struct alignas(CACHELINE_SIZE) Accumulator
 
         constexpr uint32_t registerWidth = VectorRegSize / (8 * sizeof(AccumulatorType));
         static_assert(AccumulatorSize % registerWidth == 0);
-        ASSERT((size_t)weights % 32 == 0);
+        ASSERT((size_t)weights % (16 * sizeof(WeightType)) == 0);
         ASSERT((size_t)biases % 32 == 0);
         ASSERT((size_t)values % 32 == 0);
 
@@ -53,12 +94,12 @@ struct alignas(CACHELINE_SIZE) Accumulator
             for (uint32_t j = 0; j < numActiveFeatures; ++j)
             {
                 ASSERT(activeFeatures[j] < NumNetworkInputs);
-                const FirstLayerWeightType* weightsStart = weights + (chunkBase + activeFeatures[j] * AccumulatorSize);
-                ASSERT((size_t)weightsStart % 32 == 0); // make sure loads are aligned
+                const WeightType* weightsStart = weights + (chunkBase + activeFeatures[j] * AccumulatorSize);
+                ASSERT((size_t)weightsStart % (16 * sizeof(WeightType)) == 0); // make sure loads are aligned
 
                 for (uint32_t i = 0; i < OptimalRegisterCount; ++i)
                 {
-                    regs[i] = Int16VecAdd(regs[i], Int16VecLoad(weightsStart + i * registerWidth));
+                    regs[i] = Int16VecAdd(regs[i], LoadAccumulatorWeights(weightsStart + i * registerWidth));
                 }
             }
 
@@ -84,10 +125,11 @@ struct alignas(CACHELINE_SIZE) Accumulator
 
             for (uint32_t i = 0; i < AccumulatorSize; ++i)
             {
-                ASSERT(int32_t(regs[i]) + int32_t(weights[weightsDataOffset + i]) <= std::numeric_limits<AccumulatorType>::max());
-                ASSERT(int32_t(regs[i]) + int32_t(weights[weightsDataOffset + i]) >= std::numeric_limits<AccumulatorType>::min());
+                const int32_t weight = AccumulatorWeightValue(weights[weightsDataOffset + i]);
+                ASSERT(int32_t(regs[i]) + weight <= std::numeric_limits<AccumulatorType>::max());
+                ASSERT(int32_t(regs[i]) + weight >= std::numeric_limits<AccumulatorType>::min());
 
-                regs[i] += weights[weightsDataOffset + i];
+                regs[i] += static_cast<AccumulatorType>(weight);
             }
         }
 
@@ -99,93 +141,145 @@ struct alignas(CACHELINE_SIZE) Accumulator
     }
 
 
+    template<typename WeightType>
     INLINE void Update(
         const Accumulator& source,
-        const FirstLayerWeightType* weights,
+        const WeightType* weights,
         uint32_t numAddedFeatures, const uint16_t* addedFeatures,
-        uint32_t numRemovedFeatures, const uint16_t* removedFeatures)
-    {
+        uint32_t numRemovedFeatures, const uint16_t* removedFeatures);
+
+    // apply multiple consecutive updates in a single pass:
+    // each step starts from result of the previous one (first step starts from 'source') and stores result in its 'target'
+    // intermediate results stay in registers, so each tile of the source accumulator is loaded only once
+    template<typename WeightType>
+    INLINE static void UpdateChain(
+        const Accumulator& source,
+        const WeightType* weights,
+        uint32_t numSteps, const AccumulatorUpdateStep* steps);
+};
+
+struct AccumulatorUpdateStep
+{
+    Accumulator* target = nullptr;
+    uint32_t numAddedFeatures = 0;
+    uint32_t numRemovedFeatures = 0;
+    const uint16_t* addedFeatures = nullptr;
+    const uint16_t* removedFeatures = nullptr;
+};
+
+template<typename WeightType>
+INLINE void Accumulator::Update(
+    const Accumulator& source,
+    const WeightType* weights,
+    uint32_t numAddedFeatures, const uint16_t* addedFeatures,
+    uint32_t numRemovedFeatures, const uint16_t* removedFeatures)
+{
+    const AccumulatorUpdateStep step{ this, numAddedFeatures, numRemovedFeatures, addedFeatures, removedFeatures };
+    UpdateChain(source, weights, 1, &step);
+}
+
+template<typename WeightType>
+INLINE void Accumulator::UpdateChain(
+    const Accumulator& source,
+    const WeightType* weights,
+    uint32_t numSteps, const AccumulatorUpdateStep* steps)
+{
+    ASSERT(numSteps > 0);
+
 #if defined(NN_USE_AVX512) || defined(NN_USE_AVX2) || defined(NN_USE_SSE2) || defined(NN_USE_ARM_NEON)
 
-        constexpr uint32_t registerWidth = VectorRegSize / (8 * sizeof(AccumulatorType));
-        static_assert(AccumulatorSize % registerWidth == 0);
-        const uint32_t numChunks = AccumulatorSize / registerWidth;
-        static_assert(numChunks % OptimalRegisterCount == 0);
-        const uint32_t numTiles = numChunks / OptimalRegisterCount;
-        ASSERT((size_t)weights % 32 == 0);
-        ASSERT((size_t)source.values % 32 == 0);
-        ASSERT((size_t)values % 32 == 0);
+    constexpr uint32_t registerWidth = VectorRegSize / (8 * sizeof(AccumulatorType));
+    static_assert(AccumulatorSize % registerWidth == 0);
+    constexpr uint32_t numChunks = AccumulatorSize / registerWidth;
+    static_assert(numChunks % OptimalRegisterCount == 0);
+    constexpr uint32_t numTiles = numChunks / OptimalRegisterCount;
+    ASSERT((size_t)weights % (16 * sizeof(WeightType)) == 0);
+    ASSERT((size_t)source.values % 32 == 0);
 
-        Int16VecType regs[OptimalRegisterCount];
-        for (uint32_t tile = 0; tile < numTiles; ++tile)
-        {
-            const uint32_t chunkBase = tile * OptimalRegisterCount * registerWidth;
+    Int16VecType regs[OptimalRegisterCount];
+    for (uint32_t tile = 0; tile < numTiles; ++tile)
+    {
+        const uint32_t chunkBase = tile * OptimalRegisterCount * registerWidth;
 
+        {
+            const AccumulatorType* valuesStart = source.values + chunkBase;
+            for (uint32_t i = 0; i < OptimalRegisterCount; ++i)
             {
-                const AccumulatorType* valuesStart = source.values + chunkBase;
-                for (uint32_t i = 0; i < OptimalRegisterCount; ++i)
-                {
-                    regs[i] = Int16VecLoad(valuesStart + i * registerWidth);
-                }
+                regs[i] = Int16VecLoad(valuesStart + i * registerWidth);
             }
+        }
 
-            for (uint32_t j = 0; j < numRemovedFeatures; ++j)
+        for (uint32_t s = 0; s < numSteps; ++s)
+        {
+            const AccumulatorUpdateStep& step = steps[s];
+            ASSERT((size_t)step.target->values % 32 == 0);
+
+            for (uint32_t j = 0; j < step.numRemovedFeatures; ++j)
             {
-                ASSERT(removedFeatures[j] < NumNetworkInputs);
-                const FirstLayerWeightType* weightsStart = weights + (chunkBase + removedFeatures[j] * AccumulatorSize);
+                ASSERT(step.removedFeatures[j] < NumNetworkInputs);
+                const WeightType* weightsStart = weights + (chunkBase + step.removedFeatures[j] * AccumulatorSize);
                 for (uint32_t i = 0; i < OptimalRegisterCount; ++i)
                 {
-                    regs[i] = Int16VecSub(regs[i], Int16VecLoad(weightsStart + i * registerWidth));
+                    regs[i] = Int16VecSub(regs[i], LoadAccumulatorWeights(weightsStart + i * registerWidth));
                 }
             }
 
-            for (uint32_t j = 0; j < numAddedFeatures; ++j)
+            for (uint32_t j = 0; j < step.numAddedFeatures; ++j)
             {
-                ASSERT(addedFeatures[j] < NumNetworkInputs);
-                const FirstLayerWeightType* weightsStart = weights + (chunkBase + addedFeatures[j] * AccumulatorSize);
+                ASSERT(step.addedFeatures[j] < NumNetworkInputs);
+                const WeightType* weightsStart = weights + (chunkBase + step.addedFeatures[j] * AccumulatorSize);
                 for (uint32_t i = 0; i < OptimalRegisterCount; ++i)
                 {
-                    regs[i] = Int16VecAdd(regs[i], Int16VecLoad(weightsStart + i * registerWidth));
+                    regs[i] = Int16VecAdd(regs[i], LoadAccumulatorWeights(weightsStart + i * registerWidth));
                 }
             }
 
+            AccumulatorType* valuesStart = step.target->values + chunkBase;
+            for (uint32_t i = 0; i < OptimalRegisterCount; ++i)
             {
-                AccumulatorType* valuesStart = values + chunkBase;
-                for (uint32_t i = 0; i < OptimalRegisterCount; ++i)
-                {
-                    Int16VecStore(valuesStart + i * registerWidth, regs[i]);
-                }
+                Int16VecStore(valuesStart + i * registerWidth, regs[i]);
             }
         }
+    }
 
 #else // no SIMD support
-        for (uint32_t i = 0; i < AccumulatorSize; ++i)
+    const Accumulator* prevAccum = &source;
+    for (uint32_t s = 0; s < numSteps; ++s)
+    {
+        const AccumulatorUpdateStep& step = steps[s];
+        AccumulatorType* values = step.target->values;
+
+        if (step.target != prevAccum)
         {
-            values[i] = source.values[i];
+            for (uint32_t i = 0; i < AccumulatorSize; ++i)
+            {
+                values[i] = prevAccum->values[i];
+            }
         }
-        for (uint32_t j = 0; j < numRemovedFeatures; ++j)
+        for (uint32_t j = 0; j < step.numRemovedFeatures; ++j)
         {
-            ASSERT(removedFeatures[j] < NumNetworkInputs);
-            const uint32_t weightsDataOffset = removedFeatures[j] * AccumulatorSize;
+            ASSERT(step.removedFeatures[j] < NumNetworkInputs);
+            const uint32_t weightsDataOffset = step.removedFeatures[j] * AccumulatorSize;
 
             for (uint32_t i = 0; i < AccumulatorSize; ++i)
             {
-                values[i] -= weights[weightsDataOffset + i];
+                values[i] -= static_cast<AccumulatorType>(AccumulatorWeightValue(weights[weightsDataOffset + i]));
             }
         }
-        for (uint32_t j = 0; j < numAddedFeatures; ++j)
+        for (uint32_t j = 0; j < step.numAddedFeatures; ++j)
         {
-            ASSERT(addedFeatures[j] < NumNetworkInputs);
-            const uint32_t weightsDataOffset = addedFeatures[j] * AccumulatorSize;
+            ASSERT(step.addedFeatures[j] < NumNetworkInputs);
+            const uint32_t weightsDataOffset = step.addedFeatures[j] * AccumulatorSize;
 
             for (uint32_t i = 0; i < AccumulatorSize; ++i)
             {
-                values[i] += weights[weightsDataOffset + i];
+                values[i] += static_cast<AccumulatorType>(AccumulatorWeightValue(weights[weightsDataOffset + i]));
             }
         }
-#endif
-    }
 
-};
+        prevAccum = step.target;
+    }
+#endif
+}
 
 } // namespace nn
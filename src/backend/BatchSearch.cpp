@@ -0,0 +1,124 @@
+#include "BatchSearch.hpp"
+#include "Game.hpp"
+#include "Time.hpp"
+
+#include <thread>
+
+BatchSearch::BatchSearch(const BatchSearchParam& param)
+    : mParam(param)
+{
+    mParam.numThreads = std::max(1u, mParam.numThreads);
+
+    mSearchers.reserve(mParam.numThreads);
+    for (uint32_t i = 0; i < mParam.numThreads; ++i)
+    {
+        mSearchers.emplace_back(std::make_unique<Searcher>(mParam.transpositionTableSize));
+    }
+}
+
+BatchSearch::~BatchSearch() = default;
+
+void BatchSearch::Run(const JobSource& source, const ResultSink& sink)
+{
+    mStop = false;
+
+    std::vector<std::thread> threads;
+    threads.reserve(mSearchers.size() - 1);
+
+    for (size_t i = 1; i < mSearchers.size(); ++i)
+    {
+        threads.emplace_back(&BatchSearch::SearcherThread, this, std::ref(*mSearchers[i]), std::cref(source), std::cref(sink));
+    }
+
+    // calling thread is a searcher too
+    SearcherThread(*mSearchers.front(), source, sink);
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void BatchSearch::Stop()
+{
+    std::unique_lock<std::mutex> lock(mStopMutex);
+
+    mStop = true;
+
+    for (const std::unique_ptr<Searcher>& searcher : mSearchers)
+    {
+        if (searcher->activeParam)
+        {
+            searcher->activeParam->stopSearch = true;
+        }
+    }
+}
+
+void BatchSearch::SearcherThread(Searcher& searcher, const JobSource& source, const ResultSink& sink)
+{
+    BatchSearchJob job;
+    Game game;
+
+    for (;;)
+    {
+        SearchParam searchParam{ searcher.tt };
+        searchParam.debugLog = false;
+        searchParam.numThreads = 1;
+
+        // pull next job
+        {
+            std::unique_lock<std::mutex> lock(mJobMutex);
+            if (mStop || !source(job))
+            {
+                break;
+            }
+        }
+
+        searchParam.numPvLines = std::max(1u, job.numPvLines);
+        searchParam.limits.maxNodes = job.maxNodes;
+        searchParam.limits.maxDepth = job.maxDepth;
+
+        if (mParam.clearBetweenJobs)
+        {
+            searcher.tt.Clear();
+            searcher.search.Clear();
+        }
+        else
+        {
+            searcher.tt.NextGeneration();
+        }
+
+        game.Reset(job.position);
+
+        BatchSearchResult result;
+        result.index = job.index;
+
+        // finishing a search must not wait for the job source, which may block until this result is consumed
+        bool stopped = false;
+        {
+            std::unique_lock<std::mutex> lock(mStopMutex);
+            stopped = mStop;
+            searcher.activeParam = stopped ? nullptr : &searchParam;
+        }
+
+        if (!stopped)
+        {
+            const TimePoint startTime = TimePoint::GetCurrent();
+
+            SearchStats stats;
+            searcher.search.DoSearch(game, searchParam, result.pvLines, &stats);
+
+            result.searchTime = (TimePoint::GetCurrent() - startTime).ToSeconds();
+            result.nodes = stats.nodes;
+            result.maxDepth = stats.maxDepth;
+
+            std::unique_lock<std::mutex> lock(mStopMutex);
+            searcher.activeParam = nullptr;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mResultMutex);
+            sink(std::move(result));
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Search.hpp"
+#include "TranspositionTable.hpp"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+
+struct BatchSearchJob
+{
+    // passed through to the result, so the caller can match results with jobs
+    uint64_t index = 0;
+
+    Position position;
+
+    uint64_t maxNodes = UINT64_MAX;
+    uint16_t maxDepth = UINT16_MAX;
+    uint32_t numPvLines = 1;
+};
+
+struct BatchSearchResult
+{
+    uint64_t index = 0;
+
+    // PV lines sorted from the best, scores are relative to side to move
+    SearchResult pvLines;
+
+    uint64_t nodes = 0;
+    uint32_t maxDepth = 0;
+    float searchTime = 0.0f;
+};
+
+struct BatchSearchParam
+{
+    // number of positions searched in parallel, each of them on a single thread
+    uint32_t numThreads = 1;
+
+    // transposition table size for each searcher
+    size_t transpositionTableSize = 16ull * 1024ull * 1024ull;
+
+    // clear transposition table and search history before each position, so results don't depend on job scheduling
+    // otherwise searchers keep their state between positions and only transposition table generation is advanced
+    // off by default, clearing the whole table dominates the cost of small searches
+    bool clearBetweenJobs = false;
+};
+
+// searches a stream of independent positions using a pool of searchers
+// searchers (with their transposition tables, node caches and accumulator caches) are allocated once and reused between jobs
+class BatchSearch
+{
+public:
+    // provides next job, returns false if there are no more jobs
+    // called from worker threads, but never concurrently
+    // may block (e.g. until results are consumed), searches in progress and the sink are not held up by it
+    using JobSource = std::function<bool(BatchSearchJob& outJob)>;
+
+    // consumes a result, called in order of completion (not in order of job indices)
+    // called from worker threads, but never concurrently
+    using ResultSink = std::function<void(BatchSearchResult&& result)>;
+
+    explicit BatchSearch(const BatchSearchParam& param);
+    ~BatchSearch();
+
+    // process jobs until the source runs dry or Stop() is called, blocks until all pending jobs finish
+    void Run(const JobSource& source, const ResultSink& sink);
+
+    // stop searches in progress and don't pull any more jobs
+    // jobs already pulled from the source still produce results (with no PV lines if stopped before the search started)
+    void Stop();
+
+private:
+
+    BatchSearch(const BatchSearch&) = delete;
+    BatchSearch& operator = (const BatchSearch&) = delete;
+
+    struct Searcher
+    {
+        Search search;
+        TranspositionTable tt;
+        SearchParam* activeParam = nullptr;
+
+        explicit Searcher(size_t ttSize) : tt(ttSize) { }
+    };
+
+    void SearcherThread(Searcher& searcher, const JobSource& source, const ResultSink& sink);
+
+    BatchSearchParam mParam;
+    std::vector<std::unique_ptr<Searcher>> mSearchers;
+
+    std::mutex mJobMutex;       // held while calling the job source
+    std::mutex mResultMutex;    // held while calling the result sink
+    std::mutex mStopMutex;      // guards searchers' active search params, never held while calling the source or sink
+    std::atomic<bool> mStop = false;
+};
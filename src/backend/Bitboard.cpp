@@ -1,35 +1,29 @@
 #include "Bitboard.hpp"
 #include "Square.hpp"
 
-static Bitboard gPawnAttacksBitboard[Square::NumSquares][2];
-static Bitboard gKingAttacksBitboard[Square::NumSquares];
-static Bitboard gKnightAttacksBitboard[Square::NumSquares];
-static Bitboard gRookAttacksMasks[Square::NumSquares];
-static Bitboard gBishopAttacksMasks[Square::NumSquares];
-static Bitboard gRookAttacksBitboard[Square::NumSquares];
-static Bitboard gBishopAttacksBitboard[Square::NumSquares];
-static Bitboard gRaysBitboard[Square::NumSquares][8];
-static Bitboard gBetweenBitboards[Square::NumSquares][Square::NumSquares];
+namespace BitboardTables {
 
-#ifdef USE_BMI2
+Bitboard gPawnAttacksBitboard[Square::NumSquares][2];
+Bitboard gKingAttacksBitboard[Square::NumSquares];
+Bitboard gKnightAttacksBitboard[Square::NumSquares];
+Bitboard gRookAttacksBitboard[Square::NumSquares];
+Bitboard gBishopAttacksBitboard[Square::NumSquares];
+Bitboard gRaysBitboard[Square::NumSquares][8];
+Bitboard gBetweenBitboards[Square::NumSquares][Square::NumSquares];
 
-struct AttackData
-{
-    Bitboard mask = 0;
-    uint32_t offset = 0;
-};
-
-static constexpr uint32_t cRookAttackTableSize = 102400;
-static constexpr uint32_t cBishopAttackTableSize = 5248;
+#ifdef USE_BMI2
 
-static AttackData gRookAttacksData[Square::NumSquares];
-static AttackData gBishopAttacksData[Square::NumSquares];
-static Bitboard gRookAttackTable[cRookAttackTableSize];
-static Bitboard gBishopAttackTable[cBishopAttackTableSize];
+SliderAttackData gRookAttacksData[Square::NumSquares];
+SliderAttackData gBishopAttacksData[Square::NumSquares];
+CompressedSliderAttacks gRookAttackTable[cRookAttackTableSize];
+CompressedSliderAttacks gBishopAttackTable[cBishopAttackTableSize];
 
 #else
 
-static const uint64_t cRookMagics[Square::NumSquares] =
+Bitboard gRookAttacksMasks[Square::NumSquares];
+Bitboard gBishopAttacksMasks[Square::NumSquares];
+
+const uint64_t cRookMagics[Square::NumSquares] =
 {
     0xa8002c000108020ULL, 0x6c00049b0002001ULL, 0x100200010090040ULL, 0x2480041000800801ULL, 0x280028004000800ULL,
     0x900410008040022ULL, 0x280020001001080ULL, 0x2880002041000080ULL, 0xa000800080400034ULL, 0x4808020004000ULL,
@@ -46,7 +40,7 @@ static const uint64_t cRookMagics[Square::NumSquares] =
     0x489a000810200402ULL, 0x1004400080a13ULL, 0x4000011008020084ULL, 0x26002114058042ULL
 };
 
-static const uint8_t cRookMagicOffsets[Square::NumSquares] =
+const uint8_t cRookMagicOffsets[Square::NumSquares] =
 {
     52, 53, 53, 53, 53, 53, 53, 52,
     53, 54, 54, 54, 54, 54, 54, 53,
@@ -87,161 +81,16 @@ const uint8_t cBishopMagicOffsets[Square::NumSquares] =
     58, 59, 59, 59, 59, 59, 59, 58,
 };
 
-static const uint32_t RookAttackTableSize = 4096;
-static uint64_t gRookAttackTable[Square::NumSquares][RookAttackTableSize];
-
-static const uint32_t BishopAttackTableSize = 512;
-static uint64_t gBishopAttackTable[Square::NumSquares][BishopAttackTableSize];
+uint64_t gRookAttackTable[Square::NumSquares][RookAttackTableSize];
+uint64_t gBishopAttackTable[Square::NumSquares][BishopAttackTableSize];
 
 #endif // USE_BMI2
 
-///////////////////////////////////////////////////////////////////////////////////////////////////
-
-Bitboard Bitboard::GetRay(const Square square, const Direction dir)
-{
-    ASSERT(square.IsValid());
-    ASSERT(static_cast<uint32_t>(dir) < 8u);
-    return gRaysBitboard[square.Index()][static_cast<uint32_t>(dir)];
-}
-
-Bitboard Bitboard::GetBetween(const Square squareA, const Square squareB)
-{
-    ASSERT(squareA.IsValid());
-    ASSERT(squareB.IsValid());
-    return gBetweenBitboards[squareA.Index()][squareB.Index()];
-}
-
-template<>
-Bitboard Bitboard::GetPawnAttacks<White>(const Square square)
-{
-    Bitboard bitboard;
-    bitboard = (square.GetBitboard() & ~Bitboard::FileBitboard<0u>()) << 7u;
-    bitboard |= (square.GetBitboard() & ~Bitboard::FileBitboard<7u>()) << 9u;
-    return bitboard;
-}
-
-template<>
-Bitboard Bitboard::GetPawnAttacks<Black>(const Square square)
-{
-    Bitboard bitboard;
-    bitboard = (square.GetBitboard() & ~Bitboard::FileBitboard<0u>()) >> 9u;
-    bitboard |= (square.GetBitboard() & ~Bitboard::FileBitboard<7u>()) >> 7u;
-    return bitboard;
-}
-
-template<>
-Bitboard Bitboard::GetPawnsAttacks<White>(const Bitboard pawns)
-{
-    Bitboard bitboard;
-    bitboard = (pawns & ~Bitboard::FileBitboard<0u>()) << 7u;
-    bitboard |= (pawns & ~Bitboard::FileBitboard<7u>()) << 9u;
-    return bitboard;
-}
-
-template<>
-Bitboard Bitboard::GetPawnsAttacks<Black>(const Bitboard pawns)
-{
-    Bitboard bitboard;
-    bitboard = (pawns & ~Bitboard::FileBitboard<0u>()) >> 9u;
-    bitboard |= (pawns & ~Bitboard::FileBitboard<7u>()) >> 7u;
-    return bitboard;
-}
+} // namespace BitboardTables
 
-Bitboard Bitboard::GetPawnsAttacks(const Bitboard pawns, const Color color)
-{
-    return color == White ?
-        GetPawnsAttacks<Black>(pawns) :
-        GetPawnsAttacks<White>(pawns);
-}
+using namespace BitboardTables;
 
-Bitboard Bitboard::GetPawnAttacks(const Square square, const Color color)
-{
-    ASSERT(square.IsValid());
-    return gPawnAttacksBitboard[square.Index()][(uint32_t)color];
-}
-
-Bitboard Bitboard::GetKingAttacks(const Square square)
-{
-    ASSERT(square.IsValid());
-    return gKingAttacksBitboard[square.Index()];
-}
-
-Bitboard Bitboard::GetKnightAttacks(const Square square)
-{
-    ASSERT(square.IsValid());
-    return gKnightAttacksBitboard[square.Index()];
-}
-
-Bitboard Bitboard::GetKnightAttacks(const Bitboard squares)
-{
-    Bitboard result = 0;
-    if (squares)
-    {
-        // based on: https://www.chessprogramming.org/Knight_Pattern
-        const Bitboard l1 = (squares >> 1) & 0x7f7f7f7f7f7f7f7full;
-        const Bitboard l2 = (squares >> 2) & 0x3f3f3f3f3f3f3f3full;
-        const Bitboard r1 = (squares << 1) & 0xfefefefefefefefeull;
-        const Bitboard r2 = (squares << 2) & 0xfcfcfcfcfcfcfcfcull;
-        const Bitboard h1 = l1 | r1;
-        const Bitboard h2 = l2 | r2;
-        result = (h1 << 16) | (h1 >> 16) | (h2 << 8) | (h2 >> 8);
-    }
-    return result;
-}
-
-Bitboard Bitboard::GetRookAttacks(const Square square)
-{
-    ASSERT(square.IsValid());
-    return gRookAttacksBitboard[square.Index()];
-}
-
-Bitboard Bitboard::GetBishopAttacks(const Square square)
-{
-    ASSERT(square.IsValid());
-    return gBishopAttacksBitboard[square.Index()];
-}
-
-Bitboard Bitboard::GetQueenAttacks(const Square square)
-{
-    return GetRookAttacks(square) | GetBishopAttacks(square);
-}
-
-Bitboard Bitboard::GenerateRookAttacks(const Square square, const Bitboard blockers)
-{
-#ifdef USE_BMI2
-    const AttackData& data = gRookAttacksData[square.Index()];
-    const uint32_t index = static_cast<uint32_t>(ParallelBitsExtract(blockers, data.mask));
-    return gRookAttackTable[data.offset + index];
-    //return ParallelBitsDeposit(gRookAttackTable[data.offset + index], data.dstMask);
-#else
-    uint64_t b = blockers;
-    b &= gRookAttacksMasks[square.Index()];
-    b *= cRookMagics[square.Index()];
-    b >>= cRookMagicOffsets[square.Index()];
-    return gRookAttackTable[square.Index()][b];
-#endif // USE_BMI2
-}
-
-Bitboard Bitboard::GenerateBishopAttacks(const Square square, const Bitboard blockers)
-{
-#ifdef USE_BMI2
-    const AttackData& data = gBishopAttacksData[square.Index()];
-    const uint32_t index = static_cast<uint32_t>(ParallelBitsExtract(blockers, data.mask));
-    return gBishopAttackTable[data.offset + index];
-    //return ParallelBitsDeposit(gBishopAttackTable[data.offset + index], data.dstMask);
-#else
-    uint64_t b = blockers;
-    b &= gBishopAttacksMasks[square.Index()];
-    b *= cBishopMagics[square.Index()];
-    b >>= cBishopMagicOffsets[square.Index()];
-    return gBishopAttackTable[square.Index()][b];
-#endif // USE_BMI2
-}
-
-Bitboard Bitboard::GenerateQueenAttacks(const Square square, const Bitboard blockers)
-{
-    return GenerateRookAttacks(square, blockers) | GenerateBishopAttacks(square, blockers);
-}
+///////////////////////////////////////////////////////////////////////////////////////////////////
 
 Bitboard Bitboard::GenerateRookAttacks_Slow(const Square square, const Bitboard blockers)
 {
@@ -480,26 +329,32 @@ static void InitRookAttacks()
 
         const Bitboard attackMask = GetRookAttackMask(square);
 
-        gRookAttacksMasks[squareIndex] = attackMask;
-
         // compute number of possible occluder layouts
         const uint32_t attackMaskBits = PopCount(attackMask);
         const uint32_t numBlockerSets = 1 << attackMaskBits;
 
 #ifdef USE_BMI2
+        const Bitboard rays = gRookAttacksBitboard[squareIndex];
+        ASSERT(rays.Count() <= 8 * sizeof(CompressedSliderAttacks));
+
         gRookAttacksData[squareIndex].mask = attackMask;
+        gRookAttacksData[squareIndex].rays = rays;
         gRookAttacksData[squareIndex].offset = tableSize;
 
         for (uint32_t blockersIndex = 0; blockersIndex < numBlockerSets; ++blockersIndex)
         {
             // reconstruct (masked) blockers bitboard
             const Bitboard blockerBitboard = ParallelBitsDeposit(static_cast<uint64_t>(blockersIndex), attackMask);
-            gRookAttackTable[tableSize + blockersIndex] = Bitboard::GenerateRookAttacks_Slow(square, blockerBitboard);
+            const Bitboard attacks = Bitboard::GenerateRookAttacks_Slow(square, blockerBitboard);
+            gRookAttackTable[tableSize + blockersIndex] = static_cast<CompressedSliderAttacks>(ParallelBitsExtract(attacks, rays));
+            ASSERT(Bitboard::GenerateRookAttacks(square, blockerBitboard) == attacks);
         }
 
         tableSize += numBlockerSets;
 
 #else // !USE_BMI2
+        gRookAttacksMasks[squareIndex] = attackMask;
+
         const uint64_t magic = cRookMagics[squareIndex];
         const uint64_t shift = cRookMagicOffsets[squareIndex];
 
@@ -550,26 +405,33 @@ static void InitBishopAttacks()
             Bitboard::GetRay(square, Direction::SouthWest);
 
         const Bitboard attackMask = GetBishopAttackMask(square);
-        gBishopAttacksMasks[squareIndex] = attackMask;
 
         // compute number of possible occluder layouts
         const uint32_t attackMaskBits = PopCount(attackMask);
         const uint32_t numBlockerSets = 1 << attackMaskBits;
 
 #ifdef USE_BMI2
+        const Bitboard rays = gBishopAttacksBitboard[squareIndex];
+        ASSERT(rays.Count() <= 8 * sizeof(CompressedSliderAttacks));
+
         gBishopAttacksData[squareIndex].mask = attackMask;
+        gBishopAttacksData[squareIndex].rays = rays;
         gBishopAttacksData[squareIndex].offset = tableSize;
 
         for (uint32_t blockersIndex = 0; blockersIndex < numBlockerSets; ++blockersIndex)
         {
             // reconstruct (masked) blockers bitboard
             const Bitboard blockerBitboard = ParallelBitsDeposit(static_cast<uint64_t>(blockersIndex), attackMask);
-            gBishopAttackTable[tableSize + blockersIndex] = Bitboard::GenerateBishopAttacks_Slow(square, blockerBitboard);
+            const Bitboard attacks = Bitboard::GenerateBishopAttacks_Slow(square, blockerBitboard);
+            gBishopAttackTable[tableSize + blockersIndex] = static_cast<CompressedSliderAttacks>(ParallelBitsExtract(attacks, rays));
+            ASSERT(Bitboard::GenerateBishopAttacks(square, blockerBitboard) == attacks);
         }
 
         tableSize += numBlockerSets;
 
 #else // !USE_BMI2
+        gBishopAttacksMasks[squareIndex] = attackMask;
+
         const uint64_t magic = cBishopMagics[squareIndex];
         const uint64_t shift = cBishopMagicOffsets[squareIndex];
 
@@ -1,24 +1,11 @@
 #pragma once
 
 #include "Common.hpp"
+#include "Square.hpp"
 
 #include <assert.h>
 #include <string>
 
-class Square;
-
-enum class Direction
-{
-    North,
-    South,
-    East,
-    West,
-    NorthEast,
-    NorthWest,
-    SouthEast,
-    SouthWest,
-};
-
 struct Bitboard
 {
     uint64_t value;
@@ -256,31 +243,209 @@ struct Bitboard
         return (value & (1ull << index)) != 0;
     }
 
-    static Bitboard GetRay(const Square square, const Direction dir);
-    static Bitboard GetBetween(const Square squareA, const Square squareB);
+    INLINE static Bitboard GetRay(const Square square, const Direction dir);
+    INLINE static Bitboard GetBetween(const Square squareA, const Square squareB);
 
     template<Color color>
-    static Bitboard GetPawnAttacks(const Square square);
+    INLINE static Bitboard GetPawnAttacks(const Square square);
 
     template<Color color>
-    static Bitboard GetPawnsAttacks(const Bitboard pawns);
+    INLINE static constexpr Bitboard GetPawnsAttacks(const Bitboard pawns)
+    {
+        if constexpr (color == White)
+            return ((pawns & ~FileBitboard<0u>()) << 7u) | ((pawns & ~FileBitboard<7u>()) << 9u);
+        else
+            return ((pawns & ~FileBitboard<0u>()) >> 9u) | ((pawns & ~FileBitboard<7u>()) >> 7u);
+    }
 
-    static Bitboard GetPawnAttacks(const Square square, const Color color);
-    static Bitboard GetPawnsAttacks(const Bitboard pawns, const Color color);
+    INLINE static Bitboard GetPawnAttacks(const Square square, const Color color);
 
-    static Bitboard GetKingAttacks(const Square square);
-    static Bitboard GetKnightAttacks(const Square square);
-    static Bitboard GetKnightAttacks(const Bitboard squares);
-    static Bitboard GetRookAttacks(const Square square);
-    static Bitboard GetBishopAttacks(const Square square);
-    static Bitboard GetQueenAttacks(const Square square);
+    // NOTE: color of the attacked side
+    INLINE static Bitboard GetPawnsAttacks(const Bitboard pawns, const Color color)
+    {
+        return color == White ? GetPawnsAttacks<Black>(pawns) : GetPawnsAttacks<White>(pawns);
+    }
 
-    static Bitboard GenerateRookAttacks(const Square square, const Bitboard blockers);
-    static Bitboard GenerateBishopAttacks(const Square square, const Bitboard blockers);
-    static Bitboard GenerateQueenAttacks(const Square square, const Bitboard blockers);
+    INLINE static Bitboard GetKingAttacks(const Square square);
+    INLINE static Bitboard GetKnightAttacks(const Square square);
+    INLINE static Bitboard GetKnightAttacks(const Bitboard squares);
+    INLINE static Bitboard GetRookAttacks(const Square square);
+    INLINE static Bitboard GetBishopAttacks(const Square square);
+    INLINE static Bitboard GetQueenAttacks(const Square square);
+
+    INLINE static Bitboard GenerateRookAttacks(const Square square, const Bitboard blockers);
+    INLINE static Bitboard GenerateBishopAttacks(const Square square, const Bitboard blockers);
+    INLINE static Bitboard GenerateQueenAttacks(const Square square, const Bitboard blockers);
 
     static Bitboard GenerateRookAttacks_Slow(const Square square, const Bitboard blockers);
     static Bitboard GenerateBishopAttacks_Slow(const Square square, const Bitboard blockers);
 };
 
 void InitBitboards();
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// lookup tables, filled by InitBitboards()
+// exposed only for the inline lookups below, use Bitboard methods instead
+namespace BitboardTables {
+
+extern Bitboard gPawnAttacksBitboard[Square::NumSquares][2];
+extern Bitboard gKingAttacksBitboard[Square::NumSquares];
+extern Bitboard gKnightAttacksBitboard[Square::NumSquares];
+extern Bitboard gRookAttacksBitboard[Square::NumSquares];
+extern Bitboard gBishopAttacksBitboard[Square::NumSquares];
+extern Bitboard gRaysBitboard[Square::NumSquares][8];
+extern Bitboard gBetweenBitboards[Square::NumSquares][Square::NumSquares];
+
+#ifdef USE_BMI2
+
+// Slider attacks are indexed with PEXT of the blockers. Attacks never leave the piece's empty board rays,
+// so only the bits of the rays are stored (at most 14 for a rook) and expanded back with PDEP.
+struct SliderAttackData
+{
+    Bitboard mask = 0;      // relevant blockers
+    Bitboard rays = 0;      // attacks on empty board
+    uint32_t offset = 0;    // offset in the attack table
+};
+
+using CompressedSliderAttacks = uint16_t;
+
+static constexpr uint32_t cRookAttackTableSize = 102400;
+static constexpr uint32_t cBishopAttackTableSize = 5248;
+
+extern SliderAttackData gRookAttacksData[Square::NumSquares];
+extern SliderAttackData gBishopAttacksData[Square::NumSquares];
+extern CompressedSliderAttacks gRookAttackTable[cRookAttackTableSize];
+extern CompressedSliderAttacks gBishopAttackTable[cBishopAttackTableSize];
+
+#else
+
+extern const uint64_t cRookMagics[Square::NumSquares];
+extern const uint8_t cRookMagicOffsets[Square::NumSquares];
+extern const uint64_t cBishopMagics[Square::NumSquares];
+extern const uint8_t cBishopMagicOffsets[Square::NumSquares];
+
+extern Bitboard gRookAttacksMasks[Square::NumSquares];
+extern Bitboard gBishopAttacksMasks[Square::NumSquares];
+
+static constexpr uint32_t RookAttackTableSize = 4096;
+static constexpr uint32_t BishopAttackTableSize = 512;
+
+extern uint64_t gRookAttackTable[Square::NumSquares][RookAttackTableSize];
+extern uint64_t gBishopAttackTable[Square::NumSquares][BishopAttackTableSize];
+
+#endif // USE_BMI2
+
+} // namespace BitboardTables
+
+INLINE Bitboard Square::GetBitboard() const
+{
+    return 1ull << mIndex;
+}
+
+INLINE const Bitboard operator & (const Bitboard& lhs, const Square& rhs)
+{
+    return lhs & rhs.GetBitboard();
+}
+
+INLINE Bitboard Bitboard::GetRay(const Square square, const Direction dir)
+{
+    ASSERT(square.IsValid());
+    ASSERT(static_cast<uint32_t>(dir) < 8u);
+    return BitboardTables::gRaysBitboard[square.Index()][static_cast<uint32_t>(dir)];
+}
+
+INLINE Bitboard Bitboard::GetBetween(const Square squareA, const Square squareB)
+{
+    ASSERT(squareA.IsValid());
+    ASSERT(squareB.IsValid());
+    return BitboardTables::gBetweenBitboards[squareA.Index()][squareB.Index()];
+}
+
+template<Color color>
+INLINE Bitboard Bitboard::GetPawnAttacks(const Square square)
+{
+    return GetPawnsAttacks<color>(square.GetBitboard());
+}
+
+INLINE Bitboard Bitboard::GetPawnAttacks(const Square square, const Color color)
+{
+    ASSERT(square.IsValid());
+    return BitboardTables::gPawnAttacksBitboard[square.Index()][(uint32_t)color];
+}
+
+INLINE Bitboard Bitboard::GetKingAttacks(const Square square)
+{
+    ASSERT(square.IsValid());
+    return BitboardTables::gKingAttacksBitboard[square.Index()];
+}
+
+INLINE Bitboard Bitboard::GetKnightAttacks(const Square square)
+{
+    ASSERT(square.IsValid());
+    return BitboardTables::gKnightAttacksBitboard[square.Index()];
+}
+
+INLINE Bitboard Bitboard::GetKnightAttacks(const Bitboard squares)
+{
+    // based on: https://www.chessprogramming.org/Knight_Pattern
+    const Bitboard l1 = (squares >> 1) & 0x7f7f7f7f7f7f7f7full;
+    const Bitboard l2 = (squares >> 2) & 0x3f3f3f3f3f3f3f3full;
+    const Bitboard r1 = (squares << 1) & 0xfefefefefefefefeull;
+    const Bitboard r2 = (squares << 2) & 0xfcfcfcfcfcfcfcfcull;
+    const Bitboard h1 = l1 | r1;
+    const Bitboard h2 = l2 | r2;
+    return (h1 << 16) | (h1 >> 16) | (h2 << 8) | (h2 >> 8);
+}
+
+INLINE Bitboard Bitboard::GetRookAttacks(const Square square)
+{
+    ASSERT(square.IsValid());
+    return BitboardTables::gRookAttacksBitboard[square.Index()];
+}
+
+INLINE Bitboard Bitboard::GetBishopAttacks(const Square square)
+{
+    ASSERT(square.IsValid());
+    return BitboardTables::gBishopAttacksBitboard[square.Index()];
+}
+
+INLINE Bitboard Bitboard::GetQueenAttacks(const Square square)
+{
+    return GetRookAttacks(square) | GetBishopAttacks(square);
+}
+
+INLINE Bitboard Bitboard::GenerateRookAttacks(const Square square, const Bitboard blockers)
+{
+#ifdef USE_BMI2
+    const BitboardTables::SliderAttackData& data = BitboardTables::gRookAttacksData[square.Index()];
+    const uint32_t index = static_cast<uint32_t>(ParallelBitsExtract(blockers, data.mask));
+    return ParallelBitsDeposit(static_cast<uint64_t>(BitboardTables::gRookAttackTable[data.offset + index]), data.rays);
+#else
+    uint64_t b = blockers;
+    b &= BitboardTables::gRookAttacksMasks[square.Index()];
+    b *= BitboardTables::cRookMagics[square.Index()];
+    b >>= BitboardTables::cRookMagicOffsets[square.Index()];
+    return BitboardTables::gRookAttackTable[square.Index()][b];
+#endif // USE_BMI2
+}
+
+INLINE Bitboard Bitboard::GenerateBishopAttacks(const Square square, const Bitboard blockers)
+{
+#ifdef USE_BMI2
+    const BitboardTables::SliderAttackData& data = BitboardTables::gBishopAttacksData[square.Index()];
+    const uint32_t index = static_cast<uint32_t>(ParallelBitsExtract(blockers, data.mask));
+    return ParallelBitsDeposit(static_cast<uint64_t>(BitboardTables::gBishopAttackTable[data.offset + index]), data.rays);
+#else
+    uint64_t b = blockers;
+    b &= BitboardTables::gBishopAttacksMasks[square.Index()];
+    b *= BitboardTables::cBishopMagics[square.Index()];
+    b >>= BitboardTables::cBishopMagicOffsets[square.Index()];
+    return BitboardTables::gBishopAttackTable[square.Index()][b];
+#endif // USE_BMI2
+}
+
+INLINE Bitboard Bitboard::GenerateQueenAttacks(const Square square, const Bitboard blockers)
+{
+    return GenerateRookAttacks(square, blockers) | GenerateBishopAttacks(square, blockers);
+}
@@ -0,0 +1,64 @@
+#include "EvalCache.hpp"
+#include "Memory.hpp"
+
+#include <cstring>
+
+#ifdef USE_SSE
+#include <immintrin.h>
+#endif // USE_SSE
+
+EvalCache::~EvalCache()
+{
+    Resize(0);
+}
+
+void EvalCache::Prefetch(uint64_t hash) const
+{
+    if (numEntries == 0) return;
+
+#ifdef USE_SSE
+    _mm_prefetch(reinterpret_cast<const char*>(&GetEntry(hash)), _MM_HINT_T0);
+#elif defined(USE_ARM_NEON)
+    __builtin_prefetch(reinterpret_cast<const char*>(&GetEntry(hash)), 0, 0);
+#else
+    (void)hash;
+#endif // USE_SSE
+}
+
+void EvalCache::Clear()
+{
+    if (entries)
+    {
+        memset(static_cast<void*>(entries), 0, numEntries * sizeof(Entry));
+    }
+}
+
+void EvalCache::Resize(size_t newSizeInBytes)
+{
+    const size_t newNumEntries = newSizeInBytes / sizeof(Entry);
+
+    if (newNumEntries == numEntries)
+    {
+        return;
+    }
+
+    if (entries)
+    {
+        Free(entries);
+        entries = nullptr;
+        numEntries = 0;
+    }
+
+    if (newNumEntries > 0)
+    {
+        entries = static_cast<Entry*>(Malloc(newNumEntries * sizeof(Entry)));
+        if (!entries)
+        {
+            std::cerr << "Failed to allocate evaluation cache" << std::endl;
+            return;
+        }
+
+        numEntries = newNumEntries;
+        Clear();
+    }
+}
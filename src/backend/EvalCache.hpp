@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Math.hpp"
+
+#include <atomic>
+
+// Cache of raw neural network outputs indexed by position hash, shared by all search threads.
+// A hit skips both accumulator update and inference, accumulators of the node stay dirty.
+class EvalCache
+{
+public:
+    // each entry is written with two relaxed 64-bit stores, the key is XOR-ed with the value,
+    // so an entry torn by concurrent writes fails validation on read
+    struct Entry
+    {
+        std::atomic<uint64_t> key;
+        std::atomic<uint64_t> value;
+    };
+
+    EvalCache() = default;
+    ~EvalCache();
+
+    EvalCache(const EvalCache&) = delete;
+    EvalCache& operator = (const EvalCache&) = delete;
+
+    INLINE bool Read(uint64_t hash, int32_t& outValue) const
+    {
+        if (numEntries == 0) return false;
+
+        const Entry& entry = GetEntry(hash);
+        const uint64_t key = entry.key.load(std::memory_order_relaxed);
+        const uint64_t value = entry.value.load(std::memory_order_relaxed);
+
+        if ((key ^ value) != hash) return false;
+
+        outValue = (int32_t)(uint32_t)value;
+        return true;
+    }
+
+    INLINE void Write(uint64_t hash, int32_t value)
+    {
+        if (numEntries == 0) return;
+
+        Entry& entry = GetEntry(hash);
+        const uint64_t data = (uint64_t)(uint32_t)value;
+        entry.key.store(hash ^ data, std::memory_order_relaxed);
+        entry.value.store(data, std::memory_order_relaxed);
+    }
+
+    void Prefetch(uint64_t hash) const;
+
+    // invalidate all entries
+    void Clear();
+
+    // resize the table, zero size disables the cache
+    void Resize(size_t newSizeInBytes);
+
+    size_t GetSize() const { return numEntries; }
+
+private:
+    INLINE Entry& GetEntry(uint64_t hash) const
+    {
+        const uint64_t index = MulHi64(hash, numEntries);
+        ASSERT(index < numEntries);
+        return entries[index];
+    }
+
+    Entry* entries = nullptr;
+    size_t numEntries = 0;
+};
+
+// eval cache hit rate, collected per search thread
+struct EvalCacheStats
+{
+    uint64_t numProbes = 0;
+    uint64_t numHits = 0;
+
+    EvalCacheStats& operator += (const EvalCacheStats& other)
+    {
+        numProbes += other.numProbes;
+        numHits += other.numHits;
+        return *this;
+    }
+};
@@ -1,5 +1,6 @@
 #include "Evaluate.hpp"
 #include "Endgame.hpp"
+#include "EvalCache.hpp"
 #include "Search.hpp"
 
 #include <fstream>
@@ -29,11 +30,15 @@ static constexpr ScoreType c_castlingRightsBonus = 5;
 } // namespace
 
 PackedNeuralNetworkPtr g_mainNeuralNetwork;
+EvalCache g_evalCache;
 
 bool LoadMainNeuralNetwork(const char* path)
 {
     PackedNeuralNetworkPtr network = std::make_unique<nn::PackedNeuralNetwork>();
 
+    // cached outputs belong to the previous network
+    g_evalCache.Clear();
+
     if (path == nullptr || strcmp(path, "") == 0 || strcmp(path, "<empty>") == 0)
     {
 #if defined(CAISSA_EVALFILE)
@@ -168,7 +173,12 @@ bool CheckInsufficientMaterial(const Position& pos)
 
 ScoreType Evaluate(const Position& pos)
 {
-    NodeInfo dummyNode = { pos };
+    Position position = pos;
+    nn::Accumulator accumulators[2];
+    NodeInfo dummyNode;
+    dummyNode.position = &position;
+    dummyNode.accumulatorData = accumulators;
+    dummyNode.UpdatePositionInfo();
 
     AccumulatorCache dummyCache;
     if (g_mainNeuralNetwork)
@@ -181,7 +191,7 @@ ScoreType Evaluate(const Position& pos)
 
 ScoreType Evaluate(NodeInfo& node, AccumulatorCache& cache)
 {
-    const Position& pos = node.position;
+    const Position& pos = *node.position;
 
     const int32_t whiteQueens = pos.Whites().queens.Count();
     const int32_t whiteRooks = pos.Whites().rooks.Count();
@@ -209,7 +219,23 @@ ScoreType Evaluate(NodeInfo& node, AccumulatorCache& cache)
         }
     }
 
-    int32_t value = NNEvaluator::Evaluate(*g_mainNeuralNetwork, node, cache);
+    int32_t value = node.nnContext.nnScore;
+    if (value == InvalidValue)
+    {
+        cache.evalCacheStats.numProbes++;
+        if (g_evalCache.Read(pos.GetHash(), value))
+        {
+            // accumulators stay dirty, children will be updated from the closest computed ancestor
+            // (or refreshed, if the chain of dirty accumulators gets too long)
+            cache.evalCacheStats.numHits++;
+            node.nnContext.nnScore = value;
+        }
+        else
+        {
+            value = NNEvaluator::Evaluate(*g_mainNeuralNetwork, node, cache);
+            g_evalCache.Write(pos.GetHash(), value);
+        }
+    }
 
     // convert to centipawn range
     value /= nn::OutputScale * nn::WeightScale / c_nnOutputToCentiPawns;
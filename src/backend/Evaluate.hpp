@@ -16,11 +16,15 @@ using PackedNeuralNetworkPtr = std::unique_ptr<nn::PackedNeuralNetwork>;
 
 struct DirtyPiece;
 struct AccumulatorCache;
+class EvalCache;
 
 extern const char* c_DefaultEvalFile;
 
 extern PackedNeuralNetworkPtr g_mainNeuralNetwork;
 
+// raw output of the main neural network, indexed by position hash
+extern EvalCache g_evalCache;
+
 static constexpr PieceScore c_pawnValue     = {   97, 166 };
 static constexpr PieceScore c_knightValue   = {  455, 371 };
 static constexpr PieceScore c_bishopValue   = {  494, 385 };
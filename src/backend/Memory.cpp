@@ -1,5 +1,67 @@
 #include "Memory.hpp"
 
+#include <mutex>
+#include <unordered_map>
+
+
+static std::atomic<bool> s_largePagesEnabled = true;
+
+// allocations backed by large pages, with their page size
+// (lookup is done only on free and when querying page size, which is rare)
+struct LargePageAllocations
+{
+    struct Info
+    {
+        size_t size;
+        size_t pageSize;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<const void*, Info> allocations;
+
+    // intentionally never destroyed, global objects may free memory during static destruction
+    static LargePageAllocations& Get()
+    {
+        static LargePageAllocations* instance = new LargePageAllocations;
+        return *instance;
+    }
+
+    void Add(const void* ptr, size_t size, size_t pageSize)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        allocations[ptr] = { size, pageSize };
+    }
+
+    bool Remove(const void* ptr, Info& outInfo)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        const auto iter = allocations.find(ptr);
+        if (iter == allocations.end()) return false;
+        outInfo = iter->second;
+        allocations.erase(iter);
+        return true;
+    }
+
+    bool Find(const void* ptr, Info& outInfo)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        const auto iter = allocations.find(ptr);
+        if (iter == allocations.end()) return false;
+        outInfo = iter->second;
+        return true;
+    }
+};
+
+void SetLargePagesEnabled(bool enabled)
+{
+    s_largePagesEnabled = enabled;
+}
+
+bool AreLargePagesEnabled()
+{
+    return s_largePagesEnabled;
+}
+
 
 #if defined(PLATFORM_WINDOWS)
 
@@ -47,6 +109,19 @@ bool EnableLargePagesSupport()
     return true;
 }
 
+size_t GetAllocationPageSize(const void* ptr)
+{
+    LargePageAllocations::Info info;
+    if (LargePageAllocations::Get().Find(ptr, info))
+    {
+        return info.pageSize;
+    }
+
+    SYSTEM_INFO systemInfo;
+    ::GetSystemInfo(&systemInfo);
+    return systemInfo.dwPageSize;
+}
+
 NO_INLINE void* Malloc(size_t size)
 {
     void* ptr = nullptr;
@@ -54,10 +129,15 @@ NO_INLINE void* Malloc(size_t size)
     // try large pages first
     const size_t largePageMinNumpages = 4;
     const size_t minLargePageSize = largePageMinNumpages * ::GetLargePageMinimum();
-    if (size >= minLargePageSize)
+    if (s_largePagesEnabled && minLargePageSize > 0 && size >= minLargePageSize)
     {
         const size_t roundedSize = ((size + minLargePageSize - 1) / minLargePageSize) * minLargePageSize;
         ptr = ::VirtualAlloc(NULL, roundedSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+
+        if (ptr)
+        {
+            LargePageAllocations::Get().Add(ptr, roundedSize, ::GetLargePageMinimum());
+        }
     }
 
     // fallback to regular pages
@@ -71,22 +151,117 @@ NO_INLINE void* Malloc(size_t size)
 
 void Free(void* ptr)
 {
+    if (!ptr)
+    {
+        return;
+    }
+
+    LargePageAllocations::Info info;
+    LargePageAllocations::Get().Remove(ptr, info);
+
     ::VirtualFree(ptr, 0, MEM_RELEASE);
 }
 
 
 #elif defined(__GNUC__) || defined(__clang__)
 
+#include <unistd.h>
+
+#if defined(__linux__)
+    #include <fstream>
+    #include <sys/mman.h>
+#endif // defined(__linux__)
+
+#if defined(__linux__) && defined(MAP_HUGETLB)
+    #ifndef MAP_HUGE_SHIFT
+    #define MAP_HUGE_SHIFT 26
+    #endif // MAP_HUGE_SHIFT
+
+    static constexpr size_t c_hugePageSize2MB = 2ull * 1024 * 1024;
+    static constexpr size_t c_hugePageSize1GB = 1024ull * 1024 * 1024;
+#endif // defined(__linux__) && defined(MAP_HUGETLB)
 
 bool EnableLargePagesSupport()
 {
+#if defined(__linux__) && defined(MAP_HUGETLB)
+    // huge pages are usable only if reserved by the administrator (vm.nr_hugepages or hugepages= boot parameter)
+    std::ifstream file("/proc/meminfo");
+    std::string key;
+    uint64_t numHugePages = 0;
+    uint64_t hugePageSizeKB = 0;
+    while (file >> key)
+    {
+        if (key == "HugePages_Total:") file >> numHugePages;
+        else if (key == "Hugepagesize:") file >> hugePageSizeKB;
+        file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+
+    if (numHugePages > 0)
+    {
+        std::cout << "info string Large page support enabled. Reserved pages: " << numHugePages << " x " << hugePageSizeKB << " KB" << std::endl;
+        return true;
+    }
+#endif // defined(__linux__) && defined(MAP_HUGETLB)
+
     return false;
 }
 
+size_t GetAllocationPageSize(const void* ptr)
+{
+    LargePageAllocations::Info info;
+    if (LargePageAllocations::Get().Find(ptr, info))
+    {
+        return info.pageSize;
+    }
+
+    return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+#if defined(__linux__) && defined(MAP_HUGETLB)
+static void* AllocateHugePages(size_t size, size_t pageSize, uint32_t pageSizeLog2)
+{
+    const size_t roundedSize = (size + pageSize - 1) / pageSize * pageSize;
+
+    void* ptr = mmap(nullptr, roundedSize, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (pageSizeLog2 << MAP_HUGE_SHIFT), -1, 0);
+    if (ptr == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    LargePageAllocations::Get().Add(ptr, roundedSize, pageSize);
+    return ptr;
+}
+#endif // defined(__linux__) && defined(MAP_HUGETLB)
+
 void* Malloc(size_t size)
 {
+#if defined(__linux__) && defined(MAP_HUGETLB)
+    // try explicit huge pages first, 1GB pages only if rounding up doesn't waste too much memory
+    if (s_largePagesEnabled)
+    {
+        if (size >= c_hugePageSize1GB && (c_hugePageSize1GB - size % c_hugePageSize1GB) % c_hugePageSize1GB <= size / 8)
+        {
+            if (void* ptr = AllocateHugePages(size, c_hugePageSize1GB, 30))
+            {
+                return ptr;
+            }
+        }
+
+        const size_t largePageMinNumpages = 4;
+        if (size >= largePageMinNumpages * c_hugePageSize2MB)
+        {
+            if (void* ptr = AllocateHugePages(size, c_hugePageSize2MB, 21))
+            {
+                return ptr;
+            }
+        }
+    }
+#endif // defined(__linux__) && defined(MAP_HUGETLB)
+
+    // fallback to regular pages, with transparent huge pages hint
 #if defined(__linux__) && defined(MADV_HUGEPAGE)
-    constexpr size_t alignment = 2 * 1024 * 1024;
+    const size_t alignment = s_largePagesEnabled ? 2 * 1024 * 1024 : CACHELINE_SIZE;
 #else
     constexpr size_t alignment = CACHELINE_SIZE;
 #endif // defined(__linux__)
@@ -94,15 +269,37 @@ void* Malloc(size_t size)
     void* ptr = nullptr;
     int ret = posix_memalign(&ptr, alignment, size);
 
+    if (ret != 0)
+    {
+        return nullptr;
+    }
+
 #if defined(__linux__) && defined(MADV_HUGEPAGE)
-    madvise(ptr, size, MADV_HUGEPAGE);
+    if (s_largePagesEnabled)
+    {
+        madvise(ptr, size, MADV_HUGEPAGE);
+    }
 #endif // defined(__linux__)
 
-    return ret != 0 ? nullptr : ptr;
+    return ptr;
 }
 
 void Free(void* ptr)
 {
+    if (!ptr)
+    {
+        return;
+    }
+
+#if defined(__linux__)
+    LargePageAllocations::Info info;
+    if (LargePageAllocations::Get().Remove(ptr, info))
+    {
+        munmap(ptr, info.size);
+        return;
+    }
+#endif // defined(__linux__)
+
     free(ptr);
 }
 
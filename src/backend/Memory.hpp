@@ -32,6 +32,13 @@ inline void AlignedFree(void* ptr)
 
 bool EnableLargePagesSupport();
 
+// allow large (huge) pages for allocations made with Malloc (enabled by default)
+void SetLargePagesEnabled(bool enabled);
+bool AreLargePagesEnabled();
+
+// page size backing a memory block allocated with Malloc
+size_t GetAllocationPageSize(const void* ptr);
+
 [[nodiscard]] void* Malloc(size_t size);
 void Free(void* ptr);
 
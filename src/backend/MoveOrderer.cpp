@@ -129,7 +129,7 @@ void MoveOrderer::DebugPrint() const
 
 void MoveOrderer::InitContinuationHistoryPointers(NodeInfo& node)
 {
-    const uint32_t color = (uint32_t)node.position.GetSideToMove();
+    const uint32_t color = (uint32_t)node.position->GetSideToMove();
     const NodeInfo* nodePtr = &node;
     for (uint32_t i = 0; i < 6; ++i)
     {
@@ -140,7 +140,8 @@ void MoveOrderer::InitContinuationHistoryPointers(NodeInfo& node)
             const uint32_t prevIsCapture = (uint32_t)nodePtr->previousMove.IsCapture();
             const uint32_t prevPiece = (uint32_t)nodePtr->previousMove.GetPiece() - 1;
             const uint32_t prevTo = nodePtr->previousMove.ToSquare().Index();
-            const uint32_t prevColor = (uint32_t)(nodePtr - 1)->position.GetSideToMove();
+            // side to move alternates with every ply (null moves included)
+            const uint32_t prevColor = color ^ ((i + 1) & 1u);
             node.continuationHistories[i] = &(continuationHistory[prevIsCapture][color][prevColor][prevPiece][prevTo]);
         }
         --nodePtr;
@@ -177,7 +178,7 @@ MoveOrderer::CounterType MoveOrderer::GetHistoryScore(const NodeInfo& node, cons
     const uint32_t to = move.ToSquare().Index();
     ASSERT(from < 64);
     ASSERT(to < 64);
-    return quietMoveHistory[(uint32_t)node.position.GetSideToMove()][threats.IsBitSet(from)][threats.IsBitSet(to)][move.FromTo()];
+    return quietMoveHistory[(uint32_t)node.position->GetSideToMove()][threats.IsBitSet(from)][threats.IsBitSet(to)][move.FromTo()];
 }
 
 Move MoveOrderer::GetCounterMove(const NodeInfo& node) const
@@ -187,7 +188,7 @@ Move MoveOrderer::GetCounterMove(const NodeInfo& node) const
         const Move prevMove = node.previousMove;
         const uint32_t piece = (uint32_t)prevMove.GetPiece() - 1;
         const uint32_t to = prevMove.ToSquare().Index();
-        return counterMoves[(uint32_t)node.position.GetSideToMove()][piece][to];
+        return counterMoves[(uint32_t)node.position->GetSideToMove()][piece][to];
     }
     return Move::Invalid();
 }
@@ -209,7 +210,7 @@ void MoveOrderer::UpdateQuietMovesHistory(const NodeInfo& node, const Move* move
     ASSERT(numMoves > 0);
     ASSERT(moves[0].IsQuiet());
 
-    const uint32_t color = (uint32_t)node.position.GetSideToMove();
+    const uint32_t color = (uint32_t)node.position->GetSideToMove();
 
     // update counter move
     if (bestMove.IsQuiet() && node.previousMove.IsValid())
@@ -260,7 +261,7 @@ void MoveOrderer::UpdateCapturesHistory(const NodeInfo& node, const Move* moves,
         return;
     }
 
-    const uint32_t color = (uint32_t)node.position.GetSideToMove();
+    const uint32_t color = (uint32_t)node.position->GetSideToMove();
 
     const int32_t bonus = std::min<int32_t>(CaptureBonusOffset + CaptureBonusLinear * depth, CaptureBonusLimit);
     const int32_t malus = -std::min<int32_t>(CaptureMalusOffset + CaptureMalusLinear * depth, CaptureMalusLimit);
@@ -272,7 +273,7 @@ void MoveOrderer::UpdateCapturesHistory(const NodeInfo& node, const Move* moves,
 
         const int32_t delta = move == bestMove ? bonus : malus;
 
-        const Piece captured = node.position.GetCapturedPiece(move);
+        const Piece captured = node.position->GetCapturedPiece(move);
         ASSERT(captured > Piece::None);
         ASSERT(captured < Piece::King);
 
@@ -291,7 +292,7 @@ void MoveOrderer::ScoreMoves(
     bool withQuiets,
     const NodeCacheEntry* nodeCacheEntry) const
 {
-    const Position& pos = node.position;
+    const Position& pos = *node.position;
 
     const uint32_t color = (uint32_t)pos.GetSideToMove();
     const Bitboard threats = node.threats.allThreats;
@@ -4,24 +4,6 @@
 // enable validation of NN output (check if incremental updates work correctly)
 //#define VALIDATE_NETWORK_OUTPUT
 
-#ifdef NN_ACCUMULATOR_STATS
-
-static std::atomic<uint64_t> s_NumAccumulatorUpdates = 0;
-static std::atomic<uint64_t> s_NumAccumulatorRefreshes = 0;
-
-void NNEvaluator::GetStats(uint64_t& outNumUpdates, uint64_t& outNumRefreshes)
-{
-    outNumUpdates = s_NumAccumulatorUpdates;
-    outNumRefreshes = s_NumAccumulatorRefreshes;
-}
-void NNEvaluator::ResetStats()
-{
-    s_NumAccumulatorUpdates = 0;
-    s_NumAccumulatorRefreshes = 0;
-}
-
-#endif // NN_ACCUMULATOR_STATS
-
 void AccumulatorCache::Init(const nn::PackedNeuralNetwork* net)
 {
     if (currentNet != net)
@@ -128,12 +110,10 @@ template uint32_t PositionToFeaturesVector<true>(const Position& pos, uint16_t*
 template uint32_t PositionToFeaturesVector<false>(const Position& pos, uint16_t* outFeatures, const Color perspective);
 
 template<Color perspective>
-INLINE static uint32_t DirtyPieceToFeatureIndex(const Piece piece, const Color pieceColor, Square square, const Position& pos)
+INLINE static uint32_t DirtyPieceToFeatureIndex(const Piece piece, const Color pieceColor, Square square, Square kingSquare)
 {
     // this must match PositionToFeaturesVector !!!
 
-    Square kingSquare = pos.GetSide(perspective).GetKingSquare();
-
     // flip the according to the perspective
     if constexpr (perspective == Black)
     {
@@ -181,103 +161,136 @@ int32_t NNEvaluator::Evaluate(const nn::PackedNeuralNetwork& network, const Posi
     return network.Run(ourFeatures, numOurFeatures, theirFeatures, numTheirFeatures, GetNetworkVariant(pos));
 }
 
-template<Color perspective>
-INLINE static void UpdateAccumulator(const nn::PackedNeuralNetwork& network, const NodeInfo* prevAccumNode, NodeInfo& node, AccumulatorCache::KingBucket& cache)
+static constexpr uint32_t MaxChangedFeatures = 64;
+
+// a move adds and removes at most two features each (castling, capture with promotion, en passant),
+// so incremental updates over longer chains of dirty accumulators are replaced with a refresh
+static constexpr uint32_t MaxAccumulatorUpdatePlies = MaxChangedFeatures / 2;
+
+struct ChangedFeatures
 {
-    constexpr uint32_t color = (uint32_t)perspective;
+    uint32_t numAdded = 0;
+    uint32_t numRemoved = 0;
+    uint16_t added[MaxChangedFeatures];
+    uint16_t removed[MaxChangedFeatures];
 
-    ASSERT(prevAccumNode != &node);
-    ASSERT(node.nnContext.accumDirty[color]);
+    INLINE bool IsEmpty() const { return numAdded == 0 && numRemoved == 0; }
+};
 
-    constexpr uint32_t maxChangedFeatures = 64;
-    uint32_t numAddedFeatures = 0;
-    uint32_t numRemovedFeatures = 0;
-    uint16_t addedFeatures[maxChangedFeatures];
-    uint16_t removedFeatures[maxChangedFeatures];
+// build a list of features changed between 'prevAccumNode' and 'node'
+template<Color perspective>
+INLINE static void CollectChangedFeatures(const NodeInfo* prevAccumNode, const NodeInfo& node, ChangedFeatures& outFeatures)
+{
+    uint32_t& numAddedFeatures = outFeatures.numAdded;
+    uint32_t& numRemovedFeatures = outFeatures.numRemoved;
+    uint16_t* addedFeatures = outFeatures.added;
+    uint16_t* removedFeatures = outFeatures.removed;
 
-    if (prevAccumNode)
+    // build a list of features to be updated
+    for (const NodeInfo* nodePtr = &node; nodePtr != prevAccumNode; --nodePtr)
     {
-        ASSERT(!prevAccumNode->nnContext.accumDirty[color]);
+        const NNEvaluatorContext& nnContext = nodePtr->nnContext;
 
-        // build a list of features to be updated
-        for (const NodeInfo* nodePtr = &node; nodePtr != prevAccumNode; --nodePtr)
+        for (uint32_t i = 0; i < nnContext.numDirtyPieces; ++i)
         {
-            const NNEvaluatorContext& nnContext = nodePtr->nnContext;
+            const DirtyPiece& dirtyPiece = nnContext.dirtyPieces[i];
 
-            for (uint32_t i = 0; i < nnContext.numDirtyPieces; ++i)
+            if (dirtyPiece.toSquare.IsValid() && dirtyPiece.fromSquare.IsValid())
             {
-                const DirtyPiece& dirtyPiece = nnContext.dirtyPieces[i];
-
-                if (dirtyPiece.toSquare.IsValid() && dirtyPiece.fromSquare.IsValid())
-                {
-                    // TODO use cached accumulator diff for piece move
-                }
-
-                if (dirtyPiece.toSquare.IsValid())
-                {
-                    ASSERT(numAddedFeatures < maxChangedFeatures);
-                    const uint16_t featureIdx = (uint16_t)DirtyPieceToFeatureIndex<perspective>(dirtyPiece.piece, dirtyPiece.color, dirtyPiece.toSquare, node.position);
-                    addedFeatures[numAddedFeatures++] = featureIdx;
-                }
-                if (dirtyPiece.fromSquare.IsValid())
-                {
-                    ASSERT(numRemovedFeatures < maxChangedFeatures);
-                    const uint16_t featureIdx = (uint16_t)DirtyPieceToFeatureIndex<perspective>(dirtyPiece.piece, dirtyPiece.color, dirtyPiece.fromSquare, node.position);
-                    removedFeatures[numRemovedFeatures++] = featureIdx;
-                }
+                // TODO use cached accumulator diff for piece move
             }
 
-            if (nodePtr->ply == 0)
+            if (dirtyPiece.toSquare.IsValid())
             {
-                // reached end of stack
-                break;
+                ASSERT(numAddedFeatures < MaxChangedFeatures);
+                const uint16_t featureIdx = (uint16_t)DirtyPieceToFeatureIndex<perspective>(dirtyPiece.piece, dirtyPiece.color, dirtyPiece.toSquare, node.kingSquares[perspective]);
+                addedFeatures[numAddedFeatures++] = featureIdx;
+            }
+            if (dirtyPiece.fromSquare.IsValid())
+            {
+                ASSERT(numRemovedFeatures < MaxChangedFeatures);
+                const uint16_t featureIdx = (uint16_t)DirtyPieceToFeatureIndex<perspective>(dirtyPiece.piece, dirtyPiece.color, dirtyPiece.fromSquare, node.kingSquares[perspective]);
+                removedFeatures[numRemovedFeatures++] = featureIdx;
             }
         }
 
-        // if same feature is present on both lists, it cancels out
-        for (uint32_t i = 0; i < numAddedFeatures; ++i)
+        if (nodePtr->ply == 0)
+        {
+            // reached end of stack
+            break;
+        }
+    }
+
+    // if same feature is present on both lists, it cancels out
+    for (uint32_t i = 0; i < numAddedFeatures; ++i)
+    {
+        for (uint32_t j = 0; j < numRemovedFeatures; ++j)
         {
-            for (uint32_t j = 0; j < numRemovedFeatures; ++j)
+            if (addedFeatures[i] == removedFeatures[j])
             {
-                if (addedFeatures[i] == removedFeatures[j])
-                {
-                    addedFeatures[i--] = addedFeatures[--numAddedFeatures];
-                    removedFeatures[j--] = removedFeatures[--numRemovedFeatures];
-                    break;
-                }
+                addedFeatures[i--] = addedFeatures[--numAddedFeatures];
+                removedFeatures[j--] = removedFeatures[--numRemovedFeatures];
+                break;
             }
         }
+    }
 
 #ifdef VALIDATE_NETWORK_OUTPUT
-        {
-            const uint32_t maxFeatures = 64;
-            uint16_t referenceFeatures[maxFeatures];
-            const uint32_t numReferenceFeatures = PositionToFeaturesVector(node.position, referenceFeatures, perspective);
+    {
+        const uint32_t maxFeatures = 64;
+        uint16_t referenceFeatures[maxFeatures];
+        const uint32_t numReferenceFeatures = PositionToFeaturesVector(*node.position, referenceFeatures, perspective);
 
-            for (uint32_t i = 0; i < numAddedFeatures; ++i)
+        for (uint32_t i = 0; i < numAddedFeatures; ++i)
+        {
+            bool found = false;
+            for (uint32_t j = 0; j < numReferenceFeatures; ++j)
             {
-                bool found = false;
-                for (uint32_t j = 0; j < numReferenceFeatures; ++j)
-                {
-                    if (addedFeatures[i] == referenceFeatures[j]) found = true;
-                }
-                ASSERT(found);
+                if (addedFeatures[i] == referenceFeatures[j]) found = true;
             }
-            for (uint32_t i = 0; i < numRemovedFeatures; ++i)
+            ASSERT(found);
+        }
+        for (uint32_t i = 0; i < numRemovedFeatures; ++i)
+        {
+            for (uint32_t j = 0; j < numReferenceFeatures; ++j)
             {
-                for (uint32_t j = 0; j < numReferenceFeatures; ++j)
-                {
-                    ASSERT(removedFeatures[i] != referenceFeatures[j]);
-                }
+                ASSERT(removedFeatures[i] != referenceFeatures[j]);
             }
         }
+    }
 #endif // VALIDATE_NETWORK_OUTPUT
+}
+
+// run accumulator update kernel matching feature transformer weights format of the network
+INLINE static void UpdateAccumulatorChain(const nn::PackedNeuralNetwork& network, const nn::Accumulator& source, uint32_t numSteps, const nn::AccumulatorUpdateStep* steps)
+{
+    if (network.HasInt8FeatureTransformer())
+    {
+        nn::Accumulator::UpdateChain(source, network.GetAccumulatorInt8Weights(), numSteps, steps);
+    }
+    else
+    {
+        nn::Accumulator::UpdateChain(source, network.GetAccumulatorWeights(), numSteps, steps);
+    }
+}
+
+template<Color perspective>
+INLINE static void UpdateAccumulator(const nn::PackedNeuralNetwork& network, const NodeInfo* prevAccumNode, NodeInfo& node, AccumulatorCache::KingBucket& cache)
+{
+    constexpr uint32_t color = (uint32_t)perspective;
+
+    ASSERT(prevAccumNode != &node);
+    ASSERT(node.nnContext.accumDirty[color]);
+
+    ChangedFeatures features;
+
+    if (prevAccumNode)
+    {
+        ASSERT(!prevAccumNode->nnContext.accumDirty[color]);
 
-#ifdef NN_ACCUMULATOR_STATS
-        s_NumAccumulatorUpdates++;
-#endif // NN_ACCUMULATOR_STATS
-        
-        if (numAddedFeatures == 0 && numRemovedFeatures == 0)
+        CollectChangedFeatures<perspective>(prevAccumNode, node, features);
+
+        if (features.IsEmpty())
         {
             // accumulator is unchanged, just point to the previous accumulator
             node.accumulatorPtr[color] = prevAccumNode->accumulatorPtr[color];
@@ -285,18 +298,16 @@ INLINE static void UpdateAccumulator(const nn::PackedNeuralNetwork& network, con
         else
         {
             node.accumulatorPtr[color] = &node.accumulatorData[color];
-            node.accumulatorData[color].Update(
-                *(prevAccumNode->accumulatorPtr[color]),
-                network.GetAccumulatorWeights(),
-                numAddedFeatures, addedFeatures,
-                numRemovedFeatures, removedFeatures);
+            const nn::AccumulatorUpdateStep step{ &node.accumulatorData[color], features.numAdded, features.numRemoved, features.added, features.removed };
+            UpdateAccumulatorChain(network, *(prevAccumNode->accumulatorPtr[color]), 1, &step);
         }
     }
     else // refresh accumulator
     {
         for (Color c = 0; c < 2; ++c)
         {
-            const Position& pos = node.position;
+            const Position& pos = *node.position;
+            const Square kingSquare = pos.GetSide(perspective).GetKingSquare();
             const Bitboard* bitboards = &pos.GetSide(c).pawns;
             for (uint32_t p = 0; p < 6; ++p)
             {
@@ -307,46 +318,95 @@ INLINE static void UpdateAccumulator(const nn::PackedNeuralNetwork& network, con
                 // additions
                 (curr & ~prev).Iterate([&](const Square sq) INLINE_LAMBDA
                 {
-                    ASSERT(numAddedFeatures < maxChangedFeatures);
-                    addedFeatures[numAddedFeatures++] = (uint16_t)DirtyPieceToFeatureIndex<perspective>(piece, c, sq, pos);
+                    ASSERT(features.numAdded < MaxChangedFeatures);
+                    features.added[features.numAdded++] = (uint16_t)DirtyPieceToFeatureIndex<perspective>(piece, c, sq, kingSquare);
                 });
 
                 // removals
                 (prev & ~curr).Iterate([&](const Square sq) INLINE_LAMBDA
                 {
-                    ASSERT(numRemovedFeatures < maxChangedFeatures);
-                    removedFeatures[numRemovedFeatures++] = (uint16_t)DirtyPieceToFeatureIndex<perspective>(piece, c, sq, pos);
+                    ASSERT(features.numRemoved < MaxChangedFeatures);
+                    features.removed[features.numRemoved++] = (uint16_t)DirtyPieceToFeatureIndex<perspective>(piece, c, sq, kingSquare);
                 });
 
                 cache.pieces[c][p] = curr;
             }
         }
 
-        cache.accum.Update(
-            cache.accum,
-            network.GetAccumulatorWeights(),
-            numAddedFeatures, addedFeatures,
-            numRemovedFeatures, removedFeatures);
+        // update cached accumulator in place and write the result to the node in the same pass
+        const nn::AccumulatorUpdateStep steps[] =
+        {
+            { &cache.accum, features.numAdded, features.numRemoved, features.added, features.removed },
+            { &node.accumulatorData[color] },
+        };
+        UpdateAccumulatorChain(network, cache.accum, 2, steps);
 
         node.accumulatorPtr[color] = &node.accumulatorData[color];
-        node.accumulatorData[color] = cache.accum;
     }
 
     // mark accumulator as computed
     node.nnContext.accumDirty[color] = false;
 }
 
+// update both parent and the node in a single pass over the source accumulator
 template<Color perspective>
-INLINE static void RefreshAccumulator(const nn::PackedNeuralNetwork& network, NodeInfo& node, AccumulatorCache& cache)
+INLINE static void UpdateAccumulatorWithParent(const nn::PackedNeuralNetwork& network, const NodeInfo* prevAccumNode, NodeInfo& parent, NodeInfo& node)
 {
     constexpr uint32_t color = (uint32_t)perspective;
-    const Position& pos = node.position;
 
+    ASSERT(prevAccumNode && prevAccumNode != &parent);
+    ASSERT(!prevAccumNode->nnContext.accumDirty[color]);
+    ASSERT(parent.nnContext.accumDirty[color]);
+    ASSERT(node.nnContext.accumDirty[color]);
+    ASSERT(&parent == &node - 1);
+
+    ChangedFeatures parentFeatures;
+    CollectChangedFeatures<perspective>(prevAccumNode, parent, parentFeatures);
+
+    ChangedFeatures nodeFeatures;
+    CollectChangedFeatures<perspective>(&parent, node, nodeFeatures);
+
+    nn::AccumulatorUpdateStep steps[2];
+    uint32_t numSteps = 0;
+
+    if (parentFeatures.IsEmpty())
+    {
+        parent.accumulatorPtr[color] = prevAccumNode->accumulatorPtr[color];
+    }
+    else
+    {
+        parent.accumulatorPtr[color] = &parent.accumulatorData[color];
+        steps[numSteps++] = { &parent.accumulatorData[color], parentFeatures.numAdded, parentFeatures.numRemoved, parentFeatures.added, parentFeatures.removed };
+    }
+
+    if (nodeFeatures.IsEmpty())
+    {
+        node.accumulatorPtr[color] = parent.accumulatorPtr[color];
+    }
+    else
+    {
+        node.accumulatorPtr[color] = &node.accumulatorData[color];
+        steps[numSteps++] = { &node.accumulatorData[color], nodeFeatures.numAdded, nodeFeatures.numRemoved, nodeFeatures.added, nodeFeatures.removed };
+    }
+
+    if (numSteps > 0)
+    {
+        UpdateAccumulatorChain(network, *(prevAccumNode->accumulatorPtr[color]), numSteps, steps);
+    }
+
+    parent.nnContext.accumDirty[color] = false;
+    node.nnContext.accumDirty[color] = false;
+}
+
+template<Color perspective>
+INLINE static void RefreshAccumulator(const nn::PackedNeuralNetwork& network, NodeInfo& node, AccumulatorCache& cache)
+{
+    constexpr uint32_t color = (uint32_t)perspective;
     uint32_t kingSide, kingBucket;
     if constexpr (perspective == White)
-        GetKingSideAndBucket(pos.Whites().GetKingSquare(), kingSide, kingBucket);
+        GetKingSideAndBucket(node.kingSquares[White], kingSide, kingBucket);
     else
-        GetKingSideAndBucket(pos.Blacks().GetKingSquare().FlippedRank(), kingSide, kingBucket);
+        GetKingSideAndBucket(node.kingSquares[Black].FlippedRank(), kingSide, kingBucket);
 
     AccumulatorCache::KingBucket& kingBucketCache = cache.kingBuckets[color][kingBucket + kingSide * nn::NumKingBuckets];
 
@@ -356,9 +416,9 @@ INLINE static void RefreshAccumulator(const nn::PackedNeuralNetwork& network, No
     {
         uint32_t newKingSide, newKingBucket;
         if constexpr (perspective == White)
-            GetKingSideAndBucket(static_cast<const Position&>(nodePtr->position).Whites().GetKingSquare(), newKingSide, newKingBucket);
+            GetKingSideAndBucket(nodePtr->kingSquares[White], newKingSide, newKingBucket);
         else
-            GetKingSideAndBucket(static_cast<const Position&>(nodePtr->position).Blacks().GetKingSquare().FlippedRank(), newKingSide, newKingBucket);
+            GetKingSideAndBucket(nodePtr->kingSquares[Black].FlippedRank(), newKingSide, newKingBucket);
 
         if (newKingSide != kingSide || newKingBucket != kingBucket)
         {
@@ -378,6 +438,12 @@ INLINE static void RefreshAccumulator(const nn::PackedNeuralNetwork& network, No
             // reached end of stack
             break;
         }
+
+        if (&node - nodePtr >= (ptrdiff_t)MaxAccumulatorUpdatePlies)
+        {
+            // too many dirty accumulators (e.g. evaluations skipped thanks to eval cache or TT), refresh
+            break;
+        }
     }
 
     NodeInfo* parentInfo = &node - 1;
@@ -385,6 +451,7 @@ INLINE static void RefreshAccumulator(const nn::PackedNeuralNetwork& network, No
     if (prevAccumNode == &node)
     {
         // do nothing - accumulator is already up to date (was cached)
+        cache.stats.numCached++;
     }
     else if (node.ply > 0 && prevAccumNode &&
         parentInfo != prevAccumNode &&
@@ -393,12 +460,20 @@ INLINE static void RefreshAccumulator(const nn::PackedNeuralNetwork& network, No
         // two-stage update:
         // if parent node has invalid accumulator, update it first
         // this way, sibling nodes can reuse parent's accumulator
-        UpdateAccumulator<perspective>(network, prevAccumNode, *parentInfo, kingBucketCache);
-        UpdateAccumulator<perspective>(network, parentInfo, node, kingBucketCache);
+        UpdateAccumulatorWithParent<perspective>(network, prevAccumNode, *parentInfo, node);
+        cache.stats.numUpdates += 2;
+        cache.stats.numSkippedPlies += parentInfo - prevAccumNode - 1;
+    }
+    else if (prevAccumNode)
+    {
+        UpdateAccumulator<perspective>(network, prevAccumNode, node, kingBucketCache);
+        cache.stats.numUpdates++;
+        cache.stats.numSkippedPlies += &node - prevAccumNode - 1;
     }
     else
     {
         UpdateAccumulator<perspective>(network, prevAccumNode, node, kingBucketCache);
+        cache.stats.numRefreshes++;
     }
 }
 
@@ -414,13 +489,13 @@ int32_t NNEvaluator::Evaluate(const nn::PackedNeuralNetwork& network, NodeInfo&
     RefreshAccumulator<White>(network, node, cache);
     RefreshAccumulator<Black>(network, node, cache);
 
-    const nn::Accumulator& ourAccumulator = *node.accumulatorPtr[(uint32_t)node.position.GetSideToMove()];
-    const nn::Accumulator& theirAccumulator = *node.accumulatorPtr[(uint32_t)node.position.GetSideToMove() ^ 1u];
-    const int32_t nnOutput = network.Run(ourAccumulator, theirAccumulator, GetNetworkVariant(node.position));
+    const nn::Accumulator& ourAccumulator = *node.accumulatorPtr[(uint32_t)node.position->GetSideToMove()];
+    const nn::Accumulator& theirAccumulator = *node.accumulatorPtr[(uint32_t)node.position->GetSideToMove() ^ 1u];
+    const int32_t nnOutput = network.Run(ourAccumulator, theirAccumulator, GetNetworkVariant(*node.position));
 
 #ifdef VALIDATE_NETWORK_OUTPUT
     {
-        const int32_t nnOutputReference = Evaluate(network, node.position);
+        const int32_t nnOutputReference = Evaluate(network, *node.position);
         ASSERT(nnOutput == nnOutputReference);
     }
     if (node.nnContext.nnScore != InvalidValue)
@@ -4,8 +4,7 @@
 #include "Accumulator.hpp"
 #include "Memory.hpp"
 #include "Position.hpp"
-
-//#define NN_ACCUMULATOR_STATS
+#include "EvalCache.hpp"
 
 struct DirtyPiece
 {
@@ -44,6 +43,24 @@ struct NNEvaluatorContext
     }
 };
 
+// accumulator work counters, collected per search thread
+struct AccumulatorStats
+{
+    uint64_t numUpdates = 0;        // incremental updates from the closest computed ancestor
+    uint64_t numRefreshes = 0;      // updates from the king bucket cache (king bucket changed or no computed ancestor)
+    uint64_t numSkippedPlies = 0;   // dirty plies between the node and the closest computed ancestor, never computed on their own
+    uint64_t numCached = 0;         // accumulator was already up to date
+
+    AccumulatorStats& operator += (const AccumulatorStats& other)
+    {
+        numUpdates += other.numUpdates;
+        numRefreshes += other.numRefreshes;
+        numSkippedPlies += other.numSkippedPlies;
+        numCached += other.numCached;
+        return *this;
+    }
+};
+
 struct AccumulatorCache
 {
     struct KingBucket
@@ -53,6 +70,8 @@ struct AccumulatorCache
     };
     KingBucket kingBuckets[2][2 * nn::NumKingBuckets]; // [side to move][king side * king bucket]
     const nn::PackedNeuralNetwork* currentNet = nullptr;
+    AccumulatorStats stats;
+    EvalCacheStats evalCacheStats;
 
     void Init(const nn::PackedNeuralNetwork* net);
 };
@@ -68,11 +87,6 @@ public:
 
     // update accumulators without evaluating
     static void EnsureAccumulatorUpdated(const nn::PackedNeuralNetwork& network, NodeInfo& node, AccumulatorCache& cache);
-
-#ifdef NN_ACCUMULATOR_STATS
-    static void GetStats(uint64_t& outNumUpdates, uint64_t& outNumRefreshes);
-    static void ResetStats();
-#endif // NN_ACCUMULATOR_STATS
 };
 
 
@@ -0,0 +1,171 @@
+#include "Numa.hpp"
+
+#include <vector>
+#include <fstream>
+
+#if defined(PLATFORM_WINDOWS)
+
+#define WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif // NOMINMAX
+#include <Windows.h>
+
+#elif defined(__linux__)
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#endif
+
+
+#if defined(__linux__)
+
+// parse list in format used by sysfs, e.g. "0-3,8-11"
+static std::vector<uint32_t> ParseSysfsList(const std::string& str)
+{
+    std::vector<uint32_t> result;
+
+    size_t pos = 0;
+    while (pos < str.size())
+    {
+        size_t end = str.find(',', pos);
+        if (end == std::string::npos) end = str.size();
+
+        const std::string range = str.substr(pos, end - pos);
+        const size_t dash = range.find('-');
+
+        const uint32_t first = (uint32_t)atoi(range.c_str());
+        const uint32_t last = dash != std::string::npos ? (uint32_t)atoi(range.c_str() + dash + 1) : first;
+
+        for (uint32_t i = first; i <= last; ++i)
+        {
+            result.push_back(i);
+        }
+
+        pos = end + 1;
+    }
+
+    return result;
+}
+
+static std::vector<uint32_t> ReadSysfsList(const std::string& path)
+{
+    std::ifstream file(path);
+    std::string str;
+    if (!file || !std::getline(file, str))
+    {
+        return {};
+    }
+    return ParseSysfsList(str);
+}
+
+#endif // defined(__linux__)
+
+
+uint32_t GetNumNumaNodes()
+{
+    static const uint32_t numNodes = []()
+    {
+#if defined(PLATFORM_WINDOWS)
+        ULONG highestNodeNumber = 0;
+        if (!::GetNumaHighestNodeNumber(&highestNodeNumber))
+        {
+            return 1u;
+        }
+        return (uint32_t)highestNodeNumber + 1u;
+#elif defined(__linux__)
+        const std::vector<uint32_t> nodes = ReadSysfsList("/sys/devices/system/node/online");
+        return nodes.empty() ? 1u : nodes.back() + 1u;
+#else
+        return 1u;
+#endif
+    }();
+
+    return numNodes;
+}
+
+uint32_t GetNumaNodeForThread(uint32_t threadIndex, uint32_t numThreads)
+{
+    ASSERT(threadIndex < numThreads);
+
+    const uint32_t numNodes = GetNumNumaNodes();
+    if (numNodes <= 1 || numThreads == 0)
+    {
+        return 0;
+    }
+
+    // contiguous blocks of threads, so threads on the same node share L3
+    return static_cast<uint32_t>((uint64_t)threadIndex * numNodes / numThreads);
+}
+
+bool BindCurrentThreadToNumaNode(uint32_t node)
+{
+    if (node >= GetNumNumaNodes())
+    {
+        return false;
+    }
+
+#if defined(PLATFORM_WINDOWS)
+    GROUP_AFFINITY affinity;
+    if (!::GetNumaNodeProcessorMaskEx((USHORT)node, &affinity))
+    {
+        return false;
+    }
+    return ::SetThreadGroupAffinity(::GetCurrentThread(), &affinity, nullptr) != 0;
+#elif defined(__linux__)
+    const std::vector<uint32_t> cpus = ReadSysfsList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    if (cpus.empty())
+    {
+        return false;
+    }
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (const uint32_t cpu : cpus)
+    {
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &cpuSet);
+    }
+
+    return 0 == pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet);
+#else
+    return false;
+#endif
+}
+
+bool InterleaveMemoryAcrossNumaNodes(void* ptr, size_t size)
+{
+    const uint32_t numNodes = GetNumNumaNodes();
+    if (!ptr || numNodes <= 1)
+    {
+        return false;
+    }
+
+#if defined(__linux__) && defined(SYS_mbind)
+    constexpr int MPOL_INTERLEAVE_ = 3;
+    constexpr unsigned MPOL_MF_MOVE_ = 1u << 1;
+    constexpr uint32_t bitsPerWord = 8 * sizeof(unsigned long);
+
+    const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t begin = ((size_t)ptr + pageSize - 1) / pageSize * pageSize;
+    const size_t end = ((size_t)ptr + size) / pageSize * pageSize;
+    if (begin >= end)
+    {
+        return false;
+    }
+
+    std::vector<unsigned long> nodeMask((numNodes + bitsPerWord - 1) / bitsPerWord, 0);
+    for (uint32_t i = 0; i < numNodes; ++i)
+    {
+        nodeMask[i / bitsPerWord] |= 1ul << (i % bitsPerWord);
+    }
+
+    const long ret = syscall(SYS_mbind, begin, end - begin, MPOL_INTERLEAVE_, nodeMask.data(), (unsigned long)numNodes + 1, MPOL_MF_MOVE_);
+    return ret == 0;
+#else
+    UNUSED(size);
+    return false;
+#endif
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Common.hpp"
+
+// get number of NUMA nodes available in the system (at least 1)
+uint32_t GetNumNumaNodes();
+
+// get NUMA node that a search/worker thread should be bound to
+// threads are distributed evenly across all the nodes
+uint32_t GetNumaNodeForThread(uint32_t threadIndex, uint32_t numThreads);
+
+// restrict the calling thread to CPUs of a given NUMA node
+bool BindCurrentThreadToNumaNode(uint32_t node);
+
+// request memory pages of given range to be interleaved across all NUMA nodes
+// must be called before the memory is touched for the first time
+bool InterleaveMemoryAcrossNumaNodes(void* ptr, size_t size);
@@ -194,6 +194,266 @@ INLINE static int32_t LinearLayer_Accum_SingleOutput(
     return val;
 }
 
+// maximum number of chunk indices written past the actual number of non-zero chunks
+static constexpr uint32_t ChunkIndicesPadding = 8;
+
+#if defined(NN_USE_AVX512) || defined(NN_USE_AVX2) || defined(NN_USE_SSE4)
+// offsets of set bits for each 8-bit mask, so non-zero chunk indices can be written without branching
+struct NonZeroChunksLookupTable
+{
+    alignas(16) uint16_t offsets[256][8];
+
+    constexpr NonZeroChunksLookupTable() : offsets()
+    {
+        for (uint32_t mask = 0; mask < 256; ++mask)
+        {
+            uint32_t count = 0;
+            for (uint32_t i = 0; i < 8; ++i)
+            {
+                if (mask & (1u << i)) offsets[mask][count++] = (uint16_t)i;
+            }
+        }
+    }
+};
+
+static constexpr NonZeroChunksLookupTable c_nonZeroChunksLookupTable;
+
+INLINE static void WriteNonZeroChunks(uint32_t mask, uint32_t baseIndex, uint16_t* outChunks, uint32_t& numChunks)
+{
+    ASSERT(mask < 256);
+    const __m128i offsets = _mm_load_si128(reinterpret_cast<const __m128i*>(c_nonZeroChunksLookupTable.offsets[mask]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(outChunks + numChunks), _mm_add_epi16(offsets, _mm_set1_epi16((int16_t)baseIndex)));
+    numChunks += PopCount((uint8_t)mask);
+}
+#endif // NN_USE_AVX512 || NN_USE_AVX2 || NN_USE_SSE4
+
+// Convert both accumulators to 8-bit clipped-ReLU activations and collect indices of non-zero 4-byte input chunks.
+// Most of accumulator values are clipped to zero, so the following layer can skip majority of its weights.
+static uint32_t ClippedReLU_Accum_FindNonZeroChunks(
+    const AccumulatorType* inputA, const AccumulatorType* inputB,
+    IntermediateType* outputs, uint16_t* outChunks)
+{
+    uint32_t numChunks = 0;
+
+    for (uint32_t side = 0; side < 2; ++side)
+    {
+        const AccumulatorType* input = side == 0 ? inputA : inputB;
+        IntermediateType* output = outputs + side * AccumulatorSize;
+        const uint32_t chunkOffset = side * AccumulatorSize / 4;
+
+#if defined(NN_USE_AVX512) || defined(NN_USE_AVX2)
+        constexpr uint32_t registerWidth = 32;
+        static_assert(AccumulatorSize % registerWidth == 0, "");
+
+        for (uint32_t j = 0; j < AccumulatorSize; j += registerWidth)
+        {
+            __m256i inA = _mm256_load_si256(reinterpret_cast<const __m256i*>(input + j));
+            __m256i inB = _mm256_load_si256(reinterpret_cast<const __m256i*>(input + j + registerWidth / 2));
+
+            // apply clipped-ReLU and scale down to 8-bit range
+            inA = _mm256_srli_epi16(_mm256_min_epi16(_mm256_max_epi16(inA, _mm256_setzero_si256()), _mm256_set1_epi16(ActivationRangeScaling)), HiddenLayerActivationShift);
+            inB = _mm256_srli_epi16(_mm256_min_epi16(_mm256_max_epi16(inB, _mm256_setzero_si256()), _mm256_set1_epi16(ActivationRangeScaling)), HiddenLayerActivationShift);
+
+            // pack to 8 bits (packing is done per 128-bit lane, so lanes need to be reordered)
+            const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(inA, inB), 0xD8);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(output + j), packed);
+
+            const uint32_t mask = ~(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(packed, _mm256_setzero_si256()))) & 0xFF;
+            WriteNonZeroChunks(mask, chunkOffset + j / 4, outChunks, numChunks);
+        }
+
+#elif defined(NN_USE_SSE4)
+        constexpr uint32_t registerWidth = 16;
+        static_assert(AccumulatorSize % registerWidth == 0, "");
+
+        for (uint32_t j = 0; j < AccumulatorSize; j += registerWidth)
+        {
+            __m128i inA = _mm_load_si128(reinterpret_cast<const __m128i*>(input + j));
+            __m128i inB = _mm_load_si128(reinterpret_cast<const __m128i*>(input + j + registerWidth / 2));
+
+            // apply clipped-ReLU and scale down to 8-bit range
+            inA = _mm_srli_epi16(_mm_min_epi16(_mm_max_epi16(inA, _mm_setzero_si128()), _mm_set1_epi16(ActivationRangeScaling)), HiddenLayerActivationShift);
+            inB = _mm_srli_epi16(_mm_min_epi16(_mm_max_epi16(inB, _mm_setzero_si128()), _mm_set1_epi16(ActivationRangeScaling)), HiddenLayerActivationShift);
+
+            const __m128i packed = _mm_packus_epi16(inA, inB);
+            _mm_store_si128(reinterpret_cast<__m128i*>(output + j), packed);
+
+            const uint32_t mask = ~(uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(packed, _mm_setzero_si128()))) & 0xF;
+            WriteNonZeroChunks(mask, chunkOffset + j / 4, outChunks, numChunks);
+        }
+
+#else
+        for (uint32_t j = 0; j < AccumulatorSize; j += 4)
+        {
+            uint32_t chunk = 0;
+            for (uint32_t k = 0; k < 4; ++k)
+            {
+                const AccumulatorType in = std::clamp<AccumulatorType>(input[j + k], 0, ActivationRangeScaling);
+                output[j + k] = (IntermediateType)(in >> HiddenLayerActivationShift);
+                chunk |= output[j + k];
+            }
+            outChunks[numChunks] = (uint16_t)(chunkOffset + j / 4);
+            numChunks += chunk != 0;
+        }
+#endif
+    }
+
+    return numChunks;
+}
+
+// Apply clipped-ReLU to hidden layer outputs and collect indices of non-zero 4-byte output chunks
+static uint32_t ClippedReLU_FindNonZeroChunks(const int32_t* inputs, uint32_t numInputs, IntermediateType* outputs, uint16_t* outChunks)
+{
+    ASSERT(numInputs % 4 == 0);
+
+    uint32_t numChunks = 0;
+    for (uint32_t j = 0; j < numInputs; j += 4)
+    {
+        uint32_t chunk = 0;
+        for (uint32_t k = 0; k < 4; ++k)
+        {
+            outputs[j + k] = (IntermediateType)std::clamp<int32_t>(inputs[j + k] >> HiddenLayerWeightScaleShift, 0, HiddenLayerActivationScale);
+            chunk |= outputs[j + k];
+        }
+        outChunks[numChunks] = (uint16_t)(j / 4);
+        numChunks += chunk != 0;
+    }
+    return numChunks;
+}
+
+// Hidden layer with 8-bit inputs and 8-bit weights, only non-zero input chunks are processed.
+// Weights are stored in [numInputs / 4][NumOutputs][4] order, so all weights for a single input chunk are contiguous.
+template<uint32_t NumOutputs>
+static void LinearLayer_Sparse(
+    const HiddenLayerWeightType* weights, const HiddenLayerBiasType* biases,
+    const IntermediateType* inputs, const uint16_t* chunks, uint32_t numChunks,
+    int32_t* outputs)
+{
+    static_assert(NumOutputs % 8 == 0, "");
+
+#if defined(NN_USE_AVX512) || defined(NN_USE_AVX2)
+    constexpr uint32_t numRegisters = NumOutputs / 8;
+
+    __m256i sums[numRegisters];
+    for (uint32_t k = 0; k < numRegisters; ++k)
+    {
+        sums[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(biases) + k);
+    }
+
+#ifndef NN_USE_VNNI
+    const __m256i ones = _mm256_set1_epi16(1);
+#endif // NN_USE_VNNI
+
+    for (uint32_t i = 0; i < numChunks; ++i)
+    {
+        const uint32_t chunkIndex = chunks[i];
+
+        // broadcast 4 inputs to all 32-bit lanes
+        int32_t chunk;
+        memcpy(&chunk, inputs + 4 * chunkIndex, sizeof(chunk));
+        const __m256i in = _mm256_set1_epi32(chunk);
+
+        const __m256i* w = reinterpret_cast<const __m256i*>(weights + 4 * NumOutputs * chunkIndex);
+        for (uint32_t k = 0; k < numRegisters; ++k)
+        {
+            // perform 8bit x 8bit multiplication and accumulate groups of 4 to 32bit registers
+#ifdef NN_USE_VNNI
+            sums[k] = _mm256_dpbusd_epi32(sums[k], in, _mm256_load_si256(w + k));
+#else
+            sums[k] = _mm256_add_epi32(sums[k], _mm256_madd_epi16(_mm256_maddubs_epi16(in, _mm256_load_si256(w + k)), ones));
+#endif // NN_USE_VNNI
+        }
+    }
+
+    for (uint32_t k = 0; k < numRegisters; ++k)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(outputs) + k, sums[k]);
+    }
+
+#elif defined(NN_USE_SSE4)
+    constexpr uint32_t numRegisters = NumOutputs / 4;
+
+    __m128i sums[numRegisters];
+    for (uint32_t k = 0; k < numRegisters; ++k)
+    {
+        sums[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(biases) + k);
+    }
+
+    const __m128i ones = _mm_set1_epi16(1);
+
+    for (uint32_t i = 0; i < numChunks; ++i)
+    {
+        const uint32_t chunkIndex = chunks[i];
+
+        // broadcast 4 inputs to all 32-bit lanes
+        int32_t chunk;
+        memcpy(&chunk, inputs + 4 * chunkIndex, sizeof(chunk));
+        const __m128i in = _mm_set1_epi32(chunk);
+
+        const __m128i* w = reinterpret_cast<const __m128i*>(weights + 4 * NumOutputs * chunkIndex);
+        for (uint32_t k = 0; k < numRegisters; ++k)
+        {
+            sums[k] = _mm_add_epi32(sums[k], _mm_madd_epi16(_mm_maddubs_epi16(in, _mm_load_si128(w + k)), ones));
+        }
+    }
+
+    for (uint32_t k = 0; k < numRegisters; ++k)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(outputs) + k, sums[k]);
+    }
+
+#else
+    for (uint32_t k = 0; k < NumOutputs; ++k)
+    {
+        outputs[k] = biases[k];
+    }
+
+    for (uint32_t i = 0; i < numChunks; ++i)
+    {
+        const uint32_t chunkIndex = chunks[i];
+        const IntermediateType* in = inputs + 4 * chunkIndex;
+        const HiddenLayerWeightType* w = weights + 4 * NumOutputs * chunkIndex;
+
+        for (uint32_t k = 0; k < NumOutputs; ++k)
+        {
+            for (uint32_t j = 0; j < 4; ++j)
+            {
+                outputs[k] += (int32_t)in[j] * (int32_t)w[4 * k + j];
+            }
+        }
+    }
+#endif
+}
+
+static void LinearLayer_Sparse(
+    uint32_t numOutputs,
+    const HiddenLayerWeightType* weights, const HiddenLayerBiasType* biases,
+    const IntermediateType* inputs, const uint16_t* chunks, uint32_t numChunks,
+    int32_t* outputs)
+{
+    switch (numOutputs)
+    {
+    case 8:     LinearLayer_Sparse<8>(weights, biases, inputs, chunks, numChunks, outputs); break;
+    case 16:    LinearLayer_Sparse<16>(weights, biases, inputs, chunks, numChunks, outputs); break;
+    case 32:    LinearLayer_Sparse<32>(weights, biases, inputs, chunks, numChunks, outputs); break;
+    case 64:    LinearLayer_Sparse<64>(weights, biases, inputs, chunks, numChunks, outputs); break;
+    case 128:   LinearLayer_Sparse<128>(weights, biases, inputs, chunks, numChunks, outputs); break;
+    default:    ASSERT(!"Unsupported hidden layer size");
+    }
+}
+
+static int32_t LinearLayer_SingleOutput(
+    const LastLayerWeightType* weights, const LastLayerBiasType* biases,
+    const IntermediateType* inputs, uint32_t numInputs)
+{
+    int32_t val = biases[0];
+    for (uint32_t i = 0; i < numInputs; ++i)
+    {
+        val += (int32_t)inputs[i] * (int32_t)weights[i];
+    }
+    return val;
+}
+
 ///
 
 PackedNeuralNetwork::PackedNeuralNetwork()
@@ -211,7 +471,7 @@ void PackedNeuralNetwork::Release()
 
     if (allocatedData)
     {
-        AlignedFree(allocatedData);
+        Free(allocatedData);
         allocatedData = nullptr;
     }
 
@@ -226,7 +486,8 @@ size_t PackedNeuralNetwork::GetWeightsBufferSize() const
 }
 
 bool PackedNeuralNetwork::Resize(const std::vector<uint32_t>& layerSizes,
-                                 const std::vector<uint32_t>& numVariantsPerLayer)
+                                 const std::vector<uint32_t>& numVariantsPerLayer,
+                                 uint32_t version)
 {
     Release();
 
@@ -235,8 +496,13 @@ bool PackedNeuralNetwork::Resize(const std::vector<uint32_t>& layerSizes,
         return false;
     }
 
+    if (version != CurrentVersion && version != Int8FeatureTransformerVersion)
+    {
+        return false;
+    }
+
     header.magic = MagicNumber;
-    header.version = CurrentVersion;
+    header.version = version;
 
     for (size_t i = 0; i < layerSizes.size(); ++i)
     {
@@ -248,7 +514,7 @@ bool PackedNeuralNetwork::Resize(const std::vector<uint32_t>& layerSizes,
     InitLayerDataSizes();
 
     const size_t weightsSize = GetWeightsBufferSize();
-    allocatedData = AlignedMalloc(weightsSize, CACHELINE_SIZE);
+    allocatedData = Malloc(weightsSize);
     weightsBuffer = (uint8_t*)allocatedData;
 
     InitLayerDataPointers();
@@ -270,7 +536,7 @@ void PackedNeuralNetwork::InitLayerDataSizes()
     memset(layerDataSizes, 0, sizeof(layerDataSizes));
 
     layerDataSizes[0] = header.layerVariants[0] * RoundUp<uint32_t, CACHELINE_SIZE>(
-        (header.layerSizes[0] * (header.layerSizes[1] / 2) * sizeof(FirstLayerWeightType) +
+        (header.layerSizes[0] * (header.layerSizes[1] / 2) * (uint32_t)GetAccumulatorWeightSize() +
         (header.layerSizes[1] / 2) * sizeof(FirstLayerBiasType)));
     ASSERT(layerDataSizes[0] > 0);
 
@@ -320,7 +586,7 @@ void PackedNeuralNetwork::GetLayerWeightsAndBiases(uint32_t layerIndex, uint32_t
 
     if (layerIndex == 0)
     {
-        weightSize = sizeof(FirstLayerWeightType);
+        weightSize = GetAccumulatorWeightSize();
         biasSize = sizeof(FirstLayerBiasType);
     }
     else if (layerIndex + 1 == numActiveLayers)
@@ -491,7 +757,7 @@ bool PackedNeuralNetwork::LoadFromFile(const char* filePath)
         goto onError;
     }
 
-    if (header.version != CurrentVersion)
+    if (header.version != CurrentVersion && header.version != Int8FeatureTransformerVersion)
     {
         std::cerr << "Failed to load neural network: " << "unsupported version" << std::endl;
         goto onError;
@@ -532,6 +798,16 @@ bool PackedNeuralNetwork::LoadFromFile(const char* filePath)
         goto onError;
     }
 
+    for (uint32_t i = 2; i < numActiveLayers; ++i)
+    {
+        const uint32_t layerSize = header.layerSizes[i];
+        if (layerSize < MinNeuronsInHiddenLayers || layerSize > MaxNeuronsInHiddenLayers || (layerSize & (layerSize - 1)) != 0)
+        {
+            std::cerr << "Failed to load neural network: " << "invalid hidden layer size" << std::endl;
+            goto onError;
+        }
+    }
+
     weightsBuffer = reinterpret_cast<const uint8_t*>(mappedData) + sizeof(Header);
 
     InitLayerDataSizes();
@@ -543,6 +819,16 @@ bool PackedNeuralNetwork::LoadFromFile(const char* filePath)
         goto onError;
     }
 
+    // copy weights from the file mapping, so they can be backed by large pages
+    allocatedData = Malloc(GetWeightsBufferSize());
+    if (allocatedData)
+    {
+        memcpy(allocatedData, weightsBuffer, GetWeightsBufferSize());
+        weightsBuffer = reinterpret_cast<const uint8_t*>(allocatedData);
+        InitLayerDataPointers();
+        ReleaseFileMapping();
+    }
+
     return true;
 
 onError:
@@ -556,6 +842,8 @@ bool PackedNeuralNetwork::LoadFromMemory(const void* data)
 
     // TODO this should be all hardcoded
     header = Header{};
+    // only feature transformer weights format is taken from the embedded header
+    header.version = reinterpret_cast<const Header*>(data)->version == Int8FeatureTransformerVersion ? Int8FeatureTransformerVersion : CurrentVersion;
     header.layerSizes[0] = nn::NumNetworkInputs;
     header.layerSizes[1] = nn::AccumulatorSize * 2;
     header.layerVariants[0] = 1;
@@ -577,6 +865,11 @@ int32_t PackedNeuralNetwork::Run(const Accumulator& stmAccum, const Accumulator&
     ASSERT(GetLayerSize(2) <= MaxNeuronsInHiddenLayers);
     ASSERT(GetLayerSize(3) <= MaxNeuronsInHiddenLayers);
 
+    if (numActiveLayers > 2)
+    {
+        return RunHiddenLayers(stmAccum, nstmAccum, variant);
+    }
+
     constexpr uint32_t weightSize = sizeof(LastLayerWeightType);
     constexpr uint32_t biasSize = sizeof(LastLayerBiasType);
     constexpr uint32_t weightsBlockSize = 2u * nn::AccumulatorSize * weightSize;
@@ -591,13 +884,55 @@ int32_t PackedNeuralNetwork::Run(const Accumulator& stmAccum, const Accumulator&
         nstmAccum.values);
 }
 
+int32_t PackedNeuralNetwork::RunHiddenLayers(const Accumulator& stmAccum, const Accumulator& nstmAccum, uint32_t variant) const
+{
+    alignas(CACHELINE_SIZE) IntermediateType activations[2 * AccumulatorSize];
+    alignas(CACHELINE_SIZE) int32_t hiddenOutputs[MaxNeuronsInHiddenLayers];
+    uint16_t chunks[2 * AccumulatorSize / 4 + ChunkIndicesPadding];
+
+    uint32_t numChunks = ClippedReLU_Accum_FindNonZeroChunks(stmAccum.values, nstmAccum.values, activations, chunks);
+
+    for (uint32_t i = 1; i + 1 < numActiveLayers; ++i)
+    {
+        const uint32_t layerVariant = header.layerVariants[i] > 1 ? variant : 0;
+        const uint32_t numOutputs = header.layerSizes[i + 1];
+
+        LinearLayer_Sparse(
+            numOutputs,
+            GetLayerWeights<HiddenLayerWeightType>(i, layerVariant),
+            GetLayerBiases<HiddenLayerBiasType>(i, layerVariant),
+            activations, chunks, numChunks,
+            hiddenOutputs);
+
+        // outputs are small enough, so they can be written over the inputs
+        numChunks = ClippedReLU_FindNonZeroChunks(hiddenOutputs, numOutputs, activations, chunks);
+    }
+
+    const uint32_t lastLayerIndex = numActiveLayers - 1;
+    const uint32_t lastLayerVariant = header.layerVariants[lastLayerIndex] > 1 ? variant : 0;
+
+    return LinearLayer_SingleOutput(
+        GetLayerWeights<LastLayerWeightType>(lastLayerIndex, lastLayerVariant),
+        GetLayerBiases<LastLayerBiasType>(lastLayerIndex, lastLayerVariant),
+        activations,
+        header.layerSizes[lastLayerIndex]);
+}
+
 int32_t PackedNeuralNetwork::Run(const uint16_t* stmFeatures, const uint32_t stmNumFeatures, const uint16_t* nstmFeatures, const uint32_t nstmNumFeatures, uint32_t variant) const
 {
     Accumulator stmAccum;
-    stmAccum.Refresh(GetAccumulatorWeights(), GetAccumulatorBiases(), stmNumFeatures, stmFeatures);
-
     Accumulator nstmAccum;
-    nstmAccum.Refresh(GetAccumulatorWeights(), GetAccumulatorBiases(), nstmNumFeatures, nstmFeatures);
+
+    if (HasInt8FeatureTransformer())
+    {
+        stmAccum.Refresh(GetAccumulatorInt8Weights(), GetAccumulatorBiases(), stmNumFeatures, stmFeatures);
+        nstmAccum.Refresh(GetAccumulatorInt8Weights(), GetAccumulatorBiases(), nstmNumFeatures, nstmFeatures);
+    }
+    else
+    {
+        stmAccum.Refresh(GetAccumulatorWeights(), GetAccumulatorBiases(), stmNumFeatures, stmFeatures);
+        nstmAccum.Refresh(GetAccumulatorWeights(), GetAccumulatorBiases(), nstmNumFeatures, nstmFeatures);
+    }
 
     return Run(stmAccum, nstmAccum, variant);
 }
@@ -80,6 +80,8 @@ class NeuralNetwork;
 struct Accumulator;
 
 static constexpr uint32_t CurrentVersion = 10;
+// same layout as CurrentVersion, but feature transformer weights are stored as 8-bit integers
+static constexpr uint32_t Int8FeatureTransformerVersion = 11;
 static constexpr uint32_t MagicNumber = 'CSNN';
 
 static constexpr uint32_t NumKingBuckets = 11;
@@ -109,23 +111,38 @@ static constexpr int32_t WeightScale = 1 << WeightScaleShift;
 static constexpr int32_t OutputScaleShift = 10;
 static constexpr int32_t OutputScale = 1 << OutputScaleShift;
 
+// hidden layers inputs are 8-bit clipped-ReLU activations in [0, HiddenLayerActivationScale] range
+// (accumulator values are halved, so they fit in unsigned 8-bit integers)
+static constexpr int32_t HiddenLayerActivationShift = 1;
+static constexpr int32_t HiddenLayerActivationScale = ActivationRangeScaling >> HiddenLayerActivationShift;
+
+// hidden layers outputs are shifted right by this value to get back to activation range
+static constexpr int32_t HiddenLayerWeightScaleShift = 6;
+
 static constexpr float InputLayerWeightQuantizationScale = ActivationRangeScaling;
+// 8-bit feature transformer weights have lower precision and are shifted left when added to the accumulator
+static constexpr int32_t InputLayerInt8WeightShift = 2;
+static constexpr float InputLayerInt8WeightQuantizationScale = InputLayerWeightQuantizationScale / (1 << InputLayerInt8WeightShift);
 static constexpr float InputLayerBiasQuantizationScale = ActivationRangeScaling;
-static constexpr float HiddenLayerWeightQuantizationScale = WeightScale;
-static constexpr float HiddenLayerBiasQuantizationScale = WeightScale * ActivationRangeScaling;
+static constexpr float HiddenLayerWeightQuantizationScale = 1 << HiddenLayerWeightScaleShift;
+static constexpr float HiddenLayerBiasQuantizationScale = HiddenLayerWeightQuantizationScale * HiddenLayerActivationScale;
 static constexpr float OutputLayerWeightQuantizationScale = WeightScale * OutputScale / ActivationRangeScaling;
 static constexpr float OutputLayerBiasQuantizationScale = WeightScale * OutputScale;
+// output layer following hidden layers
+static constexpr float HiddenOutputLayerWeightQuantizationScale = WeightScale * OutputScale / HiddenLayerActivationScale;
 
 using FirstLayerWeightType = int16_t;
+using FirstLayerInt8WeightType = int8_t;
 using FirstLayerBiasType = int16_t;
 
+// hidden layer weights are stored in [inputs / 4][outputs][4] order, so 4 consecutive 8-bit inputs can be multiplied at once
 using HiddenLayerWeightType = int8_t;
 using HiddenLayerBiasType = int32_t;
 
 using LastLayerWeightType = int16_t;
 using LastLayerBiasType = int32_t;
 
-using IntermediateType = int8_t;
+using IntermediateType = uint8_t;
 
 class PackedNeuralNetwork
 {
@@ -155,7 +172,8 @@ public:
 
     // allocate weights
     bool Resize(const std::vector<uint32_t>& layerSizes,
-                const std::vector<uint32_t>& numVariantsPerLayer = std::vector<uint32_t>());
+                const std::vector<uint32_t>& numVariantsPerLayer = std::vector<uint32_t>(),
+                uint32_t version = CurrentVersion);
 
     // load from file
     bool LoadFromFile(const char* filePath);
@@ -175,16 +193,27 @@ public:
     INLINE uint32_t GetNumInputs() const { return header.layerSizes[0]; }
     INLINE uint32_t GetAccumulatorSize() const { return header.layerSizes[1] / 2; }
     INLINE uint32_t GetLayerSize(uint32_t i) const { return header.layerSizes[i]; }
+    INLINE uint32_t GetVersion() const { return header.version; }
+
+    // feature transformer weights are stored as 8-bit integers (see InputLayerInt8WeightShift)
+    INLINE bool HasInt8FeatureTransformer() const { return header.version == Int8FeatureTransformerVersion; }
+    INLINE size_t GetAccumulatorWeightSize() const { return HasInt8FeatureTransformer() ? sizeof(FirstLayerInt8WeightType) : sizeof(FirstLayerWeightType); }
 
     void GetLayerWeightsAndBiases(uint32_t layerIndex, uint32_t layerVariant, const void*& outWeights, const void*& outBiases) const;
 
     INLINE const FirstLayerWeightType* GetAccumulatorWeights() const
     {
+        ASSERT(!HasInt8FeatureTransformer());
         return reinterpret_cast<const FirstLayerWeightType*>(layerDataPointers[0]);
     }
+    INLINE const FirstLayerInt8WeightType* GetAccumulatorInt8Weights() const
+    {
+        ASSERT(HasInt8FeatureTransformer());
+        return reinterpret_cast<const FirstLayerInt8WeightType*>(layerDataPointers[0]);
+    }
     INLINE const FirstLayerBiasType* GetAccumulatorBiases() const
     {
-        return reinterpret_cast<const FirstLayerBiasType*>(GetAccumulatorWeights() + GetNumInputs() * GetAccumulatorSize());
+        return reinterpret_cast<const FirstLayerBiasType*>(layerDataPointers[0] + GetNumInputs() * GetAccumulatorSize() * GetAccumulatorWeightSize());
     }
 
     template<typename T>
@@ -217,6 +246,9 @@ private:
     void InitLayerDataSizes();
     void InitLayerDataPointers();
 
+    // propagate through hidden layers (8-bit weights, sparse inputs) and the output layer
+    int32_t RunHiddenLayers(const Accumulator& stmAccum, const Accumulator& nstmAccum, uint32_t variant) const;
+
     Header header;
 
     uint32_t numActiveLayers = 0;
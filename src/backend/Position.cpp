@@ -662,6 +662,138 @@ bool Position::DoNullMove()
     return true;
 }
 
+void Position::SetPiece_NoHash(const Square square, const Piece piece, const Color color)
+{
+    SidePosition& pos = GetSide(color);
+    ASSERT(pos.pieces[square.Index()] == Piece::None);
+    pos.GetPieceBitBoard(piece) |= square.GetBitboard();
+    pos.pieces[square.Index()] = piece;
+}
+
+void Position::RemovePiece_NoHash(const Square square, const Piece piece, const Color color)
+{
+    SidePosition& pos = GetSide(color);
+    ASSERT(pos.pieces[square.Index()] == piece);
+    pos.GetPieceBitBoard(piece) &= ~square.GetBitboard();
+    pos.pieces[square.Index()] = Piece::None;
+}
+
+void Position::SaveUndoRecord(UndoRecord& outUndo) const
+{
+    outUndo.hash = mHash;
+    outUndo.pawnsHash = mPawnsHash;
+    outUndo.nonPawnsHash[0] = mNonPawnsHash[0];
+    outUndo.nonPawnsHash[1] = mNonPawnsHash[1];
+    outUndo.halfMoveCount = mHalfMoveCount;
+    outUndo.moveCount = mMoveCount;
+    outUndo.enPassantSquare = mEnPassantSquare;
+    outUndo.castlingRights[0] = mCastlingRights[0];
+    outUndo.castlingRights[1] = mCastlingRights[1];
+    outUndo.capturedPiece = Piece::None;
+}
+
+void Position::RestoreFromUndoRecord(const UndoRecord& undo)
+{
+    mHash = undo.hash;
+    mPawnsHash = undo.pawnsHash;
+    mNonPawnsHash[0] = undo.nonPawnsHash[0];
+    mNonPawnsHash[1] = undo.nonPawnsHash[1];
+    mHalfMoveCount = undo.halfMoveCount;
+    mMoveCount = undo.moveCount;
+    mEnPassantSquare = undo.enPassantSquare;
+    mCastlingRights[0] = undo.castlingRights[0];
+    mCastlingRights[1] = undo.castlingRights[1];
+}
+
+bool Position::MakeMove(const Move& move, UndoRecord& outUndo, NNEvaluatorContext& nnContext)
+{
+    SaveUndoRecord(outUndo);
+
+    if (move.IsCapture() && !move.IsEnPassant())
+    {
+        outUndo.capturedPiece = GetOpponentSide().GetPieceAtSquare(move.ToSquare());
+    }
+
+    return DoMove(move, nnContext);
+}
+
+void Position::UnmakeMove(const Move& move, const UndoRecord& undo)
+{
+    // side that made the move
+    const Color us = mSideToMove ^ 1;
+    const Color them = mSideToMove;
+
+    if (!move.IsCastling()) [[likely]]
+    {
+        const Piece targetPiece = move.GetPromoteTo() != Piece::None ? move.GetPromoteTo() : move.GetPiece();
+        RemovePiece_NoHash(move.ToSquare(), targetPiece, us);
+
+        if (move.IsCapture())
+        {
+            if (move.IsEnPassant()) [[unlikely]]
+            {
+                const Square captureSquare(move.ToSquare().File(), move.ToSquare().Rank() == 5 ? 4u : 3u);
+                SetPiece_NoHash(captureSquare, Piece::Pawn, them);
+            }
+            else
+            {
+                ASSERT(undo.capturedPiece != Piece::None);
+                SetPiece_NoHash(move.ToSquare(), undo.capturedPiece, them);
+            }
+        }
+
+        SetPiece_NoHash(move.FromSquare(), move.GetPiece(), us);
+    }
+    else
+    {
+        // castling rights before the move determine which rook was used
+        const uint8_t castlingRights = undo.castlingRights[(uint32_t)us];
+        const Square kingSquare = move.FromSquare();
+        const uint8_t rank = kingSquare.Rank();
+
+        Square oldRookSquare, newRookSquare, newKingSquare;
+        if (move.IsShortCastle())
+        {
+            oldRookSquare = GetShortCastleRookSquare(kingSquare, castlingRights);
+            newRookSquare = Square(5u, rank);
+            newKingSquare = Square(6u, rank);
+        }
+        else
+        {
+            oldRookSquare = GetLongCastleRookSquare(kingSquare, castlingRights);
+            newRookSquare = Square(3u, rank);
+            newKingSquare = Square(2u, rank);
+        }
+
+        // reverse order of DoMove, so overlapping king and rook squares (Chess960) are handled
+        RemovePiece_NoHash(newRookSquare, Piece::Rook, us);
+        RemovePiece_NoHash(newKingSquare, Piece::King, us);
+        SetPiece_NoHash(oldRookSquare, Piece::Rook, us);
+        SetPiece_NoHash(kingSquare, Piece::King, us);
+    }
+
+    mSideToMove = us;
+    RestoreFromUndoRecord(undo);
+
+    ASSERT(IsValid());
+    ASSERT(ComputeHash() == GetHash());
+}
+
+void Position::MakeNullMove(UndoRecord& outUndo)
+{
+    SaveUndoRecord(outUndo);
+    DoNullMove();
+}
+
+void Position::UnmakeNullMove(const UndoRecord& undo)
+{
+    mSideToMove = mSideToMove ^ 1;
+    RestoreFromUndoRecord(undo);
+
+    ASSERT(IsValid());
+    ASSERT(ComputeHash() == GetHash());
+}
+
 Position Position::SwappedColors() const
 {
     Position result;
@@ -703,6 +835,16 @@ Position Position::SwappedColors() const
     return result;
 }
 
+void SidePosition::UpdatePiecesArray()
+{
+    std::fill(std::begin(pieces), std::end(pieces), Piece::None);
+    for (uint32_t i = (uint32_t)Piece::Pawn; i <= (uint32_t)Piece::King; ++i)
+    {
+        const Piece piece = (Piece)i;
+        GetPieceBitBoard(piece).Iterate([&](uint32_t square) INLINE_LAMBDA { pieces[square] = piece; });
+    }
+}
+
 void Position::MirrorVertically()
 {
     mColors[0].king     = mColors[0].king.MirroredVertically();
@@ -719,6 +861,9 @@ void Position::MirrorVertically()
     mColors[1].knights  = mColors[1].knights.MirroredVertically();
     mColors[1].pawns    = mColors[1].pawns.MirroredVertically();
 
+    mColors[0].UpdatePiecesArray();
+    mColors[1].UpdatePiecesArray();
+
     mCastlingRights[0] = 0;
     mCastlingRights[1] = 0;
 
@@ -744,6 +889,9 @@ void Position::MirrorHorizontally()
     mColors[1].knights  = mColors[1].knights.MirroredHorizontally();
     mColors[1].pawns    = mColors[1].pawns.MirroredHorizontally();
 
+    mColors[0].UpdatePiecesArray();
+    mColors[1].UpdatePiecesArray();
+
     mCastlingRights[0] = ReverseBits(mCastlingRights[0]);
     mCastlingRights[1] = ReverseBits(mCastlingRights[1]);
 
@@ -769,6 +917,9 @@ void Position::FlipDiagonally()
     mColors[1].knights  = mColors[1].knights.FlippedDiagonally();
     mColors[1].pawns    = mColors[1].pawns.FlippedDiagonally();
 
+    mColors[0].UpdatePiecesArray();
+    mColors[1].UpdatePiecesArray();
+
     mCastlingRights[0] = 0;
     mCastlingRights[1] = 0;
 
@@ -23,6 +23,9 @@ struct alignas(16) SidePosition
     Bitboard& GetPieceBitBoard(Piece piece);
     const Bitboard& GetPieceBitBoard(Piece piece) const;
 
+    // rebuild piece-on-square array from bitboards
+    void UpdatePiecesArray();
+
     INLINE Bitboard Occupied() const
     {
         return pawns | knights | bishops | rooks | queens | king;
@@ -100,6 +103,21 @@ struct Threats
     Bitboard allThreats;
 };
 
+// state that can't be recovered from a move when taking it back (see Position::MakeMove)
+struct UndoRecord
+{
+    uint64_t hash;
+    uint64_t pawnsHash;
+    uint32_t nonPawnsHash[2];
+    uint16_t halfMoveCount;
+    uint16_t moveCount;
+    Square enPassantSquare;
+    uint8_t castlingRights[2];
+    Piece capturedPiece;
+};
+
+static_assert(sizeof(UndoRecord) == 32, "Invalid undo record size");
+
 // class representing whole board state
 class alignas(64) Position
 {
@@ -225,6 +243,19 @@ public:
     // apply null move
     bool DoNullMove();
 
+    // apply a move and store state needed to take it back in the undo record
+    // like DoMove, returns false if the move left the king in check (the move is applied anyway and must be taken back)
+    bool MakeMove(const Move& move, UndoRecord& outUndo, NNEvaluatorContext& nnContext);
+
+    // take back a move applied with MakeMove
+    void UnmakeMove(const Move& move, const UndoRecord& undo);
+
+    // apply null move and store state needed to take it back in the undo record
+    void MakeNullMove(UndoRecord& outUndo);
+
+    // take back a null move applied with MakeNullMove
+    void UnmakeNullMove(const UndoRecord& undo);
+
     // check what is theoretically possible best move value (without generating and analyzing actual moves)
     int32_t BestPossibleMoveValue() const;
 
@@ -314,6 +345,13 @@ private:
 
     void ClearRookCastlingRights(const Square affectedSquare);
 
+    // update piece placement only, hashes are restored from undo record when taking back a move
+    void SetPiece_NoHash(const Square square, const Piece piece, const Color color);
+    void RemovePiece_NoHash(const Square square, const Piece piece, const Color color);
+
+    void SaveUndoRecord(UndoRecord& outUndo) const;
+    void RestoreFromUndoRecord(const UndoRecord& undo);
+
     // BOARD STATE & FLAGS
 
     // bitboards for whites and blacks
@@ -35,3 +35,16 @@ void InitZobristHash()
         s_ZobristHash[i] = xoroshiro128(s);
     }
 }
+
+uint64_t GetZobristHashChecksum()
+{
+    uint64_t checksum = c_SideToMoveZobristHash;
+
+    for (uint32_t i = 0; i < c_ZobristHashSize; ++i)
+    {
+        checksum = rotl(checksum, 7) ^ s_ZobristHash[i];
+        checksum *= 0x9e3779b97f4a7c15ull;
+    }
+
+    return checksum;
+}
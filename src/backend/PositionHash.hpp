@@ -11,6 +11,9 @@ extern uint64_t s_ZobristHash[c_ZobristHashSize];
 
 void InitZobristHash();
 
+// checksum of all Zobrist keys, used to validate data keyed by position hashes (e.g. saved transposition table)
+uint64_t GetZobristHashChecksum();
+
 INLINE static uint64_t GetPieceZobristHash(const Color color, const Piece piece, const uint32_t squareIndex)
 {
     const uint32_t pieceIndex = (uint32_t)piece - (uint32_t)Piece::Pawn;
@@ -4,9 +4,11 @@
 #include "Game.hpp"
 #include "Material.hpp"
 #include "Evaluate.hpp"
+#include "EvalCache.hpp"
 #include "Tablebase.hpp"
 #include "TimeManager.hpp"
 #include "Tuning.hpp"
+#include "Numa.hpp"
 
 
 // silent warning C4127: conditional expression is constant
@@ -145,20 +147,20 @@ Search::~Search()
 
 void Search::StopWorkerThreads()
 {
-    for (size_t i = 1; i < mThreadData.size(); ++i)
+    if (mThreadData.size() > 1)
     {
-        const ThreadDataPtr& threadData = mThreadData[i];
-        std::unique_lock<std::mutex> lock(threadData->newTaskMutex);
-        threadData->stopThread = true;
-        threadData->newTaskCV.notify_one();
-    }
+        mStopWorkers = true;
+        mWorkerTaskState.store(NextWorkerTaskState(0), std::memory_order_release);
+        mWorkerTaskState.notify_all();
 
-    for (size_t i = 1; i < mThreadData.size(); ++i)
-    {
-        mThreadData[i]->thread.join();
-    }
+        for (size_t i = 1; i < mThreadData.size(); ++i)
+        {
+            mThreadData[i]->thread.join();
+        }
 
-    mThreadData.erase(mThreadData.begin() + 1, mThreadData.end());
+        mThreadData.erase(mThreadData.begin() + 1, mThreadData.end());
+        mStopWorkers = false;
+    }
 }
 
 void Search::BuildMoveReductionTable(LMRTableType& table, float scale, float bias)
@@ -214,6 +216,17 @@ const NodeCache& Search::GetNodeCache() const
     return mThreadData.front()->nodeCache;
 }
 
+void Search::PrintMemoryInfo() const
+{
+    std::cout << "=== Search memory ===" << std::endl;
+    std::cout << "Node info size:      " << sizeof(NodeInfo) << " bytes" << std::endl;
+
+    for (const ThreadDataPtr& threadData : mThreadData)
+    {
+        threadData->PrintMemoryInfo();
+    }
+}
+
 bool Search::CheckStopCondition(const ThreadData& thread, const SearchContext& ctx, bool isRootNode)
 {
     SearchParam& param = ctx.searchParam;
@@ -330,15 +343,10 @@ void Search::DoSearch(const Game& game, SearchParam& param, SearchResult& outRes
     {
         ThreadData& thread = *mThreadData.front();
 
-        NodeInfo& rootNode = thread.searchStack[0];
-        rootNode = NodeInfo{};
-        rootNode.position = game.GetPosition();
-        rootNode.isInCheck = game.GetPosition().IsInCheck();
-        rootNode.position.ComputeThreats(rootNode.threats);
+        NodeInfo& rootNode = thread.InitRootNode(game.GetPosition(), param.useMakeUnmake);
         rootNode.isPvNodeFromPrevIteration = true;
         rootNode.alpha = -InfValue;
         rootNode.beta = InfValue;
-        rootNode.nnContext.MarkAsDirty();
 
         SearchContext searchContext{ game, param, globalStats, param.excludedMoves };
         outResult.resize(1);
@@ -360,38 +368,30 @@ void Search::DoSearch(const Game& game, SearchParam& param, SearchResult& outRes
         ReportPV(aspirationWindowSearchParam, outResult[0], BoundsType::Exact, TimePoint());
     }
 
+    const TimePoint searchStartTime = TimePoint::GetCurrent();
+
     // kick off worker threads
-    for (uint32_t i = 1; i < param.numThreads; ++i)
+    SpawnWorkerThreads(param.numThreads, param.numaAware);
+    StartWorkerTask(param.numThreads, [this, numPvLines, &game, &param, &globalStats](uint32_t threadIndex)
     {
-        // spawn missing threads
-        if (mThreadData.size() < param.numThreads)
-        {
-            mThreadData.emplace_back(std::make_unique<ThreadData>());
-            mThreadData.back()->thread = std::thread(Search::WorkerThreadCallback, mThreadData.back().get());
-        }
+        Search_Internal(threadIndex, numPvLines, game, param, globalStats);
+    });
 
-        const ThreadDataPtr& threadData = mThreadData[i];
-        {
-            std::unique_lock<std::mutex> lock(threadData->newTaskMutex);
-            ASSERT(!threadData->callback);
-            threadData->callback = [this, i, numPvLines, &game, &param, &globalStats]()
-            {
-                Search_Internal(i, numPvLines, game, param, globalStats);
-            };
-            threadData->newTaskCV.notify_one();
-        }
-    }
-        
     // do search on main thread
     Search_Internal(0, numPvLines, game, param, globalStats);
 
     // wait for worker threads
-    for (uint32_t i = 1; i < param.numThreads; ++i)
+    WaitForWorkerTask();
+
+    for (uint32_t i = 0; i < param.numThreads; ++i)
+    {
+        globalStats.accumulatorStats += mThreadData[i]->accumulatorCache.stats;
+        globalStats.evalCacheStats += mThreadData[i]->accumulatorCache.evalCacheStats;
+    }
+
+    if (param.numaAware && param.debugLog)
     {
-        const ThreadDataPtr& threadData = mThreadData[i];
-        std::unique_lock<std::mutex> lock(threadData->taskFinishedMutex);
-        threadData->taskFinishedCV.wait(lock, [&threadData]() { return threadData->taskFinished; });
-        threadData->taskFinished = false;
+        ReportNumaStats(param.numThreads, TimePoint::GetCurrent() - searchStartTime);
     }
 
     // select best PV line from finished threads
@@ -454,29 +454,116 @@ void Search::DoSearch(const Game& game, SearchParam& param, SearchResult& outRes
     param.stopSearch = false;
 }
 
-void Search::WorkerThreadCallback(ThreadData* threadData)
+void Search::SpawnWorkerThreads(uint32_t numThreads, bool numaAware)
 {
-    while (!threadData->stopThread)
+    while (mThreadData.size() < numThreads)
     {
+        const uint32_t threadIndex = (uint32_t)mThreadData.size();
+        mThreadData.emplace_back(std::make_unique<ThreadData>());
+        mThreadData.back()->threadIndex = threadIndex;
+        if (numaAware && GetNumNumaNodes() > 1)
         {
-            // wait for task
-            std::function<void()> callback;
-            {
-                std::unique_lock<std::mutex> lock(threadData->newTaskMutex);
-                threadData->newTaskCV.wait(lock, [threadData]() { return threadData->callback || threadData->stopThread; });
-                if (threadData->stopThread) break;
-                callback = std::move(threadData->callback);
-            }
+            mThreadData.back()->numaNode = GetNumaNodeForThread(threadIndex, numThreads);
+        }
+        // tasks posted before the thread was spawned are not for this thread
+        const uint32_t initialTaskState = mWorkerTaskState.load(std::memory_order_relaxed);
+        mThreadData.back()->thread = std::thread(&Search::WorkerThreadCallback, this, mThreadData.back().get(), initialTaskState);
+    }
+
+    // spinning only helps if every thread has its own core, otherwise it steals time from threads doing actual work
+    static const size_t numHardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    mNumWorkerSpinIterations = mThreadData.size() <= numHardwareThreads ? 1024 : 0;
+}
+
+void Search::StartWorkerTask(uint32_t numThreads, std::function<void(uint32_t threadIndex)>&& task)
+{
+    ASSERT(numThreads <= mThreadData.size());
+    ASSERT(mNumPendingWorkers == 0);
+
+    if (numThreads <= 1)
+    {
+        return;
+    }
+
+    mWorkerTask = std::move(task);
+    mNumPendingWorkers.store(numThreads - 1, std::memory_order_relaxed);
+
+    // publish the task
+    mWorkerTaskState.store(NextWorkerTaskState(numThreads), std::memory_order_release);
+    mWorkerTaskState.notify_all();
+}
+
+void Search::WaitForWorkerTask()
+{
+    const uint32_t numSpinIterations = mNumWorkerSpinIterations.load(std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < numSpinIterations && mNumPendingWorkers.load(std::memory_order_acquire) != 0; ++i)
+    {
+        CpuPause();
+    }
+
+    for (uint32_t numPending; (numPending = mNumPendingWorkers.load(std::memory_order_acquire)) != 0; )
+    {
+        mNumPendingWorkers.wait(numPending, std::memory_order_acquire);
+    }
+
+    mWorkerTask = nullptr;
+}
+
+void Search::RunOnThreads(uint32_t numThreads, const std::function<void(uint32_t threadIndex)>& task, bool numaAware)
+{
+    numThreads = std::max(1u, numThreads);
+
+    SpawnWorkerThreads(numThreads, numaAware);
+    StartWorkerTask(numThreads, [&task](uint32_t threadIndex) { task(threadIndex); });
+
+    task(0);
 
-            callback();
+    WaitForWorkerTask();
+}
+
+void Search::WorkerThreadCallback(ThreadData* threadData, uint32_t initialTaskState)
+{
+    if (threadData->numaNode >= 0)
+    {
+        BindCurrentThreadToNumaNode(threadData->numaNode);
+    }
+
+    uint32_t lastState = initialTaskState;
+
+    for (;;)
+    {
+        // wait for task: spin for a while, then park
+        const uint32_t numSpinIterations = mNumWorkerSpinIterations.load(std::memory_order_relaxed);
+        uint32_t state = mWorkerTaskState.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < numSpinIterations && state == lastState; ++i)
+        {
+            CpuPause();
+            state = mWorkerTaskState.load(std::memory_order_acquire);
         }
 
-        // notify main thread
+        while (state == lastState)
         {
-            std::unique_lock<std::mutex> lock(threadData->taskFinishedMutex);
-            ASSERT(!threadData->taskFinished);
-            threadData->taskFinished = true;
-            threadData->taskFinishedCV.notify_one();
+            mWorkerTaskState.wait(lastState, std::memory_order_acquire);
+            state = mWorkerTaskState.load(std::memory_order_acquire);
+        }
+
+        lastState = state;
+
+        if (mStopWorkers.load(std::memory_order_acquire))
+        {
+            break;
+        }
+
+        if (threadData->threadIndex < (state & 0xFFFF))
+        {
+            mWorkerTask(threadData->threadIndex);
+
+            // notify main thread
+            if (mNumPendingWorkers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                mNumPendingWorkers.notify_one();
+            }
         }
     }
 }
@@ -616,6 +703,37 @@ void Search::ReportCurrentMove(const Move& move, int32_t depth, uint32_t moveNum
     std::cout << std::move(ss.str()) << std::endl;
 }
 
+void Search::ReportNumaStats(uint32_t numThreads, const TimePoint& searchTime) const
+{
+    const uint32_t numNodes = GetNumNumaNodes();
+    const double timeInSeconds = searchTime.ToSeconds();
+
+    // threads are grouped by the node they were bound to when spawned (-1 for unbound threads, e.g. the main thread),
+    // which may differ from the layout for the current thread count
+    for (int32_t node = -1; node < (int32_t)numNodes; ++node)
+    {
+        uint32_t numNodeThreads = 0;
+        uint64_t numSearchedNodes = 0;
+
+        for (uint32_t i = 0; i < numThreads; ++i)
+        {
+            if (mThreadData[i]->numaNode == node)
+            {
+                numNodeThreads++;
+                numSearchedNodes += mThreadData[i]->stats.nodesTotal;
+            }
+        }
+
+        if (numNodeThreads == 0) continue;
+
+        std::cout << "info string numa node " << (node >= 0 ? std::to_string(node) : "unbound")
+            << " threads " << numNodeThreads
+            << " nodes " << numSearchedNodes;
+        if (timeInSeconds > 0.0) std::cout << " nps " << (int64_t)((double)numSearchedNodes / timeInSeconds);
+        std::cout << std::endl;
+    }
+}
+
 void Search::Search_Internal(const uint32_t threadID, const uint32_t numPvLines, const Game& game, SearchParam& param, SearchStats& outStats)
 {
     const bool isMainThread = threadID == 0;
@@ -630,6 +748,8 @@ void Search::Search_Internal(const uint32_t threadID, const uint32_t numPvLines,
     thread.avgScores.resize(numPvLines, 0);
     thread.moveOrderer.NewSearch();
     thread.nodeCache.OnNewSearch();
+    thread.accumulatorCache.stats = AccumulatorStats{};
+    thread.accumulatorCache.evalCacheStats = EvalCacheStats{};
 
     uint32_t mateCounter = 0;
     TimeManagerState timeManagerState;
@@ -798,16 +918,11 @@ void Search::Search_Internal(const uint32_t threadID, const uint32_t numPvLines,
             const uint16_t singularDepth = depth / 2;
             const ScoreType singularBeta = primaryMoveScore - (ScoreType)scoreTreshold;
 
-            NodeInfo& rootNode = thread.searchStack[0];
-            rootNode = NodeInfo{};
-            rootNode.position = game.GetPosition();
-            rootNode.isInCheck = rootNode.position.IsInCheck();
-            rootNode.position.ComputeThreats(rootNode.threats);
+            NodeInfo& rootNode = thread.InitRootNode(game.GetPosition(), param.useMakeUnmake);
             rootNode.depth = singularDepth;
             rootNode.alpha = singularBeta - 1;
             rootNode.beta = singularBeta;
             rootNode.filteredMove = primaryMove;
-            rootNode.nnContext.MarkAsDirty();
 
             ScoreType score = NegaMax<NodeType::NonPV>(thread, &rootNode, searchContext);
             ASSERT(score >= -CheckmateValue && score <= CheckmateValue);
@@ -849,14 +964,9 @@ PvLine Search::AspirationWindowSearch(ThreadData& thread, const AspirationWindow
     const uint32_t maxPvLine = param.searchParam.limits.analysisMode ? UINT32_MAX : std::min(param.depth, DefaultMaxPvLineLength);
 
     // TODO root node could be created in Search_Internal
-    NodeInfo& rootNode = thread.searchStack[0];
-    rootNode = NodeInfo{};
-    rootNode.position = param.position;
-    rootNode.isInCheck = param.position.IsInCheck();
-    rootNode.position.ComputeThreats(rootNode.threats);
+    NodeInfo& rootNode = thread.InitRootNode(param.position, param.searchParam.useMakeUnmake);
     rootNode.isPvNodeFromPrevIteration = true;
     rootNode.pvIndex = static_cast<uint16_t>(param.pvIndex);
-    rootNode.nnContext.MarkAsDirty();
 
     thread.accumulatorCache.Init(g_mainNeuralNetwork.get());
 
@@ -926,8 +1036,76 @@ PvLine Search::AspirationWindowSearch(ThreadData& thread, const AspirationWindow
     return finalPvLine;
 }
 
-Search::ThreadData::ThreadData()
+// offset of given ply's PV line in the PV line pool
+INLINE static size_t GetPvLinePoolOffset(uint32_t ply)
+{
+    return (size_t)ply * MaxSearchDepth - (size_t)ply * (ply - 1) / 2;
+}
+
+void Search::ThreadData::AllocatePools()
 {
+    if (accumulatorPool)
+    {
+        return;
+    }
+
+    // pools are not initialized, so memory pages are committed on first use of a ply
+    accumulatorPool = static_cast<nn::Accumulator*>(AlignedMalloc(AccumulatorPoolSize, CACHELINE_SIZE));
+    pvLinePool = static_cast<PackedMove*>(AlignedMalloc(PvLinePoolSize, CACHELINE_SIZE));
+
+    // same as failed allocation of the thread data itself
+    if (!accumulatorPool || !pvLinePool)
+    {
+        AlignedFree(accumulatorPool);
+        AlignedFree(pvLinePool);
+        accumulatorPool = nullptr;
+        pvLinePool = nullptr;
+        throw std::bad_alloc();
+    }
+}
+
+Search::ThreadData::~ThreadData()
+{
+    AlignedFree(accumulatorPool);
+    AlignedFree(pvLinePool);
+}
+
+void Search::ThreadData::PrintMemoryInfo() const
+{
+    // plies reached in recent search
+    const uint32_t numPlies = std::min<uint32_t>(stats.maxDepth, MaxSearchDepth);
+
+    std::cout
+        << "Thread " << threadIndex << ": "
+        << "thread data " << sizeof(ThreadData) / 1024 << " KB "
+        << "(search stack " << sizeof(searchStack) / 1024 << " KB, "
+        << "positions " << sizeof(positionStack) / 1024 << " KB), "
+        << "accumulators " << (numPlies * 2 * sizeof(nn::Accumulator)) / 1024 << "/" << AccumulatorPoolSize / 1024 << " KB, "
+        << "PV lines " << (GetPvLinePoolOffset(numPlies) * sizeof(PackedMove)) / 1024 << "/" << PvLinePoolSize / 1024 << " KB "
+        << "(used/reserved, " << numPlies << " plies reached)" << std::endl;
+}
+
+NodeInfo& Search::ThreadData::InitRootNode(const Position& position, bool useMakeUnmake)
+{
+    AllocatePools();
+
+    NodeInfo& rootNode = searchStack[0];
+    rootNode = NodeInfo{};
+
+    positionStack[0] = position;
+    for (uint32_t i = 0; i < MaxSearchDepth; ++i)
+    {
+        searchStack[i].position = useMakeUnmake ? &positionStack[0] : &positionStack[i];
+        searchStack[i].accumulatorData = accumulatorPool + 2 * i;
+        searchStack[i].pvLine = pvLinePool + GetPvLinePoolOffset(i);
+    }
+
+    rootNode.UpdatePositionInfo();
+    rootNode.isInCheck = position.IsInCheck();
+    position.ComputeThreats(rootNode.threats);
+    rootNode.nnContext.MarkAsDirty();
+
+    return rootNode;
 }
 
 const Move Search::ThreadData::GetPvMove(const NodeInfo& node) const
@@ -945,7 +1123,7 @@ const Move Search::ThreadData::GetPvMove(const NodeInfo& node) const
 
     const Move pvMove = pvLine[node.ply];
     ASSERT(pvMove.IsValid());
-    ASSERT(node.position.IsMoveLegal(pvMove));
+    ASSERT(node.position->IsMoveLegal(pvMove));
 
     return pvMove;
 }
@@ -960,12 +1138,12 @@ INLINE static bool OppCanWinMaterial(const Position& position, const Threats& th
 
 ScoreType Search::ThreadData::GetEvalCorrection(const NodeInfo& node) const
 {
-    const Color stm = node.position.GetSideToMove();
+    const Color stm = node.position->GetSideToMove();
 
     int32_t corr = 0;
-    corr += EvalCorrectionPawnsScale * pawnStructureCorrection[stm][node.position.GetPawnsHash() % EvalCorrectionTableSize];
-    corr += EvalCorrectionNonPawnsScale * nonPawnWhiteCorrection[stm][node.position.GetNonPawnsHash(White) % EvalCorrectionTableSize];
-    corr += EvalCorrectionNonPawnsScale * nonPawnBlackCorrection[stm][node.position.GetNonPawnsHash(Black) % EvalCorrectionTableSize];
+    corr += EvalCorrectionPawnsScale * pawnStructureCorrection[stm][node.position->GetPawnsHash() % EvalCorrectionTableSize];
+    corr += EvalCorrectionNonPawnsScale * nonPawnWhiteCorrection[stm][node.position->GetNonPawnsHash(White) % EvalCorrectionTableSize];
+    corr += EvalCorrectionNonPawnsScale * nonPawnBlackCorrection[stm][node.position->GetNonPawnsHash(Black) % EvalCorrectionTableSize];
 
     if (node.ply >= 2 && node.previousMove.IsValid() && (&node - 1)->previousMove.IsValid())
         corr += ContCorrectionScale * continuationCorrection[stm][node.previousMove.PieceTo()][(&node - 1)->previousMove.PieceTo()];
@@ -973,6 +1151,60 @@ ScoreType Search::ThreadData::GetEvalCorrection(const NodeInfo& node) const
     return static_cast<ScoreType>(corr / EvalCorrectionScale);
 }
 
+// set up child node's position by applying a move to the node's position
+// returns false if the move is illegal (with make/unmake the move is already taken back then)
+INLINE static bool DoChildMove(const NodeInfo& node, NodeInfo& childNode, const Move move, bool useMakeUnmake)
+{
+    ASSERT(&childNode == &node + 1);
+
+    if (useMakeUnmake)
+    {
+        ASSERT(childNode.position == node.position);
+        if (!childNode.position->MakeMove(move, childNode.undo, childNode.nnContext))
+        {
+            childNode.position->UnmakeMove(move, childNode.undo);
+            return false;
+        }
+    }
+    else
+    {
+        *childNode.position = *node.position;
+        if (!childNode.position->DoMove(move, childNode.nnContext))
+            return false;
+    }
+
+    childNode.UpdatePositionInfo();
+    return true;
+}
+
+// restore node's position after child node was searched (nothing to do with copy-make)
+INLINE static void UndoChildMove(NodeInfo& childNode, const Move move, bool useMakeUnmake)
+{
+    if (useMakeUnmake)
+        childNode.position->UnmakeMove(move, childNode.undo);
+}
+
+INLINE static void DoChildNullMove(const NodeInfo& node, NodeInfo& childNode, bool useMakeUnmake)
+{
+    if (useMakeUnmake)
+    {
+        childNode.position->MakeNullMove(childNode.undo);
+    }
+    else
+    {
+        *childNode.position = *node.position;
+        childNode.position->DoNullMove();
+    }
+
+    childNode.UpdatePositionInfo();
+}
+
+INLINE static void UndoChildNullMove(NodeInfo& childNode, bool useMakeUnmake)
+{
+    if (useMakeUnmake)
+        childNode.position->UnmakeNullMove(childNode.undo);
+}
+
 INLINE static void AddToCorrHist(int16_t& history, int32_t value)
 {
     history = static_cast<int16_t>(history + value - history * std::abs(value) / 1024);
@@ -988,10 +1220,10 @@ ScoreType Search::AdjustEvalScore(const ThreadData& threadData, const NodeInfo&
         adjustedScore += threadData.GetEvalCorrection(node);
 
         // scale down when approaching 50-move draw
-        adjustedScore = adjustedScore * (256 - std::max(0, (int32_t)node.position.GetHalfMoveCount())) / 256;
+        adjustedScore = adjustedScore * (256 - std::max(0, (int32_t)node.position->GetHalfMoveCount())) / 256;
 
         if (searchParam.evalRandomization > 0)
-            adjustedScore += ((uint32_t)node.position.GetHash() ^ searchParam.seed) % (2 * searchParam.evalRandomization + 1) - searchParam.evalRandomization;
+            adjustedScore += ((uint32_t)node.position->GetHash() ^ searchParam.seed) % (2 * searchParam.evalRandomization + 1) - searchParam.evalRandomization;
     }
 
     return static_cast<ScoreType>(adjustedScore);
@@ -1002,7 +1234,7 @@ ScoreType Search::QuiescenceNegaMax(ThreadData& thread, NodeInfo* node, SearchCo
 {
     ASSERT(node->ply < MaxSearchDepth);
     ASSERT(!node->filteredMove.IsValid());
-    ASSERT(node->isInCheck == node->position.IsInCheck());
+    ASSERT(node->isInCheck == node->position->IsInCheck());
 
     constexpr bool isPvNode = nodeType == NodeType::PV || nodeType == NodeType::Root;
 
@@ -1039,10 +1271,11 @@ ScoreType Search::QuiescenceNegaMax(ThreadData& thread, NodeInfo* node, SearchCo
     }
 
     // Not checking for draw by repetition in the quiescence search
-    if (node->previousMove.IsCapture() && CheckInsufficientMaterial(node->position)) [[unlikely]]
+    if (node->previousMove.IsCapture() && CheckInsufficientMaterial(*node->position)) [[unlikely]]
         return 0;
 
-    const Position& position = node->position;
+    const Position& position = *node->position;
+    const bool useMakeUnmake = ctx.searchParam.useMakeUnmake;
 
     ScoreType bestValue = -InfValue;
     ScoreType futilityBase = -InfValue;
@@ -1177,11 +1410,12 @@ ScoreType Search::QuiescenceNegaMax(ThreadData& thread, NodeInfo* node, SearchCo
                 break;
         }
 
-        // start prefetching child node's TT entry
-        ctx.searchParam.transpositionTable.Prefetch(position.HashAfterMove(move));
+        // start prefetching child node's TT and eval cache entries
+        const uint64_t childHash = position.HashAfterMove(move);
+        ctx.searchParam.transpositionTable.Prefetch(childHash);
+        g_evalCache.Prefetch(childHash);
 
-        childNode.position = position;
-        if (!childNode.position.DoMove(move, childNode.nnContext))
+        if (!DoChildMove(*node, childNode, move, useMakeUnmake))
             continue;
         moveIndex++;
 
@@ -1190,15 +1424,22 @@ ScoreType Search::QuiescenceNegaMax(ThreadData& thread, NodeInfo* node, SearchCo
         // there shouldn't be many "good" captures available in a "normal" chess positions
         if (bestValue > -TablebaseWinValue)
         {
-                 if (node->depth < -4 && moveIndex > 1) break;
-            else if (node->depth < -2 && moveIndex > 2) break;
-            else if (node->depth <  0 && moveIndex > 3) break;
+            int32_t maxMoves = INT32_MAX;
+                 if (node->depth < -4) maxMoves = 1;
+            else if (node->depth < -2) maxMoves = 2;
+            else if (node->depth <  0) maxMoves = 3;
+
+            if (moveIndex > maxMoves)
+            {
+                UndoChildMove(childNode, move, useMakeUnmake);
+                break;
+            }
         }
 
         childNode.previousMove = move;
-        childNode.position.ComputeThreats(childNode.threats);
-        childNode.isInCheck = childNode.threats.allThreats & childNode.position.GetCurrentSideKingSquare();
-        ASSERT(childNode.isInCheck == childNode.position.IsInCheck());
+        childNode.position->ComputeThreats(childNode.threats);
+        childNode.isInCheck = childNode.threats.allThreats & childNode.position->GetCurrentSideKingSquare();
+        ASSERT(childNode.isInCheck == childNode.position->IsInCheck());
 
         childNode.staticEval = InvalidValue;
         childNode.alpha = -beta;
@@ -1206,6 +1447,8 @@ ScoreType Search::QuiescenceNegaMax(ThreadData& thread, NodeInfo* node, SearchCo
         const ScoreType score = -QuiescenceNegaMax<nodeType>(thread, &childNode, ctx);
         ASSERT(score >= -CheckmateValue && score <= CheckmateValue);
 
+        UndoChildMove(childNode, move, useMakeUnmake);
+
         if (move.IsCapture() && numCapturesTried < capturesTriedListSize)
             capturesTried[numCapturesTried++] = move;
 
@@ -1221,6 +1464,7 @@ ScoreType Search::QuiescenceNegaMax(ThreadData& thread, NodeInfo* node, SearchCo
                 // update PV line
                 if constexpr (isPvNode)
                 {
+                    ASSERT(childNode.pvLength < MaxSearchDepth - node->ply);
                     node->pvLength = std::min<uint16_t>(1u + childNode.pvLength, MaxSearchDepth);
                     node->pvLine[0] = move;
                     memcpy(node->pvLine + 1, childNode.pvLine, sizeof(PackedMove) * std::min<uint16_t>(childNode.pvLength, MaxSearchDepth - 1));
@@ -1300,15 +1544,16 @@ ScoreType Search::NegaMax(ThreadData& thread, NodeInfo* node, SearchContext& ctx
         }
     }
 
-    const Position& position = node->position;
+    const Position& position = *node->position;
+    const bool useMakeUnmake = ctx.searchParam.useMakeUnmake;
     ASSERT(node->isInCheck == position.IsInCheck());
 
     if constexpr (!isRootNode)
     {
         // Check for draw
         // Skip root node as we need some move to be reported in PV
-        if (node->position.IsFiftyMoveRuleDraw() ||
-            CheckInsufficientMaterial(node->position) ||
+        if (node->position->IsFiftyMoveRuleDraw() ||
+            CheckInsufficientMaterial(*node->position) ||
             SearchUtils::IsRepetition(*node, ctx.game, isPvNode))
         {
             return 0;
@@ -1445,6 +1690,12 @@ ScoreType Search::NegaMax(ThreadData& thread, NodeInfo* node, SearchContext& ctx
             node->staticEval = evalScore;
 
             ctx.searchParam.transpositionTable.Write(position, node->staticEval, node->staticEval, -1, TTEntry::Bounds::Lower);
+
+            // network was not run (eval cache hit or endgame evaluation), same as with static eval from TT
+            if (!node->isCutNode && (node->nnContext.accumDirty[White] || node->nnContext.accumDirty[Black]))
+            {
+                EnsureAccumulatorUpdated(*node, thread.accumulatorCache);
+            }
         }
         else if (!node->isCutNode)
         {
@@ -1537,7 +1788,6 @@ ScoreType Search::NegaMax(ThreadData& thread, NodeInfo* node, SearchContext& ctx
                     NodeInfo& childNode = *(node + 1);
                     childNode.Clear();
                     childNode.pvIndex = node->pvIndex;
-                    childNode.position = position;
                     childNode.alpha = -beta;
                     childNode.beta = -beta + 1;
                     childNode.isNullMove = true;
@@ -1547,11 +1797,13 @@ ScoreType Search::NegaMax(ThreadData& thread, NodeInfo* node, SearchContext& ctx
                     childNode.depth = static_cast<int16_t>(node->depth - r);
                     childNode.nnContext.MarkAsDirty();
 
-                    childNode.position.DoNullMove();
-                    childNode.position.ComputeThreats(childNode.threats);
+                    DoChildNullMove(*node, childNode, useMakeUnmake);
+                    childNode.position->ComputeThreats(childNode.threats);
 
                     ScoreType nullMoveScore = -NegaMax<NodeType::NonPV>(thread, &childNode, ctx);
 
+                    UndoChildNullMove(childNode, useMakeUnmake);
+
                     if (nullMoveScore >= beta)
                     {
                         if (nullMoveScore >= TablebaseWinValue)
@@ -1597,18 +1849,19 @@ ScoreType Search::NegaMax(ThreadData& thread, NodeInfo* node, SearchContext& ctx
                     if (moveScore < MoveOrderer::GoodCaptureValue && seeThreshold >= 0) continue;
                     if (!position.StaticExchangeEvaluation(move, seeThreshold)) continue;
 
-                    // start prefetching child node's TT entry
-                    ctx.searchParam.transpositionTable.Prefetch(position.HashAfterMove(move));
+                    // start prefetching child node's TT and eval cache entries
+                    const uint64_t childHash = position.HashAfterMove(move);
+                    ctx.searchParam.transpositionTable.Prefetch(childHash);
+                    g_evalCache.Prefetch(childHash);
 
-                    childNode.position = position;
-                    if (!childNode.position.DoMove(move, childNode.nnContext))
+                    if (!DoChildMove(*node, childNode, move, useMakeUnmake))
                         continue;
 
                     childNode.depth = 0;
                     childNode.previousMove = move;
-                    childNode.position.ComputeThreats(childNode.threats);
-                    childNode.isInCheck = childNode.threats.allThreats & childNode.position.GetCurrentSideKingSquare();
-                    ASSERT(childNode.isInCheck == childNode.position.IsInCheck());
+                    childNode.position->ComputeThreats(childNode.threats);
+                    childNode.isInCheck = childNode.threats.allThreats & childNode.position->GetCurrentSideKingSquare();
+                    ASSERT(childNode.isInCheck == childNode.position->IsInCheck());
 
                     // quick verification search
                     ScoreType score = -QuiescenceNegaMax<NodeType::NonPV>(thread, &childNode, ctx);
@@ -1621,6 +1874,8 @@ ScoreType Search::NegaMax(ThreadData& thread, NodeInfo* node, SearchContext& ctx
                         score = -NegaMax<NodeType::NonPV>(thread, &childNode, ctx);
                     }
 
+                    UndoChildMove(childNode, move, useMakeUnmake);
+
                     // probcut failed
                     if (score >= probBeta)
                     {
@@ -1696,8 +1951,10 @@ ScoreType Search::NegaMax(ThreadData& thread, NodeInfo* node, SearchContext& ctx
 
     while (movePicker.PickMove(*node, move, moveScore))
     {
-        // start prefetching child node's TT entry
-        ctx.searchParam.transpositionTable.Prefetch(position.HashAfterMove(move));
+        // start prefetching child node's TT and eval cache entries
+        const uint64_t childHash = position.HashAfterMove(move);
+        ctx.searchParam.transpositionTable.Prefetch(childHash);
+        g_evalCache.Prefetch(childHash);
 
 #ifdef VALIDATE_MOVE_PICKER
         for (uint32_t i = 0; i < numGeneratedMoves; ++i) ASSERT(generatedSoFar[i] != move);
@@ -1863,8 +2120,7 @@ ScoreType Search::NegaMax(ThreadData& thread, NodeInfo* node, SearchContext& ctx
         }
 
         // do the move
-        childNode.position = position;
-        if (!childNode.position.DoMove(move, childNode.nnContext))
+        if (!DoChildMove(*node, childNode, move, useMakeUnmake))
             continue;
         moveIndex++;
 
@@ -1882,8 +2138,8 @@ ScoreType Search::NegaMax(ThreadData& thread, NodeInfo* node, SearchContext& ctx
         }
 
         childNode.staticEval = InvalidValue;
-        childNode.position.ComputeThreats(childNode.threats);
-        childNode.isInCheck = childNode.threats.allThreats & childNode.position.GetCurrentSideKingSquare();
+        childNode.position->ComputeThreats(childNode.threats);
+        childNode.isInCheck = childNode.threats.allThreats & childNode.position->GetCurrentSideKingSquare();
         childNode.previousMove = move;
         childNode.moveStatScore = moveStatScore;
         childNode.isPvNodeFromPrevIteration = node->isPvNodeFromPrevIteration && (move == pvMove);
@@ -2013,6 +2269,8 @@ ScoreType Search::NegaMax(ThreadData& thread, NodeInfo* node, SearchContext& ctx
             }
         }
 
+        UndoChildMove(childNode, move, useMakeUnmake);
+
         // update node cache after searching a move
         if (nodeCacheEntry) [[unlikely]]
         {
@@ -2044,6 +2302,7 @@ ScoreType Search::NegaMax(ThreadData& thread, NodeInfo* node, SearchContext& ctx
             {
                 if (!node->filteredMove.IsValid()) // don't overwrite PV in singular search
                 {
+                    ASSERT(childNode.pvLength < MaxSearchDepth - node->ply);
                     node->pvLength = std::min<uint16_t>(1u + childNode.pvLength, MaxSearchDepth);
                     node->pvLine[0] = move;
                     memcpy(node->pvLine + 1, childNode.pvLine, sizeof(PackedMove) * std::min<uint16_t>(childNode.pvLength, MaxSearchDepth - 1));
@@ -96,6 +96,13 @@ struct SearchParam
 
     // show win/draw/loss probabilities along with classic cp score
     bool showWDL = false;
+
+    // bind worker threads to NUMA nodes (applied when worker threads are spawned)
+    // and report nodes per second for each node
+    bool numaAware = false;
+
+    // search with a single position per thread updated with make/unmake instead of copying position for each ply
+    bool useMakeUnmake = false;
 };
 
 struct PvLine
@@ -109,9 +116,18 @@ using SearchResult = std::vector<PvLine>;
 
 struct NodeInfo
 {
-    Position position;
+    // position storage is owned by the search thread: separate per ply with copy-make,
+    // shared by all plies when searching with make/unmake
+    Position* position = nullptr;
     Threats threats;
 
+    // state of the parent position, used to take back previous move (make/unmake search only)
+    UndoRecord undo;
+
+    // copy of position state read by descendant nodes (position of an ancestor may be already modified)
+    uint64_t hash = 0;
+    Square kingSquares[2] = { Square::Invalid(), Square::Invalid() };
+
     // ignore given moves in search, used for singular extensions
     PackedMove filteredMove = PackedMove::Invalid();
 
@@ -145,10 +161,20 @@ struct NodeInfo
     const nn::Accumulator* accumulatorPtr[2] = { nullptr, nullptr };
 
     uint16_t pvLength = 0;
-    PackedMove pvLine[MaxSearchDepth];
 
-    // accumulators for both perspectives
-    nn::Accumulator accumulatorData[2];
+    // PV line storage owned by the search thread (capacity is MaxSearchDepth - ply)
+    PackedMove* pvLine = nullptr;
+
+    // accumulators for both perspectives, storage owned by the search thread
+    nn::Accumulator* accumulatorData = nullptr;
+
+    // must be called after the node's position is set up
+    INLINE void UpdatePositionInfo()
+    {
+        hash = position->GetHash();
+        kingSquares[White] = position->Whites().GetKingSquare();
+        kingSquares[Black] = position->Blacks().GetKingSquare();
+    }
 
     INLINE void Clear()
     {
@@ -195,6 +221,10 @@ struct SearchStats
     std::atomic<uint32_t> maxDepth = 0;
     std::atomic<uint64_t> tbHits = 0;
 
+    // summed over all search threads when the search finishes
+    AccumulatorStats accumulatorStats;
+    EvalCacheStats evalCacheStats;
+
 #ifdef COLLECT_SEARCH_STATS
     static const int32_t EvalHistogramMaxValue = 1600;
     static const int32_t EvalHistogramBins = 100;
@@ -229,6 +259,8 @@ struct SearchStats
         quiescenceNodes = other.quiescenceNodes.load();
         maxDepth = other.maxDepth.load();
         tbHits = other.tbHits.load();
+        accumulatorStats = other.accumulatorStats;
+        evalCacheStats = other.evalCacheStats;
         return *this;
     }
 };
@@ -251,8 +283,15 @@ public:
     void Clear();
     void StopWorkerThreads();
 
+    // run a task on given number of threads (the calling thread has index 0, the rest are search worker threads)
+    // blocks until all threads finish, must not be called during search
+    void RunOnThreads(uint32_t numThreads, const std::function<void(uint32_t threadIndex)>& task, bool numaAware = false);
+
     void DoSearch(const Game& game, SearchParam& param, SearchResult& outResult, SearchStats* outStats = nullptr);
 
+    // print per-thread search memory footprint
+    void PrintMemoryInfo() const;
+
     const MoveOrderer& GetMoveOrderer() const;
     const NodeCache& GetNodeCache() const;
 
@@ -288,19 +327,13 @@ private:
 
     struct alignas(64) ThreadData
     {
-        std::atomic<bool> stopThread = false;
         std::thread thread;
 
-        std::condition_variable taskFinishedCV;
-        std::mutex taskFinishedMutex;
-        bool taskFinished = false;
-
-        std::condition_variable newTaskCV;
-        std::mutex newTaskMutex;
-        std::function<void()> callback;
-
+        uint32_t threadIndex = 0;
         bool isMainThread = false;
 
+        int32_t numaNode = -1;              // NUMA node the thread is bound to (-1 if not bound)
+
         uint16_t rootDepth = 0;             // search depth at the root node in current iterative deepening step
         uint16_t depthCompleted = 0;        // recently completed search depth
         SearchResult pvLines;               // principal variation lines from recently completed search iteration
@@ -316,6 +349,16 @@ private:
 
         NodeInfo searchStack[MaxSearchDepth];
 
+        // position storage for search stack nodes (only first entry is used with make/unmake)
+        Position positionStack[MaxSearchDepth];
+
+        // accumulator and PV line storage for search stack nodes, allocated separately and touched only
+        // when a ply is reached, so that the search stack itself stays small
+        // allocated on first search by the thread that searches with this data (worker threads are bound
+        // to their NUMA node by then), so the pages are first touched in the thread's node
+        nn::Accumulator* accumulatorPool = nullptr;     // two accumulators per ply
+        PackedMove* pvLinePool = nullptr;               // MaxSearchDepth - ply moves per ply
+
         static constexpr int32_t EvalCorrectionScale = 512;
         static constexpr uint32_t MaterialCorrectionTableSize = 2048;
         static constexpr uint32_t EvalCorrectionTableSize = 16384;
@@ -326,10 +369,24 @@ private:
         EvalCorrectionTable nonPawnBlackCorrection;
         ContCorrectionTable continuationCorrection;
 
-        ThreadData();
+        ThreadData() = default;
+        ~ThreadData();
         ThreadData(const ThreadData&) = delete;
         ThreadData(ThreadData&&) = delete;
 
+        static constexpr size_t AccumulatorPoolSize = 2 * MaxSearchDepth * sizeof(nn::Accumulator);
+        static constexpr size_t PvLinePoolSize = MaxSearchDepth * (MaxSearchDepth + 1) / 2 * sizeof(PackedMove);
+
+        // print memory used by the thread's search data
+        void PrintMemoryInfo() const;
+
+        // allocate accumulator and PV line pools, if not allocated yet
+        void AllocatePools();
+
+        // reset root node of the search stack and bind positions of search stack nodes to position storage
+        // must be called from the thread that searches with this data
+        NodeInfo& InitRootNode(const Position& position, bool useMakeUnmake);
+
         // get PV move from previous depth iteration
         const Move GetPvMove(const NodeInfo& node) const;
 
@@ -340,6 +397,15 @@ private:
 
     std::vector<ThreadDataPtr> mThreadData;
 
+    // worker threads task signalling
+    std::function<void(uint32_t threadIndex)> mWorkerTask;
+    // task sequence number (upper 16 bits) and number of threads running the task, including the main one (lower 16 bits)
+    // both are packed in one word, so a worker can't pair a new task with a stale thread count
+    std::atomic<uint32_t> mWorkerTaskState = 0;
+    std::atomic<uint32_t> mNumPendingWorkers = 0;       // number of workers still running current task
+    std::atomic<bool> mStopWorkers = false;
+    std::atomic<uint32_t> mNumWorkerSpinIterations = 0;  // how long to spin before parking on task wait
+
     static constexpr uint32_t LMRTableSize = 64;
     using LMRTableType = uint16_t[LMRTableSize][LMRTableSize];
     LMRTableType mMoveReductionTable_Quiets;
@@ -357,12 +423,27 @@ private:
     void BuildMoveReductionTable();
     void BuildMoveReductionTable(LMRTableType& table, float scale, float bias);
 
-    static void WorkerThreadCallback(ThreadData* threadData);
+    void WorkerThreadCallback(ThreadData* threadData, uint32_t initialTaskState);
+
+    // make sure there are at least numThreads threads (including the main one)
+    void SpawnWorkerThreads(uint32_t numThreads, bool numaAware);
+
+    // start a task on worker threads [1, numThreads) and wait for its completion
+    // workers spin briefly before parking on an atomic (futex), so back-to-back tasks start with low latency
+    void StartWorkerTask(uint32_t numThreads, std::function<void(uint32_t threadIndex)>&& task);
+    void WaitForWorkerTask();
+
+    INLINE uint32_t NextWorkerTaskState(uint32_t numThreads) const
+    {
+        ASSERT(numThreads <= 0xFFFF);
+        return ((mWorkerTaskState.load(std::memory_order_relaxed) + 0x10000) & 0xFFFF0000) | numThreads;
+    }
 
     static ScoreType AdjustEvalScore(const ThreadData& threadData, const NodeInfo& node, const SearchParam& searchParam);
 
     void ReportPV(const AspirationWindowSearchParam& param, const PvLine& pvLine, BoundsType boundsType, const TimePoint& searchTime) const;
     void ReportCurrentMove(const Move& move, int32_t depth, uint32_t moveNumber) const;
+    void ReportNumaStats(uint32_t numThreads, const TimePoint& searchTime) const;
 
     void Search_Internal(const uint32_t threadID, const uint32_t numPvLines, const Game& game, SearchParam& param, SearchStats& outStats);
     PvLine AspirationWindowSearch(ThreadData& thread, const AspirationWindowSearchParam& param) const;
@@ -66,13 +66,15 @@ void SearchUtils::Init()
 
 bool SearchUtils::CanReachGameCycle(const NodeInfo& node)
 {
-    if (node.position.GetHalfMoveCount() < 3)
+    const Position& position = *node.position;
+
+    if (position.GetHalfMoveCount() < 3)
         return false;
 
     if (node.isNullMove || node.previousMove.IsIrreversible())
         return false;
 
-    const uint64_t originalKey = node.position.GetHash();
+    const uint64_t originalKey = position.GetHash();
     const NodeInfo* currNode = &node - 1;
     ASSERT(currNode);
 
@@ -86,8 +88,8 @@ bool SearchUtils::CanReachGameCycle(const NodeInfo& node)
         if (currNode->isNullMove || currNode->previousMove.IsIrreversible()) break;
         currNode = currNode - 1;
 
-        ASSERT(node.position.GetSideToMove() != currNode->position.GetSideToMove());
-        const uint64_t moveKey = originalKey ^ currNode->position.GetHash();
+        ASSERT((node.ply - currNode->ply) % 2 != 0);
+        const uint64_t moveKey = originalKey ^ currNode->hash;
 
         uint32_t index = UINT32_MAX;
         if (gCuckooTable[CuckooIndex1(moveKey)] == moveKey) index = CuckooIndex1(moveKey);
@@ -101,10 +103,10 @@ bool SearchUtils::CanReachGameCycle(const NodeInfo& node)
         ASSERT(move.IsValid());
 
         // move is not legal
-        if (Bitboard::GetBetween(move.FromSquare(), move.ToSquare()) & node.position.Occupied())
+        if (Bitboard::GetBetween(move.FromSquare(), move.ToSquare()) & position.Occupied())
             continue;
 
-        const Bitboard occupied = node.position.GetCurrentSide().Occupied();
+        const Bitboard occupied = position.GetCurrentSide().Occupied();
         if (occupied & (move.FromSquare().GetBitboard() | move.ToSquare().GetBitboard()))
             return true;
     }
@@ -118,7 +120,7 @@ void SearchUtils::GetPvLine(const NodeInfo& rootNode, uint32_t maxLength, std::v
 
     if (maxLength > 0)
     {
-        Position iteratedPosition = rootNode.position;
+        Position iteratedPosition = *rootNode.position;
 
         uint32_t i = 0;
 
@@ -164,10 +166,10 @@ bool SearchUtils::IsRepetition(const NodeInfo& node, const Game& game, bool isPv
         if (ply % 2 != 0)
             continue;
 
-        ASSERT(prevNode->position.GetSideToMove() == node.position.GetSideToMove());
+        ASSERT((node.ply - prevNode->ply) % 2 == 0);
 
-        if (prevNode->position.GetHash() == node.position.GetHash() &&
-            prevNode->position == node.position)
+        // ancestor positions may be already modified (make/unmake search), so compare only hashes
+        if (prevNode->hash == node.hash)
         {
             // twofold repetition within search tree in non-PV nodes
             if (!isPvNode && prevNode->ply > 0)
@@ -180,5 +182,5 @@ bool SearchUtils::IsRepetition(const NodeInfo& node, const Game& game, bool isPv
     }
 
     // threefold repetition
-    return repCount + game.GetRepetitionCount(node.position) >= 2;
+    return repCount + game.GetRepetitionCount(*node.position) >= 2;
 }
\ No newline at end of file
@@ -1,10 +1,24 @@
 #pragma once
 
-#include "Bitboard.hpp"
+#include "Common.hpp"
 
 #include <assert.h>
 #include <string>
 
+struct Bitboard;
+
+enum class Direction
+{
+    North,
+    South,
+    East,
+    West,
+    NorthEast,
+    NorthWest,
+    SouthEast,
+    SouthWest,
+};
+
 enum SquareName : uint32_t
 {
     Square_a1, Square_b1, Square_c1, Square_d1, Square_e1, Square_f1, Square_g1, Square_h1,
@@ -63,10 +77,8 @@ public:
         return mIndex;
     }
 
-    INLINE Bitboard GetBitboard() const
-    {
-        return 1ull << mIndex;
-    }
+    // defined in Bitboard.hpp
+    INLINE Bitboard GetBitboard() const;
 
     // aka. row
     INLINE uint8_t Rank() const
@@ -220,7 +232,5 @@ public:
     alignas(CACHELINE_SIZE) static uint8_t sDistances[NumSquares * NumSquares];
 };
 
-INLINE const Bitboard operator & (const Bitboard& lhs, const Square& rhs)
-{
-    return lhs & rhs.GetBitboard();
-}
\ No newline at end of file
+// Bitboard methods are inlined and take Square arguments, so Bitboard.hpp is included once Square is complete
+#include "Bitboard.hpp"
\ No newline at end of file
@@ -1,15 +1,121 @@
 #include "TranspositionTable.hpp"
 #include "Position.hpp"
 #include "Memory.hpp"
+#include "Numa.hpp"
+#include "PositionHash.hpp"
+#include "Time.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
 #include <thread>
+#include <vector>
+
+#if defined(PLATFORM_LINUX)
+    #include <cerrno>
+    #include <csignal>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/file.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif // PLATFORM_LINUX
 
 #ifdef USE_SSE
     #endif // USE_SSE
 
 static_assert(sizeof(TTEntry) == 2 * sizeof(uint32_t), "Invalid TT entry size");
-static_assert(sizeof(TranspositionTable::TTCluster) == 32, "Invalid TT cluster size");
+static_assert(sizeof(TranspositionTable::TTCluster) == CACHELINE_SIZE, "Invalid TT cluster size");
+
+static constexpr uint32_t c_TTFileMagic = 'CSTT';
+static constexpr uint32_t c_TTFileVersion = 1;
+
+// clusters data starts at page boundary, so it can be mapped directly
+static constexpr size_t c_TTFileHeaderBlockSize = 4096;
+
+struct TTFileHeader
+{
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint64_t zobristChecksum = 0;
+    uint64_t numClusters = 0;
+    uint32_t clusterSize = 0;
+    uint32_t numEntriesPerCluster = 0;
+};
+
+static_assert(sizeof(TTFileHeader) <= c_TTFileHeaderBlockSize, "Invalid TT file header size");
+
+static constexpr uint32_t c_TTSharedMagic = 'CSTS';
+static constexpr uint32_t c_TTSharedVersion = 2;
+static constexpr uint32_t c_TTSharedMaxProcesses = 256;
+
+// shared generation is advanced at most once per this interval, so processes starting their searches
+// at the same time make a single generation step
+static constexpr uint64_t c_TTSharedGenerationIntervalMs = 100;
+
+// control block at the beginning of a shared memory segment, followed by clusters (same layout as TT file)
+struct TTSharedHeader
+{
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint64_t zobristChecksum;
+    uint64_t numClusters;
+    // generation in the lowest 8 bits, time of the last advance (in milliseconds) in the rest
+    std::atomic<uint64_t> generation;
+    // IDs of attached processes, zero marks a free slot
+    std::atomic<int32_t> processes[c_TTSharedMaxProcesses];
+};
+
+static_assert(sizeof(TTSharedHeader) <= c_TTFileHeaderBlockSize, "Invalid TT shared header size");
+static_assert(std::atomic<int32_t>::is_always_lock_free, "Shared TT requires lock-free atomics");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared TT requires lock-free atomics");
+
+static bool IsProcessAlive(int32_t pid)
+{
+#if defined(PLATFORM_LINUX)
+    return kill(pid, 0) == 0 || errno != ESRCH;
+#else
+    UNUSED(pid);
+    return true;
+#endif // PLATFORM_LINUX
+}
+
+// forget processes that exited without detaching (e.g. crashed), returns number of remaining ones
+static uint32_t PruneSharedProcesses(TTSharedHeader& header)
+{
+    uint32_t count = 0;
+    for (std::atomic<int32_t>& slot : header.processes)
+    {
+        int32_t pid = slot.load();
+        if (pid == 0) continue;
+
+        if (IsProcessAlive(pid))
+            count++;
+        else
+            slot.compare_exchange_strong(pid, 0);
+    }
+    return count;
+}
+
+static bool RegisterSharedProcess(TTSharedHeader& header, int32_t pid)
+{
+    for (std::atomic<int32_t>& slot : header.processes)
+    {
+        int32_t expected = 0;
+        if (slot.compare_exchange_strong(expected, pid)) return true;
+    }
+    return false;
+}
+
+static void UnregisterSharedProcess(TTSharedHeader& header, int32_t pid)
+{
+    for (std::atomic<int32_t>& slot : header.processes)
+    {
+        int32_t expected = pid;
+        if (slot.compare_exchange_strong(expected, 0)) return;
+    }
+}
 
 ScoreType ScoreToTT(ScoreType v, int32_t height)
 {
@@ -55,39 +161,81 @@ ScoreType ScoreFromTT(ScoreType v, int32_t height, int32_t fiftyMoveRuleCount)
 TranspositionTable::TranspositionTable(size_t initialSize)
     : clusters(nullptr)
     , numClusters(0)
+    , mappedFileSize(0)
+    , sharedHeader(nullptr)
+    , sharedMemoryFile(-1)
+    , taskRunnerThreads(0)
+    , lastClearTime(0.0f)
+    , lastResizeTime(0.0f)
+    , lastClearThreads(0)
     , generation(0)
+    , numaAware(false)
+    , lazyClear(false)
+    , loadedFromFile(false)
 {
     Resize(initialSize);
 }
 
 TranspositionTable::~TranspositionTable()
 {
-    Free(clusters);
+    ReleaseMemory();
 }
 
 TranspositionTable::TranspositionTable(TranspositionTable&& rhs)
     : clusters(rhs.clusters)
     , numClusters(rhs.numClusters)
+    , mappedFileSize(rhs.mappedFileSize)
+    , sharedHeader(rhs.sharedHeader)
+    , sharedMemoryFile(rhs.sharedMemoryFile)
+    , sharedMemoryName(std::move(rhs.sharedMemoryName))
+    , taskRunner(std::move(rhs.taskRunner))
+    , taskRunnerThreads(rhs.taskRunnerThreads)
+    , lastClearTime(rhs.lastClearTime)
+    , lastResizeTime(rhs.lastResizeTime)
+    , lastClearThreads(rhs.lastClearThreads)
     , generation(rhs.generation)
+    , numaAware(rhs.numaAware)
+    , lazyClear(rhs.lazyClear)
+    , loadedFromFile(rhs.loadedFromFile)
 {
     rhs.clusters = nullptr;
     rhs.numClusters = 0;
+    rhs.mappedFileSize = 0;
+    rhs.sharedHeader = nullptr;
+    rhs.sharedMemoryFile = -1;
     rhs.generation = 0;
+    rhs.loadedFromFile = false;
 }
 
 TranspositionTable& TranspositionTable::operator = (TranspositionTable&& rhs)
 {
     if (&rhs != this)
     {
-        Free(clusters);
+        ReleaseMemory();
 
         clusters = rhs.clusters;
         numClusters = rhs.numClusters;
+        mappedFileSize = rhs.mappedFileSize;
+        sharedHeader = rhs.sharedHeader;
+        sharedMemoryFile = rhs.sharedMemoryFile;
+        sharedMemoryName = std::move(rhs.sharedMemoryName);
+        taskRunner = std::move(rhs.taskRunner);
+        taskRunnerThreads = rhs.taskRunnerThreads;
+        lastClearTime = rhs.lastClearTime;
+        lastResizeTime = rhs.lastResizeTime;
+        lastClearThreads = rhs.lastClearThreads;
         generation = rhs.generation;
+        numaAware = rhs.numaAware;
+        lazyClear = rhs.lazyClear;
+        loadedFromFile = rhs.loadedFromFile;
 
         rhs.clusters = nullptr;
         rhs.numClusters = 0;
+        rhs.mappedFileSize = 0;
+        rhs.sharedHeader = nullptr;
+        rhs.sharedMemoryFile = -1;
         rhs.generation = 0;
+        rhs.loadedFromFile = false;
     }
 
     return *this;
@@ -95,36 +243,112 @@ TranspositionTable& TranspositionTable::operator = (TranspositionTable&& rhs)
 
 void TranspositionTable::Clear()
 {
-    const size_t numThreads = std::min(std::thread::hardware_concurrency(), 4u);
+    // don't wipe entries other processes are using
+    if (sharedHeader && PruneSharedProcesses(*sharedHeader) > 1)
+    {
+        NextGeneration();
+        return;
+    }
+
+    const TimePoint startTime = TimePoint::GetCurrent();
+
+    lastClearThreads = (lazyClear && ClearMemoryLazily()) ? 0 : ClearMemory();
+    lastClearTime = (TimePoint::GetCurrent() - startTime).ToSeconds();
+
+    generation = 0;
+    loadedFromFile = false;
 
-    if (numClusters * sizeof(TTCluster) <= 256 * 1024 * 1024 || numThreads == 1)
+    if (sharedHeader)
     {
-        std::fill(clusters, clusters + numClusters, TTCluster{});
+        sharedHeader->generation = 0;
     }
-    else // clear using multiple threads
+}
+
+uint32_t TranspositionTable::ClearMemory()
+{
+    const size_t tableSize = numClusters * sizeof(TTCluster);
+    const uint32_t numNodes = numaAware ? GetNumNumaNodes() : 1;
+
+    const auto clearSlice = [this](uint32_t threadIndex, uint32_t numThreads)
     {
         const size_t numClustersPerThread = numClusters / numThreads;
+        const size_t start = threadIndex * numClustersPerThread;
+        const size_t end = threadIndex + 1 < numThreads ? start + numClustersPerThread : numClusters;
+        std::fill(clusters + start, clusters + end, TTCluster{});
+    };
 
-        std::vector<std::thread> threads;
-        threads.reserve(numThreads);
+    if (taskRunner && taskRunnerThreads > 1 && (numNodes > 1 || tableSize > 256 * 1024 * 1024))
+    {
+        // worker threads are bound to NUMA nodes already (if enabled)
+        const uint32_t numThreads = taskRunnerThreads;
+        taskRunner(numThreads, [&clearSlice, numThreads](uint32_t threadIndex)
+        {
+            clearSlice(threadIndex, numThreads);
+        });
+        return numThreads;
+    }
+
+    const uint32_t numThreads = std::max(numNodes, std::thread::hardware_concurrency());
+
+    if (numNodes == 1 && (tableSize <= 256 * 1024 * 1024 || numThreads == 1 || taskRunner))
+    {
+        clearSlice(0, 1);
+        return 1;
+    }
 
-        for (size_t threadIndex = 0; threadIndex < numThreads; ++threadIndex)
+    // no task runner: clear using temporary threads
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+
+    for (uint32_t threadIndex = 0; threadIndex < numThreads; ++threadIndex)
+    {
+        threads.emplace_back([&clearSlice, threadIndex, numThreads, numNodes]()
         {
-            threads.emplace_back([this, threadIndex, numClustersPerThread]()
+            // first touch from a node-local thread, in case interleaving policy could not be applied
+            if (numNodes > 1)
             {
-                const size_t start = threadIndex * numClustersPerThread;
-                const size_t end = start + numClustersPerThread;
-                std::fill(clusters + start, clusters + end, TTCluster{});
-            });
-        }
+                BindCurrentThreadToNumaNode(GetNumaNodeForThread(threadIndex, numThreads));
+            }
 
-        for (size_t threadIndex = 0; threadIndex < numThreads; ++threadIndex)
-        {
-            threads[threadIndex].join();
-        }
+            clearSlice(threadIndex, numThreads);
+        });
     }
 
-    generation = 0;
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    return numThreads;
+}
+
+bool TranspositionTable::ClearMemoryLazily()
+{
+#if defined(PLATFORM_LINUX) && defined(MADV_DONTNEED)
+    // only private anonymous memory is zeroed after dropping pages (not file-backed or shared memory)
+    // explicit huge pages are excluded as well, dropping them is not supported on older kernels
+    const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    if (!clusters || IsMapped() || GetAllocationPageSize(clusters) != pageSize)
+    {
+        return false;
+    }
+
+    uint8_t* begin = reinterpret_cast<uint8_t*>(clusters);
+    uint8_t* end = begin + numClusters * sizeof(TTCluster);
+    uint8_t* alignedBegin = reinterpret_cast<uint8_t*>(((size_t)begin + pageSize - 1) / pageSize * pageSize);
+    uint8_t* alignedEnd = reinterpret_cast<uint8_t*>((size_t)end / pageSize * pageSize);
+
+    if (alignedBegin >= alignedEnd || 0 != madvise(alignedBegin, alignedEnd - alignedBegin, MADV_DONTNEED))
+    {
+        return false;
+    }
+
+    memset(begin, 0, alignedBegin - begin);
+    memset(alignedEnd, 0, end - alignedEnd);
+    return true;
+#else
+    return false;
+#endif // PLATFORM_LINUX
 }
 
 void TranspositionTable::Resize(size_t newSizeInBytes)
@@ -137,16 +361,32 @@ void TranspositionTable::Resize(size_t newSizeInBytes)
         return;
     }
 
+    if (loadedFromFile)
+    {
+        std::cout << "info string Loaded transposition table dropped (size changed)" << std::endl;
+    }
+
+    const TimePoint startTime = TimePoint::GetCurrent();
+
     if (newSize == 0)
     {
-        Free(clusters);
-        clusters = nullptr;
-        numClusters = 0;
+        ReleaseMemory();
         return;
     }
 
-    Free(clusters);
-    clusters = nullptr;
+    ReleaseMemory();
+
+    if (!sharedMemoryName.empty())
+    {
+        if (AttachSharedMemory(newNumClusters))
+        {
+            lastResizeTime = (TimePoint::GetCurrent() - startTime).ToSeconds();
+            return;
+        }
+
+        std::cout << "info string Failed to attach shared transposition table, using private one" << std::endl;
+        sharedMemoryName.clear();
+    }
 
     clusters = (TTCluster*)Malloc(newNumClusters * sizeof(TTCluster));
     numClusters = newNumClusters;
@@ -160,12 +400,562 @@ void TranspositionTable::Resize(size_t newSizeInBytes)
         return;
     }
 
+    if (numaAware && !InterleaveMemoryAcrossNumaNodes(clusters, newNumClusters * sizeof(TTCluster)) && GetNumNumaNodes() > 1)
+    {
+        std::cout << "info string Failed to interleave transposition table across NUMA nodes" << std::endl;
+    }
+
     Clear();
+
+    lastResizeTime = (TimePoint::GetCurrent() - startTime).ToSeconds();
+}
+
+void TranspositionTable::ReleaseMemory()
+{
+    if (mappedFileSize)
+    {
+#if defined(PLATFORM_LINUX)
+        if (sharedHeader)
+        {
+            // last detached process removes the segment name
+            // done under the segment lock, so a process attaching at the same time never ends up in an unlinked segment
+            if (0 != flock(sharedMemoryFile, LOCK_EX))
+            {
+                perror("flock");
+            }
+
+            UnregisterSharedProcess(*sharedHeader, (int32_t)getpid());
+
+            if (PruneSharedProcesses(*sharedHeader) == 0)
+            {
+                shm_unlink(("/" + sharedMemoryName).c_str());
+            }
+
+            // closing the descriptor releases the lock
+            close(sharedMemoryFile);
+            sharedMemoryFile = -1;
+        }
+
+        void* mappedData = reinterpret_cast<uint8_t*>(clusters) - c_TTFileHeaderBlockSize;
+        if (0 != munmap(mappedData, mappedFileSize))
+        {
+            perror("munmap");
+        }
+#endif // PLATFORM_LINUX
+    }
+    else
+    {
+        Free(clusters);
+    }
+
+    clusters = nullptr;
+    numClusters = 0;
+    mappedFileSize = 0;
+    sharedHeader = nullptr;
+    loadedFromFile = false;
+}
+
+bool TranspositionTable::AttachSharedMemory(size_t numClustersToCreate)
+{
+    ASSERT(!clusters);
+    ASSERT(!sharedMemoryName.empty());
+
+#if defined(PLATFORM_LINUX)
+
+    const std::string name = "/" + sharedMemoryName;
+    const int32_t pid = (int32_t)getpid();
+
+    // attaching and detaching processes take an exclusive lock on the segment,
+    // the creating process holds it until the segment is initialized
+    for (uint32_t attempt = 0; attempt < 100; ++attempt)
+    {
+        bool created = true;
+        int fileDesc = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fileDesc == -1 && errno == EEXIST)
+        {
+            created = false;
+            fileDesc = shm_open(name.c_str(), O_RDWR, 0600);
+
+            // unlinked by the last detaching process in the meantime
+            if (fileDesc == -1 && errno == ENOENT) continue;
+        }
+
+        if (fileDesc == -1)
+        {
+            perror("shm_open");
+            return false;
+        }
+
+        if (created && 0 != flock(fileDesc, LOCK_EX))
+        {
+            perror("flock");
+            close(fileDesc);
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        size_t size = c_TTFileHeaderBlockSize + numClustersToCreate * sizeof(TTCluster);
+
+        if (created)
+        {
+            if (0 != ftruncate(fileDesc, size))
+            {
+                perror("ftruncate");
+                close(fileDesc);
+                shm_unlink(name.c_str());
+                return false;
+            }
+        }
+        else
+        {
+            // the creating process may still be sizing the segment
+            struct stat statbuf;
+            for (uint32_t i = 0; ; ++i)
+            {
+                if (fstat(fileDesc, &statbuf))
+                {
+                    perror("fstat");
+                    close(fileDesc);
+                    return false;
+                }
+
+                if ((size_t)statbuf.st_size > c_TTFileHeaderBlockSize) break;
+
+                if (i >= 1000)
+                {
+                    close(fileDesc);
+                    std::cerr << "Failed to attach shared transposition table: " << "segment is not initialized" << std::endl;
+                    return false;
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            size = statbuf.st_size;
+        }
+
+        void* mappedData = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDesc, 0);
+
+        if (mappedData == MAP_FAILED)
+        {
+            perror("mmap");
+            close(fileDesc);
+            if (created) shm_unlink(name.c_str());
+            return false;
+        }
+
+        TTSharedHeader* header = reinterpret_cast<TTSharedHeader*>(mappedData);
+        TTCluster* mappedClusters = reinterpret_cast<TTCluster*>(reinterpret_cast<uint8_t*>(mappedData) + c_TTFileHeaderBlockSize);
+        const size_t mappedNumClusters = (size - c_TTFileHeaderBlockSize) / sizeof(TTCluster);
+
+        // segment left behind by processes that terminated without detaching
+        bool abandoned = false;
+
+        if (created)
+        {
+            if (numaAware)
+            {
+                InterleaveMemoryAcrossNumaNodes(mappedClusters, mappedNumClusters * sizeof(TTCluster));
+            }
+
+            // new segment is zero-filled, which is the same as a cleared table
+            header->version = c_TTSharedVersion;
+            header->zobristChecksum = GetZobristHashChecksum();
+            header->numClusters = mappedNumClusters;
+            header->generation = 0;
+            RegisterSharedProcess(*header, pid);
+            header->magic.store(c_TTSharedMagic, std::memory_order_release);
+        }
+        else
+        {
+            for (uint32_t i = 0; header->magic.load(std::memory_order_acquire) != c_TTSharedMagic; ++i)
+            {
+                if (i >= 1000)
+                {
+                    munmap(mappedData, size);
+                    close(fileDesc);
+                    std::cerr << "Failed to attach shared transposition table: " << "segment is not initialized" << std::endl;
+                    return false;
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            if (header->version != c_TTSharedVersion ||
+                header->zobristChecksum != GetZobristHashChecksum() ||
+                header->numClusters != mappedNumClusters)
+            {
+                munmap(mappedData, size);
+                close(fileDesc);
+                std::cerr << "Failed to attach shared transposition table: " << "incompatible segment" << std::endl;
+                return false;
+            }
+
+            if (0 != flock(fileDesc, LOCK_EX))
+            {
+                perror("flock");
+                munmap(mappedData, size);
+                close(fileDesc);
+                return false;
+            }
+
+            // the last attached process detached and unlinked the segment before the lock was taken
+            struct stat statbuf;
+            if (0 == fstat(fileDesc, &statbuf) && statbuf.st_nlink == 0)
+            {
+                munmap(mappedData, size);
+                close(fileDesc);
+                continue;
+            }
+
+            abandoned = PruneSharedProcesses(*header) == 0;
+
+            if (!RegisterSharedProcess(*header, pid))
+            {
+                munmap(mappedData, size);
+                close(fileDesc);
+                std::cerr << "Failed to attach shared transposition table: " << "too many attached processes" << std::endl;
+                return false;
+            }
+
+            if (mappedNumClusters != numClustersToCreate)
+            {
+                std::cout << "info string Shared transposition table size is "
+                    << (mappedNumClusters * sizeof(TTCluster) / (1024 * 1024)) << " MB (set by another process)" << std::endl;
+            }
+        }
+
+        if (0 != flock(fileDesc, LOCK_UN))
+        {
+            perror("flock");
+        }
+
+        clusters = mappedClusters;
+        numClusters = mappedNumClusters;
+        mappedFileSize = size;
+        sharedHeader = header;
+        sharedMemoryFile = fileDesc;
+        generation = (uint8_t)header->generation.load();
+
+        if (abandoned)
+        {
+            std::cout << "info string Shared transposition table was left by terminated processes, clearing it" << std::endl;
+            Clear();
+        }
+
+        return true;
+    }
+
+    std::cerr << "Failed to attach shared transposition table: " << "segment is being removed" << std::endl;
+    return false;
+
+#else
+
+    UNUSED(numClustersToCreate);
+    std::cerr << "Failed to attach shared transposition table: " << "not supported on this platform" << std::endl;
+    return false;
+
+#endif // PLATFORM_LINUX
+}
+
+bool TranspositionTable::SetSharedMemoryName(const std::string& name)
+{
+    if (name == sharedMemoryName)
+    {
+        return name.empty() || IsShared();
+    }
+
+    const size_t sizeInBytes = numClusters * sizeof(TTCluster);
+
+    ReleaseMemory();
+    sharedMemoryName = name;
+    Resize(sizeInBytes);
+
+    return name.empty() || IsShared();
+}
+
+bool TranspositionTable::Save(const char* filePath) const
+{
+    if (!clusters)
+    {
+        std::cerr << "Failed to save transposition table: " << "table is empty" << std::endl;
+        return false;
+    }
+
+    FILE* file = fopen(filePath, "wb");
+    if (!file)
+    {
+        std::cerr << "Failed to save transposition table: " << "cannot open file" << std::endl;
+        return false;
+    }
+
+    uint8_t headerBlock[c_TTFileHeaderBlockSize] = {};
+    {
+        TTFileHeader header;
+        header.magic = c_TTFileMagic;
+        header.version = c_TTFileVersion;
+        header.zobristChecksum = GetZobristHashChecksum();
+        header.numClusters = numClusters;
+        header.clusterSize = sizeof(TTCluster);
+        header.numEntriesPerCluster = NumEntriesPerCluster;
+        memcpy(headerBlock, &header, sizeof(header));
+    }
+
+    if (1 != fwrite(headerBlock, sizeof(headerBlock), 1, file))
+    {
+        fclose(file);
+        std::cerr << "Failed to save transposition table: " << "cannot write header" << std::endl;
+        return false;
+    }
+
+    // write in batches, rebasing entry generations so the current one becomes zero
+    constexpr size_t batchSize = 16384;
+    std::vector<TTCluster> batch(std::min(batchSize, numClusters));
+
+    for (size_t offset = 0; offset < numClusters; offset += batchSize)
+    {
+        const size_t count = std::min(batchSize, numClusters - offset);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            TTCluster& cluster = batch[i];
+            cluster = clusters[offset + i];
+
+            for (uint32_t j = 0; j < NumEntriesPerCluster; ++j)
+            {
+                TTEntry& entry = cluster.entries[j];
+                const uint16_t key = cluster.keys[j] ^ FoldEntry(entry);
+
+                entry.generation = (TTEntry::GenerationCycle + entry.generation - generation) & (TTEntry::GenerationCycle - 1);
+                cluster.keys[j] = key ^ FoldEntry(entry);
+            }
+        }
+
+        if (1 != fwrite(batch.data(), count * sizeof(TTCluster), 1, file))
+        {
+            fclose(file);
+            std::cerr << "Failed to save transposition table: " << "cannot write clusters" << std::endl;
+            return false;
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+bool TranspositionTable::Load(const char* filePath)
+{
+    if (sharedHeader)
+    {
+        std::cerr << "Failed to load transposition table: " << "table is shared" << std::endl;
+        return false;
+    }
+
+    FILE* file = fopen(filePath, "rb");
+    if (!file)
+    {
+        std::cerr << "Failed to load transposition table: " << "cannot open file" << std::endl;
+        return false;
+    }
+
+    TTFileHeader header;
+    if (1 != fread(&header, sizeof(header), 1, file))
+    {
+        fclose(file);
+        std::cerr << "Failed to load transposition table: " << "cannot read header" << std::endl;
+        return false;
+    }
+
+    std::error_code errorCode;
+    const uint64_t fileSize = std::filesystem::file_size(filePath, errorCode);
+
+    if (header.magic != c_TTFileMagic)
+    {
+        fclose(file);
+        std::cerr << "Failed to load transposition table: " << "invalid magic" << std::endl;
+        return false;
+    }
+
+    if (header.version != c_TTFileVersion ||
+        header.clusterSize != sizeof(TTCluster) ||
+        header.numEntriesPerCluster != NumEntriesPerCluster)
+    {
+        fclose(file);
+        std::cerr << "Failed to load transposition table: " << "unsupported version" << std::endl;
+        return false;
+    }
+
+    if (header.zobristChecksum != GetZobristHashChecksum())
+    {
+        fclose(file);
+        std::cerr << "Failed to load transposition table: " << "position hash keys mismatch" << std::endl;
+        return false;
+    }
+
+    const uint64_t dataSize = header.numClusters * sizeof(TTCluster);
+    if (header.numClusters == 0 || fileSize != c_TTFileHeaderBlockSize + dataSize)
+    {
+        fclose(file);
+        std::cerr << "Failed to load transposition table: " << "invalid file size" << std::endl;
+        return false;
+    }
+
+#if defined(PLATFORM_LINUX)
+
+    fclose(file);
+
+    const int fileDesc = open(filePath, O_RDONLY);
+    if (fileDesc == -1)
+    {
+        perror("open");
+        return false;
+    }
+
+    // private mapping: pages are read lazily and search writes never reach the file
+    void* mappedData = mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileDesc, 0);
+    close(fileDesc);
+
+    if (mappedData == MAP_FAILED)
+    {
+        perror("mmap");
+        return false;
+    }
+
+    ReleaseMemory();
+
+    clusters = reinterpret_cast<TTCluster*>(reinterpret_cast<uint8_t*>(mappedData) + c_TTFileHeaderBlockSize);
+    numClusters = header.numClusters;
+    mappedFileSize = fileSize;
+
+    if (numaAware)
+    {
+        InterleaveMemoryAcrossNumaNodes(clusters, dataSize);
+    }
+
+#else
+
+    TTCluster* loadedClusters = (TTCluster*)Malloc(dataSize);
+    if (!loadedClusters)
+    {
+        fclose(file);
+        std::cerr << "Failed to load transposition table: " << "cannot allocate memory" << std::endl;
+        return false;
+    }
+
+    if (0 != fseek(file, c_TTFileHeaderBlockSize, SEEK_SET) || 1 != fread(loadedClusters, dataSize, 1, file))
+    {
+        fclose(file);
+        Free(loadedClusters);
+        std::cerr << "Failed to load transposition table: " << "cannot read clusters" << std::endl;
+        return false;
+    }
+
+    fclose(file);
+
+    ReleaseMemory();
+
+    clusters = loadedClusters;
+    numClusters = header.numClusters;
+
+#endif // PLATFORM_LINUX
+
+    generation = 0;
+    loadedFromFile = true;
+    return true;
+}
+
+void TranspositionTable::SetNumaAware(bool enabled)
+{
+    if (numaAware != enabled)
+    {
+        numaAware = enabled;
+
+        // reallocate, so the memory placement policy is applied to fresh pages
+        Reallocate();
+    }
+}
+
+void TranspositionTable::SetParallelTaskRunner(ParallelTaskRunner runner, uint32_t numThreads)
+{
+    taskRunner = std::move(runner);
+    taskRunnerThreads = numThreads;
+}
+
+void TranspositionTable::Reallocate()
+{
+    if (!clusters)
+    {
+        return;
+    }
+
+    // shared segment is owned by all attached processes, keep using it as is
+    if (sharedHeader)
+    {
+        std::cout << "info string Shared transposition table is not reallocated" << std::endl;
+        return;
+    }
+
+    const TimePoint startTime = TimePoint::GetCurrent();
+    const size_t sizeInBytes = numClusters * sizeof(TTCluster);
+
+    TTCluster* newClusters = (TTCluster*)Malloc(sizeInBytes);
+    if (!newClusters)
+    {
+        std::cout << "info string Failed to reallocate transposition table, keeping the old one" << std::endl;
+        return;
+    }
+
+    if (numaAware && !InterleaveMemoryAcrossNumaNodes(newClusters, sizeInBytes) && GetNumNumaNodes() > 1)
+    {
+        std::cout << "info string Failed to interleave transposition table across NUMA nodes" << std::endl;
+    }
+
+    // keep the contents (e.g. a table restored with ttload)
+    memcpy(newClusters, clusters, sizeInBytes);
+
+    const size_t newNumClusters = numClusters;
+    const bool wasLoadedFromFile = loadedFromFile;
+    ReleaseMemory();
+
+    clusters = newClusters;
+    numClusters = newNumClusters;
+    loadedFromFile = wasLoadedFromFile;
+
+    lastResizeTime = (TimePoint::GetCurrent() - startTime).ToSeconds();
+}
+
+size_t TranspositionTable::GetPageSize() const
+{
+    // mapped (file or shared) memory is never backed by explicit large pages
+    return GetAllocationPageSize(IsMapped() ? nullptr : clusters);
 }
 
 void TranspositionTable::NextGeneration()
 {
-    generation++;
+    // all attached processes share a common generation counter
+    // it's advanced once per interval, otherwise entries would age faster with each attached process
+    if (sharedHeader)
+    {
+        const uint64_t timeMs = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+
+        uint64_t value = sharedHeader->generation.load();
+        while (timeMs >= (value >> 8) + c_TTSharedGenerationIntervalMs)
+        {
+            const uint64_t newValue = (timeMs << 8) | ((value + 1) & 0xFF);
+            if (sharedHeader->generation.compare_exchange_weak(value, newValue))
+            {
+                value = newValue;
+                break;
+            }
+        }
+
+        generation = (uint8_t)value;
+    }
+    else
+    {
+        generation++;
+    }
 }
 
 void TranspositionTable::Prefetch(const uint64_t hash) const
@@ -183,14 +973,14 @@ bool TranspositionTable::Read(const Position& position, TTEntry& outEntry) const
 {
     if (clusters)
     {
-        TTCluster& cluster = GetCluster(position.GetHash());
+        const TTCluster& cluster = GetCluster(position.GetHash());
 
         const uint16_t posKey = (uint16_t)position.GetHash();
 
         for (uint32_t i = 0; i < NumEntriesPerCluster; ++i)
         {
-            const uint16_t key = cluster.entries[i].key;
-            const TTEntry data = cluster.entries[i].entry;
+            const TTEntry data = cluster.entries[i];
+            const uint16_t key = cluster.keys[i] ^ FoldEntry(data);
 
             if (key == posKey && data.bounds != TTEntry::Bounds::Invalid)
             {
@@ -234,8 +1024,8 @@ void TranspositionTable::Write(const Position& position, ScoreType score, ScoreT
     // find target entry in the cluster (the one with lowest depth)
     for (uint32_t i = 0; i < NumEntriesPerCluster; ++i)
     {
-        const uint16_t key = cluster.entries[i].key;
-        const TTEntry data = cluster.entries[i].entry;
+        const TTEntry data = cluster.entries[i];
+        const uint16_t key = cluster.keys[i] ^ FoldEntry(data);
 
         // found entry with same hash or empty entry
         if (key == positionKey || !data.IsValid())
@@ -275,7 +1065,8 @@ void TranspositionTable::Write(const Position& position, ScoreType score, ScoreT
 
     entry.generation = generation;
 
-    cluster.entries[replaceIndex] = { positionKey, entry };
+    cluster.entries[replaceIndex] = entry;
+    cluster.keys[replaceIndex] = positionKey ^ FoldEntry(entry);
 }
 
 void TranspositionTable::PrintInfo() const
@@ -290,19 +1081,25 @@ void TranspositionTable::PrintInfo() const
         const TTCluster& cluster = clusters[i];
         for (size_t j = 0; j < NumEntriesPerCluster; ++j)
         {
-            const InternalEntry& entry = cluster.entries[j];
-            if (entry.entry.IsValid())
+            const TTEntry& entry = cluster.entries[j];
+            if (entry.IsValid())
             {
                 totalCount++;
 
-                if (entry.entry.bounds == TTEntry::Bounds::Exact) exactCount++;
-                if (entry.entry.bounds == TTEntry::Bounds::Lower) lowerBoundCount++;
-                if (entry.entry.bounds == TTEntry::Bounds::Upper) upperBoundCount++;
+                if (entry.bounds == TTEntry::Bounds::Exact) exactCount++;
+                if (entry.bounds == TTEntry::Bounds::Lower) lowerBoundCount++;
+                if (entry.bounds == TTEntry::Bounds::Upper) upperBoundCount++;
             }
         }
     }
 
     std::cout << "=== TT statistics ===" << std::endl;
+    std::cout << "Size:                " << (numClusters * sizeof(TTCluster) / (1024 * 1024)) << " MB" << std::endl;
+    std::cout << "Page size:           " << (GetPageSize() / 1024) << " KB" << std::endl;
+    std::cout << "Last clear time:     " << (1000.0f * lastClearTime) << " ms";
+    if (lastClearThreads == 0) std::cout << " (lazy)" << std::endl;
+    else std::cout << " (" << lastClearThreads << " threads)" << std::endl;
+    std::cout << "Last resize time:    " << (1000.0f * lastResizeTime) << " ms" << std::endl;
     std::cout << "Entries in use:      " << totalCount << " (" << (100.0f * (float)totalCount / (float)GetSize()) << "%)" << std::endl;
     std::cout << "Exact entries:       " << exactCount << " (" << (100.0f * (float)exactCount / (float)totalCount) << "%)" << std::endl;
     std::cout << "Lower-bound entries: " << lowerBoundCount << " (" << (100.0f * (float)lowerBoundCount / (float)totalCount) << "%)" << std::endl;
@@ -318,11 +1115,11 @@ uint32_t TranspositionTable::GetHashFull() const
     {
         for (uint32_t i = 0; i < clusterCount; ++i)
         {
-            for (const InternalEntry& entry : clusters[i].entries)
+            for (const TTEntry& entry : clusters[i].entries)
             {
-                count += (entry.entry.IsValid() && entry.entry.generation == generation);
+                count += (entry.IsValid() && entry.generation == generation);
             }
         }
     }
-    return count;
+    return count * 1000 / (clusterCount * NumEntriesPerCluster);
 }
\ No newline at end of file
@@ -3,8 +3,12 @@
 #include "Move.hpp"
 #include "Math.hpp"
 
+#include <functional>
+#include <string>
+
 
 class Position;
+struct TTSharedHeader;
 
 struct TTEntry
 {
@@ -50,18 +54,18 @@ struct TTEntry
 class TranspositionTable
 {
 public:
-    struct InternalEntry
-    {
-        uint16_t key;
-        TTEntry entry;
-    };
+    // runs a task on given number of threads and blocks until all of them finish
+    using ParallelTaskRunner = std::function<void(uint32_t numThreads, const std::function<void(uint32_t threadIndex)>& task)>;
 
     // one cluster occupies one cache line
-    static constexpr uint32_t NumEntriesPerCluster = 3;
-    struct alignas(32) TTCluster
+    // each entry is written with a single 64-bit store, the key is stored separately and XOR-ed with
+    // folded entry data, so a key/entry pair torn by concurrent writes fails validation on read
+    static constexpr uint32_t NumEntriesPerCluster = 6;
+    struct alignas(CACHELINE_SIZE) TTCluster
     {
-        InternalEntry entries[NumEntriesPerCluster];
-        uint16_t padding;
+        uint16_t keys[NumEntriesPerCluster];
+        uint16_t padding[2];
+        TTEntry entries[NumEntriesPerCluster];
     };
 
     TranspositionTable(size_t initialSize = 0);
@@ -77,12 +81,50 @@ public:
     void Prefetch(const uint64_t hash) const;
 
     // invalidate all entries
+    // for shared table entries are wiped only if no other process is attached, otherwise only the generation is advanced
     void Clear();
 
     // resize the table
     // old entries will be preserved if possible
+    // shared table keeps size of an existing segment if other processes are attached to it
     void Resize(size_t newSizeInBytes);
 
+    // back the table with a named shared memory segment, so multiple engine processes can use a single table
+    // the first process creates and sizes the segment, generation counter is shared by all attached processes
+    // segment left by crashed processes is detected by their process IDs and cleared by the next attached process
+    // empty name switches back to a private table
+    bool SetSharedMemoryName(const std::string& name);
+    bool IsShared() const { return sharedHeader != nullptr; }
+
+    // interleave the table memory across NUMA nodes and clear it using node-bound threads
+    // changing this setting reallocates the table
+    void SetNumaAware(bool enabled);
+    bool IsNumaAware() const { return numaAware; }
+
+    // move the table to a fresh allocation with current allocation settings (e.g. after toggling large pages)
+    // entries are preserved, shared table is left untouched
+    void Reallocate();
+
+    // clear the table using external threads (e.g. search worker threads) instead of spawning new ones
+    void SetParallelTaskRunner(ParallelTaskRunner runner, uint32_t numThreads);
+
+    // clear by dropping table pages, so the OS zeroes them lazily on first access (Linux only)
+    void SetLazyClear(bool enabled) { lazyClear = enabled; }
+
+    // page size backing the table memory
+    size_t GetPageSize() const;
+
+    // dump the table to a file
+    // entry generations are stored relative to the current one, so the loaded table starts at generation zero
+    bool Save(const char* filePath) const;
+
+    // restore the table from a file written by Save()
+    // the file is memory-mapped copy-on-write where supported, so pages are loaded lazily on first access
+    // the table size is taken from the file
+    bool Load(const char* filePath);
+
+    bool IsMapped() const { return mappedFileSize != 0; }
+
     size_t GetSize() const { return numClusters * NumEntriesPerCluster; }
 
     // print debug info
@@ -96,6 +138,25 @@ private:
     TranspositionTable(const TranspositionTable&) = delete;
     TranspositionTable& operator = (const TranspositionTable&) = delete;
 
+    INLINE static uint16_t FoldEntry(const TTEntry& entry)
+    {
+        uint64_t data;
+        memcpy(&data, &entry, sizeof(data));
+        data ^= data >> 32;
+        data ^= data >> 16;
+        return static_cast<uint16_t>(data);
+    }
+
+    // free table memory, either allocated or mapped from file
+    void ReleaseMemory();
+
+    // create or attach named shared memory segment
+    bool AttachSharedMemory(size_t numClustersToCreate);
+
+    // zero clusters memory, returns number of threads used (zero if cleared lazily)
+    uint32_t ClearMemory();
+    bool ClearMemoryLazily();
+
     INLINE TTCluster& GetCluster(uint64_t hash) const
     {
         const uint64_t index = MulHi64(hash, numClusters);
@@ -105,7 +166,19 @@ private:
 
     mutable TTCluster* clusters;
     size_t numClusters;
+    size_t mappedFileSize;
+    TTSharedHeader* sharedHeader;
+    int sharedMemoryFile;
+    std::string sharedMemoryName;
+    ParallelTaskRunner taskRunner;
+    uint32_t taskRunnerThreads;
+    float lastClearTime;
+    float lastResizeTime;
+    uint32_t lastClearThreads;
     uint8_t generation;
+    bool numaAware;
+    bool lazyClear;
+    bool loadedFromFile;
 };
 
 INLINE TTEntry::Bounds operator & (const TTEntry::Bounds a, const TTEntry::Bounds b)
@@ -1,9 +1,11 @@
 #include "UCI.hpp"
 #include "../backend/MoveGen.hpp"
 #include "../backend/Evaluate.hpp"
+#include "../backend/EvalCache.hpp"
 #include "../backend/Tablebase.hpp"
 #include "../backend/TimeManager.hpp"
 #include "../backend/Tuning.hpp"
+#include "../backend/Memory.hpp"
 
 #ifndef CAISSA_VERSION
 #define CAISSA_VERSION "1.21.6"
@@ -49,6 +51,8 @@ static const uint32_t c_DefaultTTSizeInMB = 64;
 static const uint32_t c_DefaultTTSizeInMB = 16;
 #endif
 static const uint32_t c_DefaultTTSize = 1024 * 1024 * c_DefaultTTSizeInMB;
+// eval cache is disabled by default, hit rate measured in search is below 0.1% (static evals are stored in TT already)
+static const uint32_t c_DefaultEvalCacheSizeInMB = 0;
 #ifdef USE_GAVIOTA_TABLEBASES
 static const uint32_t c_DefaultGaviotaTbCacheInMB = 64;
 #endif // USE_GAVIOTA_TABLEBASES
@@ -63,9 +67,12 @@ UniversalChessInterface::UniversalChessInterface()
 
     mGame.Reset(Position(Position::InitPositionFEN));
     mTranspositionTable.Resize(c_DefaultTTSize);
+    UpdateTranspositionTableTaskRunner();
 
     std::cout << c_EngineName << " by " << c_Author << std::endl;
 
+    g_evalCache.Resize(1024 * 1024 * c_DefaultEvalCacheSizeInMB);
+
     TryLoadingDefaultEvalFile();
 
 #ifdef USE_GAVIOTA_TABLEBASES
@@ -79,6 +86,17 @@ UniversalChessInterface::~UniversalChessInterface()
     StopSearchThread();
 }
 
+void UniversalChessInterface::UpdateTranspositionTableTaskRunner()
+{
+    // clear/resize the table using search worker threads
+    mTranspositionTable.SetParallelTaskRunner(
+        [this](uint32_t numThreads, const std::function<void(uint32_t)>& task)
+        {
+            mSearch.RunOnThreads(numThreads, task, mOptions.numaAware);
+        },
+        mOptions.threads);
+}
+
 void UniversalChessInterface::Loop(int argc, const char* argv[])
 {
     for (int i = 1; i < argc; ++i)
@@ -170,9 +188,14 @@ bool UniversalChessInterface::ExecuteCommand(const std::string& commandString)
         std::cout << "option name MultiPV type spin default 1 min 1 max " << MaxAllowedMoves << "\n";
         std::cout << "option name MoveOverhead type spin default " << mOptions.moveOverhead << " min 0 max 10000\n";
         std::cout << "option name Threads type spin default 1 min 1 max " << c_MaxNumThreads << "\n";
+        std::cout << "option name NumaAware type check default false\n";
+        std::cout << "option name LargePages type check default true\n";
+        std::cout << "option name LazyHashClear type check default false\n";
+        std::cout << "option name SharedHash type string default <empty>\n";
         std::cout << "option name Ponder type check default false\n";
         std::cout << "option name EvalFile type string default " << c_DefaultEvalFile << "\n";
         std::cout << "option name EvalRandomization type spin default 0 min 0 max 100\n";
+        std::cout << "option name EvalCache type spin default " << c_DefaultEvalCacheSizeInMB << " min 0 max 1048576\n";
 #ifdef USE_SYZYGY_TABLEBASES
         std::cout << "option name SyzygyPath type string default <empty>\n";
         std::cout << "option name SyzygyProbeLimit type spin default 6 min 4 max 7\n";
@@ -186,6 +209,8 @@ bool UniversalChessInterface::ExecuteCommand(const std::string& commandString)
         std::cout << "option name UCI_ShowWDL type check default false\n";
         std::cout << "option name UseSAN type check default false\n";
         std::cout << "option name ColorConsoleOutput type check default false\n";
+        std::cout << "option name AccumulatorStats type check default false\n";
+        std::cout << "option name MakeUnmake type check default false\n";
 #ifdef ENABLE_TUNING
         for (const TunableParameter& param : g_TunableParameters)
         {
@@ -200,6 +225,7 @@ bool UniversalChessInterface::ExecuteCommand(const std::string& commandString)
     }
     else if (command == "ucinewgame")
     {
+        Command_Stop();
         mTranspositionTable.Clear();
         mSearch.Clear();
         mPrevSearchPosition = Position();
@@ -279,10 +305,26 @@ bool UniversalChessInterface::ExecuteCommand(const std::string& commandString)
     {
         mTranspositionTable.PrintInfo();
     }
+    else if (command == "meminfo")
+    {
+        mSearch.PrintMemoryInfo();
+    }
     else if (command == "ttprobe")
     {
         Command_TranspositionTableProbe();
     }
+    else if (command == "ttsave" || command == "ttload")
+    {
+        if (args.size() >= 2)
+        {
+            Command_Stop();
+            Command_TranspositionTableFile(command == "ttsave", commandString.substr(commandString.find(args[1], commandString.find(command) + command.size())));
+        }
+        else
+        {
+            std::cout << "Invalid command" << std::endl;
+        }
+    }
     else if (command == "tbprobe")
     {
         Command_TablebaseProbe();
@@ -331,7 +373,10 @@ bool UniversalChessInterface::ExecuteCommand(const std::string& commandString)
         std::cout << " * eval - evaluate current position" << std::endl;
         std::cout << " * scoremoves - print all legal moves with their move orderer scores" << std::endl;
         std::cout << " * ttinfo - print transposition table info" << std::endl;
+        std::cout << " * meminfo - print per-thread search memory footprint" << std::endl;
         std::cout << " * ttprobe - probe transposition table with current position" << std::endl;
+        std::cout << " * ttsave <path> - save transposition table to a file" << std::endl;
+        std::cout << " * ttload <path> - load transposition table from a file (table size is taken from the file)" << std::endl;
         std::cout << " * tbprobe - probe tablebases with current position" << std::endl;
         std::cout << " * cacheprobe - probe node cache" << std::endl;
         std::cout << " * bench|benchmark - run benchmark" << std::endl;
@@ -614,6 +659,8 @@ bool UniversalChessInterface::Command_Go(const std::vector<std::string>& args)
     mSearchCtx->searchParam.moveNotation = mOptions.useStandardAlgebraicNotation ? MoveNotation::SAN : MoveNotation::LAN;
     mSearchCtx->searchParam.colorConsoleOutput = mOptions.colorConsoleOutput;
     mSearchCtx->searchParam.showWDL = mOptions.showWDL;
+    mSearchCtx->searchParam.numaAware = mOptions.numaAware;
+    mSearchCtx->searchParam.useMakeUnmake = mOptions.useMakeUnmake;
 
     {
         std::unique_lock<std::mutex> lock(mSearchThreadMutex);
@@ -666,15 +713,20 @@ void UniversalChessInterface::SearchThreadEntryFunc()
     }
 }
 
-#ifdef NN_ACCUMULATOR_STATS
-static void PrintNNEvaluatorStats()
+static void PrintAccumulatorStats(const AccumulatorStats& stats)
 {
-    uint64_t numUpdates = 0, numRefreshes = 0;
-    NNEvaluator::GetStats(numUpdates, numRefreshes);
-    std::cout << "NN accumulator updates: " << numUpdates << std::endl;
-    std::cout << "NN accumulator refreshes: " << numRefreshes << std::endl;
+    std::cout << "info string accumulator updates " << stats.numUpdates
+        << " refreshes " << stats.numRefreshes
+        << " skipped plies " << stats.numSkippedPlies
+        << " cached " << stats.numCached << std::endl;
+}
+
+static void PrintEvalCacheStats(const EvalCacheStats& stats)
+{
+    std::cout << "info string eval cache probes " << stats.numProbes
+        << " hits " << stats.numHits
+        << " hit rate " << (stats.numProbes > 0 ? 100.0 * stats.numHits / stats.numProbes : 0.0) << "%" << std::endl;
 }
-#endif // NN_ACCUMULATOR_STATS
 
 void UniversalChessInterface::DoSearch()
 {
@@ -682,7 +734,15 @@ void UniversalChessInterface::DoSearch()
     mSearchCtx->searchStarted.store(true, std::memory_order_release);
 
     mTranspositionTable.NextGeneration();
-    mSearch.DoSearch(mGame, mSearchCtx->searchParam, mSearchCtx->searchResult);
+
+    SearchStats stats;
+    mSearch.DoSearch(mGame, mSearchCtx->searchParam, mSearchCtx->searchResult, &stats);
+
+    if (mOptions.accumulatorStats)
+    {
+        PrintAccumulatorStats(stats.accumulatorStats);
+        PrintEvalCacheStats(stats.evalCacheStats);
+    }
 
     // make sure we're not pondering (search was either stopped or 'ponderhit' was called)
     while (mSearchCtx->searchParam.isPonder.load(std::memory_order_acquire))
@@ -723,10 +783,6 @@ void UniversalChessInterface::DoSearch()
         }
 
         std::cout << std::endl;
-
-#ifdef NN_ACCUMULATOR_STATS
-        PrintNNEvaluatorStats();
-#endif // NN_ACCUMULATOR_STATS
     }
 
     // remember search result
@@ -823,6 +879,24 @@ bool UniversalChessInterface::Command_SetOption(const std::string& name, const s
         {
             mSearch.StopWorkerThreads();
             mOptions.threads = newNumThreads;
+            UpdateTranspositionTableTaskRunner();
+        }
+    }
+    else if (lowerCaseName == "numaaware")
+    {
+        bool numaAware = false;
+        if (!ParseBool(lowerCaseValue, numaAware))
+        {
+            std::cout << "Invalid value" << std::endl;
+            return false;
+        }
+
+        if (mOptions.numaAware != numaAware)
+        {
+            // worker threads are bound to NUMA nodes when spawned
+            mSearch.StopWorkerThreads();
+            mTranspositionTable.SetNumaAware(numaAware);
+            mOptions.numaAware = numaAware;
         }
     }
     else if (lowerCaseName == "moveoverhead")
@@ -837,6 +911,45 @@ bool UniversalChessInterface::Command_SetOption(const std::string& name, const s
     {
         size_t hashSize = 1024 * 1024 * static_cast<size_t>(std::max(1, atoi(value.c_str())));
         mTranspositionTable.Resize(hashSize);
+        std::cout << "info string Transposition table page size: " << (mTranspositionTable.GetPageSize() / 1024) << " KB" << std::endl;
+    }
+    else if (lowerCaseName == "lazyhashclear")
+    {
+        bool lazyHashClear = false;
+        if (!ParseBool(lowerCaseValue, lazyHashClear))
+        {
+            std::cout << "Invalid value" << std::endl;
+            return false;
+        }
+
+        mTranspositionTable.SetLazyClear(lazyHashClear);
+    }
+    else if (lowerCaseName == "largepages")
+    {
+        bool largePages = true;
+        if (!ParseBool(lowerCaseValue, largePages))
+        {
+            std::cout << "Invalid value" << std::endl;
+            return false;
+        }
+
+        if (AreLargePagesEnabled() != largePages)
+        {
+            // neural network weights are affected on next load
+            SetLargePagesEnabled(largePages);
+            mTranspositionTable.Reallocate();
+        }
+
+        std::cout << "info string Transposition table page size: " << (mTranspositionTable.GetPageSize() / 1024) << " KB" << std::endl;
+    }
+    else if (lowerCaseName == "sharedhash")
+    {
+        const std::string sharedMemoryName = value == "<empty>" ? "" : value;
+        if (!mTranspositionTable.SetSharedMemoryName(sharedMemoryName))
+        {
+            std::cout << "info string Failed to attach shared transposition table '" << sharedMemoryName << "'" << std::endl;
+            return false;
+        }
     }
     else if (lowerCaseName == "usesan" || lowerCaseName == "usestandardalgebraicnotation")
     {
@@ -895,6 +1008,10 @@ bool UniversalChessInterface::Command_SetOption(const std::string& name, const s
     {
         LoadMainNeuralNetwork(value.c_str());
     }
+    else if (lowerCaseName == "evalcache")
+    {
+        g_evalCache.Resize(1024 * 1024 * static_cast<size_t>(std::max(0, atoi(value.c_str()))));
+    }
     else if (lowerCaseName == "ponder")
     {
         // nothing special here
@@ -907,6 +1024,22 @@ bool UniversalChessInterface::Command_SetOption(const std::string& name, const s
             return false;
         }
     }
+    else if (lowerCaseName == "accumulatorstats")
+    {
+        if (!ParseBool(lowerCaseValue, mOptions.accumulatorStats))
+        {
+            std::cout << "Invalid value" << std::endl;
+            return false;
+        }
+    }
+    else if (lowerCaseName == "makeunmake")
+    {
+        if (!ParseBool(lowerCaseValue, mOptions.useMakeUnmake))
+        {
+            std::cout << "Invalid value" << std::endl;
+            return false;
+        }
+    }
     else
     {
 #ifdef ENABLE_TUNING
@@ -959,6 +1092,35 @@ bool UniversalChessInterface::Command_TranspositionTableProbe()
     return true;
 }
 
+bool UniversalChessInterface::Command_TranspositionTableFile(bool save, const std::string& path)
+{
+    const TimePoint startTime = TimePoint::GetCurrent();
+
+    if (save)
+    {
+        if (!mTranspositionTable.Save(path.c_str()))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        if (!mTranspositionTable.Load(path.c_str()))
+        {
+            return false;
+        }
+    }
+
+    const float time = (TimePoint::GetCurrent() - startTime).ToSeconds();
+
+    std::cout << "info string " << (save ? "Saved" : "Loaded") << " transposition table: "
+        << (mTranspositionTable.GetSize() / TranspositionTable::NumEntriesPerCluster * sizeof(TranspositionTable::TTCluster) / (1024 * 1024)) << " MB"
+        << (mTranspositionTable.IsMapped() ? " (memory-mapped)" : "")
+        << " in " << time << " seconds" << std::endl;
+
+    return true;
+}
+
 bool UniversalChessInterface::Command_TablebaseProbe()
 {
     {
@@ -1019,8 +1181,10 @@ bool UniversalChessInterface::Command_ScoreMoves()
     MoveList moves;
     GenerateMoveList(mGame.GetPosition(), threats.allThreats, moves);
 
+    Position position = mGame.GetPosition();
     NodeInfo nodeInfo;
-    nodeInfo.position = mGame.GetPosition();
+    nodeInfo.position = &position;
+    nodeInfo.UpdatePositionInfo();
     mGame.GetPosition().ComputeThreats(nodeInfo.threats);
 
     const NodeCacheEntry* nodeCacheEntry = mSearch.GetNodeCache().TryGetEntry(mGame.GetPosition());
@@ -1187,6 +1351,8 @@ bool UniversalChessInterface::Command_Benchmark()
 
     uint64_t totalNodes = 0;
     double totalTime = 0.0;
+    AccumulatorStats accumulatorStats;
+    EvalCacheStats evalCacheStats;
 
     for (const char* testPosition : testPositions)
     {
@@ -1200,10 +1366,12 @@ bool UniversalChessInterface::Command_Benchmark()
 
         search.Clear();
         tt.Clear();
+        g_evalCache.Clear();
 
         SearchParam searchParam{ tt };
         searchParam.debugLog = false;
         searchParam.limits.maxDepth = maxDepth;
+        searchParam.useMakeUnmake = mOptions.useMakeUnmake;
 
         const TimePoint startTimePoint = TimePoint::GetCurrent();
 
@@ -1215,6 +1383,8 @@ bool UniversalChessInterface::Command_Benchmark()
 
         totalNodes += stats.nodes;
         totalTime += (endTimePoint - startTimePoint).ToSeconds();
+        accumulatorStats += stats.accumulatorStats;
+        evalCacheStats += stats.evalCacheStats;
 
         // print best move and stats
         printf(" Move: %s, Nodes: %" PRId64 ", Time: %.2f MNPS: %.2f\n",
@@ -1226,9 +1396,11 @@ bool UniversalChessInterface::Command_Benchmark()
 
     std::cout << totalNodes << " nodes " << static_cast<int64_t>(totalNodes / totalTime) << " nps" << std::endl;
 
-#ifdef NN_ACCUMULATOR_STATS
-    PrintNNEvaluatorStats();
-#endif // NN_ACCUMULATOR_STATS
+    if (mOptions.accumulatorStats)
+    {
+        PrintAccumulatorStats(accumulatorStats);
+        PrintEvalCacheStats(evalCacheStats);
+    }
 
     return true;
 }
@@ -19,6 +19,9 @@ struct Options
     bool useStandardAlgebraicNotation = false;
     bool colorConsoleOutput = false;
     bool showWDL = false;
+    bool numaAware = false;
+    bool accumulatorStats = false;
+    bool useMakeUnmake = false;
 };
 
 struct SearchTaskContext
@@ -51,11 +54,13 @@ private:
     bool Command_SetOption(const std::string& name, const std::string& value);
     bool Command_NodeCacheProbe();
     bool Command_TranspositionTableProbe();
+    bool Command_TranspositionTableFile(bool save, const std::string& path);
     bool Command_TablebaseProbe();
     bool Command_ScoreMoves();
     bool Command_Benchmark();
 
     void StopSearchThread();
+    void UpdateTranspositionTableTaskRunner();
     void DoSearch();
 
     void SearchThreadEntryFunc();
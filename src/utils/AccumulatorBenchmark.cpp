@@ -0,0 +1,336 @@
+#include "Common.hpp"
+
+#include "../backend/Accumulator.hpp"
+#include "../backend/PackedNeuralNetwork.hpp"
+#include "../backend/Memory.hpp"
+#include "../backend/Time.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+namespace {
+
+template<typename WeightType>
+using WeightsVector = std::vector<WeightType, AlignmentAllocator<WeightType, 64>>;
+
+static constexpr uint32_t NumAccumulators = 64;
+static constexpr uint32_t NumFeatureSets = 4096;
+
+// typical quiet move: one feature removed, one added
+// typical capture: two features removed, one added
+struct FeatureSet
+{
+    uint16_t added[2];
+    uint16_t removed[2];
+    uint32_t numAdded;
+    uint32_t numRemoved;
+};
+
+static const char* GetArchitectureName()
+{
+#if defined(NN_USE_AVX512)
+    return "AVX-512";
+#elif defined(NN_USE_AVX2)
+    return "AVX2";
+#elif defined(NN_USE_SSE2)
+    return "SSE2";
+#elif defined(NN_USE_ARM_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+static void PrintResult(const char* name, uint64_t numUpdates, float time)
+{
+    std::cout
+        << std::setw(24) << name << " | "
+        << std::fixed << std::setprecision(2)
+        << std::setw(8) << (1.0e9 * time / std::max<uint64_t>(1, numUpdates)) << " ns/update" << std::endl;
+}
+
+// kernels are called through non-inlined functions, so they are compiled the same way as in NNEvaluator
+template<typename WeightType>
+NO_INLINE static void UpdateSingle(nn::Accumulator& target, const nn::Accumulator& source, const WeightType* weights, const FeatureSet& set)
+{
+    target.Update(source, weights, set.numAdded, set.added, set.numRemoved, set.removed);
+}
+
+template<typename WeightType>
+NO_INLINE static void UpdateChained(const nn::Accumulator& source, const WeightType* weights, uint32_t numSteps, const nn::AccumulatorUpdateStep* steps)
+{
+    nn::Accumulator::UpdateChain(source, weights, numSteps, steps);
+}
+
+template<typename WeightType>
+static void RunUpdateBenchmarks(const char* formatName, uint32_t numIterations, const std::vector<FeatureSet>& featureSets, std::vector<nn::Accumulator>& accumulators)
+{
+    std::mt19937 random(12345);
+
+    WeightsVector<WeightType> weights((size_t)nn::NumNetworkInputs * nn::AccumulatorSize);
+    {
+        std::uniform_int_distribution<int32_t> distr(-64, 64);
+        for (WeightType& w : weights)
+        {
+            w = (WeightType)distr(random);
+        }
+    }
+
+    std::cout << "Weights format: " << formatName << " (" << (weights.size() * sizeof(WeightType) / 1024) << " KB)" << std::endl;
+
+    const WeightType* weightsPtr = weights.data();
+
+    // single ply update, reading parent accumulator
+    {
+        const TimePoint startTime = TimePoint::GetCurrent();
+        for (uint32_t i = 0; i < numIterations; ++i)
+        {
+            const FeatureSet& set = featureSets[i % NumFeatureSets];
+            const uint32_t index = i % (NumAccumulators - 1);
+            UpdateSingle(accumulators[index + 1], accumulators[index], weightsPtr, set);
+        }
+        PrintResult("single update", numIterations, (TimePoint::GetCurrent() - startTime).ToSeconds());
+    }
+
+    // two plies (parent and node) updated one after another
+    {
+        const TimePoint startTime = TimePoint::GetCurrent();
+        for (uint32_t i = 0; i < numIterations; ++i)
+        {
+            const FeatureSet& parentSet = featureSets[i % NumFeatureSets];
+            const FeatureSet& nodeSet = featureSets[(i + 1) % NumFeatureSets];
+            const uint32_t index = i % (NumAccumulators - 2);
+            UpdateSingle(accumulators[index + 1], accumulators[index], weightsPtr, parentSet);
+            UpdateSingle(accumulators[index + 2], accumulators[index + 1], weightsPtr, nodeSet);
+        }
+        PrintResult("2 plies, separate", 2ull * numIterations, (TimePoint::GetCurrent() - startTime).ToSeconds());
+    }
+
+    // two plies (parent and node) updated in a single pass
+    {
+        const TimePoint startTime = TimePoint::GetCurrent();
+        for (uint32_t i = 0; i < numIterations; ++i)
+        {
+            const FeatureSet& parentSet = featureSets[i % NumFeatureSets];
+            const FeatureSet& nodeSet = featureSets[(i + 1) % NumFeatureSets];
+            const uint32_t index = i % (NumAccumulators - 2);
+            const nn::AccumulatorUpdateStep steps[] =
+            {
+                { &accumulators[index + 1], parentSet.numAdded, parentSet.numRemoved, parentSet.added, parentSet.removed },
+                { &accumulators[index + 2], nodeSet.numAdded, nodeSet.numRemoved, nodeSet.added, nodeSet.removed },
+            };
+            UpdateChained(accumulators[index], weightsPtr, 2, steps);
+        }
+        PrintResult("2 plies, chained", 2ull * numIterations, (TimePoint::GetCurrent() - startTime).ToSeconds());
+    }
+
+    // accumulator cache refresh: in-place update followed by a copy to the node
+    {
+        nn::Accumulator& cacheAccum = accumulators.front();
+        const TimePoint startTime = TimePoint::GetCurrent();
+        for (uint32_t i = 0; i < numIterations; ++i)
+        {
+            const FeatureSet& set = featureSets[i % NumFeatureSets];
+            UpdateSingle(cacheAccum, cacheAccum, weightsPtr, set);
+            accumulators[1 + i % (NumAccumulators - 1)] = cacheAccum;
+        }
+        PrintResult("cache refresh, copy", numIterations, (TimePoint::GetCurrent() - startTime).ToSeconds());
+    }
+
+    // accumulator cache refresh: cache and node written in a single pass
+    {
+        nn::Accumulator& cacheAccum = accumulators.front();
+        const TimePoint startTime = TimePoint::GetCurrent();
+        for (uint32_t i = 0; i < numIterations; ++i)
+        {
+            const FeatureSet& set = featureSets[i % NumFeatureSets];
+            const nn::AccumulatorUpdateStep steps[] =
+            {
+                { &cacheAccum, set.numAdded, set.numRemoved, set.added, set.removed },
+                { &accumulators[1 + i % (NumAccumulators - 1)] },
+            };
+            UpdateChained(cacheAccum, weightsPtr, 2, steps);
+        }
+        PrintResult("cache refresh, chained", numIterations, (TimePoint::GetCurrent() - startTime).ToSeconds());
+    }
+
+    // prevent the compiler from optimizing the updates away
+    int32_t checksum = 0;
+    for (const nn::Accumulator& accum : accumulators)
+    {
+        checksum += accum.values[0];
+    }
+    std::cout << "Checksum: " << checksum << std::endl;
+}
+
+static constexpr uint32_t NumAccumulatorPairs = 256;
+
+template<typename T>
+static void FillRandom(const T* data, size_t count, int32_t minValue, int32_t maxValue, std::mt19937& random)
+{
+    std::uniform_int_distribution<int32_t> distr(minValue, maxValue);
+    T* outData = const_cast<T*>(data);
+    for (size_t i = 0; i < count; ++i)
+    {
+        outData[i] = (T)distr(random);
+    }
+}
+
+// create network with random weights, hiddenLayerSizes can be empty
+static bool InitRandomNetwork(nn::PackedNeuralNetwork& network, const std::vector<uint32_t>& hiddenLayerSizes)
+{
+    std::vector<uint32_t> layerSizes = { nn::NumNetworkInputs, 2u * nn::AccumulatorSize };
+    std::vector<uint32_t> layerVariants = { 1, 1 };
+    for (const uint32_t size : hiddenLayerSizes)
+    {
+        layerSizes.push_back(size);
+        layerVariants.push_back(1);
+    }
+    layerVariants.back() = nn::NumVariants;
+
+    if (!network.Resize(layerSizes, layerVariants))
+    {
+        return false;
+    }
+
+    std::mt19937 random(12345);
+
+    const uint32_t lastLayerIndex = (uint32_t)layerSizes.size() - 1;
+    for (uint32_t i = 1; i < lastLayerIndex; ++i)
+    {
+        FillRandom(network.GetLayerWeights<nn::HiddenLayerWeightType>(i, 0), (size_t)layerSizes[i] * layerSizes[i + 1], -16, 16, random);
+        FillRandom(network.GetLayerBiases<nn::HiddenLayerBiasType>(i, 0), layerSizes[i + 1], -2048, 2048, random);
+    }
+
+    for (uint32_t variant = 0; variant < nn::NumVariants; ++variant)
+    {
+        FillRandom(network.GetLayerWeights<nn::LastLayerWeightType>(lastLayerIndex, variant), layerSizes[lastLayerIndex], -256, 256, random);
+        FillRandom(network.GetLayerBiases<nn::LastLayerBiasType>(lastLayerIndex, variant), 1, -1024, 1024, random);
+    }
+
+    return true;
+}
+
+// evaluation is called through non-inlined function, so it's compiled the same way as in NNEvaluator
+NO_INLINE static int32_t RunNetwork(const nn::PackedNeuralNetwork& network, const nn::Accumulator& stmAccum, const nn::Accumulator& nstmAccum, uint32_t variant)
+{
+    return network.Run(stmAccum, nstmAccum, variant);
+}
+
+} // namespace
+
+// measure throughput of incremental accumulator updates for both feature transformer weights formats
+// usage: accumulatorBenchmark [iterations] [allBuckets]
+void RunAccumulatorBenchmark(const std::vector<std::string>& args)
+{
+    const uint32_t numIterations = args.size() > 0 ? std::max(1, atoi(args[0].c_str())) : 1000000;
+
+    // by default features are from a single king bucket, like during search when kings don't move
+    // "allBuckets" spreads them over whole feature transformer, so weights don't fit in caches
+    const bool allBuckets = args.size() > 1 && args[1] == "allBuckets";
+
+    std::mt19937 random(12345);
+
+    std::vector<FeatureSet> featureSets(NumFeatureSets);
+    {
+        std::uniform_int_distribution<uint32_t> featureDistr(0, (allBuckets ? nn::NumNetworkInputs : 12 * 64) - 1);
+        std::uniform_int_distribution<uint32_t> captureDistr(0, 3);
+        for (FeatureSet& set : featureSets)
+        {
+            set.numAdded = 1;
+            set.numRemoved = captureDistr(random) == 0 ? 2 : 1;
+            for (uint16_t& f : set.added) f = (uint16_t)featureDistr(random);
+            for (uint16_t& f : set.removed) f = (uint16_t)featureDistr(random);
+        }
+    }
+
+    std::vector<nn::Accumulator> accumulators(NumAccumulators);
+    for (nn::Accumulator& accum : accumulators)
+    {
+        memset(accum.values, 0, sizeof(accum.values));
+    }
+
+    std::cout << "Architecture: " << GetArchitectureName() << std::endl;
+    std::cout << "Accumulator size: " << nn::AccumulatorSize << std::endl;
+
+    RunUpdateBenchmarks<nn::FirstLayerWeightType>("int16", numIterations, featureSets, accumulators);
+    RunUpdateBenchmarks<nn::FirstLayerInt8WeightType>("int8", numIterations, featureSets, accumulators);
+}
+
+// measure evaluation time of packed network layers following the feature transformer (accumulator updates are not included)
+// for single-layer and multi-layer architectures at different accumulator sparsity levels
+// usage: networkBenchmark [iterations]
+void RunNetworkBenchmark(const std::vector<std::string>& args)
+{
+    const uint32_t numIterations = args.size() > 0 ? std::max(1, atoi(args[0].c_str())) : 1000000;
+
+    struct Architecture
+    {
+        const char* name;
+        std::vector<uint32_t> hiddenLayerSizes;
+    };
+
+    const Architecture architectures[] =
+    {
+        { "2x1024->1", {} },
+        { "2x1024->16->32->1", { 16, 32 } },
+        { "2x1024->32->32->1", { 32, 32 } },
+        { "2x1024->64->32->1", { 64, 32 } },
+    };
+
+    // fraction of accumulator values that are non-zero after clipped-ReLU
+    const float densities[] = { 0.1f, 0.25f, 0.5f, 1.0f };
+
+    std::cout << "Architecture: " << GetArchitectureName() << std::endl;
+    std::cout << "Accumulator size: " << nn::AccumulatorSize << std::endl;
+
+    std::vector<nn::Accumulator> accumulators(2 * NumAccumulatorPairs);
+
+    int32_t checksum = 0;
+
+    for (const float density : densities)
+    {
+        std::mt19937 random(12345);
+        std::uniform_real_distribution<float> densityDistr(0.0f, 1.0f);
+        std::uniform_int_distribution<int32_t> positiveDistr(2, nn::ActivationRangeScaling + 64);
+        std::uniform_int_distribution<int32_t> negativeDistr(-512, 1);
+
+        for (nn::Accumulator& accum : accumulators)
+        {
+            for (uint32_t i = 0; i < nn::AccumulatorSize; ++i)
+            {
+                accum.values[i] = (nn::AccumulatorType)(densityDistr(random) < density ? positiveDistr(random) : negativeDistr(random));
+            }
+        }
+
+        std::cout << "Accumulator density: " << std::fixed << std::setprecision(2) << density << std::endl;
+
+        for (const Architecture& arch : architectures)
+        {
+            nn::PackedNeuralNetwork network;
+            if (!InitRandomNetwork(network, arch.hiddenLayerSizes))
+            {
+                std::cerr << "Failed to allocate network" << std::endl;
+                return;
+            }
+
+            const TimePoint startTime = TimePoint::GetCurrent();
+            for (uint32_t i = 0; i < numIterations; ++i)
+            {
+                const uint32_t index = 2 * (i % NumAccumulatorPairs);
+                checksum += RunNetwork(network, accumulators[index], accumulators[index + 1], i % nn::NumVariants);
+            }
+            const float time = (TimePoint::GetCurrent() - startTime).ToSeconds();
+
+            std::cout
+                << std::setw(24) << arch.name << " | "
+                << std::fixed << std::setprecision(2)
+                << std::setw(8) << (1.0e9 * time / numIterations) << " ns/eval" << std::endl;
+        }
+    }
+
+    // prevent the compiler from optimizing the evaluations away
+    std::cout << "Checksum: " << checksum << std::endl;
+}
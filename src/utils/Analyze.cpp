@@ -0,0 +1,377 @@
+#include "Common.hpp"
+
+#include "../backend/BatchSearch.hpp"
+#include "../backend/Position.hpp"
+#include "../backend/PositionUtils.hpp"
+#include "../backend/Time.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+#pragma pack(push, 1)
+// binary output record, one per input position
+// invalid input position produces a record with zeroed position, invalid move and InvalidValue score
+struct AnalysisRecord
+{
+    PackedPosition pos;
+    PackedMove bestMove;
+    ScoreType score;    // relative to side to move
+    uint32_t nodes;     // saturated
+};
+#pragma pack(pop)
+
+static_assert(sizeof(AnalysisRecord) == 36, "Invalid AnalysisRecord size");
+
+enum class OutputFormat
+{
+    JSONL,
+    Binary,
+};
+
+struct AnalyzeParams
+{
+    std::string inputPath;
+    std::string outputPath;
+    OutputFormat format = OutputFormat::JSONL;
+    uint64_t maxNodes = 10000;
+    uint16_t maxDepth = UINT16_MAX;
+    uint32_t numPvLines = 1;
+    BatchSearchParam batchParam;
+};
+
+struct PendingPosition
+{
+    Position position;
+    std::string inputLine;  // kept only for invalid positions
+    bool isValid = false;
+    bool finished = false;
+    BatchSearchResult result;
+};
+
+// results are written in input order, finished results wait here until all preceding positions are done
+// number of waiting positions is bounded, pushing blocks until the oldest one is written
+class OrderedResultWriter
+{
+public:
+    OrderedResultWriter(std::ostream& output, OutputFormat format, size_t maxPending)
+        : mOutput(output), mFormat(format), mMaxPending(std::max<size_t>(1, maxPending))
+    { }
+
+    uint64_t Push(const Position& position, const std::string& inputLine, bool isValid)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mSpaceAvailable.wait(lock, [this] { return mPending.size() < mMaxPending; });
+        mPending.push_back({ position, isValid ? std::string() : inputLine, isValid });
+        return mFirstIndex + mPending.size() - 1;
+    }
+
+    void Finish(BatchSearchResult&& result)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        ASSERT(result.index >= mFirstIndex && result.index < mFirstIndex + mPending.size());
+        PendingPosition& entry = mPending[result.index - mFirstIndex];
+        entry.result = std::move(result);
+        entry.finished = true;
+
+        Flush();
+    }
+
+    // mark invalid position as done without searching it
+    void Skip(uint64_t index)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mPending[index - mFirstIndex].finished = true;
+        Flush();
+    }
+
+    uint64_t GetNumWritten() const { return mNumWritten; }
+
+private:
+
+    void Flush()
+    {
+        bool written = false;
+        while (!mPending.empty() && mPending.front().finished)
+        {
+            Write(mPending.front());
+            mPending.pop_front();
+            mFirstIndex++;
+            written = true;
+        }
+
+        if (written)
+        {
+            mSpaceAvailable.notify_all();
+        }
+    }
+
+    void Write(const PendingPosition& entry)
+    {
+        const SearchResult& pvLines = entry.result.pvLines;
+        const bool hasMove = !pvLines.empty() && !pvLines.front().moves.empty();
+
+        if (mFormat == OutputFormat::Binary)
+        {
+            // invalid positions are written too, so records stay aligned with input lines
+            AnalysisRecord record{};
+            if (entry.isValid)
+            {
+                PackPosition(entry.position, record.pos);
+            }
+            record.bestMove = hasMove ? PackedMove(pvLines.front().moves.front()) : PackedMove::Invalid();
+            record.score = hasMove ? pvLines.front().score : InvalidValue;
+            record.nodes = (uint32_t)std::min<uint64_t>(entry.result.nodes, UINT32_MAX);
+            mOutput.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        }
+        else
+        {
+            std::ostringstream ss;
+
+            if (!entry.isValid)
+            {
+                ss << "{\"input\":\"" << EscapeString(entry.inputLine) << "\",\"error\":\"invalid position\"";
+            }
+            else
+            {
+                ss << "{\"fen\":\"" << entry.position.ToFEN() << "\"";
+
+                if (hasMove)
+                {
+                    ss << ",\"bestmove\":\"" << pvLines.front().moves.front().ToString() << "\"";
+                    WriteScore(ss, pvLines.front().score);
+                }
+                ss << ",\"nodes\":" << entry.result.nodes;
+                ss << ",\"seldepth\":" << entry.result.maxDepth;
+
+                if (pvLines.size() > 1)
+                {
+                    ss << ",\"lines\":[";
+                    for (size_t i = 0; i < pvLines.size(); ++i)
+                    {
+                        if (i > 0) ss << ",";
+                        ss << "{";
+                        WriteScore(ss, pvLines[i].score, false);
+                        WritePv(ss, pvLines[i]);
+                        ss << "}";
+                    }
+                    ss << "]";
+                }
+                else if (hasMove)
+                {
+                    WritePv(ss, pvLines.front());
+                }
+            }
+
+            ss << "}\n";
+            mOutput << ss.str();
+        }
+
+        mNumWritten++;
+    }
+
+    static std::string EscapeString(const std::string& str)
+    {
+        std::string result;
+        for (const char c : str)
+        {
+            if (c == '"' || c == '\\') result += '\\';
+            if ((unsigned char)c >= 0x20) result += c;
+        }
+        return result;
+    }
+
+    static void WriteScore(std::ostringstream& ss, ScoreType score, bool leadingComma = true)
+    {
+        if (leadingComma) ss << ",";
+
+        if (score > CheckmateValue - (int32_t)MaxSearchDepth)
+            ss << "\"mate\":" << (CheckmateValue - score + 1) / 2;
+        else if (score < -CheckmateValue + (int32_t)MaxSearchDepth)
+            ss << "\"mate\":-" << (CheckmateValue + score + 1) / 2;
+        else
+            ss << "\"score\":" << score;
+    }
+
+    static void WritePv(std::ostringstream& ss, const PvLine& pvLine)
+    {
+        ss << ",\"pv\":\"";
+        for (size_t i = 0; i < pvLine.moves.size(); ++i)
+        {
+            if (i > 0) ss << " ";
+            ss << pvLine.moves[i].ToString();
+        }
+        ss << "\"";
+    }
+
+    std::ostream& mOutput;
+    OutputFormat mFormat;
+    size_t mMaxPending;
+    std::mutex mMutex;
+    std::condition_variable mSpaceAvailable;
+    std::deque<PendingPosition> mPending;
+    uint64_t mFirstIndex = 0;
+    std::atomic<uint64_t> mNumWritten = 0;
+};
+
+static bool ParseArgs(const std::vector<std::string>& args, AnalyzeParams& params)
+{
+    if (args.size() < 2)
+    {
+        return false;
+    }
+
+    params.inputPath = args[0];
+    params.outputPath = args[1];
+    params.batchParam.numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t i = 2; i < args.size(); ++i)
+    {
+        const size_t separator = args[i].find('=');
+        const std::string key = args[i].substr(0, separator);
+        const std::string value = separator != std::string::npos ? args[i].substr(separator + 1) : "";
+
+        if (key == "nodes")
+            params.maxNodes = std::stoull(value);
+        else if (key == "depth")
+            params.maxDepth = (uint16_t)std::clamp(atoi(value.c_str()), 1, (int32_t)MaxSearchDepth);
+        else if (key == "multipv")
+            params.numPvLines = std::max(1, atoi(value.c_str()));
+        else if (key == "threads")
+            params.batchParam.numThreads = std::max(1, atoi(value.c_str()));
+        else if (key == "hash")
+            params.batchParam.transpositionTableSize = std::max(1ull, std::stoull(value)) * 1024ull * 1024ull;
+        else if (key == "clearState")
+            params.batchParam.clearBetweenJobs = true;
+        else if (key == "format" && value == "jsonl")
+            params.format = OutputFormat::JSONL;
+        else if (key == "format" && value == "binary")
+            params.format = OutputFormat::Binary;
+        else
+        {
+            std::cerr << "Unknown argument: " << args[i] << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+// search positions given as FEN strings (one per line) and write results to JSONL or binary file
+void Analyze(const std::vector<std::string>& args)
+{
+    AnalyzeParams params;
+    if (!ParseArgs(args, params))
+    {
+        std::cout << "Usage: analyze <input file with FENs, '-' for stdin> <output file, '-' for stdout> "
+            "[nodes=N] [depth=N] [multipv=N] [threads=N] [hash=MB per thread] [format=jsonl|binary] [clearState]" << std::endl;
+        return;
+    }
+
+    std::ifstream inputFile;
+    if (params.inputPath != "-")
+    {
+        inputFile.open(params.inputPath);
+        if (!inputFile.is_open())
+        {
+            std::cerr << "Failed to open input file: " << params.inputPath << std::endl;
+            return;
+        }
+    }
+    std::istream& input = params.inputPath != "-" ? inputFile : std::cin;
+
+    std::ofstream outputFile;
+    if (params.outputPath != "-")
+    {
+        outputFile.open(params.outputPath, params.format == OutputFormat::Binary ? std::ios::binary : std::ios::out);
+        if (!outputFile.is_open())
+        {
+            std::cerr << "Failed to open output file: " << params.outputPath << std::endl;
+            return;
+        }
+    }
+    std::ostream& output = params.outputPath != "-" ? outputFile : std::cout;
+
+    // progress goes to stderr if results are written to stdout
+    std::ostream& progress = params.outputPath != "-" ? std::cout : std::cerr;
+
+    // enough for each searcher to work ahead of a slow position for a while
+    OrderedResultWriter writer(output, params.format, 256 * (size_t)params.batchParam.numThreads);
+    BatchSearch batchSearch(params.batchParam);
+
+    const TimePoint startTime = TimePoint::GetCurrent();
+    TimePoint lastReportTime = startTime;
+
+    const auto jobSource = [&](BatchSearchJob& outJob) -> bool
+    {
+        std::string line;
+        while (std::getline(input, line))
+        {
+            // allow EPD-like lines, ignore everything after ';'
+            const size_t endPos = line.find(';');
+            if (endPos != std::string::npos)
+            {
+                line.resize(endPos);
+            }
+
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+            {
+                continue;
+            }
+
+            Position position;
+            const bool isValid = position.FromFEN(line) && position.IsValid();
+            const uint64_t index = writer.Push(position, line, isValid);
+
+            if (!isValid)
+            {
+                std::cerr << "Invalid position: " << line << std::endl;
+                writer.Skip(index);
+                continue;
+            }
+
+            outJob.index = index;
+            outJob.position = position;
+            outJob.maxNodes = params.maxNodes;
+            outJob.maxDepth = params.maxDepth;
+            outJob.numPvLines = params.numPvLines;
+            return true;
+        }
+
+        return false;
+    };
+
+    batchSearch.Run([&](BatchSearchJob& outJob)
+    {
+        const bool hasJob = jobSource(outJob);
+
+        const TimePoint now = TimePoint::GetCurrent();
+        if ((now - lastReportTime).ToSeconds() > 10.0f)
+        {
+            lastReportTime = now;
+            const float elapsed = (now - startTime).ToSeconds();
+            progress << "Positions analyzed: " << writer.GetNumWritten()
+                << " (" << (uint64_t)(writer.GetNumWritten() / elapsed) << " per second)" << std::endl;
+        }
+
+        return hasJob;
+    },
+    [&writer](BatchSearchResult&& result)
+    {
+        writer.Finish(std::move(result));
+    });
+
+    const float elapsed = (TimePoint::GetCurrent() - startTime).ToSeconds();
+    progress << "Positions analyzed: " << writer.GetNumWritten()
+        << " in " << elapsed << " seconds"
+        << " (" << (uint64_t)(writer.GetNumWritten() / std::max(elapsed, 0.001f)) << " per second)" << std::endl;
+}
@@ -42,17 +42,19 @@ struct MaterialStats
     uint64_t draws;
     uint64_t losses;
 
-    double avgEvalScore = 0.0;
+    double evalScoreSum = 0.0;
 
     uint64_t NumPositions() const { return wins + draws + losses; }
 };
 
+// statistics are collected per range of games and merged in range order, so the results don't depend on the number of threads
+static constexpr uint32_t c_GamesPerRange = 1024;
+
 struct GamesStats
 {
-    std::mutex mutex;
-
-    std::ofstream fortressPosition;
-    std::ofstream kingOnFarRankPositions;
+    // dumped positions (FEN per line)
+    std::string fortressPositions;
+    std::string kingOnFarRankPositions;
 
     std::unordered_map<MaterialKey, MaterialStats> materialStats;
 
@@ -66,31 +68,75 @@ struct GamesStats
     // sum of squared eval errors (relative to WDL and search score)
     double evalErrorSum_WDL = 0.0;
     double evalErrorSum_Score = 0.0;
+
+    void Merge(const GamesStats& other);
 };
 
-void AnalyzeGames(const char* path, GamesStats& outStats)
+void GamesStats::Merge(const GamesStats& other)
 {
-    std::cout << "Reading " << path << "..." << std::endl;
+    fortressPositions += other.fortressPositions;
+    kingOnFarRankPositions += other.kingOnFarRankPositions;
+
+    numGames += other.numGames;
+    numPositions += other.numPositions;
+    numPawnlessPositions += other.numPawnlessPositions;
 
-    FileInputStream gamesFile(path);
+    evalErrorSum_Score += other.evalErrorSum_Score;
+    evalErrorSum_WDL += other.evalErrorSum_WDL;
 
-    GamesStats localStats;
+    // accumulate WDL stats
+    for (const auto& iter : other.materialStats)
+    {
+        MaterialStats& outMaterialStats = materialStats[iter.first];
 
-    Game game;
-    std::vector<Move> moves;
+        outMaterialStats.wins += iter.second.wins;
+        outMaterialStats.draws += iter.second.draws;
+        outMaterialStats.losses += iter.second.losses;
+        outMaterialStats.evalScoreSum += iter.second.evalScoreSum;
+    }
 
-    while (GameCollection::ReadGame(gamesFile, game, moves))
+    // accumulate piece occupancy stats
+    for (uint32_t pieceIndex = 0; pieceIndex < 6; ++pieceIndex)
     {
-        Position pos = game.GetInitialPosition();
+        for (uint32_t square = 0; square < 64; ++square)
+        {
+            pieceOccupancy[pieceIndex][square] += other.pieceOccupancy[pieceIndex][square];
+        }
+    }
 
-        if (game.GetScore() == Game::Score::Unknown) continue;
+    for (uint32_t score = 0; score < 3; ++score)
+    {
+        for (uint32_t halfMoveCount = 0; halfMoveCount <= 100; ++halfMoveCount)
+        {
+            gameResultVsHalfMoveCounter[score][halfMoveCount] += other.gameResultVsHalfMoveCounter[score][halfMoveCount];
+        }
+    }
+}
 
-        ASSERT(game.GetMoves().size() == game.GetMoveScores().size());
+static void AnalyzeGames(const std::string& path, const GameCollection::GameRange& range, GamesStats& localStats)
+{
+    FileInputStream gamesFile(path.c_str());
+    if (!gamesFile.IsOpen() || !gamesFile.SetPosition(range.offset))
+    {
+        std::cout << "ERROR: Failed to read " << path << std::endl;
+        return;
+    }
+
+    GameCollection::Reader reader(gamesFile);
+
+    for (uint32_t i = 0; i < range.numGames && reader.NextGame(); ++i)
+    {
+        const Game::Score gameScore = reader.GetScore();
+
+        if (gameScore == Game::Score::Unknown) continue;
 
-        for (size_t i = 0; i < game.GetMoves().size(); ++i)
+        ASSERT(reader.HasMoveScores());
+
+        Move move;
+        ScoreType moveScore;
+        while (reader.ReadMove(move, moveScore))
         {
-            const Move move = pos.MoveFromPacked(game.GetMoves()[i]);
-            const ScoreType moveScore = game.GetMoveScores()[i];
+            const Position& pos = reader.GetPosition();
 
             if (move.IsQuiet() &&
                 pos.GetNumPieces() >= 4 &&
@@ -105,7 +151,7 @@ void AnalyzeGames(const char* path, GamesStats& outStats)
 
                     if (pos.GetHalfMoveCount() <= 100)
                     {
-                        localStats.gameResultVsHalfMoveCounter[(uint32_t)game.GetScore()][pos.GetHalfMoveCount()]++;
+                        localStats.gameResultVsHalfMoveCounter[(uint32_t)gameScore][pos.GetHalfMoveCount()]++;
                     }
 
                     const float moveScoreAsGameScore = InternalEvalToExpectedGameScore(moveScore);
@@ -114,14 +160,14 @@ void AnalyzeGames(const char* path, GamesStats& outStats)
                     if (c_collectMaterialStats)
                     {
                         MaterialStats& matStats = localStats.materialStats[matKey];
-                        matStats.wins += (game.GetScore() == Game::Score::WhiteWins ? 1 : 0);
-                        matStats.draws += (game.GetScore() == Game::Score::Draw ? 1 : 0);
-                        matStats.losses += (game.GetScore() == Game::Score::BlackWins ? 1 : 0);
-                        matStats.avgEvalScore += moveScoreAsGameScore;
+                        matStats.wins += (gameScore == Game::Score::WhiteWins ? 1 : 0);
+                        matStats.draws += (gameScore == Game::Score::Draw ? 1 : 0);
+                        matStats.losses += (gameScore == Game::Score::BlackWins ? 1 : 0);
+                        matStats.evalScoreSum += moveScoreAsGameScore;
                     }
 
                     localStats.evalErrorSum_Score += Sqr(staticEvalAsGameScore - moveScoreAsGameScore);
-                    localStats.evalErrorSum_WDL += Sqr(staticEvalAsGameScore - GameScoreToExpectedGameScore(game.GetScore()));
+                    localStats.evalErrorSum_WDL += Sqr(staticEvalAsGameScore - GameScoreToExpectedGameScore(gameScore));
 
                     localStats.numPositions++;
                     if (matKey.numWhitePawns == 0 && matKey.numBlackPawns == 0) localStats.numPawnlessPositions++;
@@ -154,8 +200,7 @@ void AnalyzeGames(const char* path, GamesStats& outStats)
                     {
                         if (ProbeSyzygy_WDL(pos, &wdl) && wdl == 0)
                         {
-                            std::unique_lock<std::mutex> lock(outStats.mutex);
-                            outStats.fortressPosition << pos.ToFEN() << std::endl;
+                            localStats.fortressPositions += pos.ToFEN() + '\n';
                             break;
                         }
                     }
@@ -170,14 +215,13 @@ void AnalyzeGames(const char* path, GamesStats& outStats)
                     if (pos.Whites().GetKingSquare().Rank() >= 4 ||
                         pos.Blacks().GetKingSquare().Rank() <= 3)
                     {
-                        std::unique_lock<std::mutex> lock(outStats.mutex);
-                        outStats.kingOnFarRankPositions << pos.ToFEN() << std::endl;
+                        localStats.kingOnFarRankPositions += pos.ToFEN() + '\n';
                         //break;
                     }
                 }
             }
 
-            if (!pos.DoMove(move))
+            if (!reader.DoMove())
             {
                 break;
             }
@@ -185,75 +229,81 @@ void AnalyzeGames(const char* path, GamesStats& outStats)
 
         localStats.numGames++;
     }
+}
 
-    {
-        std::unique_lock<std::mutex> lock(outStats.mutex);
+void AnalyzeGames()
+{
+    const std::string gamesPath = DATA_PATH "selfplayGames/";
 
-        outStats.numGames += localStats.numGames;
-        outStats.numPositions += localStats.numPositions;
-        outStats.numPawnlessPositions += localStats.numPawnlessPositions;
+    std::vector<std::filesystem::path> paths;
+    for (const auto& path : std::filesystem::directory_iterator(gamesPath))
+    {
+        paths.push_back(path.path());
+    }
 
-        outStats.evalErrorSum_Score += localStats.evalErrorSum_Score;
-        outStats.evalErrorSum_WDL += localStats.evalErrorSum_WDL;
+    std::sort(paths.begin(), paths.end());
 
-        // accumulate WDL stats
-        for (const auto& iter : localStats.materialStats)
-        {
-            MaterialStats& outMaterialStats = outStats.materialStats[iter.first];
+    std::cout << "Found " << paths.size() << " paths" << std::endl;
 
-            outMaterialStats.wins += iter.second.wins;
-            outMaterialStats.draws += iter.second.draws;
-            outMaterialStats.losses += iter.second.losses;
-            outMaterialStats.avgEvalScore += iter.second.avgEvalScore / static_cast<double>(iter.second.NumPositions());
-        }
-
-        // accumulate piece occupancy stats
-        for (uint32_t pieceIndex = 0; pieceIndex < 6; ++pieceIndex)
+    // split files into ranges of games, so large files are processed by multiple threads
+    struct FileRange
+    {
+        uint32_t pathIndex;
+        GameCollection::GameRange range;
+    };
+    std::vector<FileRange> fileRanges;
+    {
+        std::vector<GameCollection::GameRange> ranges;
+        for (uint32_t i = 0; i < paths.size(); ++i)
         {
-            for (uint32_t square = 0; square < 64; ++square)
+            FileInputStream gamesFile(paths[i].string().c_str());
+            if (gamesFile.IsOpen() && GameCollection::SplitIntoRanges(gamesFile, c_GamesPerRange, ranges))
             {
-                outStats.pieceOccupancy[pieceIndex][square] += localStats.pieceOccupancy[pieceIndex][square];
+                for (const GameCollection::GameRange& range : ranges)
+                {
+                    fileRanges.push_back({ i, range });
+                }
             }
         }
     }
-}
 
-void AnalyzeGames()
-{
-    GamesStats stats;
-    stats.fortressPosition.open("fortress.epd");
-    stats.kingOnFarRankPositions.open("kingOnFarRank.epd");
+    const TimePoint startTime = TimePoint::GetCurrent();
 
-    const std::string gamesPath = DATA_PATH "selfplayGames/";
+    std::vector<GamesStats> rangeStats(fileRanges.size());
 
     Waitable waitable;
     {
         threadpool::TaskBuilder taskBuilder(waitable);
-
-        std::vector<std::filesystem::path> paths;
-        for (const auto& path : std::filesystem::directory_iterator(gamesPath))
-        {
-            paths.push_back(path.path());
-        }
-
-        // sort paths by file size
-        std::sort(paths.begin(), paths.end(), [](const std::filesystem::path& a, const std::filesystem::path& b)
+        taskBuilder.ParallelFor("AnalyzeGames", static_cast<uint32_t>(fileRanges.size()), [&](const threadpool::TaskContext&, uint32_t i)
         {
-            return std::filesystem::file_size(a) > std::filesystem::file_size(b);
+            AnalyzeGames(paths[fileRanges[i].pathIndex].string(), fileRanges[i].range, rangeStats[i]);
         });
+    }
 
-        std::cout << "Found " << paths.size() << " paths" << std::endl;
+    waitable.Wait();
 
-        for (const std::filesystem::path& path : paths)
-        {
-            taskBuilder.Task("LoadPositions", [path, &stats](const threadpool::TaskContext&)
-            {
-                AnalyzeGames(path.string().c_str(), stats);
-            });
-        }
+    GamesStats stats;
+    for (const GamesStats& localStats : rangeStats)
+    {
+        stats.Merge(localStats);
     }
 
-    waitable.Wait();
+    const float time = (TimePoint::GetCurrent() - startTime).ToSeconds();
+    std::cout
+        << "Analyzed " << stats.numGames << " games (" << fileRanges.size() << " ranges) in "
+        << std::fixed << std::setprecision(3) << time << " s using " << threadpool::ThreadPool::GetInstance().GetNumThreads() << " threads, "
+        << (uint64_t)(stats.numGames / std::max(time, 0.001f)) << " games/s" << std::endl << std::endl;
+    std::cout << std::defaultfloat << std::setprecision(6);
+
+    if (c_dumpFortressPositions)
+    {
+        std::ofstream("fortress.epd") << stats.fortressPositions;
+    }
+
+    if (c_dumpKingOnFarRankPositions)
+    {
+        std::ofstream("kingOnFarRank.epd") << stats.kingOnFarRankPositions;
+    }
 
     // piece-count distribution (no queens)
     {
@@ -268,7 +318,7 @@ void AnalyzeGames()
         }
 
         std::cout << "Piece-count distribution (no queens): " << std::endl;
-        for (uint32_t i = 1; i <= 31; ++i)
+        for (uint32_t i = 1; i < 31; ++i)
         {
             std::cout << i << " : " << numPositions[i] << std::endl;
         }
@@ -0,0 +1,624 @@
+#include "CompressedTrainingData.hpp"
+
+#include <cstddef>
+
+namespace CompressedTrainingData {
+
+static_assert(sizeof(PackedPosition) == 28, "Invalid PackedPosition size");
+static_assert(offsetof(PositionEntry, score) == 28, "Invalid PositionEntry layout");
+
+#pragma pack(push, 1)
+
+struct FileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t blockSize;
+    uint32_t padding;
+};
+
+struct BlockHeader
+{
+    uint32_t numEntries;
+    uint32_t dataSize;
+};
+
+struct FileFooter
+{
+    uint64_t indexOffset;
+    uint64_t numEntries;
+    uint32_t numBlocks;
+    uint32_t magic;
+};
+
+#pragma pack(pop)
+
+// bytes of PositionEntry stored as separate columns (everything except piece nibbles)
+static constexpr uint32_t ByteColumns[] =
+{
+    0, 1, 2, 3, 4, 5, 6, 7,     // occupied bitboard, one column per rank
+    8, 9,                       // move count
+    10,                         // side to move + half-move count
+    11,                         // castling rights + en passant file
+    28, 29,                     // score
+    30,                         // WDL score
+    31,                         // tablebase score
+};
+
+static constexpr uint32_t NumByteColumns = sizeof(ByteColumns) / sizeof(ByteColumns[0]);
+static constexpr uint32_t PiecesDataOffset = offsetof(PackedPosition, piecesData);
+
+INLINE static uint32_t GetNumPiecesDataBytes(const PackedPosition& pos)
+{
+    // 4 bits per occupied square
+    return (pos.occupied.Count() + 1) / 2;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+// static order-0 rANS coder with 16-bit renormalization
+// based on public domain implementation by Fabian Giesen
+// (at most one 16-bit word is consumed per symbol, so decoder renormalization is branchless)
+namespace rans {
+
+static constexpr uint32_t ProbBits = 12;
+static constexpr uint32_t ProbScale = 1u << ProbBits;
+static constexpr uint32_t StateLowerBound = 1u << 16;
+
+struct SymbolStats
+{
+    uint32_t freqs[256];
+    uint32_t cumFreqs[257];
+
+    void Normalize(const uint64_t counts[256], uint64_t totalCount)
+    {
+        ASSERT(totalCount > 0);
+
+        uint32_t sum = 0;
+        for (uint32_t s = 0; s < 256; ++s)
+        {
+            freqs[s] = counts[s] > 0 ? std::max<uint32_t>(1, (uint32_t)(counts[s] * ProbScale / totalCount)) : 0;
+            sum += freqs[s];
+        }
+
+        // fix rounding errors by adjusting most frequent symbols
+        while (sum != ProbScale)
+        {
+            uint32_t maxSymbol = 0;
+            for (uint32_t s = 1; s < 256; ++s)
+            {
+                if (freqs[s] > freqs[maxSymbol]) maxSymbol = s;
+            }
+
+            if (sum < ProbScale)
+            {
+                freqs[maxSymbol] += ProbScale - sum;
+                sum = ProbScale;
+            }
+            else
+            {
+                const uint32_t delta = std::min(sum - ProbScale, freqs[maxSymbol] - 1);
+                ASSERT(delta > 0);
+                freqs[maxSymbol] -= delta;
+                sum -= delta;
+            }
+        }
+
+        ComputeCumulativeFrequencies();
+    }
+
+    void ComputeCumulativeFrequencies()
+    {
+        cumFreqs[0] = 0;
+        for (uint32_t s = 0; s < 256; ++s)
+        {
+            cumFreqs[s + 1] = cumFreqs[s] + freqs[s];
+        }
+    }
+};
+
+// returns number of bytes written at the end of the output buffer
+static size_t Encode(const uint8_t* data, size_t size, const SymbolStats& stats, uint8_t* outBuffer, size_t bufferSize)
+{
+    uint8_t* const end = outBuffer + bufferSize;
+    uint8_t* ptr = end;
+
+    uint32_t x = StateLowerBound;
+
+    // rANS encodes in reverse order, so the decoder can go forward
+    for (size_t i = size; i-- > 0; )
+    {
+        const uint32_t freq = stats.freqs[data[i]];
+        const uint32_t start = stats.cumFreqs[data[i]];
+        ASSERT(freq > 0);
+
+        const uint32_t xMax = ((StateLowerBound >> ProbBits) << 16) * freq;
+        if (x >= xMax)
+        {
+            ptr -= 2;
+            const uint16_t word = (uint16_t)(x & 0xFFFF);
+            memcpy(ptr, &word, 2);
+            x >>= 16;
+        }
+
+        x = ((x / freq) << ProbBits) + (x % freq) + start;
+    }
+
+    ptr -= 4;
+    memcpy(ptr, &x, 4);
+
+    ASSERT(ptr >= outBuffer);
+    return end - ptr;
+}
+
+// column is split into lanes, each coded into a separate stream
+// lanes are decoded together, so there's no single dependency chain in the decoder
+static constexpr uint32_t NumLanes = 4;
+
+INLINE static size_t GetLaneLength(size_t size, uint32_t lane)
+{
+    // last lane takes the remainder
+    return lane + 1 < NumLanes ? size / NumLanes : size - (NumLanes - 1) * (size / NumLanes);
+}
+
+struct DecoderLane
+{
+    uint32_t x;
+    const uint8_t* ptr;
+    const uint8_t* end;
+};
+
+// input streams must be readable for 2 bytes past the end
+static bool Decode(DecoderLane (&lanes)[NumLanes], const SymbolStats& stats, uint8_t* outData, size_t size)
+{
+    // packed: symbol (8 bits), slot offset within symbol's range (12 bits), frequency (12 bits)
+    // (single-symbol columns are not entropy coded, so frequency is always lower than ProbScale)
+    static_assert(ProbBits == 12, "Lookup table packing assumes 12-bit probabilities");
+    uint32_t lookup[ProbScale];
+    for (uint32_t s = 0; s < 256; ++s)
+    {
+        if (stats.freqs[s] >= ProbScale)
+        {
+            return false;
+        }
+        for (uint32_t i = stats.cumFreqs[s]; i < stats.cumFreqs[s + 1]; ++i)
+        {
+            lookup[i] = s | ((i - stats.cumFreqs[s]) << 8) | (stats.freqs[s] << 20);
+        }
+    }
+
+    const auto decodeSymbol = [&lookup](DecoderLane& lane) INLINE_LAMBDA
+    {
+        const uint32_t entry = lookup[lane.x & (ProbScale - 1)];
+        const uint32_t freq = entry >> 20;
+        const uint32_t bias = (entry >> 8) & (ProbScale - 1);
+        uint32_t x = freq * (lane.x >> ProbBits) + bias;
+
+        // renormalization is data dependent and unpredictable, so it's done with arithmetic instead of a branch
+        uint16_t word;
+        memcpy(&word, lane.ptr, 2);
+        const uint32_t renormalize = x < StateLowerBound;
+        lane.x = (x << (renormalize * 16)) | (word & (0u - renormalize));
+        lane.ptr = std::min(lane.end, lane.ptr + renormalize * 2);
+        return (uint8_t)entry;
+    };
+
+    // lanes are copied to locals, otherwise byte stores to the output would force reloading them
+    static_assert(NumLanes == 4, "Decoder loop assumes 4 lanes");
+    DecoderLane lane0 = lanes[0];
+    DecoderLane lane1 = lanes[1];
+    DecoderLane lane2 = lanes[2];
+    DecoderLane lane3 = lanes[3];
+
+    const size_t laneLength = size / NumLanes;
+    uint8_t* out0 = outData;
+    uint8_t* out1 = out0 + laneLength;
+    uint8_t* out2 = out1 + laneLength;
+    uint8_t* out3 = out2 + laneLength;
+
+    for (size_t i = 0; i < laneLength; ++i)
+    {
+        out0[i] = decodeSymbol(lane0);
+        out1[i] = decodeSymbol(lane1);
+        out2[i] = decodeSymbol(lane2);
+        out3[i] = decodeSymbol(lane3);
+    }
+
+    // remainder of the last lane
+    for (size_t i = laneLength; i < size - 3 * laneLength; ++i)
+    {
+        out3[i] = decodeSymbol(lane3);
+    }
+
+    return true;
+}
+
+} // namespace rans
+
+//////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+INLINE static void AppendValue(std::vector<uint8_t>& buffer, const T& value)
+{
+    const size_t offset = buffer.size();
+    buffer.resize(offset + sizeof(T));
+    memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+template<typename T>
+INLINE static bool ReadValue(const uint8_t*& ptr, const uint8_t* end, T& outValue)
+{
+    if (ptr + sizeof(T) > end)
+    {
+        return false;
+    }
+    memcpy(&outValue, ptr, sizeof(T));
+    ptr += sizeof(T);
+    return true;
+}
+
+// column: uint16 number of symbols, (uint8 symbol, uint16 frequency) pairs,
+// then (if there's more than one symbol) uint32 size of each lane stream followed by the streams
+static void EncodeColumn(const std::vector<uint8_t>& column, std::vector<uint8_t>& outBuffer)
+{
+    if (column.empty())
+    {
+        AppendValue<uint16_t>(outBuffer, 0);
+        return;
+    }
+
+    uint64_t counts[256] = { 0 };
+    for (const uint8_t value : column)
+    {
+        counts[value]++;
+    }
+
+    rans::SymbolStats stats;
+    stats.Normalize(counts, column.size());
+
+    uint16_t numSymbols = 0;
+    for (uint32_t s = 0; s < 256; ++s)
+    {
+        if (stats.freqs[s]) numSymbols++;
+    }
+
+    AppendValue<uint16_t>(outBuffer, numSymbols);
+    for (uint32_t s = 0; s < 256; ++s)
+    {
+        if (stats.freqs[s])
+        {
+            AppendValue<uint8_t>(outBuffer, (uint8_t)s);
+            AppendValue<uint16_t>(outBuffer, (uint16_t)stats.freqs[s]);
+        }
+    }
+
+    // constant column, no need for rANS streams
+    if (numSymbols == 1)
+    {
+        return;
+    }
+
+    // worst case is ProbBits per symbol, rounded up to 16-bit words
+    std::vector<uint8_t> encoded(column.size() * 2 + 16);
+
+    const size_t laneSizesOffset = outBuffer.size();
+    outBuffer.resize(laneSizesOffset + rans::NumLanes * sizeof(uint32_t));
+
+    size_t laneStart = 0;
+    for (uint32_t lane = 0; lane < rans::NumLanes; ++lane)
+    {
+        const size_t laneLength = rans::GetLaneLength(column.size(), lane);
+        const uint32_t encodedSize = (uint32_t)rans::Encode(column.data() + laneStart, laneLength, stats, encoded.data(), encoded.size());
+        memcpy(outBuffer.data() + laneSizesOffset + lane * sizeof(uint32_t), &encodedSize, sizeof(uint32_t));
+        outBuffer.insert(outBuffer.end(), encoded.end() - encodedSize, encoded.end());
+        laneStart += laneLength;
+    }
+}
+
+static bool DecodeColumn(const uint8_t*& ptr, const uint8_t* end, uint8_t* outColumn, size_t size)
+{
+    uint16_t numSymbols = 0;
+    if (!ReadValue(ptr, end, numSymbols))
+    {
+        return false;
+    }
+
+    if (size == 0)
+    {
+        return numSymbols == 0;
+    }
+
+    rans::SymbolStats stats;
+    memset(stats.freqs, 0, sizeof(stats.freqs));
+    uint8_t lastSymbol = 0;
+    for (uint32_t i = 0; i < numSymbols; ++i)
+    {
+        uint8_t symbol = 0;
+        uint16_t freq = 0;
+        if (!ReadValue(ptr, end, symbol) || !ReadValue(ptr, end, freq))
+        {
+            return false;
+        }
+        stats.freqs[symbol] = freq;
+        lastSymbol = symbol;
+    }
+    stats.ComputeCumulativeFrequencies();
+
+    if (stats.cumFreqs[256] != rans::ProbScale)
+    {
+        return false;
+    }
+
+    if (numSymbols == 1)
+    {
+        memset(outColumn, lastSymbol, size);
+        return true;
+    }
+
+    uint32_t laneSizes[rans::NumLanes];
+    for (uint32_t& laneSize : laneSizes)
+    {
+        if (!ReadValue(ptr, end, laneSize))
+        {
+            return false;
+        }
+    }
+
+    rans::DecoderLane lanes[rans::NumLanes];
+    for (uint32_t lane = 0; lane < rans::NumLanes; ++lane)
+    {
+        if (laneSizes[lane] < sizeof(uint32_t) || ptr + laneSizes[lane] > end)
+        {
+            return false;
+        }
+        memcpy(&lanes[lane].x, ptr, sizeof(uint32_t));
+        lanes[lane].ptr = ptr + sizeof(uint32_t);
+        lanes[lane].end = ptr + laneSizes[lane];
+        ptr += laneSizes[lane];
+    }
+
+    return rans::Decode(lanes, stats, outColumn, size);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+bool IsCompressedFile(FileInputStream& stream)
+{
+    FileHeader header{};
+    if (!stream.SetPosition(0))
+    {
+        return false;
+    }
+
+    const bool result = stream.Read(&header, sizeof(header)) && header.magic == MagicNumber;
+    return stream.SetPosition(0) && result;
+}
+
+Writer::Writer(OutputStream& stream, uint32_t blockSize)
+    : mStream(stream)
+    , mBlockSize(std::max(1u, blockSize))
+{
+    mPendingEntries.reserve(mBlockSize);
+}
+
+bool Writer::WriteRaw(const void* data, size_t size)
+{
+    if (!mStream.Write(data, size))
+    {
+        return false;
+    }
+    mNumWrittenBytes += size;
+    return true;
+}
+
+bool Writer::Write(const PositionEntry* entries, size_t numEntries)
+{
+    if (!mHeaderWritten)
+    {
+        const FileHeader header = { MagicNumber, CurrentVersion, mBlockSize, 0 };
+        if (!WriteRaw(&header, sizeof(header)))
+        {
+            return false;
+        }
+        mHeaderWritten = true;
+    }
+
+    for (size_t i = 0; i < numEntries; ++i)
+    {
+        mPendingEntries.push_back(entries[i]);
+
+        if (mPendingEntries.size() >= mBlockSize)
+        {
+            if (!FlushBlock())
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool Writer::FlushBlock()
+{
+    if (mPendingEntries.empty())
+    {
+        return true;
+    }
+
+    mBlockData.clear();
+
+    std::vector<uint8_t> column;
+    column.reserve(mPendingEntries.size() * 16);
+
+    for (const uint32_t byteOffset : ByteColumns)
+    {
+        column.clear();
+        for (const PositionEntry& entry : mPendingEntries)
+        {
+            column.push_back(reinterpret_cast<const uint8_t*>(&entry)[byteOffset]);
+        }
+        EncodeColumn(column, mBlockData);
+    }
+
+    // piece nibbles, only for occupied squares
+    column.clear();
+    for (const PositionEntry& entry : mPendingEntries)
+    {
+        const uint32_t numBytes = GetNumPiecesDataBytes(entry.pos);
+        column.insert(column.end(), entry.pos.piecesData, entry.pos.piecesData + numBytes);
+    }
+    EncodeColumn(column, mBlockData);
+
+    mBlockOffsets.push_back(mNumWrittenBytes);
+
+    const BlockHeader blockHeader = { (uint32_t)mPendingEntries.size(), (uint32_t)mBlockData.size() };
+    if (!WriteRaw(&blockHeader, sizeof(blockHeader)) ||
+        !WriteRaw(mBlockData.data(), mBlockData.size()))
+    {
+        return false;
+    }
+
+    mPendingEntries.clear();
+    return true;
+}
+
+bool Writer::Finish()
+{
+    uint64_t numEntries = mPendingEntries.size();
+    numEntries += (uint64_t)mBlockOffsets.size() * mBlockSize;
+
+    // make sure the header is written even if there are no entries
+    if (!Write(nullptr, 0) || !FlushBlock())
+    {
+        return false;
+    }
+
+    const FileFooter footer = { mNumWrittenBytes, numEntries, (uint32_t)mBlockOffsets.size(), MagicNumber };
+
+    return
+        WriteRaw(mBlockOffsets.data(), mBlockOffsets.size() * sizeof(uint64_t)) &&
+        WriteRaw(&footer, sizeof(footer));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+bool Reader::Init(FileInputStream& stream)
+{
+    const uint64_t fileSize = stream.GetSize();
+    if (fileSize < sizeof(FileHeader) + sizeof(FileFooter))
+    {
+        return false;
+    }
+
+    FileHeader header{};
+    if (!stream.SetPosition(0) || !stream.Read(&header, sizeof(header)) || header.magic != MagicNumber)
+    {
+        return false;
+    }
+
+    if (header.version != CurrentVersion)
+    {
+        std::cout << "ERROR: Unsupported compressed training data version: " << header.version << std::endl;
+        return false;
+    }
+
+    FileFooter footer{};
+    if (!stream.SetPosition(fileSize - sizeof(FileFooter)) || !stream.Read(&footer, sizeof(footer)) || footer.magic != MagicNumber)
+    {
+        return false;
+    }
+
+    if (footer.indexOffset + (uint64_t)footer.numBlocks * sizeof(uint64_t) + sizeof(FileFooter) != fileSize)
+    {
+        return false;
+    }
+
+    mBlockOffsets.resize(footer.numBlocks);
+    if (footer.numBlocks > 0 &&
+        (!stream.SetPosition(footer.indexOffset) || !stream.Read(mBlockOffsets.data(), mBlockOffsets.size() * sizeof(uint64_t))))
+    {
+        return false;
+    }
+
+    mBlockSize = header.blockSize;
+    mNumEntries = footer.numEntries;
+
+    return true;
+}
+
+uint32_t Reader::ReadBlock(FileInputStream& stream, uint32_t blockIndex, PositionEntry* outEntries)
+{
+    if (blockIndex >= mBlockOffsets.size())
+    {
+        return 0;
+    }
+
+    BlockHeader blockHeader{};
+    if (!stream.SetPosition(mBlockOffsets[blockIndex]) ||
+        !stream.Read(&blockHeader, sizeof(blockHeader)) ||
+        blockHeader.numEntries > mBlockSize)
+    {
+        return 0;
+    }
+
+    // padding for the rANS decoder reading ahead
+    mBlockData.resize(blockHeader.dataSize + 2);
+    mBlockData[blockHeader.dataSize] = 0;
+    mBlockData[blockHeader.dataSize + 1] = 0;
+    if (!stream.Read(mBlockData.data(), blockHeader.dataSize))
+    {
+        return 0;
+    }
+
+    const uint32_t numEntries = blockHeader.numEntries;
+    const uint8_t* ptr = mBlockData.data();
+    const uint8_t* const end = ptr + blockHeader.dataSize;
+
+    // decode all byte columns first, so they are gathered into entries in a single pass
+    mColumns.resize((size_t)numEntries * std::max<size_t>(NumByteColumns, sizeof(PackedPosition::piecesData)));
+    for (uint32_t c = 0; c < NumByteColumns; ++c)
+    {
+        if (!DecodeColumn(ptr, end, mColumns.data() + (size_t)c * numEntries, numEntries))
+        {
+            return 0;
+        }
+    }
+
+    size_t numPiecesDataBytes = 0;
+    for (uint32_t i = 0; i < numEntries; ++i)
+    {
+        uint8_t* entryData = reinterpret_cast<uint8_t*>(&outEntries[i]);
+        for (uint32_t c = 0; c < NumByteColumns; ++c)
+        {
+            entryData[ByteColumns[c]] = mColumns[(size_t)c * numEntries + i];
+        }
+
+        // malformed block, pieces data would not fit in the packed position
+        if (outEntries[i].pos.occupied.Count() > 2 * sizeof(PackedPosition::piecesData))
+        {
+            return 0;
+        }
+        numPiecesDataBytes += GetNumPiecesDataBytes(outEntries[i].pos);
+    }
+
+    if (numPiecesDataBytes > mColumns.size() ||
+        !DecodeColumn(ptr, end, mColumns.data(), numPiecesDataBytes))
+    {
+        return 0;
+    }
+
+    const uint8_t* piecesData = mColumns.data();
+    for (uint32_t i = 0; i < numEntries; ++i)
+    {
+        PackedPosition& pos = outEntries[i].pos;
+        const uint32_t numBytes = GetNumPiecesDataBytes(pos);
+        memcpy(pos.piecesData, piecesData, numBytes);
+        memset(pos.piecesData + numBytes, 0, sizeof(pos.piecesData) - numBytes);
+        piecesData += numBytes;
+    }
+
+    return numEntries;
+}
+
+} // namespace CompressedTrainingData
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "TrainerCommon.hpp"
+#include "Stream.hpp"
+
+// Block-compressed training data format
+//
+// Entries are split into blocks. Inside a block, bytes of PositionEntry are transposed into columns
+// (one column per byte of the entry, piece nibbles stored only for occupied squares) and each column
+// is entropy coded with static order-0 rANS (split into 4 independently coded lanes for faster decoding).
+// Block offsets are stored in an index at the end of the file, so any block can be decoded independently.
+//
+// Layout:
+//   FileHeader
+//   blocks: BlockHeader + columns (symbol frequencies + lane sizes + rANS streams)
+//   index: uint64_t offset of each block
+//   FileFooter
+
+namespace CompressedTrainingData {
+
+static constexpr uint32_t MagicNumber = 'CTDF';
+static constexpr uint32_t CurrentVersion = 1;
+static constexpr uint32_t DefaultBlockSize = 64 * 1024;
+
+// check if a file starts with compressed training data header
+bool IsCompressedFile(FileInputStream& stream);
+
+class Writer
+{
+public:
+    explicit Writer(OutputStream& stream, uint32_t blockSize = DefaultBlockSize);
+
+    // entries are buffered and written once a full block is collected
+    bool Write(const PositionEntry* entries, size_t numEntries);
+
+    // write remaining entries and the block index, must be called once all entries are written
+    bool Finish();
+
+    uint64_t GetNumWrittenBytes() const { return mNumWrittenBytes; }
+
+private:
+    bool WriteRaw(const void* data, size_t size);
+    bool FlushBlock();
+
+    OutputStream& mStream;
+    uint32_t mBlockSize;
+    uint64_t mNumWrittenBytes = 0;
+    std::vector<PositionEntry> mPendingEntries;
+    std::vector<uint64_t> mBlockOffsets;
+    std::vector<uint8_t> mBlockData;
+    bool mHeaderWritten = false;
+};
+
+class Reader
+{
+public:
+    // read file header and block index
+    bool Init(FileInputStream& stream);
+
+    uint32_t GetNumBlocks() const { return static_cast<uint32_t>(mBlockOffsets.size()); }
+    uint64_t GetNumEntries() const { return mNumEntries; }
+    uint32_t GetMaxBlockSize() const { return mBlockSize; }
+
+    // decode a block, returns number of decoded entries (0 on failure)
+    // output must have space for GetMaxBlockSize() entries
+    uint32_t ReadBlock(FileInputStream& stream, uint32_t blockIndex, PositionEntry* outEntries);
+
+private:
+    std::vector<uint64_t> mBlockOffsets;
+    std::vector<uint8_t> mBlockData;
+    std::vector<uint8_t> mColumns;
+    uint64_t mNumEntries = 0;
+    uint32_t mBlockSize = 0;
+};
+
+} // namespace CompressedTrainingData
@@ -0,0 +1,185 @@
+#include "Common.hpp"
+
+#include "../backend/PackedNeuralNetwork.hpp"
+#include "../backend/NeuralNetworkEvaluator.hpp"
+#include "../backend/Evaluate.hpp"
+#include "../backend/Position.hpp"
+#include "../backend/Move.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <random>
+
+namespace {
+
+static constexpr uint32_t NumOpeningPlies = 8;
+static constexpr uint32_t MaxGamePlies = 200;
+
+static Move GetRandomMove(std::mt19937& randomGenerator, const Position& pos)
+{
+    std::vector<Move> moves;
+    pos.GetNumLegalMoves(&moves);
+
+    // don't play losing moves (according to SEE), so positions stay reasonably balanced
+    moves.erase(std::remove_if(moves.begin(),
+        moves.end(),
+        [&](const Move& move) { return !pos.StaticExchangeEvaluation(move); }),
+        moves.end());
+
+    if (moves.empty())
+        return Move::Invalid();
+
+    std::uniform_int_distribution<size_t> distr(0, moves.size() - 1);
+    return moves[distr(randomGenerator)];
+}
+
+static void ConvertFeatureTransformer(const nn::PackedNeuralNetwork& source, nn::PackedNeuralNetwork& target, uint32_t& outNumClampedWeights)
+{
+    const size_t numWeights = (size_t)source.GetNumInputs() * source.GetAccumulatorSize();
+
+    outNumClampedWeights = 0;
+
+    if (source.HasInt8FeatureTransformer() && target.HasInt8FeatureTransformer())
+    {
+        memcpy(const_cast<nn::FirstLayerInt8WeightType*>(target.GetAccumulatorInt8Weights()),
+               source.GetAccumulatorInt8Weights(),
+               numWeights * sizeof(nn::FirstLayerInt8WeightType));
+    }
+    else if (!source.HasInt8FeatureTransformer() && !target.HasInt8FeatureTransformer())
+    {
+        memcpy(const_cast<nn::FirstLayerWeightType*>(target.GetAccumulatorWeights()),
+               source.GetAccumulatorWeights(),
+               numWeights * sizeof(nn::FirstLayerWeightType));
+    }
+    else if (target.HasInt8FeatureTransformer())
+    {
+        const nn::FirstLayerWeightType* weights = source.GetAccumulatorWeights();
+        nn::FirstLayerInt8WeightType* outWeights = const_cast<nn::FirstLayerInt8WeightType*>(target.GetAccumulatorInt8Weights());
+
+        constexpr int32_t minWeight = std::numeric_limits<nn::FirstLayerInt8WeightType>::min();
+        constexpr int32_t maxWeight = std::numeric_limits<nn::FirstLayerInt8WeightType>::max();
+
+        for (size_t i = 0; i < numWeights; ++i)
+        {
+            const int32_t weight = (int32_t)std::round((float)weights[i] / (float)(1 << nn::InputLayerInt8WeightShift));
+            if (weight < minWeight || weight > maxWeight) outNumClampedWeights++;
+            outWeights[i] = (nn::FirstLayerInt8WeightType)std::clamp(weight, minWeight, maxWeight);
+        }
+    }
+    else
+    {
+        const nn::FirstLayerInt8WeightType* weights = source.GetAccumulatorInt8Weights();
+        nn::FirstLayerWeightType* outWeights = const_cast<nn::FirstLayerWeightType*>(target.GetAccumulatorWeights());
+
+        for (size_t i = 0; i < numWeights; ++i)
+        {
+            outWeights[i] = (nn::FirstLayerWeightType)((int32_t)weights[i] * (1 << nn::InputLayerInt8WeightShift));
+        }
+    }
+
+    memcpy(const_cast<nn::FirstLayerBiasType*>(target.GetAccumulatorBiases()),
+           source.GetAccumulatorBiases(),
+           source.GetAccumulatorSize() * sizeof(nn::FirstLayerBiasType));
+}
+
+} // namespace
+
+// convert packed network to a different feature transformer weights format (post-training quantization)
+// and report how much the evaluation changed on positions from random games
+// usage: convertNetwork <input file> <output file> [int8|int16] [number of positions]
+void RunConvertNetwork(const std::vector<std::string>& args)
+{
+    if (args.size() < 2)
+    {
+        std::cerr << "Usage: convertNetwork <input file> <output file> [int8|int16] [number of positions]" << std::endl;
+        return;
+    }
+
+    const bool toInt8 = args.size() < 3 || args[2] == "int8";
+    const uint32_t numPositions = args.size() > 3 ? std::max(1, atoi(args[3].c_str())) : 100000;
+
+    nn::PackedNeuralNetwork source;
+    if (!source.LoadFromFile(args[0].c_str()))
+    {
+        std::cerr << "Failed to load " << args[0] << std::endl;
+        return;
+    }
+
+    if (source.GetLayerSize(2) != 0)
+    {
+        std::cerr << "Only networks with a single layer after the feature transformer are supported" << std::endl;
+        return;
+    }
+
+    nn::PackedNeuralNetwork target;
+    {
+        const std::vector<uint32_t> layerSizes = { source.GetNumInputs(), source.GetLayerSize(1) };
+        const std::vector<uint32_t> layerVariants = { 1, nn::NumVariants };
+
+        if (!target.Resize(layerSizes, layerVariants, toInt8 ? nn::Int8FeatureTransformerVersion : nn::CurrentVersion))
+        {
+            std::cerr << "Failed to allocate network" << std::endl;
+            return;
+        }
+    }
+
+    uint32_t numClampedWeights = 0;
+    ConvertFeatureTransformer(source, target, numClampedWeights);
+
+    // last layer is stored in the same format
+    const uint32_t lastLayerIndex = 1;
+    for (uint32_t variantIdx = 0; variantIdx < nn::NumVariants; ++variantIdx)
+    {
+        memcpy(const_cast<nn::LastLayerWeightType*>(target.GetLayerWeights<nn::LastLayerWeightType>(lastLayerIndex, variantIdx)),
+               source.GetLayerWeights<nn::LastLayerWeightType>(lastLayerIndex, variantIdx),
+               source.GetLayerSize(lastLayerIndex) * nn::OutputSize * sizeof(nn::LastLayerWeightType));
+        memcpy(const_cast<nn::LastLayerBiasType*>(target.GetLayerBiases<nn::LastLayerBiasType>(lastLayerIndex, variantIdx)),
+               source.GetLayerBiases<nn::LastLayerBiasType>(lastLayerIndex, variantIdx),
+               nn::OutputSize * sizeof(nn::LastLayerBiasType));
+    }
+
+    if (!target.Save(args[1].c_str()))
+    {
+        return;
+    }
+
+    // compare evaluations of both networks
+    std::mt19937 randomGenerator(12345);
+    uint32_t numEvaluatedPositions = 0;
+    double errorSum = 0.0;
+    double scoreErrorSum = 0.0;
+    int32_t maxError = 0;
+
+    while (numEvaluatedPositions < numPositions)
+    {
+        Position pos(Position::InitPositionFEN);
+
+        for (uint32_t ply = 0; ply < MaxGamePlies && numEvaluatedPositions < numPositions; ++ply)
+        {
+            const Move move = GetRandomMove(randomGenerator, pos);
+            if (!move.IsValid()) break;
+            pos.DoMove(move);
+
+            if (ply < NumOpeningPlies) continue;
+
+            // convert to centipawn range, like in Evaluate()
+            const int32_t sourceEval = NNEvaluator::Evaluate(source, pos) / (nn::OutputScale * nn::WeightScale / c_nnOutputToCentiPawns);
+            const int32_t targetEval = NNEvaluator::Evaluate(target, pos) / (nn::OutputScale * nn::WeightScale / c_nnOutputToCentiPawns);
+
+            const int32_t error = std::abs(sourceEval - targetEval);
+            errorSum += error;
+            scoreErrorSum += std::abs(InternalEvalToExpectedGameScore(sourceEval) - InternalEvalToExpectedGameScore(targetEval));
+            maxError = std::max(maxError, error);
+            numEvaluatedPositions++;
+        }
+    }
+
+    std::cout
+        << "Converted " << args[0] << " (version " << source.GetVersion() << ") to "
+        << args[1] << " (version " << target.GetVersion() << ")" << std::endl
+        << "Clamped weights: " << numClampedWeights << std::endl
+        << "Positions: " << numEvaluatedPositions << std::endl
+        << "Eval error avg/max: " << std::fixed << std::setprecision(3) << (errorSum / numEvaluatedPositions) << " / " << maxError << " cp" << std::endl
+        << "Expected score error avg: " << std::setprecision(6) << (scoreErrorSum / numEvaluatedPositions) << std::endl;
+}
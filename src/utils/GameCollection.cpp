@@ -1,49 +1,73 @@
 #include "GameCollection.hpp"
 #include "../backend/Game.hpp"
+#include "../backend/Evaluate.hpp"
+
+#include <algorithm>
 
 namespace GameCollection
 {
 
-    bool ReadGame(InputStream& stream, Game& game, std::vector<Move>& decodedMoves)
+    // read game header, validate game score
+    static bool ReadGameHeader(InputStream& stream, GameHeader& outHeader)
     {
-        GameHeader header{};
-
         if (stream.IsEndOfFile())
         {
             return false;
         }
 
-        if (!stream.Read(&header, sizeof(header)))
+        if (!stream.Read(&outHeader, sizeof(outHeader)))
         {
             std::cout << "Failed to read game header in file " << stream.GetFileName() << " offset=" << stream.GetPosition() << std::endl;
             return false;
         }
 
-        thread_local std::vector<MoveAndScore> moves;
-        moves.clear();
-        moves.resize(header.numMoves);
+        if (outHeader.forcedScore != Game::Score::Unknown &&
+            outHeader.forcedScore != Game::Score::WhiteWins &&
+            outHeader.forcedScore != Game::Score::BlackWins &&
+            outHeader.forcedScore != Game::Score::Draw)
+        {
+            std::cout << "Failed to parse game from " << stream.GetFileName() << ": invalid game score" << std::endl;
+            return false;
+        }
 
-        decodedMoves.clear();
-        decodedMoves.reserve(header.numMoves);
+        return true;
+    }
+
+    // read game header and packed moves
+    static bool ReadGameData(InputStream& stream, GameHeader& outHeader, std::vector<MoveAndScore>& outMoves)
+    {
+        if (!ReadGameHeader(stream, outHeader))
+        {
+            return false;
+        }
 
-        if (header.numMoves)
+        outMoves.resize(outHeader.numMoves);
+
+        if (outHeader.numMoves)
         {
-            if (!stream.Read(moves.data(), sizeof(MoveAndScore) * header.numMoves))
+            if (!stream.Read(outMoves.data(), sizeof(MoveAndScore) * outHeader.numMoves))
             {
                 std::cout << "Failed to read game moves from file " << stream.GetFileName() << " offset=" << stream.GetPosition() << std::endl;
                 return false;
             }
         }
 
-        if (header.forcedScore != Game::Score::Unknown &&
-            header.forcedScore != Game::Score::WhiteWins &&
-            header.forcedScore != Game::Score::BlackWins &&
-            header.forcedScore != Game::Score::Draw)
+        return true;
+    }
+
+    bool ReadGame(InputStream& stream, Game& game, std::vector<Move>& decodedMoves)
+    {
+        GameHeader header{};
+
+        thread_local std::vector<MoveAndScore> moves;
+        if (!ReadGameData(stream, header, moves))
         {
-            std::cout << "Failed to parse game from " << stream.GetFileName() << ": invalid game score" << std::endl;
             return false;
         }
 
+        decodedMoves.clear();
+        decodedMoves.reserve(header.numMoves);
+
         Position initialPosition;
         if (!UnpackPosition(header.initialPosition, initialPosition))
         {
@@ -79,6 +103,254 @@ namespace GameCollection
         return true;
     }
 
+    bool SplitIntoRanges(FileInputStream& stream, uint32_t maxGamesPerRange, std::vector<GameRange>& outRanges)
+    {
+        ASSERT(maxGamesPerRange > 0);
+
+        outRanges.clear();
+
+        const uint64_t fileSize = stream.GetSize();
+        GameHeader header{};
+
+        for (;;)
+        {
+            const uint64_t offset = stream.GetPosition();
+            if (!ReadGameHeader(stream, header))
+            {
+                break;
+            }
+
+            // skip the moves, game with truncated moves ends the scan like in sequential reading
+            const uint64_t nextOffset = stream.GetPosition() + (uint64_t)header.numMoves * sizeof(MoveAndScore);
+            if (nextOffset > fileSize || !stream.SetPosition(nextOffset))
+            {
+                std::cout << "Failed to read game moves from file " << stream.GetFileName() << " offset=" << offset << std::endl;
+                break;
+            }
+
+            if (outRanges.empty() || outRanges.back().numGames >= maxGamesPerRange)
+            {
+                outRanges.push_back({ offset, 0 });
+            }
+            outRanges.back().numGames++;
+        }
+
+        return !outRanges.empty();
+    }
+
+    bool Reader::NextGame()
+    {
+        GameHeader header{};
+        if (!ReadGameData(mStream, header, mMoves))
+        {
+            return false;
+        }
+
+        if (!UnpackPosition(header.initialPosition, mInitialPosition))
+        {
+            return false;
+        }
+
+        mHasMoveScores = header.hasMoveScores;
+        mPosition = mInitialPosition;
+        mCurrentMove = Move::Invalid();
+        mMoveIndex = 0;
+
+        // game result depends on the final position, so the game needs to be replayed upfront
+        mScore = header.forcedScore;
+        if (mScore == Game::Score::Unknown)
+        {
+            mScore = CalculateScore();
+            mPosition = mInitialPosition;
+        }
+
+        return true;
+    }
+
+    bool Reader::DecodeMove(const Position& pos, uint32_t index, Move& outMove) const
+    {
+        outMove = pos.MoveFromPacked(mMoves[index].move);
+        if (!outMove.IsValid())
+        {
+            std::cout
+                << "Failed to parse game from " << mStream.GetFileName() << ": move " << mMoves[index].move.ToString()
+                << " is invalid in position " << pos.ToFEN() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    Game::Score Reader::CalculateScore()
+    {
+        mPositionHashes.clear();
+        mPositionHashes.push_back(mPosition.GetHash());
+
+        for (uint32_t i = 0; i < mMoves.size(); ++i)
+        {
+            Move move;
+            if (!DecodeMove(mPosition, i, move) || !mPosition.DoMove(move))
+            {
+                return Game::Score::Unknown;
+            }
+            mPositionHashes.push_back(mPosition.GetHash());
+        }
+
+        if (mPosition.IsMate())
+        {
+            return mPosition.GetSideToMove() == White ? Game::Score::BlackWins : Game::Score::WhiteWins;
+        }
+
+        // same conditions as Game::IsDrawn, repetitions are detected by position hash
+        const uint64_t finalHash = mPosition.GetHash();
+        if (std::count(mPositionHashes.begin(), mPositionHashes.end(), finalHash) >= 3 ||
+            mPosition.IsFiftyMoveRuleDraw() ||
+            CheckInsufficientMaterial(mPosition) ||
+            mPosition.IsStalemate())
+        {
+            return Game::Score::Draw;
+        }
+
+        return Game::Score::Unknown;
+    }
+
+    bool Reader::ReadMove(Move& outMove, ScoreType& outMoveScore)
+    {
+        if (mMoveIndex >= mMoves.size())
+        {
+            return false;
+        }
+
+        if (!DecodeMove(mPosition, mMoveIndex, mCurrentMove))
+        {
+            return false;
+        }
+
+        outMove = mCurrentMove;
+        outMoveScore = mHasMoveScores ? mMoves[mMoveIndex].score : 0;
+        return true;
+    }
+
+    bool Reader::DoMove()
+    {
+        ASSERT(mCurrentMove.IsValid());
+
+        if (!mPosition.DoMove(mCurrentMove))
+        {
+            return false;
+        }
+
+        mCurrentMove = Move::Invalid();
+        mMoveIndex++;
+        return true;
+    }
+
+#pragma pack(push, 1)
+    struct IndexHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t indexedSize;
+        uint64_t numGames;
+    };
+#pragma pack(pop)
+
+    void Index::Clear()
+    {
+        mEntries.clear();
+        mIndexedSize = 0;
+    }
+
+    bool Index::Load(const char* path)
+    {
+        Clear();
+
+        FileInputStream stream(path);
+        if (!stream.IsOpen())
+        {
+            return false;
+        }
+
+        IndexHeader header{};
+        if (!stream.Read(&header, sizeof(header)) ||
+            header.magic != MagicNumber ||
+            header.version != CurrentVersion ||
+            stream.GetSize() != sizeof(IndexHeader) + header.numGames * sizeof(IndexEntry))
+        {
+            std::cout << "Invalid games index file: " << path << std::endl;
+            return false;
+        }
+
+        mEntries.resize(header.numGames);
+        if (header.numGames > 0 && !stream.Read(mEntries.data(), header.numGames * sizeof(IndexEntry)))
+        {
+            std::cout << "Failed to read games index file: " << path << std::endl;
+            Clear();
+            return false;
+        }
+
+        mIndexedSize = header.indexedSize;
+        return true;
+    }
+
+    bool Index::Save(const char* path) const
+    {
+        FileOutputStream stream(path);
+        if (!stream.IsOpen())
+        {
+            return false;
+        }
+
+        IndexHeader header{};
+        header.magic = MagicNumber;
+        header.version = CurrentVersion;
+        header.indexedSize = mIndexedSize;
+        header.numGames = mEntries.size();
+
+        if (!stream.Write(&header, sizeof(header)) ||
+            !stream.Write(mEntries.data(), mEntries.size() * sizeof(IndexEntry)))
+        {
+            std::cout << "Failed to write games index file: " << path << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    uint32_t Index::Update(InputStream& gamesStream)
+    {
+        ASSERT(gamesStream.GetPosition() == mIndexedSize);
+
+        uint32_t numGames = 0;
+
+        Reader reader(gamesStream);
+        for (;;)
+        {
+            IndexEntry entry{};
+            entry.offset = gamesStream.GetPosition();
+
+            if (!reader.NextGame())
+            {
+                break;
+            }
+
+            // replay the game to get the final material
+            Move move;
+            ScoreType moveScore;
+            while (reader.ReadMove(move, moveScore) && reader.DoMove()) { }
+
+            entry.openingHash = reader.GetInitialPosition().GetHash();
+            entry.finalMaterial = reader.GetPosition().GetMaterialKey();
+            entry.numMoves = static_cast<uint16_t>(reader.GetNumMoves());
+            entry.score = reader.GetScore();
+
+            mEntries.push_back(entry);
+            mIndexedSize = gamesStream.GetPosition();
+            numGames++;
+        }
+
+        return numGames;
+    }
+
     bool Writer::WriteGame(const Game& game)
     {
         ASSERT(game.GetMoves().size() <= UINT16_MAX);
@@ -5,6 +5,7 @@
 #include "../backend/PositionUtils.hpp"
 #include "../backend/Move.hpp"
 #include "../backend/Game.hpp"
+#include "../backend/Material.hpp"
 
 #include <string>
 #include <mutex>
@@ -33,6 +34,118 @@ namespace GameCollection
 
     bool ReadGame(InputStream& stream, Game& game, std::vector<Move>& decodedMoves);
 
+    // range of consecutive games inside a games file
+    struct GameRange
+    {
+        uint64_t offset = 0;
+        uint32_t numGames = 0;
+    };
+
+    // scan game headers (moves are skipped, not decoded) and split the stream into ranges of at most 'maxGamesPerRange' games,
+    // so a single file can be processed in parallel: each range is read by a separate Reader after seeking to its offset
+    // scanning stops at the first game that can't be parsed, like sequential reading does
+    bool SplitIntoRanges(FileInputStream& stream, uint32_t maxGamesPerRange, std::vector<GameRange>& outRanges);
+
+    // Streaming game reader for bulk processing. Games are replayed move by move on a single position,
+    // without building Game history, and buffers are reused between games.
+    //
+    // usage:
+    //   while (reader.NextGame())
+    //       while (reader.ReadMove(move, moveScore))
+    //           ... reader.GetPosition() is the position before 'move'
+    //           if (!reader.DoMove()) break;
+    class Reader
+    {
+    public:
+        Reader(InputStream& stream) : mStream(stream) { }
+
+        // read next game and rewind to its initial position
+        // returns false at the end of the stream or if the game can't be parsed
+        bool NextGame();
+
+        // forced score if the game was adjudicated, otherwise computed from the final position like Game::GetScore()
+        Game::Score GetScore() const { return mScore; }
+
+        uint32_t GetNumMoves() const { return static_cast<uint32_t>(mMoves.size()); }
+        bool HasMoveScores() const { return mHasMoveScores; }
+        const Position& GetInitialPosition() const { return mInitialPosition; }
+
+        // position before the move returned by ReadMove
+        const Position& GetPosition() const { return mPosition; }
+        uint32_t GetMoveIndex() const { return mMoveIndex; }
+
+        // decode the next move of the game (without playing it)
+        // returns false after the last move or if the move is invalid
+        bool ReadMove(Move& outMove, ScoreType& outMoveScore);
+
+        // play the move returned by the last ReadMove, returns false if it's illegal
+        bool DoMove();
+
+    private:
+        bool DecodeMove(const Position& pos, uint32_t index, Move& outMove) const;
+        Game::Score CalculateScore();
+
+        InputStream& mStream;
+        std::vector<MoveAndScore> mMoves;
+        std::vector<uint64_t> mPositionHashes;
+        Position mInitialPosition;
+        Position mPosition;
+        Move mCurrentMove = Move::Invalid();
+        uint32_t mMoveIndex = 0;
+        Game::Score mScore = Game::Score::Unknown;
+        bool mHasMoveScores = false;
+    };
+
+#pragma pack(push, 1)
+    struct IndexEntry
+    {
+        uint64_t offset;                // offset of the game header in the games file
+        uint64_t openingHash;           // hash of the initial position
+        MaterialKey finalMaterial;      // material in the final position
+        uint16_t numMoves;
+        Game::Score score;              // forced score or score computed from the final position
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(IndexEntry) == 27, "IndexEntry size mismatch");
+
+    // Index of a games file, stored in a companion file.
+    // Allows random access by game ID (order of games in the file) and filtering games without reading them.
+    // Games files are append-only, so the index can be updated with newly appended games.
+    //
+    // Layout:
+    //   IndexHeader
+    //   IndexEntry for each game
+    class Index
+    {
+    public:
+        static constexpr uint32_t MagicNumber = 'GIDX';
+        static constexpr uint32_t CurrentVersion = 1;
+
+        // default index file path for a games file
+        static std::string GetIndexPath(const std::string& gamesPath) { return gamesPath + ".idx"; }
+
+        bool Load(const char* path);
+        bool Save(const char* path) const;
+
+        void Clear();
+
+        // read and index games until the end of the stream
+        // stream must be positioned at GetIndexedSize(), returns number of indexed games
+        uint32_t Update(InputStream& gamesStream);
+
+        // size of the games file covered by the index
+        uint64_t GetIndexedSize() const { return mIndexedSize; }
+
+        uint32_t GetNumGames() const { return static_cast<uint32_t>(mEntries.size()); }
+        const IndexEntry& GetEntry(uint32_t gameID) const { return mEntries[gameID]; }
+        const std::vector<IndexEntry>& GetEntries() const { return mEntries; }
+
+    private:
+        std::vector<IndexEntry> mEntries;
+        uint64_t mIndexedSize = 0;
+    };
+
     class Writer
     {
     public:
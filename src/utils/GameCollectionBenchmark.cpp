@@ -0,0 +1,288 @@
+#include "Common.hpp"
+#include "GameCollection.hpp"
+#include "ThreadPool.hpp"
+
+#include "../backend/Position.hpp"
+#include "../backend/Game.hpp"
+#include "../backend/Time.hpp"
+#include "../backend/Waitable.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <random>
+
+using namespace threadpool;
+
+namespace {
+
+static constexpr uint32_t MaxGamePlies = 300;
+static constexpr uint32_t NumRounds = 3;
+static constexpr uint32_t GamesPerRange = 1024;
+
+// write random games (with random move scores) to measure reading speed without running selfplay
+static bool GenerateGames(const char* path, uint32_t numGames)
+{
+    FileOutputStream stream(path);
+    if (!stream.IsOpen())
+    {
+        std::cout << "Failed to open " << path << std::endl;
+        return false;
+    }
+
+    GameCollection::Writer writer(stream);
+
+    std::mt19937 randomGenerator(12345);
+    std::uniform_int_distribution<int32_t> scoreDistr(-500, 500);
+    std::uniform_int_distribution<uint32_t> resultDistr(0, 2);
+
+    std::vector<Move> moves;
+
+    for (uint32_t i = 0; i < numGames; ++i)
+    {
+        Game game;
+        game.Reset(Position(Position::InitPositionFEN));
+
+        for (uint32_t ply = 0; ply < MaxGamePlies && game.GetScore() == Game::Score::Unknown; ++ply)
+        {
+            moves.clear();
+            game.GetPosition().GetNumLegalMoves(&moves);
+            ASSERT(!moves.empty());
+
+            std::uniform_int_distribution<size_t> moveDistr(0, moves.size() - 1);
+            VERIFY(game.DoMove(moves[moveDistr(randomGenerator)], (ScoreType)scoreDistr(randomGenerator)));
+        }
+
+        // adjudicate unfinished games
+        if (game.GetScore() == Game::Score::Unknown)
+        {
+            game.SetScore((Game::Score)resultDistr(randomGenerator));
+        }
+
+        if (!writer.WriteGame(game))
+        {
+            return false;
+        }
+    }
+
+    std::cout << "Generated " << numGames << " games" << std::endl;
+    return true;
+}
+
+struct ReadStats
+{
+    uint64_t numGames = 0;
+    uint64_t numPositions = 0;
+    uint64_t checksum = 0;
+};
+
+// old path: build Game with full history, then replay it again
+static ReadStats ReadGames_Game(const char* path)
+{
+    ReadStats stats;
+    FileInputStream stream(path);
+
+    Game game;
+    std::vector<Move> moves;
+
+    while (GameCollection::ReadGame(stream, game, moves))
+    {
+        if (game.GetScore() == Game::Score::Unknown) continue;
+
+        Position pos = game.GetInitialPosition();
+        for (size_t i = 0; i < moves.size(); ++i)
+        {
+            stats.checksum += pos.GetHash() ^ (uint16_t)game.GetMoveScores()[i];
+            stats.numPositions++;
+            if (!pos.DoMove(moves[i])) break;
+        }
+
+        stats.checksum += (uint32_t)game.GetScore();
+        stats.numGames++;
+    }
+
+    return stats;
+}
+
+static ReadStats ReadGames_Reader(const char* path, uint64_t offset = 0, uint32_t maxGames = UINT32_MAX)
+{
+    ReadStats stats;
+    FileInputStream stream(path);
+    if (!stream.SetPosition(offset))
+    {
+        return stats;
+    }
+
+    GameCollection::Reader reader(stream);
+
+    for (uint32_t i = 0; i < maxGames && reader.NextGame(); ++i)
+    {
+        if (reader.GetScore() == Game::Score::Unknown) continue;
+
+        Move move;
+        ScoreType moveScore;
+        while (reader.ReadMove(move, moveScore))
+        {
+            stats.checksum += reader.GetPosition().GetHash() ^ (uint16_t)moveScore;
+            stats.numPositions++;
+            if (!reader.DoMove()) break;
+        }
+
+        stats.checksum += (uint32_t)reader.GetScore();
+        stats.numGames++;
+    }
+
+    return stats;
+}
+
+// read ranges of games in parallel (using at most 'maxThreads' threads) and merge the results in range order
+static ReadStats ReadGames_Parallel(const char* path, const std::vector<GameCollection::GameRange>& ranges, uint32_t maxThreads)
+{
+    std::vector<ReadStats> rangeStats(ranges.size());
+
+    Waitable waitable;
+    {
+        TaskBuilder taskBuilder(waitable);
+        taskBuilder.ParallelFor("ReadGames", static_cast<uint32_t>(ranges.size()), [&](const TaskContext&, uint32_t i)
+        {
+            rangeStats[i] = ReadGames_Reader(path, ranges[i].offset, ranges[i].numGames);
+        }, maxThreads);
+    }
+    waitable.Wait();
+
+    ReadStats stats;
+    for (const ReadStats& localStats : rangeStats)
+    {
+        stats.numGames += localStats.numGames;
+        stats.numPositions += localStats.numPositions;
+        stats.checksum += localStats.checksum;
+    }
+    return stats;
+}
+
+// report throughput of reading a single file split into ranges of games vs. number of threads
+static void RunThreadsBenchmark(const char* path, const ReadStats& expectedStats)
+{
+    std::vector<GameCollection::GameRange> ranges;
+    {
+        const TimePoint startTime = TimePoint::GetCurrent();
+
+        FileInputStream stream(path);
+        if (!GameCollection::SplitIntoRanges(stream, GamesPerRange, ranges))
+        {
+            std::cout << "Failed to split " << path << " into ranges" << std::endl;
+            return;
+        }
+
+        const float time = (TimePoint::GetCurrent() - startTime).ToSeconds();
+        std::cout << "Split into " << ranges.size() << " ranges of " << GamesPerRange << " games in " << std::fixed << std::setprecision(3) << time << " s" << std::endl;
+    }
+
+    std::vector<uint32_t> threadCounts;
+    const uint32_t maxThreads = ThreadPool::GetInstance().GetNumThreads();
+    for (uint32_t numThreads = 1; numThreads < maxThreads; numThreads *= 2)
+    {
+        threadCounts.push_back(numThreads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::cout << std::setw(8) << "Threads" << " | " << std::setw(9) << "Time" << " | " << std::setw(12) << "Games/s" << " | Speedup" << std::endl;
+
+    float singleThreadTime = 0.0f;
+    for (const uint32_t numThreads : threadCounts)
+    {
+        float time = std::numeric_limits<float>::max();
+        ReadStats stats;
+
+        for (uint32_t i = 0; i < NumRounds; ++i)
+        {
+            const TimePoint startTime = TimePoint::GetCurrent();
+            stats = ReadGames_Parallel(path, ranges, numThreads);
+            time = std::min(time, (TimePoint::GetCurrent() - startTime).ToSeconds());
+        }
+
+        if (numThreads == 1)
+        {
+            singleThreadTime = time;
+        }
+
+        std::cout
+            << std::setw(8) << numThreads << " | "
+            << std::fixed << std::setprecision(3) << std::setw(7) << time << " s | "
+            << std::setw(12) << (uint64_t)(stats.numGames / std::max(time, 0.001f)) << " | "
+            << std::setprecision(2) << singleThreadTime / std::max(time, 0.001f) << "x" << std::endl;
+
+        if (stats.checksum != expectedStats.checksum || stats.numGames != expectedStats.numGames)
+        {
+            std::cout << "ERROR: Results mismatch" << std::endl;
+        }
+    }
+}
+
+static void PrintResult(const char* name, const ReadStats& stats, float time)
+{
+    std::cout
+        << std::setw(14) << name << " | "
+        << std::fixed << std::setprecision(3) << time << " s | "
+        << (uint64_t)(stats.numGames / std::max(time, 0.001f)) << " games/s | "
+        << (uint64_t)(stats.numPositions / std::max(time, 0.001f)) << " positions/s" << std::endl;
+}
+
+} // namespace
+
+// compare reading a games file through Game (GameCollection::ReadGame) and through GameCollection::Reader,
+// "threads" reports throughput of reading the file split into ranges of games vs. number of threads
+// usage: gameCollectionBenchmark <games file> [generate <number of games>] [threads]
+void RunGameCollectionBenchmark(const std::vector<std::string>& args)
+{
+    if (args.empty())
+    {
+        std::cout << "Usage: gameCollectionBenchmark <games file> [generate <number of games>] [threads]" << std::endl;
+        return;
+    }
+
+    const char* path = args[0].c_str();
+
+    if (args.size() > 2 && args[1] == "generate")
+    {
+        if (!GenerateGames(path, std::stoul(args[2])))
+        {
+            return;
+        }
+    }
+
+    if (args.back() == "threads")
+    {
+        const ReadStats expectedStats = ReadGames_Reader(path);
+        std::cout << "Games: " << expectedStats.numGames << ", positions: " << expectedStats.numPositions << std::endl;
+        RunThreadsBenchmark(path, expectedStats);
+        return;
+    }
+
+    // first pass warms up file cache
+    const ReadStats expectedStats = ReadGames_Reader(path);
+
+    float gameTime = std::numeric_limits<float>::max();
+    float readerTime = std::numeric_limits<float>::max();
+    ReadStats gameStats, readerStats;
+
+    for (uint32_t i = 0; i < NumRounds; ++i)
+    {
+        TimePoint startTime = TimePoint::GetCurrent();
+        gameStats = ReadGames_Game(path);
+        gameTime = std::min(gameTime, (TimePoint::GetCurrent() - startTime).ToSeconds());
+
+        startTime = TimePoint::GetCurrent();
+        readerStats = ReadGames_Reader(path);
+        readerTime = std::min(readerTime, (TimePoint::GetCurrent() - startTime).ToSeconds());
+    }
+
+    std::cout << "Games: " << expectedStats.numGames << ", positions: " << expectedStats.numPositions << std::endl;
+    PrintResult("Game", gameStats, gameTime);
+    PrintResult("Reader", readerStats, readerTime);
+
+    if (gameStats.checksum != readerStats.checksum || gameStats.numGames != readerStats.numGames)
+    {
+        std::cout << "ERROR: Results mismatch" << std::endl;
+    }
+}
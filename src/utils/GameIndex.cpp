@@ -0,0 +1,302 @@
+#include "Common.hpp"
+#include "GameCollection.hpp"
+
+#include "../backend/Position.hpp"
+#include "../backend/Game.hpp"
+#include "../backend/Time.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+#include <memory>
+
+namespace {
+
+struct GamesQuery
+{
+    uint32_t gameID = UINT32_MAX;
+    MaterialKey material;
+    bool filterMaterial = false;
+    Game::Score score = Game::Score::Unknown;
+    bool filterScore = false;
+    uint32_t minMoves = 0;
+    uint32_t maxMoves = UINT32_MAX;
+    uint64_t openingHash = 0;
+    bool filterOpening = false;
+    uint32_t limit = UINT32_MAX;
+    std::string outputPath;
+
+    bool Matches(uint32_t id, const GameCollection::IndexEntry& entry) const
+    {
+        if (gameID != UINT32_MAX && id != gameID) return false;
+        if (filterMaterial && !(entry.finalMaterial == material)) return false;
+        if (filterScore && entry.score != score) return false;
+        if (entry.numMoves < minMoves || entry.numMoves > maxMoves) return false;
+        if (filterOpening && entry.openingHash != openingHash) return false;
+        return true;
+    }
+};
+
+static bool ParseScore(const std::string& str, Game::Score& outScore)
+{
+         if (str == "white")    outScore = Game::Score::WhiteWins;
+    else if (str == "black")    outScore = Game::Score::BlackWins;
+    else if (str == "draw")     outScore = Game::Score::Draw;
+    else if (str == "unknown")  outScore = Game::Score::Unknown;
+    else return false;
+    return true;
+}
+
+static const char* ScoreToString(Game::Score score)
+{
+    switch (score)
+    {
+    case Game::Score::WhiteWins: return "1-0";
+    case Game::Score::BlackWins: return "0-1";
+    case Game::Score::Draw: return "1/2-1/2";
+    default: return "*";
+    }
+}
+
+static bool ParseQuery(const std::vector<std::string>& args, GamesQuery& outQuery)
+{
+    for (size_t i = 1; i < args.size(); ++i)
+    {
+        const std::string& arg = args[i];
+        const size_t separator = arg.find('=');
+        if (separator == std::string::npos)
+        {
+            std::cout << "Invalid query argument: " << arg << std::endl;
+            return false;
+        }
+
+        const std::string key = arg.substr(0, separator);
+        const std::string value = arg.substr(separator + 1);
+
+        if (key == "id")
+        {
+            outQuery.gameID = std::stoul(value);
+        }
+        else if (key == "material")
+        {
+            outQuery.material.FromString(value.c_str());
+            outQuery.filterMaterial = true;
+        }
+        else if (key == "result")
+        {
+            if (!ParseScore(value, outQuery.score))
+            {
+                std::cout << "Invalid result: " << value << " (expected white, black, draw or unknown)" << std::endl;
+                return false;
+            }
+            outQuery.filterScore = true;
+        }
+        else if (key == "minMoves")
+        {
+            outQuery.minMoves = std::stoul(value);
+        }
+        else if (key == "maxMoves")
+        {
+            outQuery.maxMoves = std::stoul(value);
+        }
+        else if (key == "opening")
+        {
+            outQuery.openingHash = std::stoull(value, nullptr, 16);
+            outQuery.filterOpening = true;
+        }
+        else if (key == "limit")
+        {
+            outQuery.limit = std::stoul(value);
+        }
+        else if (key == "output")
+        {
+            outQuery.outputPath = value;
+        }
+        else
+        {
+            std::cout << "Unknown query argument: " << key << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// load index of a games file, index games appended since the last update and save the updated index
+static bool LoadIndex(const std::string& gamesPath, GameCollection::Index& index)
+{
+    FileInputStream gamesStream(gamesPath.c_str());
+    if (!gamesStream.IsOpen())
+    {
+        return false;
+    }
+
+    const std::string indexPath = GameCollection::Index::GetIndexPath(gamesPath);
+    if (std::filesystem::exists(indexPath) && index.Load(indexPath.c_str()))
+    {
+        // games file is append-only, so smaller file means the index is stale
+        if (index.GetIndexedSize() > gamesStream.GetSize())
+        {
+            std::cout << "Games file is smaller than indexed size, rebuilding index" << std::endl;
+            index.Clear();
+        }
+    }
+    else
+    {
+        index.Clear();
+    }
+
+    if (index.GetIndexedSize() < gamesStream.GetSize())
+    {
+        if (!gamesStream.SetPosition(index.GetIndexedSize()))
+        {
+            return false;
+        }
+
+        const TimePoint startTime = TimePoint::GetCurrent();
+        const uint32_t numNewGames = index.Update(gamesStream);
+        const float time = (TimePoint::GetCurrent() - startTime).ToSeconds();
+
+        std::cout
+            << "Indexed " << numNewGames << " games in " << std::fixed << std::setprecision(3) << time << " s ("
+            << (uint64_t)(numNewGames / std::max(time, 0.001f)) << " games/s)" << std::endl;
+
+        if (index.GetIndexedSize() < gamesStream.GetSize())
+        {
+            std::cout << "WARNING: Failed to parse games after offset " << index.GetIndexedSize() << std::endl;
+        }
+
+        if (numNewGames > 0 && !index.Save(indexPath.c_str()))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+// build or update index file of a games file (stored next to it with .idx extension)
+// usage: indexGames <games file>
+void RunIndexGames(const std::vector<std::string>& args)
+{
+    if (args.empty())
+    {
+        std::cout << "Usage: indexGames <games file>" << std::endl;
+        return;
+    }
+
+    const std::string& gamesPath = args[0];
+
+    GameCollection::Index index;
+    if (!LoadIndex(gamesPath, index))
+    {
+        std::cout << "Failed to index " << gamesPath << std::endl;
+        return;
+    }
+
+    std::cout << "Games in index: " << index.GetNumGames() << std::endl;
+}
+
+// find games matching all given filters using games index, matching games are read directly from their offsets
+// and printed or written to output games file
+// usage: queryGames <games file> [id=<game ID>] [material=<e.g. KRPvKR>] [result=white|black|draw|unknown]
+//                   [minMoves=<N>] [maxMoves=<N>] [opening=<hex hash>] [limit=<N>] [output=<games file>]
+void RunQueryGames(const std::vector<std::string>& args)
+{
+    if (args.empty())
+    {
+        std::cout
+            << "Usage: queryGames <games file> [id=<game ID>] [material=<e.g. KRPvKR>] [result=white|black|draw|unknown]" << std::endl
+            << "                  [minMoves=<N>] [maxMoves=<N>] [opening=<hex hash>] [limit=<N>] [output=<games file>]" << std::endl;
+        return;
+    }
+
+    const std::string& gamesPath = args[0];
+
+    GamesQuery query;
+    if (!ParseQuery(args, query))
+    {
+        return;
+    }
+
+    GameCollection::Index index;
+    if (!LoadIndex(gamesPath, index))
+    {
+        std::cout << "Failed to index " << gamesPath << std::endl;
+        return;
+    }
+
+    const TimePoint startTime = TimePoint::GetCurrent();
+
+    std::vector<uint32_t> matchingGames;
+    if (query.gameID != UINT32_MAX)
+    {
+        if (query.gameID < index.GetNumGames() && query.Matches(query.gameID, index.GetEntry(query.gameID)))
+        {
+            matchingGames.push_back(query.gameID);
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < index.GetNumGames() && matchingGames.size() < query.limit; ++i)
+        {
+            if (query.Matches(i, index.GetEntry(i)))
+            {
+                matchingGames.push_back(i);
+            }
+        }
+    }
+
+    FileInputStream gamesStream(gamesPath.c_str());
+
+    std::unique_ptr<FileOutputStream> outputStream;
+    std::unique_ptr<GameCollection::Writer> writer;
+    if (!query.outputPath.empty())
+    {
+        outputStream = std::make_unique<FileOutputStream>(query.outputPath.c_str());
+        if (!outputStream->IsOpen())
+        {
+            return;
+        }
+        writer = std::make_unique<GameCollection::Writer>(*outputStream);
+    }
+
+    Game game;
+    std::vector<Move> moves;
+
+    for (const uint32_t gameID : matchingGames)
+    {
+        const GameCollection::IndexEntry& entry = index.GetEntry(gameID);
+
+        if (!gamesStream.SetPosition(entry.offset) || !GameCollection::ReadGame(gamesStream, game, moves))
+        {
+            std::cout << "Failed to read game " << gameID << " at offset " << entry.offset << std::endl;
+            return;
+        }
+
+        if (writer)
+        {
+            if (!writer->WriteGame(game))
+            {
+                return;
+            }
+        }
+        else
+        {
+            std::cout
+                << "#" << gameID << " "
+                << ScoreToString(entry.score) << " "
+                << entry.numMoves << " moves, "
+                << "final material " << entry.finalMaterial.ToString() << ", "
+                << "opening " << std::hex << entry.openingHash << std::dec << ": "
+                << game.GetInitialPosition().ToFEN() << std::endl;
+        }
+    }
+
+    const float time = (TimePoint::GetCurrent() - startTime).ToSeconds();
+    std::cout
+        << "Matched " << matchingGames.size() << " of " << index.GetNumGames() << " games in "
+        << std::fixed << std::setprecision(3) << time << " s" << std::endl;
+}
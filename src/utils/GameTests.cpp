@@ -26,6 +26,63 @@ static void TestGameSerialization(const Game& originalGame)
     }
 
     TEST_EXPECT(readGame == originalGame);
+
+    // streaming reader must replay the same moves and compute the same score
+    {
+        MemoryInputStream stream(buffer);
+        GameCollection::Reader reader(stream);
+        TEST_EXPECT(reader.NextGame());
+        TEST_EXPECT(reader.GetScore() == originalGame.GetScore());
+        TEST_EXPECT(reader.GetNumMoves() == originalGame.GetMoves().size());
+        TEST_EXPECT(reader.GetInitialPosition() == originalGame.GetInitialPosition());
+
+        Move move;
+        ScoreType moveScore;
+        while (reader.ReadMove(move, moveScore))
+        {
+            TEST_EXPECT(move == originalGame.GetMoves()[reader.GetMoveIndex()]);
+            TEST_EXPECT(reader.DoMove());
+        }
+
+        TEST_EXPECT(reader.GetMoveIndex() == originalGame.GetMoves().size());
+        TEST_EXPECT(reader.GetPosition() == originalGame.GetPosition());
+        TEST_EXPECT(!reader.NextGame());
+    }
+}
+
+static void TestGameIndex(const std::vector<Game>& games)
+{
+    std::vector<uint8_t> buffer;
+    std::vector<uint64_t> gameOffsets;
+
+    {
+        MemoryOutputStream stream(buffer);
+        GameCollection::Writer writer(stream);
+        for (const Game& game : games)
+        {
+            gameOffsets.push_back(buffer.size());
+            TEST_EXPECT(writer.WriteGame(game));
+        }
+    }
+
+    GameCollection::Index index;
+    {
+        MemoryInputStream stream(buffer);
+        TEST_EXPECT(index.Update(stream) == games.size());
+    }
+
+    TEST_EXPECT(index.GetNumGames() == games.size());
+    TEST_EXPECT(index.GetIndexedSize() == buffer.size());
+
+    for (uint32_t i = 0; i < games.size(); ++i)
+    {
+        const GameCollection::IndexEntry& entry = index.GetEntry(i);
+        TEST_EXPECT(entry.offset == gameOffsets[i]);
+        TEST_EXPECT(entry.score == games[i].GetScore());
+        TEST_EXPECT(entry.numMoves == games[i].GetMoves().size());
+        TEST_EXPECT(entry.openingHash == games[i].GetInitialPosition().GetHash());
+        TEST_EXPECT(entry.finalMaterial == games[i].GetPosition().GetMaterialKey());
+    }
 }
 
 void RunGameTests()
@@ -69,6 +126,26 @@ void RunGameTests()
         TestGameSerialization(game);
     }
 
+    // index of multiple games (finished and adjudicated)
+    {
+        std::vector<Game> games(3);
+
+        games[0].Reset(Position(Position::InitPositionFEN));
+        TEST_EXPECT(games[0].DoMove(Move::Make(Square_f2, Square_f3, Piece::Pawn)));
+        TEST_EXPECT(games[0].DoMove(Move::Make(Square_e7, Square_e5, Piece::Pawn)));
+        TEST_EXPECT(games[0].DoMove(Move::Make(Square_g2, Square_g4, Piece::Pawn)));
+        TEST_EXPECT(games[0].DoMove(Move::Make(Square_d8, Square_h4, Piece::Queen)));
+
+        games[1].Reset(Position("4K2k/8/6q1/4P3/6Q1/8/8/8 w - - 27 74"));
+        TEST_EXPECT(games[1].DoMove(games[1].GetPosition().MoveFromString("g4g6")));
+
+        games[2].Reset(Position(Position::InitPositionFEN));
+        TEST_EXPECT(games[2].DoMove(Move::Make(Square_d2, Square_d4, Piece::Pawn)));
+        games[2].SetScore(Game::Score::WhiteWins);
+
+        TestGameIndex(games);
+    }
+
     {
         Search search;
         TranspositionTable tt{ 16 * 1024 };
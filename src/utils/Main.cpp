@@ -17,6 +17,18 @@ extern bool TestNetwork();
 extern bool TrainNetwork();
 extern void ValidateEndgame();
 extern void AnalyzeGames();
+extern void Analyze(const std::vector<std::string>& args);
+extern void RunTranspositionTableBenchmark(const std::vector<std::string>& args);
+extern void RunSearchLatencyBenchmark(const std::vector<std::string>& args);
+extern void RunAccumulatorBenchmark(const std::vector<std::string>& args);
+extern void RunThreatsBenchmark(const std::vector<std::string>& args);
+extern void RunNetworkBenchmark(const std::vector<std::string>& args);
+extern void RunTrainingDataBenchmark(const std::vector<std::string>& args);
+extern void RunTrainerBenchmark(const std::vector<std::string>& args);
+extern void RunConvertNetwork(const std::vector<std::string>& args);
+extern void RunGameCollectionBenchmark(const std::vector<std::string>& args);
+extern void RunIndexGames(const std::vector<std::string>& args);
+extern void RunQueryGames(const std::vector<std::string>& args);
 
 int main(int argc, const char* argv[])
 {
@@ -34,7 +46,13 @@ int main(int argc, const char* argv[])
     }
 
     InitEngine();
-    TryLoadingDefaultEvalFile();
+
+    // engine info strings go to stderr, so tools can write their results to stdout
+    {
+        std::streambuf* outputBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+        TryLoadingDefaultEvalFile();
+        std::cout.rdbuf(outputBuffer);
+    }
 
     // load optional syzygy
     for (size_t i = 0; i < args.size(); ++i)
@@ -71,10 +89,34 @@ int main(int argc, const char* argv[])
         ValidateEndgame();
     else if (toolName == "analyzeGames")
         AnalyzeGames();
+    else if (toolName == "analyze")
+        Analyze(args);
     else if (toolName == "trainNetwork")
         TrainNetwork();
     else if (toolName == "generateEndgamePositions")
         GenerateEndgamePositions();
+    else if (toolName == "ttBenchmark")
+        RunTranspositionTableBenchmark(args);
+    else if (toolName == "searchLatency")
+        RunSearchLatencyBenchmark(args);
+    else if (toolName == "accumulatorBenchmark")
+        RunAccumulatorBenchmark(args);
+    else if (toolName == "threatsBenchmark")
+        RunThreatsBenchmark(args);
+    else if (toolName == "networkBenchmark")
+        RunNetworkBenchmark(args);
+    else if (toolName == "trainingDataBenchmark")
+        RunTrainingDataBenchmark(args);
+    else if (toolName == "trainerBenchmark")
+        RunTrainerBenchmark(args);
+    else if (toolName == "convertNetwork")
+        RunConvertNetwork(args);
+    else if (toolName == "gameCollectionBenchmark")
+        RunGameCollectionBenchmark(args);
+    else if (toolName == "indexGames")
+        RunIndexGames(args);
+    else if (toolName == "queryGames")
+        RunQueryGames(args);
     else
     {
         std::cerr << "Unknown option: " << args[0] << std::endl;
@@ -40,6 +40,11 @@ static const uint32_t cMaxIterations = 1'000'000'000;
 static const uint32_t cNumTrainingVectorsPerIteration = 512 * 1024;
 static const uint32_t cNumValidationVectorsPerIteration = 128 * 1024;
 static const uint32_t cBatchSize = 32 * 1024;
+static const uint32_t cGradientReductionShardSize = 64; // weight rows reduced per task after each batch
+static const bool cInt8FeatureTransformer = false; // quantization-aware training and 8-bit feature transformer weights in packed network
+static const bool cMultiLayerNetwork = false; // two hidden layers between feature transformer and output layer
+static const uint32_t cHiddenLayer1Size = 16;
+static const uint32_t cHiddenLayer2Size = 32;
 #ifdef USE_VIRTUAL_FEATURES
 static const uint32_t cNumVirtualFeatures = 12 * 64;
 #endif // USE_VIRTUAL_FEATURES
@@ -52,9 +57,6 @@ public:
         : m_randomGenerator(m_randomDevice())
         , m_trainingLog("training.log")
     {
-        m_validationSet.resize(cNumTrainingVectorsPerIteration);
-        m_trainingSet.resize(cNumTrainingVectorsPerIteration);
-        m_trainingSetCopy.resize(cNumTrainingVectorsPerIteration);
         m_validationPerThreadData.resize(ThreadPool::GetInstance().GetNumThreads());
     }
 
@@ -89,6 +91,8 @@ private:
     TrainingDataLoader m_dataLoader;
 
     nn::WeightsStoragePtr m_featureTransformerWeights;
+    nn::WeightsStoragePtr m_hiddenLayer1Weights;
+    nn::WeightsStoragePtr m_hiddenLayer2Weights;
     nn::WeightsStoragePtr m_lastLayerWeights;
 
     nn::NeuralNetwork m_network;
@@ -98,9 +102,11 @@ private:
     nn::PackedNeuralNetwork m_packedNet;
 #endif // USE_PACKED_NET
 
-    std::vector<TrainingEntry> m_validationSet;
-    std::vector<TrainingEntry> m_trainingSet;
-    std::vector<TrainingEntry> m_trainingSetCopy; // copy, because training set generation runs in parallel with training
+    TrainingSetBuffer m_validationSet;
+
+    // training set generation runs in parallel with training (and validation),
+    // so one set is being consumed while the other one is being filled
+    TrainingSetBuffer m_trainingSets[2];
     std::vector<ValidationPerThreadData> m_validationPerThreadData;
 
     alignas(CACHELINE_SIZE)
@@ -114,9 +120,9 @@ private:
 
     std::ofstream m_trainingLog;
 
-    bool GenerateTrainingSet(std::vector<TrainingEntry>& outEntries, uint64_t kingBucketMask, float baseLambda);
+    bool GenerateTrainingSet(TrainingSetBuffer& outSet, uint32_t numEntries, uint64_t kingBucketMask, float baseLambda);
 
-    void Validate(size_t iteration);
+    ValidationStats Validate();
 
     void BlendLastLayerWeights();
 
@@ -138,23 +144,39 @@ void NetworkTrainer::InitNetwork()
     // divide by number of active input features to avoid accumulator overflow
     m_featureTransformerWeights->m_weightsRange = (float)std::numeric_limits<nn::FirstLayerWeightType>::max() / 16 / nn::InputLayerWeightQuantizationScale;
     m_featureTransformerWeights->m_biasRange = (float)std::numeric_limits<nn::FirstLayerBiasType>::max() / 16 / nn::InputLayerBiasQuantizationScale;
+    if (cInt8FeatureTransformer)
+    {
+        // 8-bit weights can't overflow the accumulator, so full range is used
+        m_featureTransformerWeights->m_weightsRange = (float)std::numeric_limits<nn::FirstLayerInt8WeightType>::max() / nn::InputLayerInt8WeightQuantizationScale;
+        m_featureTransformerWeights->EnableQuantization(nn::InputLayerInt8WeightQuantizationScale, nn::InputLayerBiasQuantizationScale);
+    }
     m_featureTransformerWeights->Init(32u, 0.0f);
 
-    //nn::WeightsStoragePtr layer1Weights = std::make_shared<nn::WeightsStorage>(2u * accumulatorSize, 1);
-    //layer1Weights->m_weightsRange = (float)std::numeric_limits<nn::HiddenLayerWeightType>::max() / nn::HiddenLayerWeightQuantizationScale;
-    //layer1Weights->m_biasRange = (float)std::numeric_limits<nn::HiddenLayerWeightType>::max() / nn::HiddenLayerBiasQuantizationScale;
+    const uint32_t lastLayerInputs = cMultiLayerNetwork ? cHiddenLayer2Size : 2u * accumulatorSize;
 
-    m_lastLayerWeights = std::make_shared<nn::WeightsStorage>(2u * accumulatorSize, 1, nn::NumVariants);
-    m_lastLayerWeights->m_weightsRange = (float)std::numeric_limits<nn::LastLayerWeightType>::max() / nn::OutputLayerWeightQuantizationScale;
+    if (cMultiLayerNetwork)
+    {
+        m_hiddenLayer1Weights = std::make_shared<nn::WeightsStorage>(2u * accumulatorSize, cHiddenLayer1Size, 1);
+        m_hiddenLayer1Weights->m_weightsRange = (float)std::numeric_limits<nn::HiddenLayerWeightType>::max() / nn::HiddenLayerWeightQuantizationScale;
+        m_hiddenLayer1Weights->m_biasRange = (float)std::numeric_limits<nn::HiddenLayerBiasType>::max() / nn::HiddenLayerBiasQuantizationScale;
+        m_hiddenLayer1Weights->Init(2u * accumulatorSize);
+
+        m_hiddenLayer2Weights = std::make_shared<nn::WeightsStorage>(cHiddenLayer1Size, cHiddenLayer2Size, 1);
+        m_hiddenLayer2Weights->m_weightsRange = (float)std::numeric_limits<nn::HiddenLayerWeightType>::max() / nn::HiddenLayerWeightQuantizationScale;
+        m_hiddenLayer2Weights->m_biasRange = (float)std::numeric_limits<nn::HiddenLayerBiasType>::max() / nn::HiddenLayerBiasQuantizationScale;
+        m_hiddenLayer2Weights->Init(cHiddenLayer1Size);
+    }
+
+    m_lastLayerWeights = std::make_shared<nn::WeightsStorage>(lastLayerInputs, 1, nn::NumVariants);
+    m_lastLayerWeights->m_weightsRange = (float)std::numeric_limits<nn::LastLayerWeightType>::max() /
+        (cMultiLayerNetwork ? nn::HiddenOutputLayerWeightQuantizationScale : nn::OutputLayerWeightQuantizationScale);
     m_lastLayerWeights->m_biasRange = (float)std::numeric_limits<nn::LastLayerBiasType>::max() / nn::OutputLayerBiasQuantizationScale;
-    m_lastLayerWeights->Init(2 * nn::AccumulatorSize);
+    m_lastLayerWeights->Init(lastLayerInputs);
 
     nn::NodePtr inputNodeA = std::make_shared<nn::SparseBinaryInputNode>(networkInputs, accumulatorSize, m_featureTransformerWeights);
     nn::NodePtr inputNodeB = std::make_shared<nn::SparseBinaryInputNode>(networkInputs, accumulatorSize, m_featureTransformerWeights);
     nn::NodePtr concatenationNode = std::make_shared<nn::ConcatenationNode>(inputNodeA, inputNodeB);
     nn::NodePtr activationNode = std::make_shared<nn::ActivationNode>(concatenationNode, nn::ActivationFunction::CReLU);
-    nn::NodePtr hiddenNode = std::make_shared<nn::FullyConnectedNode>(activationNode, 2u * accumulatorSize, 1, m_lastLayerWeights);
-    nn::NodePtr outputNode = std::make_shared<nn::ActivationNode>(hiddenNode, nn::ActivationFunction::Sigmoid);
 
     std::vector<nn::NodePtr> nodes =
     {
@@ -163,11 +185,31 @@ void NetworkTrainer::InitNetwork()
 
         concatenationNode,
         activationNode,
-        hiddenNode,
-
-        outputNode,
     };
 
+    nn::NodePtr lastLayerInputNode = activationNode;
+
+    if (cMultiLayerNetwork)
+    {
+        nn::NodePtr hiddenNode1 = std::make_shared<nn::FullyConnectedNode>(activationNode, 2u * accumulatorSize, cHiddenLayer1Size, m_hiddenLayer1Weights);
+        nn::NodePtr activationNode1 = std::make_shared<nn::ActivationNode>(hiddenNode1, nn::ActivationFunction::CReLU);
+        nn::NodePtr hiddenNode2 = std::make_shared<nn::FullyConnectedNode>(activationNode1, cHiddenLayer1Size, cHiddenLayer2Size, m_hiddenLayer2Weights);
+        nn::NodePtr activationNode2 = std::make_shared<nn::ActivationNode>(hiddenNode2, nn::ActivationFunction::CReLU);
+
+        nodes.push_back(hiddenNode1);
+        nodes.push_back(activationNode1);
+        nodes.push_back(hiddenNode2);
+        nodes.push_back(activationNode2);
+
+        lastLayerInputNode = activationNode2;
+    }
+
+    nn::NodePtr lastLayerNode = std::make_shared<nn::FullyConnectedNode>(lastLayerInputNode, lastLayerInputs, 1, m_lastLayerWeights);
+    nn::NodePtr outputNode = std::make_shared<nn::ActivationNode>(lastLayerNode, nn::ActivationFunction::Sigmoid);
+
+    nodes.push_back(lastLayerNode);
+    nodes.push_back(outputNode);
+
     m_network.Init(nodes);
     m_trainer.Init(m_network);
     m_runCtx.Init(m_network);
@@ -178,7 +220,7 @@ void NetworkTrainer::InitNetwork()
     }
 }
 
-static void PositionToTrainingEntry(const Position& pos, TrainingEntry& outEntry)
+static void AddTrainingEntry(const Position& pos, float output, TrainingSetBuffer& outSet)
 {
     ASSERT(pos.GetSideToMove() == White);
 
@@ -189,46 +231,48 @@ static void PositionToTrainingEntry(const Position& pos, TrainingEntry& outEntry
     constexpr bool useVirtualFeatures = false;
 #endif // USE_VIRTUAL_FEATURES
 
-    uint16_t whiteFeatures[maxFeatures];
-    uint32_t numWhiteFeatures = PositionToFeaturesVector<useVirtualFeatures>(pos, whiteFeatures, pos.GetSideToMove());
-    ASSERT(numWhiteFeatures <= maxFeatures);
+    TrainingSetBuffer::Entry& entry = outSet.entries.emplace_back();
+    entry.output = output;
+    entry.networkVariant = (uint16_t)GetNetworkVariant(pos);
+    entry.featuresOffset = (uint32_t)outSet.features.size();
+    VERIFY(PackPosition(pos, entry.pos));
 
-    uint16_t blackFeatures[maxFeatures];
-    uint32_t numBlackFeatures = PositionToFeaturesVector<useVirtualFeatures>(pos, blackFeatures, pos.GetSideToMove() ^ 1);
-    ASSERT(numBlackFeatures == numWhiteFeatures);
+    // features are written directly to the flat array
+    outSet.features.resize(entry.featuresOffset + 2 * maxFeatures);
+    uint16_t* whiteFeatures = outSet.features.data() + entry.featuresOffset;
 
-    outEntry.whiteFeatures.clear();
-    outEntry.whiteFeatures.reserve(numWhiteFeatures);
-    for (uint32_t i = 0; i < numWhiteFeatures; ++i)
-        outEntry.whiteFeatures.emplace_back(whiteFeatures[i]);
+    const uint32_t numWhiteFeatures = PositionToFeaturesVector<useVirtualFeatures>(pos, whiteFeatures, pos.GetSideToMove());
+    ASSERT(numWhiteFeatures <= maxFeatures);
 
-    outEntry.blackFeatures.clear();
-    outEntry.blackFeatures.reserve(numBlackFeatures);
-    for (uint32_t i = 0; i < numBlackFeatures; ++i)
-        outEntry.blackFeatures.emplace_back(blackFeatures[i]);
+    const uint32_t numBlackFeatures = PositionToFeaturesVector<useVirtualFeatures>(pos, whiteFeatures + numWhiteFeatures, pos.GetSideToMove() ^ 1);
+    ASSERT(numBlackFeatures == numWhiteFeatures);
+    (void)numBlackFeatures;
 
-    outEntry.networkVariant = GetNetworkVariant(pos);
+    entry.numFeatures = (uint16_t)numWhiteFeatures;
+    outSet.features.resize(entry.featuresOffset + 2 * numWhiteFeatures);
 }
 
-static void TrainingEntryToNetworkInput(const TrainingEntry& entry, nn::InputDesc& inputDesc)
+static void TrainingEntryToNetworkInput(const TrainingSetBuffer& set, const TrainingSetBuffer::Entry& entry, nn::InputDesc& inputDesc)
 {
     inputDesc.variant = entry.networkVariant;
 
     inputDesc.inputs[0].mode = nn::InputMode::SparseBinary;
-    inputDesc.inputs[0].binaryFeatures = entry.whiteFeatures.data();
-    inputDesc.inputs[0].numFeatures = static_cast<uint32_t>(entry.whiteFeatures.size());
+    inputDesc.inputs[0].binaryFeatures = set.GetWhiteFeatures(entry);
+    inputDesc.inputs[0].numFeatures = entry.numFeatures;
 
     inputDesc.inputs[1].mode = nn::InputMode::SparseBinary;
-    inputDesc.inputs[1].binaryFeatures = entry.blackFeatures.data();
-    inputDesc.inputs[1].numFeatures = static_cast<uint32_t>(entry.blackFeatures.size());
+    inputDesc.inputs[1].binaryFeatures = set.GetBlackFeatures(entry);
+    inputDesc.inputs[1].numFeatures = entry.numFeatures;
 }
 
-bool NetworkTrainer::GenerateTrainingSet(std::vector<TrainingEntry>& outEntries, uint64_t kingBucketMask, float baseLambda)
+bool NetworkTrainer::GenerateTrainingSet(TrainingSetBuffer& outSet, uint32_t numEntries, uint64_t kingBucketMask, float baseLambda)
 {
     Position pos;
     PositionEntry entry;
 
-    for (uint32_t i = 0; i < cNumTrainingVectorsPerIteration; ++i)
+    outSet.Clear();
+
+    for (uint32_t i = 0; i < numEntries; ++i)
     {
         if (!m_dataLoader.FetchNextPosition(m_randomGenerator, entry, pos, kingBucketMask))
             return false;
@@ -267,9 +311,7 @@ bool NetworkTrainer::GenerateTrainingSet(std::vector<TrainingEntry>& outEntries,
             score = std::lerp(wdlScore, score, tbLambda);
         }
 
-        PositionToTrainingEntry(pos, outEntries[i]);
-        outEntries[i].output = score;
-        outEntries[i].pos = pos;
+        AddTrainingEntry(pos, score, outSet);
     }
 
     return true;
@@ -286,33 +328,36 @@ static void ParallelFor(const char* debugName, uint32_t arraySize, const threadp
 }
 
 #ifdef USE_PACKED_NET
-static float EvalPackedNetwork(const TrainingEntry& entry, const nn::PackedNeuralNetwork& net)
+static float EvalPackedNetwork(const TrainingSetBuffer& set, const TrainingSetBuffer::Entry& entry, const nn::PackedNeuralNetwork& net)
 {
+    const uint16_t* whiteFeatures = set.GetWhiteFeatures(entry);
+    const uint16_t* blackFeatures = set.GetBlackFeatures(entry);
+
     uint32_t numWhiteFeatures = 0;
     uint32_t numBlackFeatures = 0;
 
     // skip virtual features
-    for (size_t i = 0; i < entry.whiteFeatures.size(); ++i)
+    for (uint32_t i = 0; i < entry.numFeatures; ++i)
     {
-        if (entry.whiteFeatures[i] >= nn::NumNetworkInputs) break;
+        if (whiteFeatures[i] >= nn::NumNetworkInputs) break;
         ++numWhiteFeatures;
     }
-    for (size_t i = 0; i < entry.blackFeatures.size(); ++i)
+    for (uint32_t i = 0; i < entry.numFeatures; ++i)
     {
-        if (entry.blackFeatures[i] >= nn::NumNetworkInputs) break;
+        if (blackFeatures[i] >= nn::NumNetworkInputs) break;
         ++numBlackFeatures;
     }
 
     const int32_t packedNetworkOutput = net.Run(
-        entry.whiteFeatures.data(), numWhiteFeatures,
-        entry.blackFeatures.data(), numBlackFeatures,
+        whiteFeatures, numWhiteFeatures,
+        blackFeatures, numBlackFeatures,
         entry.networkVariant);
     const float scaledPackedNetworkOutput = (float)packedNetworkOutput / (float)(nn::OutputScale * nn::WeightScale) * c_nnOutputToCentiPawns / 100.0f;
     return EvalToExpectedGameScore(scaledPackedNetworkOutput);
 }
 #endif // USE_PACKED_NET
 
-void NetworkTrainer::Validate(size_t iteration)
+NetworkTrainer::ValidationStats NetworkTrainer::Validate()
 {
     // reset stats
     for (size_t i = 0; i < ThreadPool::GetInstance().GetNumThreads(); ++i)
@@ -327,18 +372,21 @@ void NetworkTrainer::Validate(size_t iteration)
         {
             ValidationPerThreadData& threadData = m_validationPerThreadData[ctx.threadId];
 
-            const TrainingEntry& entry = m_validationSet[i];
+            const TrainingSetBuffer::Entry& entry = m_validationSet.entries[i];
 
             const float expectedValue = entry.output;
 
-            const ScoreType evalValue = Evaluate(entry.pos);
+            Position pos;
+            VERIFY(UnpackPosition(entry.pos, pos, false));
+
+            const ScoreType evalValue = Evaluate(pos);
 
 #ifdef USE_PACKED_NET
-            const float nnPackedValue = EvalPackedNetwork(entry, m_packedNet);
+            const float nnPackedValue = EvalPackedNetwork(m_validationSet, entry, m_packedNet);
 #endif // USE_PACKED_NET
 
             nn::InputDesc inputDesc;
-            TrainingEntryToNetworkInput(entry, inputDesc);
+            TrainingEntryToNetworkInput(m_validationSet, entry, inputDesc);
 
             const nn::Values& networkOutput = m_network.Run(inputDesc, threadData.networkRunContext);
             const float nnValue = networkOutput[0];
@@ -346,7 +394,7 @@ void NetworkTrainer::Validate(size_t iteration)
             if (i + 1 == cNumValidationVectorsPerIteration)
             {
                 std::cout
-                    << entry.pos.ToFEN() << std::endl << entry.pos.Print() << std::endl
+                    << pos.ToFEN() << std::endl << pos.Print() << std::endl
                     << "True Score:     " << expectedValue << " (" << ExpectedGameScoreToInternalEval(expectedValue) << ")" << std::endl
                     << "NN eval:        " << nnValue << " (" << ExpectedGameScoreToInternalEval(nnValue) << ")" << std::endl
 #ifdef USE_PACKED_NET
@@ -444,20 +492,23 @@ void NetworkTrainer::Validate(size_t iteration)
             "8/8/8/p7/K5R1/1n6/1k1r4/8 w - - 0 1", // should be 0
         };
 
+        TrainingSetBuffer testSet;
+
         for (const char* testPosition : s_testPositions)
         {
             Position pos(testPosition);
 
-            TrainingEntry entry;
-            PositionToTrainingEntry(pos, entry);
+            testSet.Clear();
+            AddTrainingEntry(pos, 0.0f, testSet);
+            const TrainingSetBuffer::Entry& entry = testSet.entries.front();
 
             nn::InputDesc inputDesc;
-            TrainingEntryToNetworkInput(entry, inputDesc);
+            TrainingEntryToNetworkInput(testSet, entry, inputDesc);
 
             const float nnValue = m_network.Run(inputDesc, m_runCtx)[0];
 
 #ifdef USE_PACKED_NET
-            const float scaledPackedNetworkOutput = EvalPackedNetwork(entry, m_packedNet);
+            const float scaledPackedNetworkOutput = EvalPackedNetwork(testSet, entry, m_packedNet);
 #endif // USE_PACKED_NET
 
             std::cout
@@ -470,15 +521,9 @@ void NetworkTrainer::Validate(size_t iteration)
         }
     }
 
-    m_trainingLog
-        << iteration << "\t"
-        << stats.nnErrorSum
-#ifdef USE_PACKED_NET
-        << "\t" << stats.nnPackedErrorSum
-#endif // USE_PACKED_NET
-        << std::endl;
-
     m_network.PrintStats();
+
+    return stats;
 }
 
 template<typename WeightType, typename BiasType>
@@ -533,13 +578,52 @@ static void UnpackWeights(nn::Values& outWeights, uint32_t numInputs, uint32_t n
     }
 }
 
+// hidden layer weights are stored in groups of 4 consecutive inputs for each output (see LinearLayer_Sparse)
+static void PackHiddenLayerWeights(const nn::Values& weights, uint32_t numInputs, uint32_t numOutputs, nn::HiddenLayerWeightType* outWeights, nn::HiddenLayerBiasType* outBiases)
+{
+    ASSERT(numInputs % 4 == 0);
+
+    std::vector<nn::HiddenLayerWeightType> transposedWeights((size_t)numInputs * numOutputs);
+    PackWeights(weights, numInputs, numOutputs, transposedWeights.data(), outBiases, nn::HiddenLayerWeightQuantizationScale, nn::HiddenLayerBiasQuantizationScale, true);
+
+    for (uint32_t j = 0; j < numInputs; j++)
+    {
+        for (uint32_t i = 0; i < numOutputs; i++)
+        {
+            outWeights[(j / 4) * 4 * numOutputs + 4 * i + (j % 4)] = transposedWeights[numOutputs * j + i];
+        }
+    }
+}
+
+static void UnpackHiddenLayerWeights(nn::Values& outWeights, uint32_t numInputs, uint32_t numOutputs, const nn::HiddenLayerWeightType* weights, const nn::HiddenLayerBiasType* biases)
+{
+    ASSERT(numInputs % 4 == 0);
+
+    std::vector<nn::HiddenLayerWeightType> transposedWeights((size_t)numInputs * numOutputs);
+    for (uint32_t j = 0; j < numInputs; j++)
+    {
+        for (uint32_t i = 0; i < numOutputs; i++)
+        {
+            transposedWeights[numOutputs * j + i] = weights[(j / 4) * 4 * numOutputs + 4 * i + (j % 4)];
+        }
+    }
+
+    UnpackWeights(outWeights, numInputs, numOutputs, transposedWeights.data(), biases, nn::HiddenLayerWeightQuantizationScale, nn::HiddenLayerBiasQuantizationScale, true);
+}
+
 bool NetworkTrainer::PackNetwork()
 {
     {
-        const std::vector<uint32_t> layerSizes = { nn::NumNetworkInputs, 2u * nn::AccumulatorSize };
-        const std::vector<uint32_t> layerVariants = { 1, nn::NumVariants };
+        std::vector<uint32_t> layerSizes = { nn::NumNetworkInputs, 2u * nn::AccumulatorSize };
+        std::vector<uint32_t> layerVariants = { 1, nn::NumVariants };
+        if (cMultiLayerNetwork)
+        {
+            layerSizes = { nn::NumNetworkInputs, 2u * nn::AccumulatorSize, cHiddenLayer1Size, cHiddenLayer2Size };
+            layerVariants = { 1, 1, 1, nn::NumVariants };
+        }
+        const uint32_t version = cInt8FeatureTransformer ? nn::Int8FeatureTransformerVersion : nn::CurrentVersion;
 
-        if (!m_packedNet.Resize(layerSizes, layerVariants))
+        if (!m_packedNet.Resize(layerSizes, layerVariants, version))
         {
             return false;
         }
@@ -550,7 +634,7 @@ bool NetworkTrainer::PackNetwork()
 #ifdef USE_VIRTUAL_FEATURES
         nn::Values weights((nn::NumNetworkInputs + 1u) * nn::AccumulatorSize, 0.0f);
 
-        const nn::Values& originalWeights = m_featureTransformerWeights->m_variants.front().m_weights;
+        const nn::Values& originalWeights = m_featureTransformerWeights->m_variants.front().GetRunWeights();
 
         // distribute weights of virtual features to all king buckets
         for (uint32_t kingBucket = 0; kingBucket < nn::NumKingBuckets; ++kingBucket)
@@ -573,22 +657,55 @@ bool NetworkTrainer::PackNetwork()
                 originalWeights[accumIndex + (nn::NumNetworkInputs + 12 * 64) * nn::AccumulatorSize];
         }
 #else // !USE_VIRTUAL_FEATURES
-        const nn::Values weights = m_featureTransformerWeights->m_variants.front().m_weights;
+        // already rounded to the quantization grid if quantization-aware training is enabled
+        const nn::Values weights = m_featureTransformerWeights->m_variants.front().GetRunWeights();
 #endif // USE_VIRTUAL_FEATURES
 
-        PackWeights(
-            weights,
-            nn::NumNetworkInputs,
-            nn::AccumulatorSize,
-            const_cast<nn::FirstLayerWeightType*>(m_packedNet.GetAccumulatorWeights()),
-            const_cast<nn::FirstLayerBiasType*>(m_packedNet.GetAccumulatorBiases()),
-            nn::InputLayerWeightQuantizationScale,
-            nn::InputLayerBiasQuantizationScale,
-            true);
+        if (m_packedNet.HasInt8FeatureTransformer())
+        {
+            PackWeights(
+                weights,
+                nn::NumNetworkInputs,
+                nn::AccumulatorSize,
+                const_cast<nn::FirstLayerInt8WeightType*>(m_packedNet.GetAccumulatorInt8Weights()),
+                const_cast<nn::FirstLayerBiasType*>(m_packedNet.GetAccumulatorBiases()),
+                nn::InputLayerInt8WeightQuantizationScale,
+                nn::InputLayerBiasQuantizationScale,
+                true);
+        }
+        else
+        {
+            PackWeights(
+                weights,
+                nn::NumNetworkInputs,
+                nn::AccumulatorSize,
+                const_cast<nn::FirstLayerWeightType*>(m_packedNet.GetAccumulatorWeights()),
+                const_cast<nn::FirstLayerBiasType*>(m_packedNet.GetAccumulatorBiases()),
+                nn::InputLayerWeightQuantizationScale,
+                nn::InputLayerBiasQuantizationScale,
+                true);
+        }
+    }
+
+    // hidden layers
+    if (cMultiLayerNetwork)
+    {
+        PackHiddenLayerWeights(
+            m_hiddenLayer1Weights->m_variants.front().m_weights,
+            m_hiddenLayer1Weights->m_inputSize,
+            m_hiddenLayer1Weights->m_outputSize,
+            const_cast<nn::HiddenLayerWeightType*>(m_packedNet.GetLayerWeights<nn::HiddenLayerWeightType>(1, 0)),
+            const_cast<nn::HiddenLayerBiasType*>(m_packedNet.GetLayerBiases<nn::HiddenLayerBiasType>(1, 0)));
+        PackHiddenLayerWeights(
+            m_hiddenLayer2Weights->m_variants.front().m_weights,
+            m_hiddenLayer2Weights->m_inputSize,
+            m_hiddenLayer2Weights->m_outputSize,
+            const_cast<nn::HiddenLayerWeightType*>(m_packedNet.GetLayerWeights<nn::HiddenLayerWeightType>(2, 0)),
+            const_cast<nn::HiddenLayerBiasType*>(m_packedNet.GetLayerBiases<nn::HiddenLayerBiasType>(2, 0)));
     }
 
     // last layer
-    const uint32_t lastLayerIndex = 1;
+    const uint32_t lastLayerIndex = cMultiLayerNetwork ? 3 : 1;
     for (uint32_t variantIdx = 0; variantIdx < nn::NumVariants; ++variantIdx)
     {
         PackWeights(
@@ -597,7 +714,7 @@ bool NetworkTrainer::PackNetwork()
             1u,
             const_cast<nn::LastLayerWeightType*>(m_packedNet.GetLayerWeights<nn::LastLayerWeightType>(lastLayerIndex, variantIdx)),
             const_cast<nn::LastLayerBiasType*>(m_packedNet.GetLayerBiases<nn::LastLayerBiasType>(lastLayerIndex, variantIdx)),
-            nn::OutputLayerWeightQuantizationScale,
+            cMultiLayerNetwork ? nn::HiddenOutputLayerWeightQuantizationScale : nn::OutputLayerWeightQuantizationScale,
             nn::OutputLayerBiasQuantizationScale,
             false);
     }
@@ -618,6 +735,19 @@ bool NetworkTrainer::UnpackNetwork()
     constexpr float OldOutputLayerBiasQuantizationScale = OldWeightScale * OldOutputScale;
 
     // feature transformer
+    if (m_packedNet.HasInt8FeatureTransformer())
+    {
+        UnpackWeights(
+            m_featureTransformerWeights->m_variants.front().m_weights,
+            nn::NumNetworkInputs,
+            nn::AccumulatorSize,
+            m_packedNet.GetAccumulatorInt8Weights(),
+            m_packedNet.GetAccumulatorBiases(),
+            nn::InputLayerInt8WeightQuantizationScale,
+            OldInputLayerBiasQuantizationScale,
+            true);
+    }
+    else
     {
         UnpackWeights(
             m_featureTransformerWeights->m_variants.front().m_weights,
@@ -629,9 +759,35 @@ bool NetworkTrainer::UnpackNetwork()
             OldInputLayerBiasQuantizationScale,
             true);
     }
+    m_featureTransformerWeights->UpdateQuantizedWeights();
+
+    // hidden and last layers are kept freshly initialized if loaded network has different topology
+    const bool hasHiddenLayers = m_packedNet.GetLayerSize(2) != 0;
+    if (hasHiddenLayers != cMultiLayerNetwork ||
+        (cMultiLayerNetwork && (m_packedNet.GetLayerSize(2) != cHiddenLayer1Size || m_packedNet.GetLayerSize(3) != cHiddenLayer2Size)))
+    {
+        std::cout << "Packed network topology differs, only feature transformer weights were loaded" << std::endl;
+        return true;
+    }
+
+    if (cMultiLayerNetwork)
+    {
+        UnpackHiddenLayerWeights(
+            m_hiddenLayer1Weights->m_variants.front().m_weights,
+            m_hiddenLayer1Weights->m_inputSize,
+            m_hiddenLayer1Weights->m_outputSize,
+            m_packedNet.GetLayerWeights<nn::HiddenLayerWeightType>(1, 0),
+            m_packedNet.GetLayerBiases<nn::HiddenLayerBiasType>(1, 0));
+        UnpackHiddenLayerWeights(
+            m_hiddenLayer2Weights->m_variants.front().m_weights,
+            m_hiddenLayer2Weights->m_inputSize,
+            m_hiddenLayer2Weights->m_outputSize,
+            m_packedNet.GetLayerWeights<nn::HiddenLayerWeightType>(2, 0),
+            m_packedNet.GetLayerBiases<nn::HiddenLayerBiasType>(2, 0));
+    }
 
     // last layer
-    const uint32_t lastLayerIndex = 1;
+    const uint32_t lastLayerIndex = cMultiLayerNetwork ? 3 : 1;
     for (uint32_t variantIdx = 0; variantIdx < nn::NumVariants; ++variantIdx)
     {
         UnpackWeights(
@@ -640,7 +796,7 @@ bool NetworkTrainer::UnpackNetwork()
             1u,
             m_packedNet.GetLayerWeights<nn::LastLayerWeightType>(lastLayerIndex, variantIdx),
             m_packedNet.GetLayerBiases<nn::LastLayerBiasType>(lastLayerIndex, variantIdx),
-            OldOutputLayerWeightQuantizationScale,
+            cMultiLayerNetwork ? nn::HiddenOutputLayerWeightQuantizationScale : OldOutputLayerWeightQuantizationScale,
             OldOutputLayerBiasQuantizationScale,
             false);
     }
@@ -682,7 +838,10 @@ bool NetworkTrainer::Train()
     uint64_t kingBucketMask = UINT64_MAX;
     m_featureTransformerWeights->m_updateWeights = false; // freeze feature transformer weights
 
-    GenerateTrainingSet(m_validationSet, kingBucketMask, maxLambda);
+    GenerateTrainingSet(m_validationSet, cNumValidationVectorsPerIteration, kingBucketMask, maxLambda);
+
+    // set consumed by the current iteration, the other one is filled in the background
+    uint32_t currentSetIndex = 0;
 
     size_t epoch = 0;
     for (size_t iteration = 0; iteration < cMaxIterations; ++iteration)
@@ -693,7 +852,7 @@ bool NetworkTrainer::Train()
 
         if (iteration == 0)
         {
-            if (!GenerateTrainingSet(m_trainingSet, kingBucketMask, lambda))
+            if (!GenerateTrainingSet(m_trainingSets[currentSetIndex], cNumTrainingVectorsPerIteration, kingBucketMask, lambda))
                 return false;
         }
 
@@ -701,30 +860,44 @@ bool NetworkTrainer::Train()
         float iterationTime = (iterationStartTime - prevIterationStartTime).ToSeconds();
         prevIterationStartTime = iterationStartTime;
 
-        // use validation set from previous iteration as training set in the current one
-        ParallelFor("PrepareBatch", cNumTrainingVectorsPerIteration, [&batch, this](const TaskContext&, uint32_t i)
+        const TrainingSetBuffer& trainingSet = m_trainingSets[currentSetIndex];
+        TrainingSetBuffer& nextTrainingSet = m_trainingSets[currentSetIndex ^ 1];
+
+        // generate set for the next iteration in the background, while training and validating on the current one
+        Waitable generateWaitable;
+        bool generateSuccess = false;
+        float generateTime = 0.0f;
         {
-            m_trainingSetCopy[i] = m_trainingSet[i];
+            TaskBuilder taskBuilder{ generateWaitable };
+            taskBuilder.Task("GenerateSet", [&](const TaskContext&)
+            {
+                const TimePoint startTime = TimePoint::GetCurrent();
+                generateSuccess = GenerateTrainingSet(nextTrainingSet, cNumTrainingVectorsPerIteration, kingBucketMask, lambda);
+                generateTime = (TimePoint::GetCurrent() - startTime).ToSeconds();
+            });
+        }
 
-            const TrainingEntry& entry = m_trainingSetCopy[i];
+        TimePoint stageStartTime = TimePoint::GetCurrent();
+
+        ParallelFor("PrepareBatch", cNumTrainingVectorsPerIteration, [&batch, &trainingSet](const TaskContext&, uint32_t i)
+        {
+            const TrainingSetBuffer::Entry& entry = trainingSet.entries[i];
 
             nn::TrainingVector& trainingVector = batch[i];
-            trainingVector.input.variant = entry.networkVariant;
             trainingVector.output.mode = nn::OutputMode::Single;
             trainingVector.output.singleValue = entry.output;
 
-            TrainingEntryToNetworkInput(entry, trainingVector.input);
+            TrainingEntryToNetworkInput(trainingSet, entry, trainingVector.input);
         });
 
-        // validation vectors generation can be done in parallel with training
-        Waitable waitable;
-        {
-            TaskBuilder taskBuilder{ waitable };
-            taskBuilder.Task("GenerateSet", [&](const TaskContext&)
-            {
-                GenerateTrainingSet(m_trainingSet, kingBucketMask, lambda);
-            });
+        SortBatchesByKingBucket(batch, cBatchSize);
+
+        const float prepareTime = (TimePoint::GetCurrent() - stageStartTime).ToSeconds();
+        stageStartTime = TimePoint::GetCurrent();
 
+        Waitable trainWaitable;
+        {
+            TaskBuilder taskBuilder{ trainWaitable };
             taskBuilder.Task("Train", [this, kingBucketMask, &epoch, &batch, learningRate](const TaskContext& ctx)
             {
                 nn::TrainParams params;
@@ -733,6 +906,7 @@ bool NetworkTrainer::Train()
                 params.batchSize = cBatchSize;
                 params.learningRate = learningRate;
                 params.weightDecay = g_weightDecay;
+                params.reductionShardSize = cGradientReductionShardSize;
 
                 if (kingBucketMask != UINT64_MAX)
                 {
@@ -758,7 +932,9 @@ bool NetworkTrainer::Train()
                 epoch += m_trainer.Train(m_network, batch, params, &taskBuilder);
             });
         }
-        waitable.Wait();
+        trainWaitable.Wait();
+
+        const float trainTime = (TimePoint::GetCurrent() - stageStartTime).ToSeconds();
 
 #ifdef USE_PACKED_NET
         PackNetwork();
@@ -774,16 +950,53 @@ bool NetworkTrainer::Train()
             << "Num training vectors:   " << std::setprecision(3) << m_numTrainingVectorsPassed / 1.0e9f << "B" << std::endl
             << "Learning rate:          " << learningRate << std::endl;
 
-        Validate(iteration);
+        stageStartTime = TimePoint::GetCurrent();
+        const ValidationStats stats = Validate();
+        const float validateTime = (TimePoint::GetCurrent() - stageStartTime).ToSeconds();
+
+        // time spent waiting for the producer means training is starved of data
+        stageStartTime = TimePoint::GetCurrent();
+        generateWaitable.Wait();
+        const float stallTime = (TimePoint::GetCurrent() - stageStartTime).ToSeconds();
+
+        if (!generateSuccess)
+            return false;
+
+        currentSetIndex ^= 1;
 
         std::cout << "Iteration time:   " << 1000.0f * iterationTime << " ms" << std::endl;
-        std::cout << "Training rate :   " << ((float)cNumTrainingVectorsPerIteration / iterationTime) << " pos/sec" << std::endl << std::endl;
+        std::cout << "Training rate :   " << ((float)cNumTrainingVectorsPerIteration / iterationTime) << " pos/sec" << std::endl;
+        std::cout << "Stage times:      generate " << 1000.0f * generateTime << " ms, prepare " << 1000.0f * prepareTime << " ms, train "
+            << 1000.0f * trainTime << " ms, validate " << 1000.0f * validateTime << " ms, stall " << 1000.0f * stallTime << " ms" << std::endl << std::endl;
+
+        // iteration, errors, stage times in ms
+        m_trainingLog
+            << iteration << "\t"
+            << stats.nnErrorSum
+#ifdef USE_PACKED_NET
+            << "\t" << stats.nnPackedErrorSum
+#endif // USE_PACKED_NET
+            << "\t" << 1000.0f * generateTime
+            << "\t" << 1000.0f * prepareTime
+            << "\t" << 1000.0f * trainTime
+            << "\t" << 1000.0f * validateTime
+            << "\t" << 1000.0f * stallTime
+            << std::endl;
 
         // print weights stats
         {
             std::cout << "FT weights stats: ";
             m_featureTransformerWeights->PrintStats();
 
+            if (cMultiLayerNetwork)
+            {
+                std::cout << "H1 weights stats: ";
+                m_hiddenLayer1Weights->PrintStats();
+
+                std::cout << "H2 weights stats: ";
+                m_hiddenLayer2Weights->PrintStats();
+            }
+
             std::cout << "LL weights stats: ";
             m_lastLayerWeights->PrintStats();
         }
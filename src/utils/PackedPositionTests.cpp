@@ -1,8 +1,10 @@
+#include "CompressedTrainingData.hpp"
 #include "../backend/Position.hpp"
 #include "../backend/PositionUtils.hpp"
 #include "../backend/Material.hpp"
 
 #include <iostream>
+#include <filesystem>
 
 #define TEST_EXPECT(x) \
     if (!(x)) { std::cout << "Test failed: " << #x << std::endl; DEBUG_BREAK(); }
@@ -97,4 +99,88 @@ void RunPackedPositionTests()
             TEST_EXPECT(originalPos == unpackedPos);
         }
     }
+
+    // compressed training data round trip (several full blocks and a partial one)
+    {
+        using Distr = std::uniform_int_distribution<uint32_t>;
+
+        std::mt19937 mt;
+
+        const uint32_t blockSize = 1000;
+        std::vector<PositionEntry> entries(3500);
+        for (PositionEntry& entry : entries)
+        {
+            MaterialKey key;
+            key.numWhitePawns   = Distr(0, 8)(mt);
+            key.numWhiteKnights = Distr(0, 2)(mt);
+            key.numWhiteRooks   = Distr(0, 2)(mt);
+            key.numBlackPawns   = Distr(0, 8)(mt);
+            key.numBlackBishops = Distr(0, 2)(mt);
+            key.numBlackQueens  = Distr(0, 1)(mt);
+
+            RandomPosDesc desc;
+            desc.materialKey = key;
+
+            Position pos;
+            GenerateRandomPosition(mt, desc, pos);
+            TEST_EXPECT(PackPosition(pos, entry.pos));
+
+            entry.score = (ScoreType)((int32_t)Distr(0, 2000)(mt) - 1000);
+            entry.wdlScore = (uint8_t)Distr(0, 2)(mt);
+            entry.tbScore = Distr(0, 3)(mt) == 0 ? (uint8_t)Distr(0, 2)(mt) : 0xFF;
+        }
+
+        const std::string filePath = (std::filesystem::temp_directory_path() / "caissa_compressed_training_data_test.bin").string();
+
+        {
+            FileOutputStream outputStream(filePath.c_str());
+            TEST_EXPECT(outputStream.IsOpen());
+
+            CompressedTrainingData::Writer writer(outputStream, blockSize);
+            TEST_EXPECT(writer.Write(entries.data(), entries.size()));
+            TEST_EXPECT(writer.Finish());
+        }
+
+        {
+            FileInputStream inputStream(filePath.c_str());
+            TEST_EXPECT(inputStream.IsOpen());
+            TEST_EXPECT(CompressedTrainingData::IsCompressedFile(inputStream));
+
+            CompressedTrainingData::Reader reader;
+            TEST_EXPECT(reader.Init(inputStream));
+            TEST_EXPECT(reader.GetNumEntries() == entries.size());
+            TEST_EXPECT(reader.GetNumBlocks() == 4);
+
+            std::vector<PositionEntry> decodedEntries(reader.GetMaxBlockSize());
+            size_t entryIndex = 0;
+
+            // decode blocks out of order, each of them is independent
+            for (const uint32_t blockIndex : { 2u, 0u, 3u, 1u })
+            {
+                const uint32_t numDecoded = reader.ReadBlock(inputStream, blockIndex, decodedEntries.data());
+                TEST_EXPECT(numDecoded == (blockIndex < 3 ? blockSize : 500u));
+
+                for (uint32_t i = 0; i < numDecoded; ++i)
+                {
+                    const PositionEntry& original = entries[(size_t)blockIndex * blockSize + i];
+                    const PositionEntry& decoded = decodedEntries[i];
+
+                    Position originalPos, decodedPos;
+                    TEST_EXPECT(UnpackPosition(original.pos, originalPos));
+                    TEST_EXPECT(UnpackPosition(decoded.pos, decodedPos));
+                    TEST_EXPECT(originalPos == decodedPos);
+                    TEST_EXPECT(original.score == decoded.score);
+                    TEST_EXPECT(original.wdlScore == decoded.wdlScore);
+                    TEST_EXPECT(original.tbScore == decoded.tbScore);
+                }
+
+                entryIndex += numDecoded;
+            }
+
+            TEST_EXPECT(entryIndex == entries.size());
+            TEST_EXPECT(reader.ReadBlock(inputStream, 4, decodedEntries.data()) == 0);
+        }
+
+        std::filesystem::remove(filePath);
+    }
 }
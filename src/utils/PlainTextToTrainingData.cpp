@@ -1,6 +1,7 @@
 #include "Common.hpp"
 #include "ThreadPool.hpp"
 #include "TrainerCommon.hpp"
+#include "CompressedTrainingData.hpp"
 #include "GameCollection.hpp"
 
 #include "../backend/Math.hpp"
@@ -10,21 +11,29 @@
 #include "../backend/Endgame.hpp"
 #include "../backend/Tablebase.hpp"
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 
 // converts games in plain text format <FEN> [game result] <eval>
-// to binary format
+// to binary format (optionally block-compressed)
 void PlainTextToTrainingData(const std::vector<std::string>& args)
 {
-    if (args.size() < 1)
+    const bool compress = std::find(args.begin(), args.end(), "compress") != args.end();
+
+    if (args.size() < (compress ? 2u : 1u))
     {
-        std::cout << "Usage: PrepareTrainingData <input files>" << std::endl;
+        std::cout << "Usage: PrepareTrainingData <input files> [compress]" << std::endl;
         return;
     }
 
     for (const std::string& inputPath : args)
     {
+        if (inputPath == "compress")
+        {
+            continue;
+        }
+
         std::cout << "Processing " << inputPath << std::endl;
 
         // read input file
@@ -37,8 +46,8 @@ void PlainTextToTrainingData(const std::vector<std::string>& args)
 
         // write output file
         const std::string outputPath = inputPath + ".bin";
-        std::ofstream outputFile(outputPath, std::ios::binary);
-        if (!outputFile.is_open())
+        FileOutputStream outputFile(outputPath.c_str());
+        if (!outputFile.IsOpen())
         {
             std::cout << "Failed to open output file: " << outputPath << std::endl;
             return;
@@ -132,6 +141,25 @@ void PlainTextToTrainingData(const std::vector<std::string>& args)
         }
 
         // write entries
-        outputFile.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(PositionEntry));
+        bool writeSuccess = false;
+        if (compress)
+        {
+            CompressedTrainingData::Writer writer(outputFile);
+            writeSuccess = writer.Write(entries.data(), entries.size()) && writer.Finish();
+            if (writeSuccess)
+            {
+                std::cout << "Compressed " << entries.size() * sizeof(PositionEntry) << " bytes to " << writer.GetNumWrittenBytes() << " bytes" << std::endl;
+            }
+        }
+        else
+        {
+            writeSuccess = outputFile.Write(entries.data(), entries.size() * sizeof(PositionEntry));
+        }
+
+        if (!writeSuccess)
+        {
+            std::cout << "Failed to write output file: " << outputPath << std::endl;
+            return;
+        }
     }
 }
\ No newline at end of file
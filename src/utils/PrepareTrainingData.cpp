@@ -1,6 +1,7 @@
 #include "Common.hpp"
 #include "ThreadPool.hpp"
 #include "TrainerCommon.hpp"
+#include "CompressedTrainingData.hpp"
 #include "GameCollection.hpp"
 
 #include "../backend/Math.hpp"
@@ -10,6 +11,7 @@
 #include "../backend/Endgame.hpp"
 #include "../backend/Tablebase.hpp"
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 
@@ -34,58 +36,52 @@ static bool IsPositionImbalanced(const Position& pos, ScoreType moveScore)
         (moveScore < -c_ScoreTreshold && Evaluate(pos) < -c_EvalTreshold);
 }
 
-static bool ConvertGamesToTrainingData(const std::string& inputPath, const std::string& outputPath)
+// games file is split into ranges of games, converted in parallel and concatenated in range order,
+// so the output does not depend on the number of threads
+static constexpr uint32_t c_GamesPerRange = 1024;
+
+struct ConversionJob
 {
-    std::vector<PositionEntry> entries;
-    std::vector<Move> moves;
+    std::string inputPath;
+    std::string outputPath;
+    bool compress = false;
+    std::vector<GameCollection::GameRange> ranges;
+    std::vector<std::vector<PositionEntry>> rangeEntries;
+    std::vector<uint32_t> rangeNumGames;
+};
 
-    if (std::filesystem::exists(outputPath))
-    {
-        std::unique_lock<std::mutex> lock(g_mutex);
-        std::cout << "INFO: Output training data file " << outputPath << " already exists. Skipping" << std::endl;
-        return true;
-    }
+using ConversionJobPtr = std::shared_ptr<ConversionJob>;
 
+static bool ExtractPositions(const std::string& inputPath, const GameCollection::GameRange& range, std::vector<PositionEntry>& entries, uint32_t& outNumGames)
+{
     FileInputStream gamesFile(inputPath.c_str());
-    if (!gamesFile.IsOpen())
+    if (!gamesFile.IsOpen() || !gamesFile.SetPosition(range.offset))
     {
         std::unique_lock<std::mutex> lock(g_mutex);
         std::cout << "ERROR: Failed to load selfplay data file: " << inputPath << std::endl;
         return false;
     }
 
-#ifndef OUTPUT_TEXT_FILE
-    FileOutputStream trainingDataFile(outputPath.c_str());
-    if (!trainingDataFile.IsOpen())
-    {
-        std::unique_lock<std::mutex> lock(g_mutex);
-        std::cout << "ERROR: Failed to load output training data file: " << outputPath << std::endl;
-        return false;
-    }
-#endif // OUTPUT_TEXT_FILE
-
     uint32_t numGames = 0;
-    uint32_t numPositions = 0;
 
-    Game game;
-    while (GameCollection::ReadGame(gamesFile, game, moves))
+    GameCollection::Reader reader(gamesFile);
+    for (uint32_t i = 0; i < range.numGames && reader.NextGame(); ++i)
     {
-        Game::Score gameScore = game.GetScore();
+        const Game::Score gameScore = reader.GetScore();
 
-        ASSERT(game.GetMoves().size() == game.GetMoveScores().size());
+        ASSERT(reader.HasMoveScores());
 
-        if (game.GetScore() == Game::Score::Unknown)
+        if (gameScore == Game::Score::Unknown)
         {
             continue;
         }
 
-        Position pos = game.GetInitialPosition();
-
         // replay the game
-        for (size_t i = 0; i < game.GetMoves().size(); ++i)
+        Move move;
+        ScoreType moveScore;
+        while (reader.ReadMove(move, moveScore))
         {
-            const Move move = moves[i];
-            const ScoreType moveScore = game.GetMoveScores()[i];
+            const Position& pos = reader.GetPosition();
 
             if (move.IsQuiet() &&                                               // best move must be quiet
                 pos.GetNumPieces() >= 4 &&                                      // skip known endgames
@@ -123,10 +119,9 @@ static bool ConvertGamesToTrainingData(const std::string& inputPath, const std::
                 ASSERT(normalizedPos.IsValid());
                 VERIFY(PackPosition(normalizedPos, entry.pos));
                 entries.push_back(entry);
-                numPositions++;
             }
 
-            if (!pos.DoMove(move))
+            if (!reader.DoMove())
             {
                 break;
             }
@@ -135,21 +130,47 @@ static bool ConvertGamesToTrainingData(const std::string& inputPath, const std::
         numGames++;
     }
 
+    outNumGames = numGames;
+    return true;
+}
+
+static bool WriteTrainingData(const ConversionJob& job)
+{
+    std::vector<PositionEntry> entries;
+    {
+        size_t numEntries = 0;
+        for (const std::vector<PositionEntry>& rangeEntries : job.rangeEntries)
+        {
+            numEntries += rangeEntries.size();
+        }
+        entries.reserve(numEntries);
+
+        for (const std::vector<PositionEntry>& rangeEntries : job.rangeEntries)
+        {
+            entries.insert(entries.end(), rangeEntries.begin(), rangeEntries.end());
+        }
+    }
+
     {
+        uint32_t numGames = 0;
+        for (const uint32_t rangeNumGames : job.rangeNumGames)
+        {
+            numGames += rangeNumGames;
+        }
+
         std::unique_lock<std::mutex> lock(g_mutex);
-        std::cout << "Parsed " << numGames << " games from " << inputPath << ", extracted " << numPositions << " positions" << std::endl;
+        std::cout << "Parsed " << numGames << " games from " << job.inputPath << ", extracted " << entries.size() << " positions" << std::endl;
     }
 
-    // shuffle the training data
+    // shuffle the training data (seeded by file name, so the output is reproducible)
     {
-        std::random_device rd;
-        std::mt19937 randomGenerator(rd());
+        std::mt19937 randomGenerator(static_cast<uint32_t>(std::hash<std::string>{}(job.outputPath)));
         std::shuffle(entries.begin(), entries.end(), randomGenerator);
     }
 
 #ifdef OUTPUT_TEXT_FILE
     {
-        FILE* outputTextFile = fopen(outputPath.c_str(), "w");
+        FILE* outputTextFile = fopen(job.outputPath.c_str(), "w");
 
         Position pos;
         for (const PositionEntry& entry : entries)
@@ -168,10 +189,29 @@ static bool ConvertGamesToTrainingData(const std::string& inputPath, const std::
     }
 #else // !OUTPUT_TEXT_FILE
 
-    if (!trainingDataFile.Write(entries.data(), entries.size() * sizeof(PositionEntry)))
+    FileOutputStream trainingDataFile(job.outputPath.c_str());
+    if (!trainingDataFile.IsOpen())
+    {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        std::cout << "ERROR: Failed to load output training data file: " << job.outputPath << std::endl;
+        return false;
+    }
+
+    bool writeSuccess = false;
+    if (job.compress)
+    {
+        CompressedTrainingData::Writer writer(trainingDataFile);
+        writeSuccess = writer.Write(entries.data(), entries.size()) && writer.Finish();
+    }
+    else
+    {
+        writeSuccess = trainingDataFile.Write(entries.data(), entries.size() * sizeof(PositionEntry));
+    }
+
+    if (!writeSuccess)
     {
         std::unique_lock<std::mutex> lock(g_mutex);
-        std::cout << "ERROR: Failed to write training data file: " << outputPath << std::endl;
+        std::cout << "ERROR: Failed to write training data file: " << job.outputPath << std::endl;
         return false;
     }
 
@@ -180,9 +220,53 @@ static bool ConvertGamesToTrainingData(const std::string& inputPath, const std::
     return true;
 }
 
+static void ConvertGamesToTrainingData(const std::string& inputPath, const std::string& outputPath, bool compress, const TaskContext& ctx)
+{
+    if (std::filesystem::exists(outputPath))
+    {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        std::cout << "INFO: Output training data file " << outputPath << " already exists. Skipping" << std::endl;
+        return;
+    }
+
+    ConversionJobPtr job = std::make_shared<ConversionJob>();
+    job->inputPath = inputPath;
+    job->outputPath = outputPath;
+    job->compress = compress;
+
+    {
+        FileInputStream gamesFile(inputPath.c_str());
+        if (!gamesFile.IsOpen() || !GameCollection::SplitIntoRanges(gamesFile, c_GamesPerRange, job->ranges))
+        {
+            std::unique_lock<std::mutex> lock(g_mutex);
+            std::cout << "ERROR: Failed to load selfplay data file: " << inputPath << std::endl;
+            return;
+        }
+    }
+
+    job->rangeEntries.resize(job->ranges.size());
+    job->rangeNumGames.resize(job->ranges.size(), 0);
+
+    TaskBuilder taskBuilder{ ctx };
+
+    taskBuilder.ParallelFor("ExtractPositions", static_cast<uint32_t>(job->ranges.size()), [job](const TaskContext&, uint32_t rangeIndex)
+    {
+        ExtractPositions(job->inputPath, job->ranges[rangeIndex], job->rangeEntries[rangeIndex], job->rangeNumGames[rangeIndex]);
+    });
+
+    taskBuilder.Fence();
+
+    taskBuilder.Task("WriteTrainingData", [job](const TaskContext&)
+    {
+        WriteTrainingData(*job);
+    });
+}
+
+// usage: prepareTrainingData [compress]
 void PrepareTrainingData(const std::vector<std::string>& args)
 {
-    (void)args;
+    // write block-compressed training data files instead of raw entries
+    const bool compress = std::find(args.begin(), args.end(), "compress") != args.end();
 
     const std::string gamesPath = DATA_PATH "selfplayGames/";
     const std::string trainingDataPath = DATA_PATH "trainingData/";
@@ -198,10 +282,10 @@ void PrepareTrainingData(const std::vector<std::string>& args)
                 std::cout << "Loading " << path.path().string() << "..." << std::endl;
             }
 
-            taskBuilder.Task("LoadPositions", [path, &trainingDataPath](const TaskContext&)
+            taskBuilder.Task("LoadPositions", [path, &trainingDataPath, compress](const TaskContext& ctx)
             {
                 const std::string outputPath = trainingDataPath + path.path().stem().string() + ".dat";
-                ConvertGamesToTrainingData(path.path().string().c_str(), outputPath);
+                ConvertGamesToTrainingData(path.path().string(), outputPath, compress, ctx);
             });
         }
     }
@@ -0,0 +1,132 @@
+#include "Common.hpp"
+
+#include "../backend/Position.hpp"
+#include "../backend/Game.hpp"
+#include "../backend/Search.hpp"
+#include "../backend/TranspositionTable.hpp"
+#include "../backend/Time.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+struct LatencyStats
+{
+    std::vector<float> samples;
+
+    void Print(const char* name, uint32_t numThreads)
+    {
+        std::sort(samples.begin(), samples.end());
+
+        float sum = 0.0f;
+        for (const float sample : samples) sum += sample;
+
+        const auto toMicroseconds = [](float t) { return 1.0e6f * t; };
+
+        std::cout
+            << std::setw(16) << name << " | "
+            << std::setw(3) << numThreads << " threads | "
+            << std::fixed << std::setprecision(1)
+            << "avg: " << std::setw(9) << toMicroseconds(sum / std::max<size_t>(1, samples.size())) << " us | "
+            << "median: " << std::setw(9) << toMicroseconds(samples[samples.size() / 2]) << " us | "
+            << "max: " << std::setw(9) << toMicroseconds(samples.back()) << " us" << std::endl;
+    }
+};
+
+// time from posting a task to the moment the last thread starts running it
+static void MeasureTaskStartLatency(Search& search, uint32_t numThreads, uint32_t numIterations)
+{
+    std::vector<TimePoint> threadStartTimes(numThreads);
+
+    LatencyStats stats;
+    stats.samples.reserve(numIterations);
+
+    // warm up, so worker threads are spawned
+    search.RunOnThreads(numThreads, [](uint32_t) {});
+
+    for (uint32_t i = 0; i < numIterations; ++i)
+    {
+        // let workers go idle, like between two "go" commands
+        if (i % 16 == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        const TimePoint startTime = TimePoint::GetCurrent();
+        search.RunOnThreads(numThreads, [&threadStartTimes](uint32_t threadIndex)
+        {
+            threadStartTimes[threadIndex] = TimePoint::GetCurrent();
+        });
+
+        float maxLatency = 0.0f;
+        for (const TimePoint& threadStartTime : threadStartTimes)
+        {
+            maxLatency = std::max(maxLatency, (threadStartTime - startTime).ToSeconds());
+        }
+        stats.samples.push_back(maxLatency);
+    }
+
+    stats.Print("go -> searching", numThreads);
+}
+
+// time from raising stop flag to search returning the best move
+static void MeasureStopLatency(Search& search, TranspositionTable& tt, uint32_t numThreads, uint32_t numIterations, uint32_t searchTimeMs)
+{
+    Game game;
+    game.Reset(Position(Position::InitPositionFEN));
+
+    LatencyStats stats;
+    stats.samples.reserve(numIterations);
+
+    for (uint32_t i = 0; i < numIterations; ++i)
+    {
+        SearchParam searchParam{ tt };
+        searchParam.debugLog = false;
+        searchParam.useRootTablebase = false;
+        searchParam.numThreads = numThreads;
+
+        TimePoint stopTime;
+        TimePoint bestMoveTime;
+
+        std::thread searchThread([&]()
+        {
+            SearchResult searchResult;
+            search.DoSearch(game, searchParam, searchResult);
+            bestMoveTime = TimePoint::GetCurrent();
+        });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(searchTimeMs));
+
+        stopTime = TimePoint::GetCurrent();
+        searchParam.stopSearch = true;
+
+        searchThread.join();
+
+        stats.samples.push_back((bestMoveTime - stopTime).ToSeconds());
+    }
+
+    stats.Print("stop -> bestmove", numThreads);
+}
+
+} // namespace
+
+void RunSearchLatencyBenchmark(const std::vector<std::string>& args)
+{
+    const uint32_t numIterations = args.size() > 0 ? std::max(1, atoi(args[0].c_str())) : 1000;
+    const uint32_t numStopIterations = args.size() > 1 ? std::max(1, atoi(args[1].c_str())) : 10;
+    const uint32_t searchTimeMs = args.size() > 2 ? std::max(1, atoi(args[2].c_str())) : 100;
+    const uint32_t threadCounts[] = { 1, 8, 64 };
+
+    TranspositionTable tt(16 * 1024 * 1024);
+
+    for (const uint32_t numThreads : threadCounts)
+    {
+        Search search;
+        MeasureTaskStartLatency(search, numThreads, numIterations);
+        MeasureStopLatency(search, tt, numThreads, numStopIterations, searchTimeMs);
+    }
+}
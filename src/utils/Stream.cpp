@@ -117,9 +117,9 @@ uint64_t FileInputStream::GetPosition() const
 bool FileInputStream::SetPosition(uint64_t offset)
 {
 #if defined(_MSC_VER)
-    return 0 != _fseeki64(mFile, offset, SEEK_SET);
+    return 0 == _fseeki64(mFile, offset, SEEK_SET);
 #else
-    return 0 != fseeko64(mFile, offset, SEEK_SET);
+    return 0 == fseeko64(mFile, offset, SEEK_SET);
 #endif
 }
 
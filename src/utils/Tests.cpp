@@ -5,6 +5,7 @@
 #include "../backend/MoveGen.hpp"
 #include "../backend/Search.hpp"
 #include "../backend/TranspositionTable.hpp"
+#include "../backend/BatchSearch.hpp"
 #include "../backend/Evaluate.hpp"
 #include "../backend/Tablebase.hpp"
 #include "../backend/Game.hpp"
@@ -150,6 +151,26 @@ static void RunPositionTests()
     {
         TEST_EXPECT(Position("rn1qkb1r/pp2pppp/5n2/3p1b2/3P4/1QN1P3/PP3PPP/R1B1KBNR b KQkq - 0 1").MirroredHorizontally() == Position("r1bkq1nr/pppp2pp/2n5/2b1p3/4P3/3P1NQ1/PPP3PP/RNBK1B1R b AHah - 0 1"));
         TEST_EXPECT(Position("rn1qkb1r/pp2pppp/5n2/3p1b2/3P4/1QN1P3/PP3PPP/R1B1KBNR b KQkq - 0 1").MirroredVertically() == Position("R1B1KBNR/PP3PPP/1QN1P3/3P4/3p1b2/5n2/pp2pppp/rn1qkb1r b AHah - 0 1"));
+
+        // piece-on-square arrays must follow the bitboards
+        const auto checkPiecesArrays = [](const Position& pos)
+        {
+            const Position reference(pos.ToFEN());
+            for (uint32_t i = 0; i < 64; ++i)
+            {
+                TEST_EXPECT(pos.Whites().pieces[i] == reference.Whites().pieces[i]);
+                TEST_EXPECT(pos.Blacks().pieces[i] == reference.Blacks().pieces[i]);
+            }
+        };
+
+        const Position pawnless("2kr4/8/1b6/8/5N2/8/6Q1/1R4K1 w - - 0 1");
+        checkPiecesArrays(pawnless.MirroredVertically());
+        checkPiecesArrays(pawnless.MirroredHorizontally());
+        {
+            Position flipped = pawnless;
+            flipped.FlipDiagonally();
+            checkPiecesArrays(flipped);
+        }
     }
 
     // king moves
@@ -968,7 +989,10 @@ static void RunPositionTests()
         //const Position pos("r2q1rk1/1Q2npp1/p1p1b2p/b2p4/2nP4/2N1PNP1/PP1B1PBP/R4RK1 w - - 0 17");
         //const Position pos("r2q1rk1/1Q2npp1/p1p1b2p/b2p4/2nP3P/2N1PNP1/PP1B1PB1/R4RK1 b - - 0 17");
         const Position pos("k2r4/4P3/8/1pP5/8/3p1q2/5PPP/KQ1B1RN1 w - b6 0 1");
-        const NodeInfo node{ pos };
+        Position nodePosition = pos;
+        NodeInfo node;
+        node.position = &nodePosition;
+        node.UpdatePositionInfo();
 
         MoveList allMoves;
         GenerateMoveList(pos, Bitboard::GetKingAttacks(pos.GetOpponentSide().GetKingSquare()), allMoves);
@@ -1388,6 +1412,69 @@ static void RunPositionTests()
             TEST_EXPECT(false == pos.GivesCheck_Approx(pos.MoveFromString("f3a8")));
         }
     }
+
+    // MakeMove / UnmakeMove
+    {
+        const auto testMakeUnmake = [](const char* fen)
+        {
+            Position pos;
+            TEST_EXPECT(pos.FromFEN(fen));
+            const Position originalPos = pos;
+
+            Threats threats;
+            pos.ComputeThreats(threats);
+
+            MoveList moves;
+            GenerateMoveList(pos, threats.allThreats, moves);
+            TEST_EXPECT(moves.Size() > 0);
+
+            for (uint32_t i = 0; i < moves.Size(); ++i)
+            {
+                const Move move = moves.GetMove(i);
+
+                Position copiedPos = originalPos;
+                NNEvaluatorContext nnContext, copiedNnContext;
+                UndoRecord undo;
+                const bool isLegal = pos.MakeMove(move, undo, nnContext);
+                TEST_EXPECT(isLegal == copiedPos.DoMove(move, copiedNnContext));
+                TEST_EXPECT(pos == copiedPos);
+                TEST_EXPECT(pos.GetHash() == copiedPos.GetHash());
+
+                if (isLegal && !pos.IsInCheck())
+                {
+                    UndoRecord nullMoveUndo;
+                    pos.MakeNullMove(nullMoveUndo);
+                    pos.UnmakeNullMove(nullMoveUndo);
+                    TEST_EXPECT(pos == copiedPos);
+                    TEST_EXPECT(pos.GetHash() == copiedPos.GetHash());
+                }
+
+                pos.UnmakeMove(move, undo);
+                TEST_EXPECT(pos == originalPos);
+                TEST_EXPECT(pos.GetHash() == originalPos.GetHash());
+                TEST_EXPECT(pos.GetPawnsHash() == originalPos.GetPawnsHash());
+                TEST_EXPECT(pos.GetNonPawnsHash(White) == originalPos.GetNonPawnsHash(White));
+                TEST_EXPECT(pos.GetNonPawnsHash(Black) == originalPos.GetNonPawnsHash(Black));
+                TEST_EXPECT(pos.GetHalfMoveCount() == originalPos.GetHalfMoveCount());
+                TEST_EXPECT(pos.GetMoveCount() == originalPos.GetMoveCount());
+            }
+        };
+
+        // castling, promotions (with captures), en passant, pinned pieces
+        testMakeUnmake(Position::InitPositionFEN);
+        testMakeUnmake("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+        testMakeUnmake("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b KQkq - 0 1");
+        testMakeUnmake("n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1");
+        testMakeUnmake("8/2p5/3p4/KP5r/1R3pPk/8/4P3/8 b - g3 0 1");
+        testMakeUnmake("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8");
+
+        // Chess960 castling with king and rook squares overlapping
+        Position::s_enableChess960 = true;
+        testMakeUnmake("1r2k1r1/pppppppp/8/8/8/8/PPPPPPPP/1R2K1R1 w GBgb - 0 1");
+        testMakeUnmake("rk4r1/pppppppp/8/8/8/8/PPPPPPPP/RK4R1 w AGag - 0 1");
+        testMakeUnmake("5rkr/8/8/8/8/8/8/5RKR w HFhf - 0 1");
+        Position::s_enableChess960 = false;
+    }
 }
 
 static void RunMaterialTests()
@@ -2210,10 +2297,12 @@ bool RunPerformanceTests(const std::vector<std::string>& paths)
 
     bool verbose = false;
 
-    std::vector<Search> searchArray{ std::thread::hardware_concurrency() };
+    BatchSearchParam batchParam;
+    batchParam.numThreads = std::thread::hardware_concurrency();
+    batchParam.transpositionTableSize = 16 * 1024 * 1024;
+    batchParam.clearBetweenJobs = true;
 
-    std::vector<TranspositionTable> ttArray;
-    ttArray.resize(std::thread::hardware_concurrency());
+    BatchSearch batchSearch(batchParam);
 
     uint32_t maxNodes = 2048;
 
@@ -2223,122 +2312,105 @@ bool RunPerformanceTests(const std::vector<std::string>& paths)
         std::atomic<uint32_t> success = 0;
         float accumTime = 0.0f;
 
-        Waitable waitable;
-        {
-            TaskBuilder taskBuilder(waitable);
+        size_t nextTestCase = 0;
 
-            for (const TestCaseEntry& testCase : testVector)
+        const auto jobSource = [&](BatchSearchJob& outJob) -> bool
+        {
+            if (nextTestCase >= testVector.size())
             {
-                taskBuilder.Task("SearchTest", [testCase, &searchArray, maxNodes, &mutex, verbose, &success, &ttArray, &accumTime](const TaskContext& ctx)
-                {
-                    Search& search = searchArray[ctx.threadId];
-                    search.Clear();
+                return false;
+            }
 
-                    TranspositionTable& tt = ttArray[ctx.threadId];
-                    if (tt.GetSize() == 0)
-                    {
-                        tt.Resize(16 * 1024 * 1024);
-                    }
-                    tt.Clear();
+            const TestCaseEntry& testCase = testVector[nextTestCase];
 
-                    const Position position(testCase.positionStr);
-                    TEST_EXPECT(position.IsValid());
+            outJob.index = nextTestCase++;
+            outJob.position = Position(testCase.positionStr);
+            outJob.maxNodes = maxNodes;
+            TEST_EXPECT(outJob.position.IsValid());
 
-                    Game game;
-                    game.Reset(position);
+            return true;
+        };
 
-                    SearchParam searchParam{ tt };
-                    searchParam.debugLog = false;
-                    searchParam.limits.maxNodes = maxNodes;
+        const auto resultSink = [&](BatchSearchResult&& result)
+        {
+            const TestCaseEntry& testCase = testVector[result.index];
+            const Position position(testCase.positionStr);
+            const SearchResult& searchResult = result.pvLines;
 
-                    const TimePoint startTimePoint = TimePoint::GetCurrent();
+            accumTime += result.searchTime;
 
-                    SearchResult searchResult;
-                    search.DoSearch(game, searchParam, searchResult);
+            Move foundMove = Move::Invalid();
+            if (!searchResult.empty() && !searchResult[0].moves.empty())
+            {
+                foundMove = searchResult[0].moves[0];
+            }
 
-                    const TimePoint endTimePoint = TimePoint::GetCurrent();
+            if (!foundMove.IsValid())
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                std::cout << "[FAILURE] No move found! position: " << testCase.positionStr << std::endl;
+                return;
+            }
 
+            const std::string foundMoveStrLAN = position.MoveToString(foundMove, MoveNotation::LAN);
+            const std::string foundMoveStrSAN = position.MoveToString(foundMove, MoveNotation::SAN);
+            bool correctMoveFound = false;
+            if (!testCase.bestMoves.empty())
+            {
+                for (const std::string& bestMoveStr : testCase.bestMoves)
+                {
+                    if (foundMoveStrLAN == bestMoveStr || foundMoveStrSAN == bestMoveStr)
                     {
-                        std::unique_lock<std::mutex> lock(mutex);
-                        accumTime += (endTimePoint - startTimePoint).ToSeconds();
+                        correctMoveFound = true;
                     }
-
-                    Move foundMove = Move::Invalid();
-                    if (!searchResult[0].moves.empty())
+                }
+            }
+            else
+            {
+                correctMoveFound = true;
+                for (const std::string& avoidMoveStr : testCase.avoidMoves)
+                {
+                    if (foundMoveStrLAN == avoidMoveStr || foundMoveStrSAN == avoidMoveStr)
                     {
-                        foundMove = searchResult[0].moves[0];
+                        correctMoveFound = false;
                     }
+                }
+            }
 
-                    if (!foundMove.IsValid())
-                    {
-                        std::unique_lock<std::mutex> lock(mutex);
-                        std::cout << "[FAILURE] No move found! position: " << testCase.positionStr << std::endl;
-                        return;
-                    }
+            if (!correctMoveFound)
+            {
+                if (verbose)
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    std::cout << "[FAILURE] Wrong move found! ";
 
-                    const std::string foundMoveStrLAN = position.MoveToString(foundMove, MoveNotation::LAN);
-                    const std::string foundMoveStrSAN = position.MoveToString(foundMove, MoveNotation::SAN);
-                    bool correctMoveFound = false;
                     if (!testCase.bestMoves.empty())
                     {
-                        for (const std::string& bestMoveStr : testCase.bestMoves)
-                        {
-                            if (foundMoveStrLAN == bestMoveStr || foundMoveStrSAN == bestMoveStr)
-                            {
-                                correctMoveFound = true;
-                            }
-                        }
-                    }
-                    else
-                    {
-                        correctMoveFound = true;
-                        for (const std::string& avoidMoveStr : testCase.avoidMoves)
-                        {
-                            if (foundMoveStrLAN == avoidMoveStr || foundMoveStrSAN == avoidMoveStr)
-                            {
-                                correctMoveFound = false;
-                            }
-                        }
+                        std::cout << "expected: ";
+                        for (const std::string& bestMoveStr : testCase.bestMoves) std::cout << bestMoveStr << " ";
                     }
-
-                    if (!correctMoveFound)
+                    else if (!testCase.avoidMoves.empty())
                     {
-                        if (verbose)
-                        {
-                            std::unique_lock<std::mutex> lock(mutex);
-                            std::cout << "[FAILURE] Wrong move found! ";
-
-                            if (!testCase.bestMoves.empty())
-                            {
-                                std::cout << "expected: ";
-                                for (const std::string& bestMoveStr : testCase.bestMoves) std::cout << bestMoveStr << " ";
-                            }
-                            else if (!testCase.avoidMoves.empty())
-                            {
-                                std::cout << "not expected: ";
-                                for (const std::string& bestMoveStr : testCase.avoidMoves) std::cout << bestMoveStr << " ";
-                            }
-
-                            std::cout << "found: " << foundMoveStrLAN << " position: " << testCase.positionStr << std::endl;
-                        }
-                        return;
+                        std::cout << "not expected: ";
+                        for (const std::string& bestMoveStr : testCase.avoidMoves) std::cout << bestMoveStr << " ";
                     }
 
-                    {
-                        if (verbose)
-                        {
-                            std::unique_lock<std::mutex> lock(mutex);
-                            std::cout << "[SUCCESS] Found valid move: " << foundMoveStrLAN << std::endl;
-                        }
-                        success++;
-                    }
-                });
+                    std::cout << "found: " << foundMoveStrLAN << " position: " << testCase.positionStr << std::endl;
+                }
+                return;
             }
 
-            //taskBuilder.Fence();
-        }
+            {
+                if (verbose)
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    std::cout << "[SUCCESS] Found valid move: " << foundMoveStrLAN << std::endl;
+                }
+                success++;
+            }
+        };
 
-        waitable.Wait();
+        batchSearch.Run(jobSource, resultSink);
 
         const float passRate = !testVector.empty() ? (float)success / (float)testVector.size() : 0.0f;
         const float factor = accumTime / passRate;
@@ -73,7 +73,7 @@ ThreadPool::ThreadPool()
     // TODO make it configurable
     InitTasksTable(TasksCapacity);
 
-    const uint32_t numThreads = std::max<uint32_t>(1, std::thread::hardware_concurrency() - 2);
+    const uint32_t numThreads = std::max<int32_t>(1, (int32_t)std::thread::hardware_concurrency() - 2);
     SpawnWorkerThreads(numThreads);
 }
 
@@ -539,9 +539,9 @@ void TaskBuilder::ParallelFor(const char* debugName, uint32_t arraySize, const P
     const uint32_t numThreads = std::thread::hardware_concurrency();
     uint32_t numTasksToSpawn = std::min(arraySize, numThreads);
 
-    if (maxThread > 1)
+    if (maxThread > 0)
     {
-        numTasksToSpawn = std::min(numThreads, maxThread);
+        numTasksToSpawn = std::min(numTasksToSpawn, maxThread);
     }
 
     struct alignas(64) ThreadData
@@ -590,11 +590,8 @@ void TaskBuilder::ParallelFor(const char* debugName, uint32_t arraySize, const P
             // consume elements assigned to each thread (starting from self)
             for (uint32_t threadDataOffset = 0; threadDataOffset < numTasksToSpawn; ++threadDataOffset)
             {
-                uint32_t threadDataIndex = context.threadId + threadDataOffset;
-                if (threadDataIndex >= numTasksToSpawn)
-                {
-                    threadDataIndex -= numTasksToSpawn;
-                }
+                // worker thread ID may exceed number of spawned tasks if the thread count is limited
+                const uint32_t threadDataIndex = (context.threadId + threadDataOffset) % numTasksToSpawn;
 
                 ThreadData& threadData = (*threadDataPtr)[threadDataIndex];
 
@@ -0,0 +1,255 @@
+#include "Common.hpp"
+
+#include "../backend/Position.hpp"
+#include "../backend/MoveGen.hpp"
+#include "../backend/NeuralNetworkEvaluator.hpp"
+#include "../backend/Time.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <limits>
+#include <vector>
+
+namespace {
+
+static const char* c_benchmarkPositions[] =
+{
+    "r1bqkb1r/pp3ppp/2n1pn2/2Pp4/3P1B2/5N2/PP1N1PPP/R2QKB1R w KQkq - 1 9",
+    "3rk2r/1bpqbp2/np1ppn1p/p5p1/2PPP3/P1N2NP1/1PQ2PBP/R1BR2K1 w k - 4 15",
+    "r4rk1/2qn1pbp/3Npnp1/p1Pb2B1/1p1P4/1P3NP1/2Q2PBP/R2R2K1 w - - 2 18",
+    "2r3k1/pp2q1pn/7p/2PRpr2/2P1p3/2B1P2P/4QPP1/5RK1 w - - 3 19",
+    "r2q1rk1/p2nbpp1/2n1b2p/1p2p3/1P1pP3/P2P1NPP/3N1PB1/1RBQ1RK1 w - - 0 14",
+    "8/1p3k2/1b1r1pp1/7p/4pP1B/PRP5/4K1PP/8 w - - 0 29",
+    "8/4kpp1/6p1/2br2P1/1p2pP2/pP2P2P/K1P1R3/2B5 w - - 4 33",
+    "1k6/5R2/1pn1q1p1/2p3p1/3p4/1P1P1Q2/1KP2P2/8 w - - 6 33",
+};
+
+// Attacks of every slider (bishop, rook, queen) of both colors, indexed by the slider's square.
+// After a move only sliders whose attack set contains one of the changed squares (or which were just placed)
+// need new magic lookups, so the table can be updated from the dirty pieces produced by Position::DoMove.
+// Pawn, knight and king attacks don't depend on occupancy and are computed in bulk.
+// Kept here for comparison only: with PEXT slider lookups it's slower than Position::ComputeThreats.
+class AttackTable
+{
+public:
+    // compute attacks of all sliders from scratch
+    void Init(const Position& pos);
+
+    // update from parent node's table, 'pos' is the position after the move described by 'nnContext'
+    // (parent and this table may be the same object)
+    void Update(const AttackTable& parent, const Position& pos, const NNEvaluatorContext& nnContext);
+
+    // same result as Position::ComputeThreats
+    void ComputeThreats(const Position& pos, Threats& outThreats) const;
+
+    // number of sliders recomputed by the last Update call
+    INLINE uint32_t GetNumUpdatedSliders() const { return mNumUpdatedSliders; }
+
+private:
+    // entries of squares without a slider are undefined
+    Bitboard mSliderAttacks[Square::NumSquares];
+    uint32_t mNumUpdatedSliders = 0;
+};
+
+void AttackTable::Init(const Position& pos)
+{
+    const Bitboard occupied = pos.Occupied();
+
+    const Bitboard bishops = pos.Whites().bishops | pos.Blacks().bishops;
+    const Bitboard rooks = pos.Whites().rooks | pos.Blacks().rooks;
+    const Bitboard queens = pos.Whites().queens | pos.Blacks().queens;
+
+    bishops.Iterate([&](uint32_t square) INLINE_LAMBDA {
+        mSliderAttacks[square] = Bitboard::GenerateBishopAttacks(Square(square), occupied); });
+    rooks.Iterate([&](uint32_t square) INLINE_LAMBDA {
+        mSliderAttacks[square] = Bitboard::GenerateRookAttacks(Square(square), occupied); });
+    queens.Iterate([&](uint32_t square) INLINE_LAMBDA {
+        mSliderAttacks[square] = Bitboard::GenerateQueenAttacks(Square(square), occupied); });
+
+    mNumUpdatedSliders = (bishops | rooks | queens).Count();
+}
+
+void AttackTable::Update(const AttackTable& parent, const Position& pos, const NNEvaluatorContext& nnContext)
+{
+    // squares which were vacated or occupied by the move and squares where a piece was placed
+    Bitboard changedSquares = 0;
+    Bitboard placedPieces = 0;
+    for (uint32_t i = 0; i < nnContext.numDirtyPieces; ++i)
+    {
+        const DirtyPiece& dirtyPiece = nnContext.dirtyPieces[i];
+        if (dirtyPiece.fromSquare.IsValid()) changedSquares |= dirtyPiece.fromSquare.GetBitboard();
+        if (dirtyPiece.toSquare.IsValid()) placedPieces |= dirtyPiece.toSquare.GetBitboard();
+    }
+    changedSquares |= placedPieces;
+
+    const Bitboard occupied = pos.Occupied();
+    const Bitboard queens = pos.Whites().queens | pos.Blacks().queens;
+    const Bitboard diagonalSliders = pos.Whites().bishops | pos.Blacks().bishops | queens;
+    const Bitboard orthogonalSliders = pos.Whites().rooks | pos.Blacks().rooks | queens;
+
+    // a slider's attack set includes its first blocker in each direction,
+    // so its attacks change only if one of the changed squares is in the set
+    // only entries of squares occupied by sliders are copied from the parent,
+    // stale parent entries of placed pieces are never used, because these are always recomputed
+    uint32_t numUpdatedSliders = 0;
+    (diagonalSliders | orthogonalSliders).Iterate([&](uint32_t index) INLINE_LAMBDA
+    {
+        const Square square(index);
+        Bitboard attacks = parent.mSliderAttacks[index];
+        if ((placedPieces & square) || (attacks & changedSquares))
+        {
+            attacks = 0;
+            if (diagonalSliders & square) attacks |= Bitboard::GenerateBishopAttacks(square, occupied);
+            if (orthogonalSliders & square) attacks |= Bitboard::GenerateRookAttacks(square, occupied);
+            numUpdatedSliders++;
+        }
+        mSliderAttacks[index] = attacks;
+    });
+
+    mNumUpdatedSliders = numUpdatedSliders;
+}
+
+void AttackTable::ComputeThreats(const Position& pos, Threats& outThreats) const
+{
+    const SidePosition& opponentSide = pos.GetOpponentSide();
+
+    Bitboard attackedByPawns = Bitboard::GetPawnsAttacks(opponentSide.pawns, pos.GetSideToMove());
+
+    Bitboard attackedByMinors = attackedByPawns |
+        Bitboard::GetKnightAttacks(opponentSide.knights);
+    opponentSide.bishops.Iterate([&](uint32_t square) INLINE_LAMBDA {
+        attackedByMinors |= mSliderAttacks[square]; });
+
+    Bitboard attackedByRooks = attackedByMinors;
+    opponentSide.rooks.Iterate([&](uint32_t square) INLINE_LAMBDA {
+        attackedByRooks |= mSliderAttacks[square]; });
+
+    Bitboard allThreats = attackedByRooks;
+    opponentSide.queens.Iterate([&](uint32_t square) INLINE_LAMBDA {
+        allThreats |= mSliderAttacks[square]; });
+    allThreats |= Bitboard::GetKingAttacks(opponentSide.GetKingSquare());
+
+    outThreats.attackedByPawns = attackedByPawns;
+    outThreats.attackedByMinors = attackedByMinors;
+    outThreats.attackedByRooks = attackedByRooks;
+    outThreats.allThreats = allThreats;
+}
+
+enum class ThreatsBenchmarkMode
+{
+    MoveGenOnly,    // baseline: move generation and DoMove only
+    Full,           // Position::ComputeThreats in every node
+    Incremental,    // AttackTable updated from parent node's table
+    Validate,       // both, compare results
+};
+
+struct ThreatsBenchmarkStats
+{
+    uint64_t nodes = 0;
+    uint64_t updatedSliders = 0;
+    uint64_t mismatches = 0;
+    uint64_t checksum = 0;
+};
+
+template<ThreatsBenchmarkMode mode>
+static void ThreatsBenchmark_Walk(const Position& pos, const AttackTable& attackTable, uint32_t depth, ThreatsBenchmarkStats& stats)
+{
+    MoveList moves;
+    GenerateMoveList(pos, Bitboard::GetKingAttacks(pos.GetOpponentSide().GetKingSquare()), moves);
+
+    for (uint32_t i = 0; i < moves.Size(); ++i)
+    {
+        Position child = pos;
+        NNEvaluatorContext nnContext;
+        if (!child.DoMove(moves.GetMove(i), nnContext))
+            continue;
+
+        AttackTable childAttackTable;
+        Threats threats = {};
+
+        if constexpr (mode == ThreatsBenchmarkMode::Full)
+        {
+            child.ComputeThreats(threats);
+        }
+        else if constexpr (mode == ThreatsBenchmarkMode::Incremental || mode == ThreatsBenchmarkMode::Validate)
+        {
+            childAttackTable.Update(attackTable, child, nnContext);
+            childAttackTable.ComputeThreats(child, threats);
+            stats.updatedSliders += childAttackTable.GetNumUpdatedSliders();
+        }
+
+        if constexpr (mode == ThreatsBenchmarkMode::Validate)
+        {
+            Threats expectedThreats;
+            child.ComputeThreats(expectedThreats);
+            if (threats.attackedByPawns != expectedThreats.attackedByPawns ||
+                threats.attackedByMinors != expectedThreats.attackedByMinors ||
+                threats.attackedByRooks != expectedThreats.attackedByRooks ||
+                threats.allThreats != expectedThreats.allThreats)
+            {
+                stats.mismatches++;
+            }
+        }
+
+        stats.nodes++;
+        stats.checksum += threats.allThreats.value ^ threats.attackedByRooks.value;
+
+        if (depth > 1)
+        {
+            ThreatsBenchmark_Walk<mode>(child, childAttackTable, depth - 1, stats);
+        }
+    }
+}
+
+template<ThreatsBenchmarkMode mode>
+static float ThreatsBenchmark_Run(uint32_t depth, ThreatsBenchmarkStats& outStats)
+{
+    const TimePoint startTimePoint = TimePoint::GetCurrent();
+
+    for (const char* testPosition : c_benchmarkPositions)
+    {
+        Position pos;
+        VERIFY(pos.FromFEN(testPosition));
+
+        AttackTable attackTable;
+        attackTable.Init(pos);
+
+        ThreatsBenchmark_Walk<mode>(pos, attackTable, depth, outStats);
+    }
+
+    return (TimePoint::GetCurrent() - startTimePoint).ToSeconds();
+}
+
+} // namespace
+
+void RunThreatsBenchmark(const std::vector<std::string>& args)
+{
+    const uint32_t depth = args.size() > 0 ? std::max(1, atoi(args[0].c_str())) : 3;
+
+    ThreatsBenchmarkStats validationStats;
+    ThreatsBenchmark_Run<ThreatsBenchmarkMode::Validate>(depth, validationStats);
+
+    // modes are interleaved and the best time of each is taken to reduce noise
+    const uint32_t numRounds = 5;
+    float baselineTime = std::numeric_limits<float>::max();
+    float fullTime = baselineTime;
+    float incrementalTime = baselineTime;
+    ThreatsBenchmarkStats stats;
+    for (uint32_t i = 0; i < numRounds; ++i)
+    {
+        baselineTime = std::min(baselineTime, ThreatsBenchmark_Run<ThreatsBenchmarkMode::MoveGenOnly>(depth, stats));
+        fullTime = std::min(fullTime, ThreatsBenchmark_Run<ThreatsBenchmarkMode::Full>(depth, stats));
+        incrementalTime = std::min(incrementalTime, ThreatsBenchmark_Run<ThreatsBenchmarkMode::Incremental>(depth, stats));
+    }
+
+    // time spent on computing threats, move generation and DoMove are excluded
+    const double nodes = (double)std::max<uint64_t>(1, validationStats.nodes);
+    const double fullNs = 1.0e9 * std::max(0.0f, fullTime - baselineTime) / nodes;
+    const double incrementalNs = 1.0e9 * std::max(0.0f, incrementalTime - baselineTime) / nodes;
+
+    printf("Nodes: %" PRIu64 " (depth %u)\n", validationStats.nodes, depth);
+    printf("Move generation only:    %.2f ns/node\n", 1.0e9 * baselineTime / nodes);
+    printf("Full threats:            %.2f ns/node\n", fullNs);
+    printf("Incremental threats:     %.2f ns/node (%.2f sliders updated per node)\n", incrementalNs, (double)validationStats.updatedSliders / nodes);
+    printf("Mismatches:              %" PRIu64 "\n", validationStats.mismatches);
+}
@@ -0,0 +1,164 @@
+#include "Common.hpp"
+#include "ThreadPool.hpp"
+#include "TrainerCommon.hpp"
+
+#include "net/Network.hpp"
+#include "net/SparseBinaryInputNode.hpp"
+#include "net/FullyConnectedNode.hpp"
+#include "net/ConcatenationNode.hpp"
+#include "net/ActivationNode.hpp"
+#include "net/WeightsStorage.hpp"
+
+#include "../backend/PackedNeuralNetwork.hpp"
+#include "../backend/Waitable.hpp"
+#include "../backend/Time.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <random>
+
+using namespace threadpool;
+
+namespace {
+
+static constexpr uint32_t NumFeaturesPerPosition = 30;
+static constexpr uint32_t NumFeaturesPerKingBucket = 12 * 64;
+
+} // namespace
+
+// measure throughput of NeuralNetworkTrainer::Train on synthetic data using the same topology as trainNetwork
+// usage: trainerBenchmark [number of batches] [batch size] [unsorted] [shard=<rows per reduction task>] [qat]
+void RunTrainerBenchmark(const std::vector<std::string>& args)
+{
+    const uint32_t numBatches = args.size() > 0 ? std::stoul(args[0]) : 16;
+    const uint32_t batchSize = args.size() > 1 ? std::stoul(args[1]) : 16 * 1024;
+
+    // "unsorted" keeps random order of training vectors inside a batch (as it was before batches were sorted by king bucket)
+    bool sortByKingBucket = true;
+    // "qat" enables quantization-aware training of 8-bit feature transformer weights
+    bool quantizationAware = false;
+    uint32_t reductionShardSize = nn::TrainParams().reductionShardSize;
+
+    for (size_t i = 2; i < args.size(); ++i)
+    {
+        if (args[i] == "unsorted")
+            sortByKingBucket = false;
+        else if (args[i].starts_with("shard="))
+            reductionShardSize = std::stoul(args[i].substr(6));
+        else if (args[i] == "qat")
+            quantizationAware = true;
+    }
+
+    const uint32_t accumulatorSize = nn::AccumulatorSize;
+    const uint32_t networkInputs = nn::NumNetworkInputs;
+
+    nn::WeightsStoragePtr featureTransformerWeights = std::make_shared<nn::WeightsStorage>(networkInputs, accumulatorSize, 1);
+    featureTransformerWeights->m_isSparse = true;
+    if (quantizationAware)
+    {
+        featureTransformerWeights->m_weightsRange = (float)std::numeric_limits<nn::FirstLayerInt8WeightType>::max() / nn::InputLayerInt8WeightQuantizationScale;
+        featureTransformerWeights->EnableQuantization(nn::InputLayerInt8WeightQuantizationScale, nn::InputLayerBiasQuantizationScale);
+    }
+    featureTransformerWeights->Init(32u, 0.0f);
+
+    nn::WeightsStoragePtr lastLayerWeights = std::make_shared<nn::WeightsStorage>(2u * accumulatorSize, 1, nn::NumVariants);
+    lastLayerWeights->Init(2 * accumulatorSize);
+
+    nn::NodePtr inputNodeA = std::make_shared<nn::SparseBinaryInputNode>(networkInputs, accumulatorSize, featureTransformerWeights);
+    nn::NodePtr inputNodeB = std::make_shared<nn::SparseBinaryInputNode>(networkInputs, accumulatorSize, featureTransformerWeights);
+    nn::NodePtr concatenationNode = std::make_shared<nn::ConcatenationNode>(inputNodeA, inputNodeB);
+    nn::NodePtr activationNode = std::make_shared<nn::ActivationNode>(concatenationNode, nn::ActivationFunction::CReLU);
+    nn::NodePtr hiddenNode = std::make_shared<nn::FullyConnectedNode>(activationNode, 2u * accumulatorSize, 1, lastLayerWeights);
+    nn::NodePtr outputNode = std::make_shared<nn::ActivationNode>(hiddenNode, nn::ActivationFunction::Sigmoid);
+
+    nn::NeuralNetwork network;
+    network.Init({ inputNodeA, inputNodeB, concatenationNode, activationNode, hiddenNode, outputNode });
+
+    nn::NeuralNetworkTrainer trainer;
+    trainer.Init(network);
+
+    // synthetic positions: features of each perspective are drawn from a single king bucket
+    std::mt19937 gen(12345);
+    std::vector<uint16_t> features(2 * (size_t)batchSize * NumFeaturesPerPosition);
+    nn::TrainingSet trainingSet(batchSize);
+    {
+        std::uniform_int_distribution<uint32_t> bucketDistr(0, nn::NumKingBuckets - 1);
+        std::uniform_int_distribution<uint32_t> featureDistr(0, NumFeaturesPerKingBucket - 1);
+        std::uniform_int_distribution<uint32_t> variantDistr(0, nn::NumVariants - 1);
+        std::uniform_real_distribution<float> outputDistr(0.0f, 1.0f);
+
+        for (uint32_t i = 0; i < batchSize; ++i)
+        {
+            nn::TrainingVector& vec = trainingSet[i];
+            vec.output.mode = nn::OutputMode::Single;
+            vec.output.singleValue = outputDistr(gen);
+            vec.input.variant = variantDistr(gen);
+
+            for (uint32_t side = 0; side < 2; ++side)
+            {
+                uint16_t* sideFeatures = features.data() + (2 * i + side) * NumFeaturesPerPosition;
+                const uint32_t bucketOffset = bucketDistr(gen) * NumFeaturesPerKingBucket;
+                for (uint32_t j = 0; j < NumFeaturesPerPosition; ++j)
+                {
+                    sideFeatures[j] = static_cast<uint16_t>(bucketOffset + featureDistr(gen));
+                }
+                std::sort(sideFeatures, sideFeatures + NumFeaturesPerPosition);
+
+                vec.input.inputs[side].mode = nn::InputMode::SparseBinary;
+                vec.input.inputs[side].binaryFeatures = sideFeatures;
+                vec.input.inputs[side].numFeatures = NumFeaturesPerPosition;
+            }
+        }
+
+        if (sortByKingBucket)
+        {
+            SortBatchesByKingBucket(trainingSet, batchSize);
+        }
+    }
+
+    nn::TrainParams params;
+    params.optimizer = nn::Optimizer::Adam;
+    params.batchSize = batchSize;
+    params.learningRate = 0.001f;
+    params.reductionShardSize = reductionShardSize;
+
+    const uint32_t numThreads = ThreadPool::GetInstance().GetNumThreads();
+
+    const auto runBatch = [&](size_t iteration)
+    {
+        params.iteration = iteration;
+
+        Waitable waitable;
+        {
+            TaskBuilder taskBuilder{ waitable };
+            taskBuilder.Task("Train", [&](const TaskContext& ctx)
+            {
+                TaskBuilder taskBuilder{ ctx };
+                trainer.Train(network, trainingSet, params, &taskBuilder);
+            });
+        }
+        waitable.Wait();
+    };
+
+    // warm up (touches all gradient and moment buffers)
+    runBatch(0);
+
+    const TimePoint startTime = TimePoint::GetCurrent();
+
+    for (uint32_t i = 0; i < numBatches; ++i)
+    {
+        runBatch(i + 1);
+    }
+
+    const float time = (TimePoint::GetCurrent() - startTime).ToSeconds();
+    const double positionsPerSecond = (double)numBatches * batchSize / std::max(time, 0.001f);
+
+    std::cout
+        << "Threads: " << numThreads << std::endl
+        << "Reduction shard size: " << reductionShardSize << " rows" << std::endl
+        << "Batches: " << numBatches << " x " << batchSize << (sortByKingBucket ? "" : " (unsorted)") << (quantizationAware ? " (quantization-aware)" : "") << std::endl
+        << "Time: " << std::fixed << std::setprecision(3) << time << " s" << std::endl
+        << "Positions/s: " << (uint64_t)positionsPerSecond << std::endl
+        << "Positions/s per core: " << (uint64_t)(positionsPerSecond / numThreads) << std::endl;
+}
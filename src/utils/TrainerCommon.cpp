@@ -1,15 +1,57 @@
 #include "Common.hpp"
 #include "ThreadPool.hpp"
 #include "TrainerCommon.hpp"
+#include "CompressedTrainingData.hpp"
 
 #include "../backend/Math.hpp"
 #include "../backend/Evaluate.hpp"
 #include "../backend/NeuralNetworkEvaluator.hpp"
+#include "../backend/PackedNeuralNetwork.hpp"
 
+#include <algorithm>
 #include <filesystem>
 
 static_assert(sizeof(PositionEntry) == 32, "Invalid PositionEntry size");
 
+void SortBatchesByKingBucket(nn::TrainingSet& trainingSet, uint32_t batchSize)
+{
+    const auto getBucketKey = [](const nn::TrainingVector& vec)
+    {
+        const nn::NodeInput& whiteInput = vec.input.inputs[0];
+        const nn::NodeInput& blackInput = vec.input.inputs[1];
+        ASSERT(whiteInput.mode == nn::InputMode::SparseBinary && whiteInput.numFeatures > 0);
+        ASSERT(blackInput.mode == nn::InputMode::SparseBinary && blackInput.numFeatures > 0);
+
+        constexpr uint32_t numFeaturesPerBucket = 12 * 64;
+        return (whiteInput.binaryFeatures[0] / numFeaturesPerBucket) * nn::NumKingBuckets + blackInput.binaryFeatures[0] / numFeaturesPerBucket;
+    };
+
+    for (size_t batchStart = 0; batchStart < trainingSet.size(); batchStart += batchSize)
+    {
+        const auto batchEnd = trainingSet.begin() + std::min<size_t>(batchStart + batchSize, trainingSet.size());
+        std::stable_sort(trainingSet.begin() + batchStart, batchEnd, [&](const nn::TrainingVector& a, const nn::TrainingVector& b)
+        {
+            return getBucketKey(a) < getBucketKey(b);
+        });
+    }
+}
+
+TrainingDataLoader::~TrainingDataLoader()
+{
+    if (mPrefetchThread.joinable())
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mStopPrefetch = true;
+        }
+        mPrefetchCV.notify_one();
+        mPrefetchThread.join();
+    }
+}
+
+TrainingDataLoader::InputFileContext::InputFileContext() = default;
+TrainingDataLoader::InputFileContext::~InputFileContext() = default;
+
 bool TrainingDataLoader::Init(std::mt19937& gen, const std::string& trainingDataPath)
 {
     uint64_t totalDataSize = 0;
@@ -21,21 +63,39 @@ bool TrainingDataLoader::Init(std::mt19937& gen, const std::string& trainingData
         const std::string& fileName = path.path().string();
         auto fileStream = std::make_unique<FileInputStream>(fileName.c_str());
 
-        uint64_t fileSize = fileStream->GetSize();
-        totalDataSize += fileSize;
+        const uint64_t fileSize = fileStream->GetSize();
 
         if (fileStream->IsOpen() && fileSize > sizeof(PositionEntry))
         {
             std::cout << "Using " << fileName << std::endl;
 
-            InputFileContext& ctx = mContexts.emplace_back();
+            InputFileContext& ctx = *mContexts.emplace_back(std::make_unique<InputFileContext>());
             ctx.fileStream = std::move(fileStream);
             ctx.fileName = fileName;
             ctx.fileSize = fileSize;
 
+            uint64_t numEntries = fileSize / sizeof(PositionEntry);
+
+            if (CompressedTrainingData::IsCompressedFile(*ctx.fileStream))
+            {
+                ctx.compressedReader = std::make_unique<CompressedTrainingData::Reader>();
+                if (!ctx.compressedReader->Init(*ctx.fileStream) || ctx.compressedReader->GetNumBlocks() == 0)
+                {
+                    std::cout << "ERROR: Invalid compressed training data file: " << fileName << std::endl;
+                    mContexts.pop_back();
+                    continue;
+                }
+                numEntries = ctx.compressedReader->GetNumEntries();
+            }
+
             // Seek to random location so that each stream starts at different position.
+            if (ctx.compressedReader)
+            {
+                std::uniform_int_distribution<uint32_t> distr(0, ctx.compressedReader->GetNumBlocks() - 1);
+                ctx.nextBlockIndex = distr(gen);
+            }
+            else
             {
-                const uint64_t numEntries = fileSize / sizeof(PositionEntry);
                 std::uniform_int_distribution<uint64_t> distr(0, numEntries - 1);
                 const uint64_t entryIndex = distr(gen);
                 ctx.fileStream->SetPosition(entryIndex * sizeof(PositionEntry));
@@ -50,6 +110,14 @@ bool TrainingDataLoader::Init(std::mt19937& gen, const std::string& trainingData
                 ctx.skippingProbability = distr(gen);
             }
 
+            if (!LoadBlock(ctx, ctx.frontBlock, gen))
+            {
+                std::cout << "ERROR: Failed to read selfplay data file: " << fileName << std::endl;
+                mContexts.pop_back();
+                continue;
+            }
+
+            totalDataSize += numEntries;
             mCDF.push_back((double)totalDataSize);
         }
         else
@@ -67,7 +135,143 @@ bool TrainingDataLoader::Init(std::mt19937& gen, const std::string& trainingData
         }
     }
 
-    return !mContexts.empty();
+    if (mContexts.empty())
+    {
+        return false;
+    }
+
+    // start prefetching second block of each file
+    mPrefetchRandomGenerator.seed(gen());
+    mPrefetchThread = std::thread(&TrainingDataLoader::PrefetchThread, this);
+
+    return true;
+}
+
+bool TrainingDataLoader::LoadBlock(InputFileContext& ctx, Block& block, std::mt19937& gen)
+{
+    block.numEntries = 0;
+    block.readOffset = 0;
+
+    if (ctx.compressedReader)
+    {
+        CompressedTrainingData::Reader& reader = *ctx.compressedReader;
+
+        if (ctx.nextBlockIndex >= reader.GetNumBlocks())
+        {
+            std::cout << "Resetting stream " << ctx.fileName << std::endl;
+            ctx.nextBlockIndex = 0;
+        }
+
+        block.entries.resize(reader.GetMaxBlockSize());
+
+        const uint32_t numEntries = reader.ReadBlock(*ctx.fileStream, ctx.nextBlockIndex++, block.entries.data());
+        if (numEntries == 0)
+        {
+            return false;
+        }
+
+        block.numEntries = numEntries;
+        std::shuffle(block.entries.begin(), block.entries.begin() + numEntries, gen);
+
+        return true;
+    }
+
+    uint64_t position = ctx.fileStream->GetPosition();
+
+    if (position + sizeof(PositionEntry) > ctx.fileSize)
+    {
+        // reached end of the file, start from the beginning
+        if (position > 0)
+        {
+            std::cout << "Resetting stream " << ctx.fileName << std::endl;
+        }
+        ctx.fileStream->SetPosition(0);
+        position = 0;
+    }
+
+    const uint32_t numEntries = (uint32_t)std::min<uint64_t>(BlockSize, (ctx.fileSize - position) / sizeof(PositionEntry));
+
+    block.entries.resize(BlockSize);
+
+    if (numEntries == 0 || !ctx.fileStream->Read(block.entries.data(), numEntries * sizeof(PositionEntry)))
+    {
+        return false;
+    }
+
+    block.numEntries = numEntries;
+    std::shuffle(block.entries.begin(), block.entries.begin() + numEntries, gen);
+
+    return true;
+}
+
+bool TrainingDataLoader::SwapBlocks(InputFileContext& ctx)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    mBlockReadyCV.wait(lock, [&ctx]() { return ctx.backBlockReady || ctx.readFailed; });
+
+    if (!ctx.backBlockReady)
+    {
+        return false;
+    }
+
+    std::swap(ctx.frontBlock, ctx.backBlock);
+    ctx.backBlockReady = false;
+
+    lock.unlock();
+    mPrefetchCV.notify_one();
+
+    return true;
+}
+
+void TrainingDataLoader::PrefetchThread()
+{
+    const auto needsPrefetch = [](const InputFileContext& ctx) { return !ctx.backBlockReady && !ctx.readFailed; };
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    for (;;)
+    {
+        mPrefetchCV.wait(lock, [&]()
+        {
+            return mStopPrefetch || std::any_of(mContexts.begin(), mContexts.end(), [&](const auto& ctx) { return needsPrefetch(*ctx); });
+        });
+
+        if (mStopPrefetch)
+        {
+            return;
+        }
+
+        for (const std::unique_ptr<InputFileContext>& ctx : mContexts)
+        {
+            if (!needsPrefetch(*ctx))
+            {
+                continue;
+            }
+
+            // consumer never touches the back block until it's marked as ready
+            lock.unlock();
+            const bool success = LoadBlock(*ctx, ctx->backBlock, mPrefetchRandomGenerator);
+            lock.lock();
+
+            if (success)
+            {
+                ctx->backBlockReady = true;
+            }
+            else
+            {
+                std::cout << "ERROR: Failed to read selfplay data file: " << ctx->fileName << std::endl;
+                ctx->readFailed = true;
+            }
+
+            mBlockReadyCV.notify_all();
+
+            if (mStopPrefetch)
+            {
+                return;
+            }
+        }
+    }
 }
 
 uint32_t TrainingDataLoader::SampleInputFileIndex(double u) const
@@ -102,33 +306,23 @@ bool TrainingDataLoader::FetchNextPosition(std::mt19937& gen, PositionEntry& out
     if (fileIndex >= mContexts.size())
         return false;
 
-    return mContexts[fileIndex].FetchNextPosition(gen, outEntry, outPosition, kingBucketMask);
+    return mContexts[fileIndex]->FetchNextPosition(*this, gen, outEntry, outPosition, kingBucketMask);
 }
 
-bool TrainingDataLoader::InputFileContext::FetchNextPosition(std::mt19937& gen, PositionEntry& outEntry, Position& outPosition, uint64_t kingBucketMask)
+bool TrainingDataLoader::InputFileContext::FetchNextPosition(TrainingDataLoader& loader, std::mt19937& gen, PositionEntry& outEntry, Position& outPosition, uint64_t kingBucketMask)
 {
     for (;;)
     {
-        if (!fileStream->Read(&outEntry, sizeof(PositionEntry)))
+        if (frontBlock.readOffset >= frontBlock.numEntries)
         {
-            // if read failed, reset to the file beginning and try again
-
-            if (fileStream->GetPosition() > 0)
-            {
-                std::cout << "Resetting stream " << fileName << std::endl;
-                fileStream->SetPosition(0);
-            }
-            else
-            {
-                return false;
-            }
-
-            if (!fileStream->Read(&outEntry, sizeof(PositionEntry)))
+            if (!loader.SwapBlocks(*this))
             {
                 return false;
             }
         }
 
+        outEntry = frontBlock.entries[frontBlock.readOffset++];
+
         // skip invalid scores
         if (outEntry.score >= CheckmateValue || outEntry.score <= -CheckmateValue)
             continue;
@@ -140,21 +334,7 @@ bool TrainingDataLoader::InputFileContext::FetchNextPosition(std::mt19937& gen,
                 continue;
         }
 
-        VERIFY(UnpackPosition(outEntry.pos, outPosition, false));
-        ASSERT(outPosition.IsValid());
-
-        // filter by king bucket
-        if (kingBucketMask != UINT64_MAX)
-        {
-            uint32_t whiteKingSide, blackKingSide;
-            uint32_t whiteKingBucket, blackKingBucket;
-            GetKingSideAndBucket(outPosition.Whites().GetKingSquare(), whiteKingSide, whiteKingBucket);
-            GetKingSideAndBucket(outPosition.Blacks().GetKingSquare().FlippedRank(), blackKingSide, blackKingBucket);
-
-            if ((((1ull << whiteKingBucket) & kingBucketMask) == 0ull) && (((1ull << blackKingBucket) & kingBucketMask) == 0ull))
-                continue;
-        }
-        else
+        if (kingBucketMask == UINT64_MAX)
         {
             // skip drawn game based half-move counter
             if (outEntry.wdlScore == (uint8_t)Game::Score::Draw)
@@ -200,6 +380,22 @@ bool TrainingDataLoader::InputFileContext::FetchNextPosition(std::mt19937& gen,
             }
         }
 
+        // unpack only positions that passed filters based on packed entry
+        VERIFY(UnpackPosition(outEntry.pos, outPosition, false));
+        ASSERT(outPosition.IsValid());
+
+        // filter by king bucket
+        if (kingBucketMask != UINT64_MAX)
+        {
+            uint32_t whiteKingSide, blackKingSide;
+            uint32_t whiteKingBucket, blackKingBucket;
+            GetKingSideAndBucket(outPosition.Whites().GetKingSquare(), whiteKingSide, whiteKingBucket);
+            GetKingSideAndBucket(outPosition.Blacks().GetKingSquare().FlippedRank(), blackKingSide, blackKingBucket);
+
+            if ((((1ull << whiteKingBucket) & kingBucketMask) == 0ull) && (((1ull << blackKingBucket) & kingBucketMask) == 0ull))
+                continue;
+        }
+
         return true;
     }
 }
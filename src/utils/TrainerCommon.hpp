@@ -1,3 +1,5 @@
+#pragma once
+
 #include "Common.hpp"
 #include "net/Network.hpp"
 #include "GameCollection.hpp"
@@ -6,6 +8,13 @@
 #include "../backend/PositionUtils.hpp"
 
 #include <array>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace CompressedTrainingData {
+class Reader;
+}
 
 struct PositionEntry
 {
@@ -15,19 +24,43 @@ struct PositionEntry
     uint8_t tbScore = 0xFF;
 };
 
-struct TrainingEntry
+// training positions stored in flat arrays, so the set can be regenerated without per-entry allocations
+struct TrainingSetBuffer
 {
-    Position pos;
-    std::vector<uint16_t> whiteFeatures;
-    std::vector<uint16_t> blackFeatures;
-    float output = 0.0f;
-    uint32_t networkVariant = 0;
+    struct Entry
+    {
+        PackedPosition pos;
+        float output = 0.0f;
+        uint32_t featuresOffset = 0;    // white features followed by the same number of black features
+        uint16_t numFeatures = 0;       // number of features per perspective
+        uint16_t networkVariant = 0;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<uint16_t> features;
+
+    // keeps allocated memory
+    void Clear()
+    {
+        entries.clear();
+        features.clear();
+    }
+
+    const uint16_t* GetWhiteFeatures(const Entry& entry) const { return features.data() + entry.featuresOffset; }
+    const uint16_t* GetBlackFeatures(const Entry& entry) const { return features.data() + entry.featuresOffset + entry.numFeatures; }
 };
 
+// Reorder training vectors inside each batch by king buckets of both perspectives (derived from the first
+// sparse feature), so consecutive vectors touch the same feature transformer rows during training.
+// Gradients are summed over a batch, so the order of vectors within a batch does not affect training.
+void SortBatchesByKingBucket(nn::TrainingSet& trainingSet, uint32_t batchSize);
+
 class TrainingDataLoader
 {
 public:
 
+    ~TrainingDataLoader();
+
     // initialize the loader at given directory
     bool Init(
         std::mt19937& gen,
@@ -38,25 +71,61 @@ public:
 
 private:
 
+    // number of entries read from a file at once (512 KB)
+    // entries are shuffled within a block, so this is also the shuffling window
+    static constexpr uint32_t BlockSize = 16 * 1024;
+
+    struct Block
+    {
+        std::vector<PositionEntry> entries;
+        uint32_t numEntries = 0;
+        uint32_t readOffset = 0;
+    };
+
     struct InputFileContext
     {
+        InputFileContext();
+        ~InputFileContext();
+
         std::unique_ptr<FileInputStream> fileStream;
         std::string fileName;
         uint64_t fileSize = 0;
 
-        static constexpr uint32_t BufferSize = 64;
-        std::array<PositionEntry, BufferSize> buffer;
-        uint32_t bufferOffset = 0;
+        // set for block-compressed files, blocks are then read sequentially by index
+        std::unique_ptr<CompressedTrainingData::Reader> compressedReader;
+        uint32_t nextBlockIndex = 0;
+
+        // block currently consumed and block being prefetched by the loader thread
+        Block frontBlock;
+        Block backBlock;
+        bool backBlockReady = false;    // guarded by loader mutex
+        bool readFailed = false;        // guarded by loader mutex
+
         float skippingProbability = 0.0f;
 
-        bool FetchNextPosition(std::mt19937& gen, PositionEntry& outEntry, Position& outPosition, uint64_t kingBucketMask);
+        bool FetchNextPosition(TrainingDataLoader& loader, std::mt19937& gen, PositionEntry& outEntry, Position& outPosition, uint64_t kingBucketMask);
     };
 
-    std::vector<InputFileContext> mContexts;
+    // read next block from the file (wrapping around at the end) and shuffle it
+    static bool LoadBlock(InputFileContext& ctx, Block& block, std::mt19937& gen);
+
+    // swap front block with prefetched one and request prefetching of the next one
+    bool SwapBlocks(InputFileContext& ctx);
+
+    void PrefetchThread();
+
+    std::vector<std::unique_ptr<InputFileContext>> mContexts;
 
     // cumulative distribution function of picking data from each file
-    // (approximation based on file sizes)
+    // (approximation based on number of entries in each file)
     std::vector<double> mCDF;
 
+    std::thread mPrefetchThread;
+    std::mutex mMutex;
+    std::condition_variable mPrefetchCV;     // wakes up the loader thread
+    std::condition_variable mBlockReadyCV;   // wakes up the consumer
+    std::mt19937 mPrefetchRandomGenerator;
+    bool mStopPrefetch = false;
+
     uint32_t SampleInputFileIndex(double u) const;
 };
@@ -0,0 +1,57 @@
+#include "Common.hpp"
+#include "TrainerCommon.hpp"
+
+#include "../backend/Time.hpp"
+
+#include <iostream>
+#include <iomanip>
+
+// measure throughput of sampling positions from training data files
+// usage: trainingDataBenchmark <training data directory> [number of positions]
+void RunTrainingDataBenchmark(const std::vector<std::string>& args)
+{
+    if (args.empty())
+    {
+        std::cout << "Usage: trainingDataBenchmark <training data directory> [number of positions]" << std::endl;
+        return;
+    }
+
+    const uint64_t numPositions = args.size() > 1 ? std::stoull(args[1]) : 10000000;
+
+    std::mt19937 gen(12345);
+
+    TimePoint startTime = TimePoint::GetCurrent();
+
+    TrainingDataLoader loader;
+    if (!loader.Init(gen, args[0]))
+    {
+        std::cout << "Failed to initialize training data loader" << std::endl;
+        return;
+    }
+
+    std::cout << "Init time: " << std::fixed << std::setprecision(3) << (TimePoint::GetCurrent() - startTime).ToSeconds() << " s" << std::endl;
+
+    startTime = TimePoint::GetCurrent();
+
+    PositionEntry entry;
+    Position pos;
+    uint64_t checksum = 0;
+
+    for (uint64_t i = 0; i < numPositions; ++i)
+    {
+        if (!loader.FetchNextPosition(gen, entry, pos, UINT64_MAX))
+        {
+            std::cout << "Failed to fetch position" << std::endl;
+            return;
+        }
+        checksum += pos.GetHash();
+    }
+
+    const float time = (TimePoint::GetCurrent() - startTime).ToSeconds();
+
+    std::cout
+        << "Positions: " << numPositions << std::endl
+        << "Time: " << std::setprecision(3) << time << " s" << std::endl
+        << "Positions/s: " << (uint64_t)(numPositions / std::max(time, 0.001f)) << std::endl
+        << "Checksum: " << std::hex << checksum << std::dec << std::endl;
+}
@@ -0,0 +1,324 @@
+#include "Common.hpp"
+
+#include "../backend/Position.hpp"
+#include "../backend/MoveGen.hpp"
+#include "../backend/Game.hpp"
+#include "../backend/Search.hpp"
+#include "../backend/TranspositionTable.hpp"
+#include "../backend/Memory.hpp"
+#include "../backend/Time.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+namespace {
+
+static const char* c_benchmarkPositions[] =
+{
+    "r1bqkb1r/pp3ppp/2n1pn2/2Pp4/3P1B2/5N2/PP1N1PPP/R2QKB1R w KQkq - 1 9",
+    "3rk2r/1bpqbp2/np1ppn1p/p5p1/2PPP3/P1N2NP1/1PQ2PBP/R1BR2K1 w k - 4 15",
+    "r4rk1/2qn1pbp/3Npnp1/p1Pb2B1/1p1P4/1P3NP1/2Q2PBP/R2R2K1 w - - 2 18",
+    "2r3k1/pp2q1pn/7p/2PRpr2/2P1p3/2B1P2P/4QPP1/5RK1 w - - 3 19",
+    "r2q1rk1/p2nbpp1/2n1b2p/1p2p3/1P1pP3/P2P1NPP/3N1PB1/1RBQ1RK1 w - - 0 14",
+    "8/1p3k2/1b1r1pp1/7p/4pP1B/PRP5/4K1PP/8 w - - 0 29",
+    "8/4kpp1/6p1/2br2P1/1p2pP2/pP2P2P/K1P1R3/2B5 w - - 4 33",
+    "1k6/5R2/1pn1q1p1/2p3p1/3p4/1P1P1Q2/1KP2P2/8 w - - 6 33",
+};
+
+// transposition table format used before cache-line sized clusters were introduced:
+// 3 entries per 32-byte cluster, plain 16-bit key, no protection against torn writes
+class LegacyTranspositionTable
+{
+public:
+    struct InternalEntry
+    {
+        uint16_t key;
+        TTEntry entry;
+    };
+
+    struct alignas(32) TTCluster
+    {
+        InternalEntry entries[3];
+        uint16_t padding;
+    };
+
+    explicit LegacyTranspositionTable(size_t sizeInBytes)
+    {
+        numClusters = sizeInBytes / sizeof(TTCluster);
+        clusters = (TTCluster*)Malloc(numClusters * sizeof(TTCluster));
+        Clear();
+    }
+
+    ~LegacyTranspositionTable()
+    {
+        Free(clusters);
+    }
+
+    void Clear()
+    {
+        std::fill(clusters, clusters + numClusters, TTCluster{});
+        generation = 0;
+    }
+
+    void NextGeneration()
+    {
+        generation++;
+    }
+
+    bool Read(const Position& position, TTEntry& outEntry) const
+    {
+        const TTCluster& cluster = clusters[MulHi64(position.GetHash(), numClusters)];
+        const uint16_t posKey = (uint16_t)position.GetHash();
+
+        for (const InternalEntry& entry : cluster.entries)
+        {
+            const uint16_t key = entry.key;
+            const TTEntry data = entry.entry;
+            if (key == posKey && data.IsValid())
+            {
+                outEntry = data;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void Write(const Position& position, ScoreType score, ScoreType staticEval, int32_t depth, TTEntry::Bounds bounds, PackedMove move = PackedMove::Invalid())
+    {
+        TTEntry entry;
+        entry.score = score;
+        entry.staticEval = staticEval;
+        entry.depth = (int8_t)std::clamp<int32_t>(depth, INT8_MIN, INT8_MAX);
+        entry.bounds = bounds;
+        entry.move = move;
+
+        TTCluster& cluster = clusters[MulHi64(position.GetHash(), numClusters)];
+        const uint16_t positionKey = (uint16_t)position.GetHash();
+
+        uint32_t replaceIndex = 0;
+        int32_t minRelevanceInCluster = INT32_MAX;
+        uint16_t prevKey = 0;
+        TTEntry prevEntry;
+
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            const uint16_t key = cluster.entries[i].key;
+            const TTEntry data = cluster.entries[i].entry;
+
+            if (key == positionKey || !data.IsValid())
+            {
+                replaceIndex = i;
+                prevKey = key;
+                prevEntry = data;
+                break;
+            }
+
+            const int32_t entryAge = (TTEntry::GenerationCycle + generation - data.generation) & (TTEntry::GenerationCycle - 1);
+            const int32_t entryRelevance = (int32_t)data.depth - entryAge;
+
+            if (entryRelevance < minRelevanceInCluster)
+            {
+                minRelevanceInCluster = entryRelevance;
+                replaceIndex = i;
+                prevKey = key;
+                prevEntry = data;
+            }
+        }
+
+        if (entry.bounds != TTEntry::Bounds::Exact && positionKey == prevKey && entry.depth < prevEntry.depth - 4)
+        {
+            return;
+        }
+
+        if (positionKey == prevKey && !entry.move.IsValid())
+        {
+            entry.move = prevEntry.move;
+        }
+
+        entry.generation = generation;
+
+        cluster.entries[replaceIndex] = { positionKey, entry };
+    }
+
+private:
+    TTCluster* clusters = nullptr;
+    size_t numClusters = 0;
+    uint8_t generation = 0;
+};
+
+struct TreeWalkStats
+{
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+    uint64_t corruptedHits = 0;
+};
+
+// depth-limited tree walk mimicking Lazy SMP traffic: each thread visits the same trees in a different move order,
+// uses TT entries for cutoffs and stores entries with data derived from the position hash, so corrupted hits can be detected
+template<typename TableType>
+static void WalkTree(TableType& tt, const Position& pos, int32_t depth, uint64_t threadSeed, TreeWalkStats& stats)
+{
+    constexpr uint32_t maxMovesPerNode = 6;
+
+    const uint64_t hash = pos.GetHash();
+    const ScoreType expectedScore = (ScoreType)(hash >> 32);
+    const ScoreType expectedStaticEval = (ScoreType)(hash >> 48);
+
+    TTEntry ttEntry;
+    stats.probes++;
+    if (tt.Read(pos, ttEntry))
+    {
+        stats.hits++;
+
+        if (ttEntry.score != expectedScore || ttEntry.staticEval != expectedStaticEval)
+        {
+            stats.corruptedHits++;
+        }
+        else if (ttEntry.depth >= depth)
+        {
+            return;
+        }
+    }
+
+    PackedMove bestMove = PackedMove::Invalid();
+
+    if (depth > 0)
+    {
+        MoveList moves;
+        GenerateMoveList(pos, moves);
+
+        // move order is stable between iterations of the same thread, but differs between threads
+        const uint32_t offset = (uint32_t)(Murmur3(hash ^ threadSeed) % std::max<uint32_t>(1, moves.Size()));
+
+        uint32_t numMovesSearched = 0;
+        for (uint32_t i = 0; i < moves.Size() && numMovesSearched < maxMovesPerNode; ++i)
+        {
+            const Move move = moves.GetMove((i + offset) % moves.Size());
+
+            Position child = pos;
+            if (!child.DoMove(move))
+            {
+                continue;
+            }
+
+            if (!bestMove.IsValid()) bestMove = move;
+            numMovesSearched++;
+
+            WalkTree(tt, child, depth - 1, threadSeed, stats);
+        }
+    }
+
+    tt.Write(pos, expectedScore, expectedStaticEval, depth, TTEntry::Bounds::Exact, bestMove);
+}
+
+template<typename TableType>
+static void RunTreeWalkBenchmark(const char* name, TableType& tt, uint32_t numThreads, int32_t depth)
+{
+    tt.Clear();
+
+    std::vector<TreeWalkStats> threadStats(numThreads);
+    std::vector<std::thread> threads;
+
+    const TimePoint startTime = TimePoint::GetCurrent();
+
+    for (uint32_t threadIndex = 0; threadIndex < numThreads; ++threadIndex)
+    {
+        threads.emplace_back([&tt, &threadStats, threadIndex, depth]()
+        {
+            const uint64_t threadSeed = Murmur3(threadIndex + 1);
+            for (const char* fen : c_benchmarkPositions)
+            {
+                const Position pos(fen);
+                for (int32_t d = 1; d <= depth; ++d)
+                {
+                    WalkTree(tt, pos, d, threadSeed, threadStats[threadIndex]);
+                }
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    const float time = (TimePoint::GetCurrent() - startTime).ToSeconds();
+
+    TreeWalkStats total;
+    for (const TreeWalkStats& stats : threadStats)
+    {
+        total.probes += stats.probes;
+        total.hits += stats.hits;
+        total.corruptedHits += stats.corruptedHits;
+    }
+
+    std::cout
+        << std::setw(8) << name << " | "
+        << std::setw(3) << numThreads << " threads | "
+        << "probes: " << std::setw(10) << total.probes << " | "
+        << "hit rate: " << std::setw(6) << std::fixed << std::setprecision(2) << (100.0 * total.hits / std::max<uint64_t>(1, total.probes)) << "% | "
+        << "corrupted hits: " << std::setw(6) << total.corruptedHits << " | "
+        << "probes/s: " << std::setw(10) << (uint64_t)(total.probes / std::max(time, 0.001f)) << std::endl;
+}
+
+static void RunSearchBenchmark(TranspositionTable& tt, uint32_t numThreads, uint64_t maxNodes)
+{
+    Search search;
+
+    uint64_t totalNodes = 0;
+    float totalTime = 0.0f;
+
+    for (const char* fen : c_benchmarkPositions)
+    {
+        Game game;
+        game.Reset(Position(fen));
+
+        search.Clear();
+        tt.Clear();
+
+        SearchParam searchParam{ tt };
+        searchParam.debugLog = false;
+        searchParam.numThreads = numThreads;
+        searchParam.limits.maxNodes = maxNodes;
+
+        const TimePoint startTime = TimePoint::GetCurrent();
+
+        SearchStats stats;
+        SearchResult searchResult;
+        search.DoSearch(game, searchParam, searchResult, &stats);
+
+        totalTime += (TimePoint::GetCurrent() - startTime).ToSeconds();
+        totalNodes += stats.nodes;
+    }
+
+    std::cout
+        << "  search | "
+        << std::setw(3) << numThreads << " threads | "
+        << "nodes: " << std::setw(10) << totalNodes << " | "
+        << "nps: " << std::setw(10) << (uint64_t)(totalNodes / std::max(totalTime, 0.001f)) << std::endl;
+}
+
+} // namespace
+
+void RunTranspositionTableBenchmark(const std::vector<std::string>& args)
+{
+    const size_t ttSizeInMB = args.size() > 0 ? std::max(1, atoi(args[0].c_str())) : 4;
+    const int32_t walkDepth = args.size() > 1 ? std::max(1, atoi(args[1].c_str())) : 6;
+    const uint64_t searchNodes = args.size() > 2 ? std::stoull(args[2]) : 200000;
+    const uint32_t threadCounts[] = { 1, 8, 64 };
+
+    std::cout << "Transposition table size: " << ttSizeInMB << " MB" << std::endl;
+
+    TranspositionTable tt(ttSizeInMB * 1024 * 1024);
+    LegacyTranspositionTable legacyTT(ttSizeInMB * 1024 * 1024);
+
+    for (const uint32_t numThreads : threadCounts)
+    {
+        RunTreeWalkBenchmark("legacy", legacyTT, numThreads, walkDepth);
+        RunTreeWalkBenchmark("current", tt, numThreads, walkDepth);
+        RunSearchBenchmark(tt, numThreads, searchNodes);
+    }
+}
@@ -11,7 +11,8 @@ namespace nn {
     class Layer;
     class NeuralNetwork;
 
-using Values = std::vector<float, AlignmentAllocator<float, 32>>;
+// aligned to 64 bytes so rows can be processed with AVX-512 aligned loads
+using Values = std::vector<float, AlignmentAllocator<float, 64>>;
 
 struct ActiveFeature
 {
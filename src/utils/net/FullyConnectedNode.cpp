@@ -44,7 +44,7 @@ void FullyConnectedNode::Run(INodeContext& ctx) const
     ASSERT(!m_weightsStorage->m_variants.empty());
     const size_t variantIndex = std::min<size_t>(ctx.variant, m_weightsStorage->m_variants.size() - 1);
 
-    const Values& weights = m_weightsStorage->m_variants[variantIndex].m_weights;
+    const Values& weights = m_weightsStorage->m_variants[variantIndex].GetRunWeights();
 
     ASSERT(ctx.outputs.size() == m_numOutputs);
     ASSERT(ctx.inputs.size() == m_numInputs);
@@ -115,7 +115,7 @@ void FullyConnectedNode::Backpropagate(const Values& error, INodeContext& ctx, G
     ASSERT(!m_weightsStorage->m_variants.empty());
     const size_t variantIndex = std::min<size_t>(ctx.variant, m_weightsStorage->m_variants.size() - 1);
 
-    const Values& weights = m_weightsStorage->m_variants[variantIndex].m_weights;
+    const Values& weights = m_weightsStorage->m_variants[variantIndex].GetRunWeights();
     Gradients::Variant& gradientsVariant = gradients.m_variants[variantIndex];
 
     ASSERT(!gradients.m_isSparse);
@@ -160,7 +160,7 @@ void FullyConnectedNode::Backpropagate(const Values& error, INodeContext& ctx, G
                 {
                     gradientsVariant.m_values[j * m_numOutputs + i] += inputValue * error[i];
                 }
-                gradientsVariant.m_dirty[j] = true;
+                gradientsVariant.MarkDirty(j);
             }
         }
     }
@@ -217,7 +217,7 @@ void FullyConnectedNode::Backpropagate(const Values& error, INodeContext& ctx, G
         {
             gradientsVariant.m_values[m_numInputs * m_numOutputs + i] += error[i];
         }
-        gradientsVariant.m_dirty[m_numInputs] = true;
+        gradientsVariant.MarkDirty(m_numInputs);
     }
 }
 
@@ -1,6 +1,6 @@
 #include "Gradient.hpp"
 
-#include <random>
+#include <algorithm>
 
 namespace nn {
 
@@ -14,7 +14,7 @@ void Gradients::Init(uint32_t numInputs, uint32_t numOutputs, uint32_t numVarian
     for (Variant& variant : m_variants)
     {
         variant.m_values.resize((numInputs + 1) * numOutputs, 0.0f);
-        variant.m_dirty.resize(numInputs + 1, false);
+        variant.m_dirtyMask.resize((numInputs + RowsPerDirtyWord) / RowsPerDirtyWord, 0);
     }
 }
 
@@ -25,10 +25,14 @@ void Gradients::Clear()
         for (Variant& variant : m_variants)
         {
             // clear only dirty gradients
-            for (size_t i = 0; i <= m_numInputs; ++i)
+            for (size_t wordIndex = 0; wordIndex < variant.m_dirtyMask.size(); ++wordIndex)
             {
-                if (variant.m_dirty[i])
+                uint64_t word = variant.m_dirtyMask[wordIndex];
+                while (word)
                 {
+                    const size_t i = wordIndex * RowsPerDirtyWord + FirstBitSet(word);
+                    word &= word - 1;
+
                     std::fill(
                         variant.m_values.begin() + i * m_numOutputs,
                         variant.m_values.begin() + (i + 1) * m_numOutputs,
@@ -43,7 +47,7 @@ void Gradients::Clear()
             }
 #endif // CONFIGURATION_FINAL
 
-            std::fill(variant.m_dirty.begin(), variant.m_dirty.end(), false);
+            std::fill(variant.m_dirtyMask.begin(), variant.m_dirtyMask.end(), 0);
         }
     }
     else
@@ -55,58 +59,43 @@ void Gradients::Clear()
     }
 }
 
-void Gradients::Accumulate(Gradients& rhs, uint32_t inputIndex)
+// ranges of dense gradients may start at any element, so unaligned loads are used
+static void AccumulateValues(float* values, float* rhsValues, size_t count)
 {
-    ASSERT(inputIndex <= m_numInputs);
-    ASSERT(rhs.m_numInputs == m_numInputs);
-    ASSERT(rhs.m_numOutputs == m_numOutputs);
-    ASSERT(rhs.m_variants.size() == m_variants.size());
-    ASSERT(rhs.m_isSparse == m_isSparse);
+    size_t j = 0;
 
-    for (size_t variantIndex = 0; variantIndex < m_variants.size(); ++variantIndex)
+#if defined(USE_AVX512)
+    for (; j + 16 <= count; j += 16)
     {
-        Variant& variant = m_variants[variantIndex];
-        Variant& rhsVariant = rhs.m_variants[variantIndex];
-
-        ASSERT(rhsVariant.m_values.size() == variant.m_values.size());
-
-        if (m_isSparse && !rhsVariant.m_dirty[inputIndex])
-            continue;
-
-        // NOTE: not updating dirty flags here, because it's not thread-safe
-        // It will be done later in Accumulate_UpdateDirtyFlags
-        //variant.m_dirty[inputIndex] = true;
-        //rhsVariant.m_dirty[inputIndex] = false;
-
-        size_t j = inputIndex * m_numOutputs;
-        const size_t j_max = (inputIndex + 1) * m_numOutputs;
-
-#ifdef USE_AVX
-        float* values = variant.m_values.data();
-        float* rhsValues = rhsVariant.m_values.data();
-        for (; j + 8 <= j_max; j += 8)
-        {
-            _mm256_store_ps(values + j,
-                _mm256_add_ps(_mm256_load_ps(values + j), _mm256_load_ps(rhsValues + j)));
-            _mm256_store_ps(rhsValues + j, _mm256_setzero_ps());
-        }
-#endif // USE_AVX
+        _mm512_storeu_ps(values + j,
+            _mm512_add_ps(_mm512_loadu_ps(values + j), _mm512_loadu_ps(rhsValues + j)));
+        _mm512_storeu_ps(rhsValues + j, _mm512_setzero_ps());
+    }
+#elif defined(USE_AVX)
+    for (; j + 8 <= count; j += 8)
+    {
+        _mm256_storeu_ps(values + j,
+            _mm256_add_ps(_mm256_loadu_ps(values + j), _mm256_loadu_ps(rhsValues + j)));
+        _mm256_storeu_ps(rhsValues + j, _mm256_setzero_ps());
+    }
+#endif // USE_AVX512
 
-        for (; j < j_max; ++j)
-        {
-            variant.m_values[j] += rhsVariant.m_values[j];
-            rhsVariant.m_values[j] = 0.0f;
-        }
+    for (; j < count; ++j)
+    {
+        values[j] += rhsValues[j];
+        rhsValues[j] = 0.0f;
     }
 }
 
-void Gradients::Accumulate_UpdateDirtyFlags(Gradients& rhs, uint32_t inputIndex)
+void Gradients::Accumulate(Gradients& rhs, uint32_t beginIndex, uint32_t endIndex)
 {
-    ASSERT(inputIndex <= m_numInputs);
+    ASSERT(beginIndex <= endIndex);
+    ASSERT(endIndex <= m_numInputs + 1);
     ASSERT(rhs.m_numInputs == m_numInputs);
     ASSERT(rhs.m_numOutputs == m_numOutputs);
     ASSERT(rhs.m_variants.size() == m_variants.size());
     ASSERT(rhs.m_isSparse == m_isSparse);
+    ASSERT(!m_isSparse || beginIndex % RowsPerDirtyWord == 0);
 
     for (size_t variantIndex = 0; variantIndex < m_variants.size(); ++variantIndex)
     {
@@ -115,12 +104,38 @@ void Gradients::Accumulate_UpdateDirtyFlags(Gradients& rhs, uint32_t inputIndex)
 
         ASSERT(rhsVariant.m_values.size() == variant.m_values.size());
 
-        if (m_isSparse)
+        if (!m_isSparse)
         {
-            if (rhsVariant.m_dirty[inputIndex])
+            AccumulateValues(
+                variant.m_values.data() + (size_t)beginIndex * m_numOutputs,
+                rhsVariant.m_values.data() + (size_t)beginIndex * m_numOutputs,
+                (size_t)(endIndex - beginIndex) * m_numOutputs);
+            continue;
+        }
+
+        // visit only rows dirty in 'rhs', one mask word at a time
+        for (uint32_t wordBase = beginIndex; wordBase < endIndex; wordBase += RowsPerDirtyWord)
+        {
+            const uint32_t wordIndex = wordBase / RowsPerDirtyWord;
+            const uint32_t numRowsInWord = std::min(RowsPerDirtyWord, endIndex - wordBase);
+            const uint64_t rangeMask = numRowsInWord < 64 ? ((1ull << numRowsInWord) - 1) : UINT64_MAX;
+
+            uint64_t word = rhsVariant.m_dirtyMask[wordIndex] & rangeMask;
+            if (word == 0)
+                continue;
+
+            variant.m_dirtyMask[wordIndex] |= word;
+            rhsVariant.m_dirtyMask[wordIndex] &= ~word;
+
+            while (word)
             {
-                variant.m_dirty[inputIndex] = true;
-                rhsVariant.m_dirty[inputIndex] = false;
+                const size_t i = wordBase + FirstBitSet(word);
+                word &= word - 1;
+
+                AccumulateValues(
+                    variant.m_values.data() + i * m_numOutputs,
+                    rhsVariant.m_values.data() + i * m_numOutputs,
+                    m_numOutputs);
             }
         }
     }
@@ -7,21 +7,37 @@ namespace nn {
 // Sparse gradients for WeightsStorage
 struct Gradients
 {
+    // number of rows covered by a single word of the dirty mask
+    // row ranges reduced in parallel must be aligned to it, so that shards never share a mask word
+    static constexpr uint32_t RowsPerDirtyWord = 64;
+
     uint32_t            m_numInputs = 0;
     uint32_t            m_numOutputs = 0;
     bool                m_isSparse = false;
 
     struct Variant
     {
-        Values              m_values;
-        std::vector<bool>   m_dirty;
+        Values                  m_values;
+        std::vector<uint64_t>   m_dirtyMask;    // one bit per input row
+
+        INLINE bool IsDirty(uint32_t inputIndex) const
+        {
+            return (m_dirtyMask[inputIndex / RowsPerDirtyWord] >> (inputIndex % RowsPerDirtyWord)) & 1u;
+        }
+
+        INLINE void MarkDirty(uint32_t inputIndex)
+        {
+            m_dirtyMask[inputIndex / RowsPerDirtyWord] |= 1ull << (inputIndex % RowsPerDirtyWord);
+        }
     };
     std::vector<Variant> m_variants;
 
     void Init(uint32_t numInputs, uint32_t numOutputs, uint32_t numVariants, bool isSparse);
     void Clear();
-    void Accumulate(Gradients& rhs, uint32_t inputIndex);
-    void Accumulate_UpdateDirtyFlags(Gradients& rhs, uint32_t inputIndex);
+
+    // Add rows [beginIndex, endIndex) of 'rhs' to this gradients, zero them in 'rhs' and move dirty flags.
+    // Disjoint ranges can be accumulated concurrently if 'beginIndex' is a multiple of RowsPerDirtyWord.
+    void Accumulate(Gradients& rhs, uint32_t beginIndex, uint32_t endIndex);
 };
 
 } // namespace nn
@@ -533,27 +533,26 @@ size_t NeuralNetworkTrainer::Train(NeuralNetwork& network, const TrainingSet& tr
 
                 Gradients& gradients = m_perThreadData.front().perWeightsStorageGradients[weightsStorageIndex];
 
-                for (uint32_t inputIndex = 0; inputIndex <= weightsStorage->m_inputSize; ++inputIndex)
+                const uint32_t numRows = weightsStorage->m_inputSize + 1;
+
+                // accumulate gradients from all per-thread gradients
+                for (size_t threadIdx = 1; threadIdx < m_perThreadData.size(); ++threadIdx)
                 {
-                    // accumulate gradients from all per-thread gradients
-                    for (size_t threadIdx = 1; threadIdx < m_perThreadData.size(); ++threadIdx)
-                    {
-                        Gradients& srcGradients = m_perThreadData[threadIdx].perWeightsStorageGradients[weightsStorageIndex];
-                        gradients.Accumulate(srcGradients, inputIndex);
-                    }
+                    Gradients& srcGradients = m_perThreadData[threadIdx].perWeightsStorageGradients[weightsStorageIndex];
+                    gradients.Accumulate(srcGradients, 0, numRows);
+                }
 
-                    // apply weights update
-                    switch (params.optimizer)
-                    {
-                    case Optimizer::Adadelta:
-                        weightsStorage->Update_Adadelta(gradients, inputIndex, updateOptions);
-                        break;
-                    case Optimizer::Adam:
-                        weightsStorage->Update_Adam(gradients, inputIndex, updateOptions);
-                        break;
-                    default:
-                        DEBUG_BREAK();
-                    }
+                // apply weights update
+                switch (params.optimizer)
+                {
+                case Optimizer::Adadelta:
+                    weightsStorage->Update_Adadelta(gradients, 0, numRows, updateOptions);
+                    break;
+                case Optimizer::Adam:
+                    weightsStorage->Update_Adam(gradients, 0, numRows, updateOptions);
+                    break;
+                default:
+                    DEBUG_BREAK();
                 }
             }
         };
@@ -592,20 +591,29 @@ size_t NeuralNetworkTrainer::Train(NeuralNetwork& network, const TrainingSet& tr
 
                 if (!weightsStorage->m_updateWeights) continue;
 
-                //for (uint32_t inputIndex = 0; inputIndex <= weightsStorage->m_inputSize; ++inputIndex)
-                taskBuilder->ParallelFor("UpdateWeights", weightsStorage->m_inputSize + 1,
-                    [this, weightsStorageIndex, params, batchIdx](const TaskContext&, uint32_t inputIndex)
+                // Rows are split into shards reduced by independent tasks. Each shard sums per-thread gradients
+                // of its rows (moving dirty flags along) and updates the weights, so the reduction is lock-free
+                // and needs no serial pass. Shards are aligned to dirty mask words, so they never share one.
+                const uint32_t numRows = weightsStorage->m_inputSize + 1;
+                const uint32_t shardSize = std::max(1u, params.reductionShardSize / Gradients::RowsPerDirtyWord) * Gradients::RowsPerDirtyWord;
+                const uint32_t numShards = (numRows + shardSize - 1) / shardSize;
+
+                taskBuilder->ParallelFor("UpdateWeights", numShards,
+                    [this, weightsStorageIndex, params, batchIdx, numRows, shardSize](const TaskContext&, uint32_t shardIndex)
                 {
                     WeightsStorage* weightsStorage = m_weightsStorages[weightsStorageIndex];
                     ASSERT(weightsStorage);
 
+                    const uint32_t beginIndex = shardIndex * shardSize;
+                    const uint32_t endIndex = std::min(beginIndex + shardSize, numRows);
+
                     Gradients& gradients = m_perThreadData.front().perWeightsStorageGradients[weightsStorageIndex];
 
                     // accumulate gradients from all per-thread gradients
                     for (size_t threadIdx = 1; threadIdx < m_perThreadData.size(); ++threadIdx)
                     {
                         Gradients& srcGradients = m_perThreadData[threadIdx].perWeightsStorageGradients[weightsStorageIndex];
-                        gradients.Accumulate(srcGradients, inputIndex);
+                        gradients.Accumulate(srcGradients, beginIndex, endIndex);
                     }
 
                     WeightsStorage::WeightsUpdateOptions updateOptions;
@@ -618,46 +626,16 @@ size_t NeuralNetworkTrainer::Train(NeuralNetwork& network, const TrainingSet& tr
                     switch (params.optimizer)
                     {
                     case Optimizer::Adadelta:
-                        weightsStorage->Update_Adadelta(gradients, inputIndex, updateOptions);
+                        weightsStorage->Update_Adadelta(gradients, beginIndex, endIndex, updateOptions);
                         break;
                     case Optimizer::Adam:
-                        weightsStorage->Update_Adam(gradients, inputIndex, updateOptions);
+                        weightsStorage->Update_Adam(gradients, beginIndex, endIndex, updateOptions);
                         break;
                     default:
                         DEBUG_BREAK();
                     }
                 });
             }
-
-            taskBuilder->Fence();
-
-            taskBuilder->Task("UpdateGradientsDirtyFlag", [this](const TaskContext&)
-            {
-                for (size_t weightsStorageIndex = 0; weightsStorageIndex < m_weightsStorages.size(); ++weightsStorageIndex)
-                {
-                    WeightsStorage* weightsStorage = m_weightsStorages[weightsStorageIndex];
-                    ASSERT(weightsStorage);
-
-                    if (!weightsStorage->m_updateWeights) continue;
-                    if (!weightsStorage->m_isSparse) continue;
-
-                    Gradients& gradients = m_perThreadData.front().perWeightsStorageGradients[weightsStorageIndex];
-
-                    for (size_t threadIdx = 1; threadIdx < m_perThreadData.size(); ++threadIdx)
-                    {
-                        Gradients& srcGradients = m_perThreadData[threadIdx].perWeightsStorageGradients[weightsStorageIndex];
-                        for (uint32_t i = 0; i < weightsStorage->m_inputSize + 1; ++i)
-                        {
-                            gradients.Accumulate_UpdateDirtyFlags(srcGradients, i);
-
-                            //for (const Gradients::Variant& variant : srcGradients.m_variants)
-                            //{
-                            //    ASSERT(!variant.m_dirty[i]);
-                            //}
-                        }
-                    }
-                }
-            });
         }
         else // single-threaded
         {
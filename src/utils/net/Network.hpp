@@ -147,6 +147,10 @@ struct TrainParams
     float weightDecay = 1.0e-5f;
     Optimizer optimizer = Optimizer::Adadelta;
     bool clampWeights = true;
+
+    // number of weight rows reduced (and updated) by a single task after each batch
+    // rounded to a multiple of Gradients::RowsPerDirtyWord
+    uint32_t reductionShardSize = 64;
 };
 
 class NeuralNetworkTrainer
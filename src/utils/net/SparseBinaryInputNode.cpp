@@ -6,6 +6,9 @@ namespace nn {
 
 static constexpr uint32_t c_NumRegisters = 8;
 
+// max number of SIMD-wide output tiles handled by backpropagation
+static constexpr uint32_t MaxTiles = 512;
+
 SparseBinaryInputNode::SparseBinaryInputNode(uint32_t inputSize, uint32_t outputSize, const nn::WeightsStoragePtr& weights)
     : ITrainableNode(nullptr, weights, inputSize, outputSize)
 {
@@ -17,7 +20,7 @@ void SparseBinaryInputNode::Run(INodeContext& ctx) const
 
     ASSERT(!m_weightsStorage->m_variants.empty());
     const size_t variantIndex = std::min<size_t>(ctx.variant, m_weightsStorage->m_variants.size() - 1);
-    const Values& weights = m_weightsStorage->m_variants[variantIndex].m_weights;
+    const Values& weights = m_weightsStorage->m_variants[variantIndex].GetRunWeights();
 
     ASSERT(ctx.outputs.size() == m_numOutputs);
     ASSERT(m_numOutputs % (c_NumRegisters * 8) == 0);
@@ -87,28 +90,47 @@ void SparseBinaryInputNode::Backpropagate(const Values& error, INodeContext& ctx
 
 #ifdef USE_AVX
 
-    for (uint32_t i = 0; i < m_numOutputs; i += 8u)
-    {
-        // load error into AVX register
-        const __m256 errorV = _mm256_load_ps(error.data() + i);
+#if defined(USE_AVX512)
+    constexpr uint32_t laneWidth = 16u;
+#else
+    constexpr uint32_t laneWidth = 8u;
+#endif // USE_AVX512
 
-        // skip tile if error is zero in every lane
-        if (0xFF == _mm256_movemask_ps(_mm256_cmp_ps(errorV, _mm256_setzero_ps(), _CMP_EQ_OQ)))
-            continue;
+    ASSERT(m_numOutputs % laneWidth == 0);
+    ASSERT(m_numOutputs / laneWidth <= MaxTiles);
 
-        // accumulate error to active feature's gradients
-        for (const IndexType featureIdx : context.sparseInputs)
-        {
-            float* gradientPtr = gradientsVariant.m_values.data() + featureIdx * m_numOutputs;
-            _mm256_store_ps(gradientPtr + i,
-                _mm256_add_ps(_mm256_load_ps(gradientPtr + i), errorV));
-        }
+    // collect tiles with non-zero error (CReLU zeroes large parts of the error vector)
+    uint16_t activeTiles[MaxTiles];
+    uint32_t numActiveTiles = 0;
+    for (uint32_t i = 0; i < m_numOutputs; i += laneWidth)
+    {
+#if defined(USE_AVX512)
+        const bool isZero = 0 == _mm512_cmp_ps_mask(_mm512_load_ps(error.data() + i), _mm512_setzero_ps(), _CMP_NEQ_UQ);
+#else
+        const bool isZero = 0xFF == _mm256_movemask_ps(_mm256_cmp_ps(_mm256_load_ps(error.data() + i), _mm256_setzero_ps(), _CMP_EQ_OQ));
+#endif // USE_AVX512
+        activeTiles[numActiveTiles] = static_cast<uint16_t>(i);
+        numActiveTiles += isZero ? 0 : 1;
     }
 
-    // mark gradients as dirty
+    // accumulate error to active feature's gradients, one contiguous gradient row at a time
     for (const IndexType featureIdx : context.sparseInputs)
     {
-        gradientsVariant.m_dirty[featureIdx] = true;
+        float* gradientPtr = gradientsVariant.m_values.data() + featureIdx * m_numOutputs;
+        for (uint32_t j = 0; j < numActiveTiles; ++j)
+        {
+            const uint32_t i = activeTiles[j];
+#if defined(USE_AVX512)
+            _mm512_store_ps(gradientPtr + i,
+                _mm512_add_ps(_mm512_load_ps(gradientPtr + i), _mm512_load_ps(error.data() + i)));
+#else
+            _mm256_store_ps(gradientPtr + i,
+                _mm256_add_ps(_mm256_load_ps(gradientPtr + i), _mm256_load_ps(error.data() + i)));
+#endif // USE_AVX512
+        }
+
+        // mark gradients as dirty
+        gradientsVariant.MarkDirty(featureIdx);
     }
 
 #else
@@ -121,11 +143,10 @@ void SparseBinaryInputNode::Backpropagate(const Values& error, INodeContext& ctx
             // not multiplying by input value, because it's equal to 1.0
             gradientsVariant.m_values[j * m_numOutputs + i] += error[i];
         }
-        gradientsVariant.m_dirty[j] = true;
+        gradientsVariant.MarkDirty(j);
     }
 #endif // USE_AVX
 
-
     // add bias gradient
     {
         size_t i = 0;
@@ -142,7 +163,7 @@ void SparseBinaryInputNode::Backpropagate(const Values& error, INodeContext& ctx
         {
             gradientsVariant.m_values[m_numInputs * m_numOutputs + i] += error[i];
         }
-        gradientsVariant.m_dirty[m_numInputs] = true;
+        gradientsVariant.MarkDirty(m_numInputs);
     }
 }
 
@@ -10,7 +10,7 @@ void SparseInputNode::Run(INodeContext& ctx) const
 
     ASSERT(!m_weightsStorage->m_variants.empty());
     const size_t variantIndex = std::min<size_t>(ctx.variant, m_weightsStorage->m_variants.size() - 1);
-    const Values& weights = m_weightsStorage->m_variants[variantIndex].m_weights;
+    const Values& weights = m_weightsStorage->m_variants[variantIndex].GetRunWeights();
 
     ASSERT(ctx.outputs.size() == m_numOutputs);
 
@@ -75,7 +75,7 @@ void SparseInputNode::Backpropagate(const Values& error, INodeContext& ctx, Grad
         {
             gradientsVariant.m_values[feature.index * m_numOutputs + i] += feature.value * error[i];
         }
-        gradientsVariant.m_dirty[feature.index] = true;
+        gradientsVariant.MarkDirty(feature.index);
     }
 
     // add bias gradient
@@ -94,7 +94,7 @@ void SparseInputNode::Backpropagate(const Values& error, INodeContext& ctx, Grad
         {
             gradientsVariant.m_values[m_numInputs * m_numOutputs + i] += error[i];
         }
-        gradientsVariant.m_dirty[m_numInputs] = true;
+        gradientsVariant.MarkDirty(m_numInputs);
     }
 }
 
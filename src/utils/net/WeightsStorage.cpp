@@ -3,10 +3,33 @@
 #include "../minitrace/minitrace.h"
 
 #include <algorithm>
+#include <cmath>
 #include <random>
 
 namespace nn {
 
+// round weight to the quantization grid of the packed network
+INLINE static float FakeQuantize(float w, float scale)
+{
+    return std::nearbyint(w * scale) * (1.0f / scale);
+}
+
+#ifdef USE_AVX512
+INLINE static __m512 FakeQuantize(__m512 w, float scale)
+{
+    const __m512 rounded = _mm512_roundscale_ps(_mm512_mul_ps(w, _mm512_set1_ps(scale)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    return _mm512_mul_ps(rounded, _mm512_set1_ps(1.0f / scale));
+}
+#endif // USE_AVX512
+
+#ifdef USE_AVX
+INLINE static __m256 FakeQuantize(__m256 w, float scale)
+{
+    const __m256 rounded = _mm256_round_ps(_mm256_mul_ps(w, _mm256_set1_ps(scale)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    return _mm256_mul_ps(rounded, _mm256_set1_ps(1.0f / scale));
+}
+#endif // USE_AVX
+
 WeightsStorage::WeightsStorage(uint32_t inputSize, uint32_t outputSize, uint32_t numVariants)
     : m_inputSize(inputSize)
     , m_outputSize(outputSize)
@@ -64,218 +87,382 @@ void WeightsStorage::Init(uint32_t numActiveNeurons, float bias)
         memset(variant.m_gradientMoment2.data(), 0, sizeof(float) * variant.m_gradientMoment2.size());
         memcpy(variant.m_weights.data(), m_variants[0].m_weights.data(), sizeof(float) * variant.m_weights.size());
     }
+
+    UpdateQuantizedWeights();
 }
 
-void WeightsStorage::Update_Adadelta(const Gradients& gradients, uint32_t inputIndex, const WeightsUpdateOptions& options)
+void WeightsStorage::EnableQuantization(float weightsScale, float biasScale)
 {
-    ASSERT(inputIndex <= m_inputSize);
-    ASSERT(gradients.m_numInputs == m_inputSize);
-    ASSERT(gradients.m_numOutputs == m_outputSize);
-    ASSERT(gradients.m_variants.size() == m_variants.size());
+    ASSERT(weightsScale > 0.0f);
+    ASSERT(biasScale > 0.0f);
 
-    for (size_t variantIndex = 0; variantIndex < m_variants.size(); ++variantIndex)
+    m_weightsQuantizationScale = weightsScale;
+    m_biasQuantizationScale = biasScale;
+
+    for (Variant& variant : m_variants)
     {
-        Variant& variant = m_variants[variantIndex];
-        const Gradients::Variant& gradientsVariant = gradients.m_variants[variantIndex];
+        variant.m_quantizedWeights.resize(variant.m_weights.size());
+    }
 
-        ASSERT(gradientsVariant.m_values.size() == (m_inputSize + 1) * m_outputSize);
+    UpdateQuantizedWeights();
+}
+
+void WeightsStorage::UpdateQuantizedWeights()
+{
+    if (!IsQuantized())
+    {
+        return;
+    }
+
+    const size_t numWeights = (size_t)m_inputSize * m_outputSize;
+
+    for (Variant& variant : m_variants)
+    {
+        ASSERT(variant.m_quantizedWeights.size() == variant.m_weights.size());
 
-        const float cRho = 0.95f;
-        const float cEpsilon = 1.0e-8f;
+        for (size_t i = 0; i < variant.m_weights.size(); ++i)
+        {
+            const bool isBias = i >= numWeights;
+            const float range = isBias ? m_biasRange : m_weightsRange;
+            const float scale = isBias ? m_biasQuantizationScale : m_weightsQuantizationScale;
+            variant.m_quantizedWeights[i] = FakeQuantize(std::clamp(variant.m_weights[i], -range, range), scale);
+        }
+    }
+}
+
+// update 'count' consecutive weights starting at 'offset' (any alignment, all sharing the same clamping range and quantization scale)
+static void UpdateRange_Adadelta(WeightsStorage::Variant& variant, const float* weightsMask, const float* gradients,
+                                 size_t offset, size_t count, float maxWeightValue, float quantizationScale, const WeightsStorage::WeightsUpdateOptions& options)
+{
+    const float cRho = 0.95f;
+    const float cEpsilon = 1.0e-8f;
+
+    float* mBase = variant.m_gradientMoment1.data() + offset;
+    float* vBase = variant.m_gradientMoment2.data() + offset;
+    float* wBase = variant.m_weights.data() + offset;
+    const float* wMaskBase = weightsMask + offset;
+    const float* gBase = gradients + offset;
+
+    // fake quantized copy is written along with updated weights
+    float* qBase = variant.m_quantizedWeights.empty() ? nullptr : variant.m_quantizedWeights.data() + offset;
+    ASSERT(!qBase || quantizationScale > 0.0f);
+
+    size_t i = 0;
+
+#ifdef USE_AVX512
+    {
+        const __m512 minValueV = _mm512_set1_ps(-maxWeightValue);
+        const __m512 maxValueV = _mm512_set1_ps(maxWeightValue);
+        const __m512 rhoV = _mm512_set1_ps(cRho);
+        const __m512 oneMinusRhoV = _mm512_set1_ps(1.0f - cRho);
+        const __m512 epsilonV = _mm512_set1_ps(cEpsilon);
+        for (; i + 16 <= count; i += 16)
+        {
+            __m512 g = _mm512_mul_ps(_mm512_set1_ps(options.gradientScale), _mm512_loadu_ps(gBase + i));
+            __m512 v = _mm512_loadu_ps(vBase + i);
+            __m512 m = _mm512_loadu_ps(mBase + i);
+            __m512 w = _mm512_loadu_ps(wBase + i);
+
+            // weight decay
+            g = _mm512_fmadd_ps(w, _mm512_set1_ps(options.weightDecay), g);
+
+            // ADADELTA algorithm
+            m = _mm512_fmadd_ps(oneMinusRhoV, _mm512_mul_ps(g, g), _mm512_mul_ps(rhoV, m));
+            __m512 delta = _mm512_mul_ps(g, _mm512_sqrt_ps(_mm512_div_ps(_mm512_add_ps(v, epsilonV), _mm512_add_ps(m, epsilonV))));
+            v = _mm512_fmadd_ps(oneMinusRhoV, _mm512_mul_ps(delta, delta), _mm512_mul_ps(rhoV, v));
+            delta = _mm512_mul_ps(_mm512_loadu_ps(wMaskBase + i), delta);
+            w = _mm512_fnmadd_ps(delta, _mm512_set1_ps(options.learningRate), w);
+
+            // clamping
+            w = _mm512_max_ps(_mm512_min_ps(w, maxValueV), minValueV);
+
+            _mm512_storeu_ps(vBase + i, v);
+            _mm512_storeu_ps(mBase + i, m);
+            _mm512_storeu_ps(wBase + i, w);
+            if (qBase) _mm512_storeu_ps(qBase + i, FakeQuantize(w, quantizationScale));
+        }
+    }
+#endif // USE_AVX512
 
 #ifdef USE_AVX
+    {
         const __m256 cOneMinusRhoVec = _mm256_set1_ps(1.0f - cRho);
         const __m256 cRhoVec = _mm256_set1_ps(cRho);
         const __m256 cEpsilonVec = _mm256_set1_ps(cEpsilon);
         const __m256 gradientScaleVec = _mm256_set1_ps(options.gradientScale);
-#endif
-
+        const __m256 minValueV = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_set1_ps(maxWeightValue));
+        const __m256 maxValueV = _mm256_set1_ps(maxWeightValue);
+        for (; i + 8 <= count; i += 8)
         {
-            const float maxWeightValue = inputIndex < m_inputSize ? m_weightsRange : m_biasRange;
-
-            size_t i = 0;
-
-#ifdef USE_AVX
-            const __m256 minValueV = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_set1_ps(maxWeightValue));
-            const __m256 maxValueV = _mm256_set1_ps(maxWeightValue);
-            for (; i + 8 <= m_outputSize; i += 8)
-            {
-                float* mPtr = variant.m_gradientMoment1.data() + inputIndex * m_outputSize + i;
-                float* vPtr = variant.m_gradientMoment2.data() + inputIndex * m_outputSize + i;
-                float* wPtr = variant.m_weights.data() + inputIndex * m_outputSize + i;
-                float* wMaskPtr = m_weightsMask.data() + inputIndex * m_outputSize + i;
-                const float* gPtr = gradientsVariant.m_values.data() + inputIndex * m_outputSize + i;
-
-                __m256 g = _mm256_mul_ps(gradientScaleVec, _mm256_load_ps(gPtr));
-                __m256 v = _mm256_load_ps(vPtr);
-                __m256 m = _mm256_load_ps(mPtr);
-                __m256 w = _mm256_load_ps(wPtr);
-                const __m256 wMask = _mm256_load_ps(wMaskPtr);
-
-                // weight decay
-                g = _mm256_fmadd_ps(w, _mm256_set1_ps(options.weightDecay), g);
-
-                // ADADELTA algorithm
-                m = _mm256_fmadd_ps(cOneMinusRhoVec, _mm256_mul_ps(g, g), _mm256_mul_ps(cRhoVec, m));
-                __m256 delta = _mm256_mul_ps(g, _mm256_sqrt_ps(_mm256_div_ps(_mm256_add_ps(v, cEpsilonVec), _mm256_add_ps(m, cEpsilonVec))));
-                v = _mm256_fmadd_ps(cOneMinusRhoVec, _mm256_mul_ps(delta, delta), _mm256_mul_ps(cRhoVec, v));
-                delta = _mm256_mul_ps(wMask, delta);
-                w = _mm256_fnmadd_ps(delta, _mm256_set1_ps(options.learningRate), w);
-
-                // clamping
-                w = _mm256_min_ps(w, maxValueV);
-                w = _mm256_max_ps(w, minValueV);
-
-                _mm256_store_ps(vPtr, v);
-                _mm256_store_ps(mPtr, m);
-                _mm256_store_ps(wPtr, w);
-            }
+            __m256 g = _mm256_mul_ps(gradientScaleVec, _mm256_loadu_ps(gBase + i));
+            __m256 v = _mm256_loadu_ps(vBase + i);
+            __m256 m = _mm256_loadu_ps(mBase + i);
+            __m256 w = _mm256_loadu_ps(wBase + i);
+            const __m256 wMask = _mm256_loadu_ps(wMaskBase + i);
+
+            // weight decay
+            g = _mm256_fmadd_ps(w, _mm256_set1_ps(options.weightDecay), g);
+
+            // ADADELTA algorithm
+            m = _mm256_fmadd_ps(cOneMinusRhoVec, _mm256_mul_ps(g, g), _mm256_mul_ps(cRhoVec, m));
+            __m256 delta = _mm256_mul_ps(g, _mm256_sqrt_ps(_mm256_div_ps(_mm256_add_ps(v, cEpsilonVec), _mm256_add_ps(m, cEpsilonVec))));
+            v = _mm256_fmadd_ps(cOneMinusRhoVec, _mm256_mul_ps(delta, delta), _mm256_mul_ps(cRhoVec, v));
+            delta = _mm256_mul_ps(wMask, delta);
+            w = _mm256_fnmadd_ps(delta, _mm256_set1_ps(options.learningRate), w);
+
+            // clamping
+            w = _mm256_min_ps(w, maxValueV);
+            w = _mm256_max_ps(w, minValueV);
+
+            _mm256_storeu_ps(vBase + i, v);
+            _mm256_storeu_ps(mBase + i, m);
+            _mm256_storeu_ps(wBase + i, w);
+            if (qBase) _mm256_storeu_ps(qBase + i, FakeQuantize(w, quantizationScale));
+        }
+    }
 #endif // USE_AVX
 
-            for (; i < m_outputSize; ++i)
-            {
-                float& m = variant.m_gradientMoment1[inputIndex * m_outputSize + i];
-                float& v = variant.m_gradientMoment2[inputIndex * m_outputSize + i];
-                float& w = variant.m_weights[inputIndex * m_outputSize + i];
-                const float& wMask = m_weightsMask[inputIndex * m_outputSize + i];
-                float g = options.gradientScale * gradientsVariant.m_values[inputIndex * m_outputSize + i];
+    for (; i < count; ++i)
+    {
+        float& m = mBase[i];
+        float& v = vBase[i];
+        float& w = wBase[i];
+        const float wMask = wMaskBase[i];
+        float g = options.gradientScale * gBase[i];
 
-                ASSERT(!std::isnan(g));
-                ASSERT(v >= 0.0f);
-                ASSERT(m >= 0.0f);
+        ASSERT(!std::isnan(g));
+        ASSERT(v >= 0.0f);
+        ASSERT(m >= 0.0f);
 
-                // weight decay
-                g += w * options.weightDecay;
+        // weight decay
+        g += w * options.weightDecay;
 
-                // ADADELTA algorithm
-                m = cRho * m + (1.0f - cRho) * g * g;
-                ASSERT(!std::isnan(m));
+        // ADADELTA algorithm
+        m = cRho * m + (1.0f - cRho) * g * g;
+        ASSERT(!std::isnan(m));
 
-                const float delta = g * sqrtf((v + cEpsilon) / (m + cEpsilon));
-                v = cRho * v + (1.0f - cRho) * delta * delta;
-                ASSERT(!std::isnan(v));
+        const float delta = g * sqrtf((v + cEpsilon) / (m + cEpsilon));
+        v = cRho * v + (1.0f - cRho) * delta * delta;
+        ASSERT(!std::isnan(v));
 
-                w -= wMask * options.learningRate * delta;
-                ASSERT(!std::isnan(w));
+        w -= wMask * options.learningRate * delta;
+        ASSERT(!std::isnan(w));
 
-                // clamping
-                w = std::clamp(w, -maxWeightValue, maxWeightValue);
-            }
-        }
+        // clamping
+        w = std::clamp(w, -maxWeightValue, maxWeightValue);
+
+        if (qBase) qBase[i] = FakeQuantize(w, quantizationScale);
     }
 }
 
-void WeightsStorage::Update_Adam(const Gradients& gradients, uint32_t inputIndex, const WeightsUpdateOptions& options)
+// update 'count' consecutive weights starting at 'offset' (any alignment, all sharing the same clamping range and quantization scale)
+static void UpdateRange_Adam(WeightsStorage::Variant& variant, const float* weightsMask, const float* gradients,
+                             size_t offset, size_t count, float maxWeightValue, float quantizationScale, const WeightsStorage::WeightsUpdateOptions& options)
 {
-    ASSERT(gradients.m_numInputs == m_inputSize);
-    ASSERT(gradients.m_numOutputs == m_outputSize);
-    ASSERT(gradients.m_variants.size() == m_variants.size());
+    const float cBeta1 = 0.9f;
+    const float cBeta2 = 0.999f;
+    const float cEpsilon = 1.0e-12f;
 
-    for (size_t variantIndex = 0; variantIndex < m_variants.size(); ++variantIndex)
-    {
-        Variant& variant = m_variants[variantIndex];
-        const Gradients::Variant& gradientsVariant = gradients.m_variants[variantIndex];
+    const float cIter = (float)(options.iteration + 1);
+    const float cBeta1Mult = 1.0f / (1.0f - powf(cBeta1, cIter));
+    const float cBeta2Mult = 1.0f / (1.0f - powf(cBeta2, cIter));
 
-        ASSERT(gradientsVariant.m_values.size() == (m_inputSize + 1) * m_outputSize);
+    float* mBase = variant.m_gradientMoment1.data() + offset;
+    float* vBase = variant.m_gradientMoment2.data() + offset;
+    float* wBase = variant.m_weights.data() + offset;
+    const float* wMaskBase = weightsMask + offset;
+    const float* gBase = gradients + offset;
+
+    // fake quantized copy is written along with updated weights
+    float* qBase = variant.m_quantizedWeights.empty() ? nullptr : variant.m_quantizedWeights.data() + offset;
+    ASSERT(!qBase || quantizationScale > 0.0f);
 
-        const float cBeta1 = 0.9f;
-        const float cBeta2 = 0.999f;
-        const float cEpsilon = 1.0e-12f;
+    size_t i = 0;
 
-        const float cIter = (float)(options.iteration + 1);
-        const float cBeta1Mult = 1.0f / (1.0f - powf(cBeta1, cIter));
-        const float cBeta2Mult = 1.0f / (1.0f - powf(cBeta2, cIter));
+#ifdef USE_AVX512
+    {
+        const __m512 minValueV = _mm512_set1_ps(-maxWeightValue);
+        const __m512 maxValueV = _mm512_set1_ps(maxWeightValue);
+        const __m512 beta1V = _mm512_set1_ps(cBeta1);
+        const __m512 oneMinusBeta1V = _mm512_set1_ps(1.0f - cBeta1);
+        const __m512 beta2V = _mm512_set1_ps(cBeta2);
+        const __m512 oneMinusBeta2V = _mm512_set1_ps(1.0f - cBeta2);
+        const __m512 epsilonV = _mm512_set1_ps(cEpsilon);
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m512 g = _mm512_mul_ps(_mm512_set1_ps(options.gradientScale), _mm512_loadu_ps(gBase + i));
+            __m512 v = _mm512_loadu_ps(vBase + i);
+            __m512 m = _mm512_loadu_ps(mBase + i);
+            __m512 w = _mm512_loadu_ps(wBase + i);
+
+            // update biased moment estimates
+            m = _mm512_fmadd_ps(oneMinusBeta1V, g, _mm512_mul_ps(beta1V, m));
+            v = _mm512_fmadd_ps(oneMinusBeta2V, _mm512_mul_ps(g, g), _mm512_mul_ps(beta2V, v));
+
+            // compute bias-corrected moment estimates
+            const __m512 m_hat = _mm512_mul_ps(m, _mm512_set1_ps(cBeta1Mult));
+            const __m512 v_hat = _mm512_mul_ps(v, _mm512_set1_ps(cBeta2Mult));
+
+            // compute final weight change
+            __m512 delta = _mm512_div_ps(m_hat, _mm512_add_ps(epsilonV, _mm512_sqrt_ps(v_hat)));
+            delta = _mm512_fmadd_ps(w, _mm512_set1_ps(options.weightDecay), delta); // weight decay
+            delta = _mm512_mul_ps(_mm512_loadu_ps(wMaskBase + i), delta);
+            w = _mm512_fnmadd_ps(delta, _mm512_set1_ps(options.learningRate), w);
+
+            // clamping
+            w = _mm512_max_ps(_mm512_min_ps(w, maxValueV), minValueV);
+
+            _mm512_storeu_ps(vBase + i, v);
+            _mm512_storeu_ps(mBase + i, m);
+            _mm512_storeu_ps(wBase + i, w);
+            if (qBase) _mm512_storeu_ps(qBase + i, FakeQuantize(w, quantizationScale));
+        }
+    }
+#endif // USE_AVX512
 
 #ifdef USE_AVX
+    {
         const __m256 cOneMinusBeta1Vec = _mm256_set1_ps(1.0f - cBeta1);
         const __m256 cBeta1Vec = _mm256_set1_ps(cBeta1);
         const __m256 cOneMinusBeta2Vec = _mm256_set1_ps(1.0f - cBeta2);
         const __m256 cBeta2Vec = _mm256_set1_ps(cBeta2);
         const __m256 cEpsilonVec = _mm256_set1_ps(cEpsilon);
         const __m256 gradientScaleVec = _mm256_set1_ps(options.gradientScale);
-#endif
-
+        const __m256 minValueV = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_set1_ps(maxWeightValue));
+        const __m256 maxValueV = _mm256_set1_ps(maxWeightValue);
+        for (; i + 8 <= count; i += 8)
         {
-            const float maxWeightValue = inputIndex < m_inputSize ? m_weightsRange : m_biasRange;
+            __m256 g = _mm256_mul_ps(gradientScaleVec, _mm256_loadu_ps(gBase + i));
+            __m256 v = _mm256_loadu_ps(vBase + i);
+            __m256 m = _mm256_loadu_ps(mBase + i);
+            __m256 w = _mm256_loadu_ps(wBase + i);
+            const __m256 wMask = _mm256_loadu_ps(wMaskBase + i);
+
+            // update biased first moment estimate
+            m = _mm256_fmadd_ps(cOneMinusBeta1Vec, g, _mm256_mul_ps(cBeta1Vec, m));
+
+            // update biased second moment estimate
+            v = _mm256_fmadd_ps(cOneMinusBeta2Vec, _mm256_mul_ps(g, g), _mm256_mul_ps(cBeta2Vec, v));
+
+            // compute bias-corrected moment estimates
+            const __m256 m_hat = _mm256_mul_ps(m, _mm256_set1_ps(cBeta1Mult));
+            const __m256 v_hat = _mm256_mul_ps(v, _mm256_set1_ps(cBeta2Mult));
+
+            // compute final weight change
+            __m256 delta = _mm256_div_ps(m_hat, _mm256_add_ps(cEpsilonVec, _mm256_sqrt_ps(v_hat)));
+            delta = _mm256_fmadd_ps(w, _mm256_set1_ps(options.weightDecay), delta); // weight decay
+            delta = _mm256_mul_ps(wMask, delta);
+            w = _mm256_fnmadd_ps(delta, _mm256_set1_ps(options.learningRate), w);
+
+            // clamping
+            w = _mm256_min_ps(w, maxValueV);
+            w = _mm256_max_ps(w, minValueV);
+
+            _mm256_storeu_ps(vBase + i, v);
+            _mm256_storeu_ps(mBase + i, m);
+            _mm256_storeu_ps(wBase + i, w);
+            if (qBase) _mm256_storeu_ps(qBase + i, FakeQuantize(w, quantizationScale));
+        }
+    }
+#endif // USE_AVX
 
-            size_t i = 0;
+    for (; i < count; ++i)
+    {
+        float& m = mBase[i];
+        float& v = vBase[i];
+        float& w = wBase[i];
+        const float wMask = wMaskBase[i];
+        float g = options.gradientScale * gBase[i];
 
-#ifdef USE_AVX
-            const __m256 minValueV = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_set1_ps(maxWeightValue));
-            const __m256 maxValueV = _mm256_set1_ps(maxWeightValue);
-            for (; i + 8 <= m_outputSize; i += 8)
-            {
-                float* mPtr = variant.m_gradientMoment1.data() + inputIndex * m_outputSize + i;
-                float* vPtr = variant.m_gradientMoment2.data() + inputIndex * m_outputSize + i;
-                float* wPtr = variant.m_weights.data() + inputIndex * m_outputSize + i;
-                float* wMaskPtr = m_weightsMask.data() + inputIndex * m_outputSize + i;
-                const float* gPtr = gradientsVariant.m_values.data() + inputIndex * m_outputSize + i;
-
-                __m256 g = _mm256_mul_ps(gradientScaleVec, _mm256_load_ps(gPtr));
-                __m256 v = _mm256_load_ps(vPtr);
-                __m256 m = _mm256_load_ps(mPtr);
-                __m256 w = _mm256_load_ps(wPtr);
-                const __m256 wMask = _mm256_load_ps(wMaskPtr);
-
-                // update biased first moment estimate
-                m = _mm256_fmadd_ps(cOneMinusBeta1Vec, g, _mm256_mul_ps(cBeta1Vec, m));
-
-                // update biased second moment estimate
-                v = _mm256_fmadd_ps(cOneMinusBeta2Vec, _mm256_mul_ps(g, g), _mm256_mul_ps(cBeta2Vec, v));
-
-                // compute bias-corrected moment estimates
-                const __m256 m_hat = _mm256_mul_ps(m, _mm256_set1_ps(cBeta1Mult));
-                const __m256 v_hat = _mm256_mul_ps(v, _mm256_set1_ps(cBeta2Mult));
-
-                // compute final weight change
-                __m256 delta = _mm256_div_ps(m_hat, _mm256_add_ps(cEpsilonVec, _mm256_sqrt_ps(v_hat)));
-                delta = _mm256_fmadd_ps(w, _mm256_set1_ps(options.weightDecay), delta); // weight decay
-                delta = _mm256_mul_ps(wMask, delta);
-                w = _mm256_fnmadd_ps(delta, _mm256_set1_ps(options.learningRate), w);
-
-                // clamping
-                w = _mm256_min_ps(w, maxValueV);
-                w = _mm256_max_ps(w, minValueV);
-
-                _mm256_store_ps(vPtr, v);
-                _mm256_store_ps(mPtr, m);
-                _mm256_store_ps(wPtr, w);
-            }
-#endif // USE_AVX
+        ASSERT(!std::isnan(g));
+        ASSERT(v >= 0.0f);
 
-            for (; i < m_outputSize; ++i)
-            {
-                float& m = variant.m_gradientMoment1[inputIndex * m_outputSize + i];
-                float& v = variant.m_gradientMoment2[inputIndex * m_outputSize + i];
-                float& w = variant.m_weights[inputIndex * m_outputSize + i];
-                const float wMask = m_weightsMask[inputIndex * m_outputSize + i];
-                float g = options.gradientScale * gradientsVariant.m_values[inputIndex * m_outputSize + i];
+        // update biased first moment estimate
+        m = cBeta1 * m + (1.0f - cBeta1) * g;
+        ASSERT(!std::isnan(m));
 
-                ASSERT(!std::isnan(g));
-                ASSERT(v >= 0.0f);
+        // update biased second moment estimate
+        v = cBeta2 * v + (1.0f - cBeta2) * g * g;
+        ASSERT(!std::isnan(v));
 
-                // update biased first moment estimate
-                m = cBeta1 * m + (1.0f - cBeta1) * g;
-                ASSERT(!std::isnan(m));
+        // compute bias-corrected moment estimates
+        const float m_hat = m * cBeta1Mult;
+        const float v_hat = v * cBeta2Mult;
 
-                // update biased second moment estimate
-                v = cBeta2 * v + (1.0f - cBeta2) * g * g;
-                ASSERT(!std::isnan(v));
+        // compute final weight change
+        const float delta = options.learningRate * (m_hat / (cEpsilon + sqrtf(v_hat)) + w * options.weightDecay);
+        ASSERT(!std::isnan(delta));
 
-                // compute bias-corrected moment estimates
-                const float m_hat = m * cBeta1Mult;
-                const float v_hat = v * cBeta2Mult;
+        w -= wMask * delta;
+        ASSERT(!std::isnan(w));
 
-                // compute final weight change
-                const float delta = options.learningRate * (m_hat / (cEpsilon + sqrtf(v_hat)) + w * options.weightDecay);
-                ASSERT(!std::isnan(delta));
+        // clamping
+        w = std::clamp(w, -maxWeightValue, maxWeightValue);
 
-                w -= wMask * delta;
-                ASSERT(!std::isnan(w));
+        if (qBase) qBase[i] = FakeQuantize(w, quantizationScale);
+    }
+}
 
-                // clamping
-                w = std::clamp(w, -maxWeightValue, maxWeightValue);
-            }
+void WeightsStorage::Update_Adadelta(const Gradients& gradients, uint32_t beginIndex, uint32_t endIndex, const WeightsUpdateOptions& options)
+{
+    ASSERT(beginIndex <= endIndex);
+    ASSERT(endIndex <= m_inputSize + 1);
+    ASSERT(gradients.m_numInputs == m_inputSize);
+    ASSERT(gradients.m_numOutputs == m_outputSize);
+    ASSERT(gradients.m_variants.size() == m_variants.size());
+
+    // weights rows and bias row use different clamping ranges and quantization scales
+    const uint32_t weightsEndIndex = std::min(endIndex, m_inputSize);
+
+    for (size_t variantIndex = 0; variantIndex < m_variants.size(); ++variantIndex)
+    {
+        Variant& variant = m_variants[variantIndex];
+        const Gradients::Variant& gradientsVariant = gradients.m_variants[variantIndex];
+
+        ASSERT(gradientsVariant.m_values.size() == (m_inputSize + 1) * m_outputSize);
+
+        if (beginIndex < weightsEndIndex)
+        {
+            UpdateRange_Adadelta(variant, m_weightsMask.data(), gradientsVariant.m_values.data(),
+                                 (size_t)beginIndex * m_outputSize, (size_t)(weightsEndIndex - beginIndex) * m_outputSize, m_weightsRange, m_weightsQuantizationScale, options);
+        }
+
+        if (endIndex > m_inputSize)
+        {
+            UpdateRange_Adadelta(variant, m_weightsMask.data(), gradientsVariant.m_values.data(),
+                                 (size_t)m_inputSize * m_outputSize, m_outputSize, m_biasRange, m_biasQuantizationScale, options);
+        }
+    }
+}
+
+void WeightsStorage::Update_Adam(const Gradients& gradients, uint32_t beginIndex, uint32_t endIndex, const WeightsUpdateOptions& options)
+{
+    ASSERT(beginIndex <= endIndex);
+    ASSERT(endIndex <= m_inputSize + 1);
+    ASSERT(gradients.m_numInputs == m_inputSize);
+    ASSERT(gradients.m_numOutputs == m_outputSize);
+    ASSERT(gradients.m_variants.size() == m_variants.size());
+
+    // weights rows and bias row use different clamping ranges and quantization scales
+    const uint32_t weightsEndIndex = std::min(endIndex, m_inputSize);
+
+    for (size_t variantIndex = 0; variantIndex < m_variants.size(); ++variantIndex)
+    {
+        Variant& variant = m_variants[variantIndex];
+        const Gradients::Variant& gradientsVariant = gradients.m_variants[variantIndex];
+
+        ASSERT(gradientsVariant.m_values.size() == (m_inputSize + 1) * m_outputSize);
+
+        if (beginIndex < weightsEndIndex)
+        {
+            UpdateRange_Adam(variant, m_weightsMask.data(), gradientsVariant.m_values.data(),
+                             (size_t)beginIndex * m_outputSize, (size_t)(weightsEndIndex - beginIndex) * m_outputSize, m_weightsRange, m_weightsQuantizationScale, options);
+        }
+
+        if (endIndex > m_inputSize)
+        {
+            UpdateRange_Adam(variant, m_weightsMask.data(), gradientsVariant.m_values.data(),
+                             (size_t)m_inputSize * m_outputSize, m_outputSize, m_biasRange, m_biasQuantizationScale, options);
         }
     }
 }
@@ -15,6 +15,15 @@ public:
 
     void PrintStats() const;
 
+    // Quantization-aware training: forward pass uses weights rounded to the precision of the packed network
+    // (fake quantization), while updates are applied to full-precision weights (straight-through estimator).
+    void EnableQuantization(float weightsScale, float biasScale);
+
+    // recalculate quantized weights, must be called after full-precision weights were modified directly
+    void UpdateQuantizedWeights();
+
+    bool IsQuantized() const { return m_weightsQuantizationScale > 0.0f; }
+
     struct WeightsUpdateOptions
     {
         float learningRate = 1.0f;
@@ -23,8 +32,9 @@ public:
         size_t iteration = 0;
     };
 
-    void Update_Adadelta(const Gradients& gradients, uint32_t inputIndex, const WeightsUpdateOptions& options);
-    void Update_Adam(const Gradients& gradients, uint32_t inputIndex, const WeightsUpdateOptions& options);
+    // update weights of input rows [beginIndex, endIndex), row 'm_inputSize' holds biases
+    void Update_Adadelta(const Gradients& gradients, uint32_t beginIndex, uint32_t endIndex, const WeightsUpdateOptions& options);
+    void Update_Adam(const Gradients& gradients, uint32_t beginIndex, uint32_t endIndex, const WeightsUpdateOptions& options);
 
     uint32_t m_inputSize = 0;
     uint32_t m_outputSize = 0;
@@ -36,10 +46,20 @@ public:
     float m_weightsRange = 10.0f;
     float m_biasRange = 10.0f;
 
+    // zero if quantization-aware training is disabled
+    float m_weightsQuantizationScale = 0.0f;
+    float m_biasQuantizationScale = 0.0f;
+
     struct Variant
     {
         Values m_weights;
 
+        // fake quantized weights (only when quantization-aware training is enabled)
+        Values m_quantizedWeights;
+
+        // weights used in forward pass
+        const Values& GetRunWeights() const { return m_quantizedWeights.empty() ? m_weights : m_quantizedWeights; }
+
         // used for learning
         Values m_gradientMoment1;
         Values m_gradientMoment2;